@@ -0,0 +1,101 @@
+#pragma once
+
+// C++ STL headers.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @brief Arena class.
+ *
+ * Linear allocator for temporaries that die together. An allocation bumps
+ * a pointer in the current block and a new, larger block is taken from the
+ * heap when it runs out. Deallocation does nothing; Reset() releases
+ * everything at once and keeps a single block sized to the high-water
+ * mark, so a repeated workload stops touching the heap after its first run.
+ *
+ * Containers use it through std::pmr, e.g.
+ * std::pmr::vector<glm::vec3> positions(&arena).
+ *
+ * @note Not thread-safe: use one arena per thread.
+*/
+class Arena : public std::pmr::memory_resource
+{
+public:
+	// Arena Public Methods.
+	Arena(const size_t initialBlockSize = 64 * 1024);
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	/**
+	 * @brief Release every allocation. Memory obtained from the arena must not be used afterwards.
+	*/
+	void Reset();
+
+	/**
+	 * @brief Allocations served since the last Reset().
+	*/
+	size_t GetNumAllocations() const { return numAllocations; }
+	size_t GetBytesAllocated() const { return bytesAllocated; }
+
+	/**
+	 * @brief Heap blocks held by the arena, i.e. the heap allocations behind GetNumAllocations().
+	*/
+	size_t GetNumBlocks() const { return blocks.size(); }
+	size_t GetCapacity() const;
+
+private:
+	// Arena Private Methods.
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void*, size_t, size_t) override {}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+	void AddBlock(const size_t minSize);
+	void ReleaseBlocks();
+
+	// Arena Private Declarations.
+	struct Block {
+		std::byte* data;
+		size_t size;
+	};
+
+	// Arena Private Data.
+	std::vector<Block> blocks;
+	std::byte* cursor;
+	std::byte* limit;
+	size_t nextBlockSize;
+	size_t numAllocations;
+	size_t bytesAllocated;
+};
+
+/**
+ * @brief FrameArena class.
+ *
+ * Per-thread scratch memory that lives for one frame. Each thread gets its
+ * own arena, so allocation needs no lock; an arena is reset the first time
+ * its thread asks for it in a new frame, so nothing allocated during the
+ * current frame is ever released under a job still using it.
+ *
+ * @note Only for data that does not outlive the frame: jobs that can span
+ * frames (loaders, the prefetcher) must use their own Arena.
+*/
+class FrameArena
+{
+public:
+	/**
+	 * @brief Start a new frame. Called once per frame on the GL thread.
+	*/
+	static void BeginFrame();
+
+	/**
+	 * @brief Get the scratch arena of the calling thread for the current frame.
+	*/
+	static Arena& Get();
+
+private:
+	static std::atomic<uint64_t> frameIndex;
+};
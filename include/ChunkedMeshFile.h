@@ -0,0 +1,101 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// C++ STL headers.
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Project headers.
+#include "MappedFile.h"
+
+/**
+ * @brief Header of a chunked mesh file, at offset 0.
+*/
+struct ChunkedMeshHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t numChunks;
+	uint32_t vertexBytes;		// 12 with positions only, 24 with normals after them.
+	float boundsMin[3];
+	float boundsMax[3];
+	uint64_t numVertices;		// Summed over the chunks; vertices on chunk borders count once per chunk.
+	uint64_t numTriangles;
+	uint64_t chunkTableOffset;
+	uint64_t proxyOffset;		// Proxy vertices, then their indices.
+	uint32_t numProxyVertices;
+	uint32_t numProxyIndices;
+};
+
+/**
+ * @brief One chunk of a chunked mesh file: its vertices, then its indices.
+*/
+struct MeshChunk
+{
+	float boundsMin[3];
+	float boundsMax[3];
+	uint64_t offset;
+	uint32_t numVertices;
+	uint32_t numIndices;		// Local to the chunk vertices.
+	uint32_t proxyFirstIndex;	// The coarse stand-in of the chunk, in the proxy indices.
+	uint32_t proxyNumIndices;
+};
+
+/**
+ * @brief ChunkedMeshFile class.
+ *
+ * A mesh split offline into spatially coherent chunks of at most a few
+ * tens of thousands of triangles, with their bounds, for meshes too large
+ * to hold in memory. The file is read through a memory mapping, so a
+ * viewer only touches the pages of the chunks it uploads. Every chunk also
+ * has a coarse proxy, made by vertex clustering; the proxies of all the
+ * chunks are stored together and are small enough to stay resident.
+ *
+ * Chunk data is 4-byte aligned and ready to upload as it is: vertices with
+ * vertexBytes each, then 32-bit indices local to the chunk. Proxy indices
+ * refer to the proxy vertices as a whole.
+*/
+class ChunkedMeshFile
+{
+public:
+	// ChunkedMeshFile Public Methods.
+	/**
+	 * @brief Map and validate a file.
+	 *
+	 * @return false if the file is not a usable chunked mesh; the reason goes to std::cerr.
+	*/
+	bool Open(const std::filesystem::path& filePath);
+
+	const ChunkedMeshHeader& GetHeader() const { return *header; }
+	const MeshChunk* GetChunks() const { return chunks; }
+	uint32_t GetNumChunks() const { return header->numChunks; }
+	const uint8_t* GetFileData() const { return file.GetData(); }
+	size_t GetFileBytes() const { return file.GetSize(); }
+	const MappedFile& GetMappedFile() const { return file; }
+
+	size_t GetChunkBytes(const MeshChunk& chunk) const {
+		return (size_t)chunk.numVertices * header->vertexBytes + (size_t)chunk.numIndices * sizeof(uint32_t);
+	}
+	size_t GetProxyBytes() const {
+		return (size_t)header->numProxyVertices * header->vertexBytes + (size_t)header->numProxyIndices * sizeof(uint32_t);
+	}
+
+	/**
+	 * @brief Split a binary PLY mesh into a chunked mesh file.
+	 *
+	 * The source is streamed and sorted into chunks through temporary files
+	 * next to the output, so the host memory used does not grow with the mesh.
+	 *
+	 * @return false if the source cannot be read or the output written.
+	*/
+	static bool Build(const std::filesystem::path& plyFilePath, const std::filesystem::path& outputFilePath);
+
+private:
+	// ChunkedMeshFile Private Data.
+	MappedFile file;
+	const ChunkedMeshHeader* header = nullptr;
+	const MeshChunk* chunks = nullptr;
+};
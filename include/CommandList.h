@@ -0,0 +1,169 @@
+#pragma once
+
+// C++ STL headers.
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// OpenGL headers.
+#include <GL/glew.h>
+
+// CommandType Declarations.
+enum class CommandType : uint32_t
+{
+	BIND_PROGRAM,
+	UNIFORM_MAT4,
+	UNIFORM_VEC3,
+	UNIFORM_1I,
+	UNIFORM_1F,
+	BIND_TEXTURE,
+	VERTEX_ATTRIB,
+	DISABLE_VERTEX_ATTRIBS,
+	DRAW_ELEMENTS,
+	DRAW_ARRAYS,
+	BUFFER_SUB_DATA,
+	BIND_BUFFER_BASE
+};
+
+/**
+ * @brief CommandList class.
+ *
+ * Linear buffer of GL commands recorded on any thread and executed later
+ * on the GL thread. Commands and their data (including buffer update
+ * contents) are copied into one contiguous allocation, which is kept
+ * across Reset() so a list reused every frame stops allocating.
+ *
+ * @note Only the recording thread may touch the list until it has been
+ * submitted and replayed.
+*/
+class CommandList
+{
+public:
+	// CommandList Public Methods.
+	CommandList(const size_t initialCapacity = 16 * 1024);
+	~CommandList();
+
+	/**
+	 * @brief Clear the commands and set the replay order of the list.
+	*/
+	void Reset(const uint64_t sortKey);
+
+	void BindProgram(const GLuint program);
+	void SetUniform(const GLint location, const glm::mat4& value);
+	void SetUniform(const GLint location, const glm::vec3& value);
+	void SetUniform(const GLint location, const GLint value);
+	void SetUniform(const GLint location, const GLfloat value);
+	void BindTexture(const GLenum textureUnit, const GLenum target, const GLuint texture);
+
+	/**
+	 * @brief Bind a vertex buffer, enable the attribute and set its pointer.
+	*/
+	void SetVertexAttrib(const GLuint index, const GLuint buffer, const GLint size, const GLsizei stride, const size_t offset,
+		const GLenum type = GL_FLOAT, const GLboolean normalized = GL_FALSE);
+	void DisableVertexAttribs(const uint32_t attribMask);
+
+	/**
+	 * @brief Draw indexed; firstIndex counts indices of indexType, not bytes.
+	*/
+	void DrawElements(const GLenum mode, const GLuint indexBuffer, const GLsizei count, const size_t firstIndex = 0,
+		const GLenum indexType = GL_UNSIGNED_INT);
+	void DrawArrays(const GLenum mode, const GLint first, const GLsizei count);
+
+	/**
+	 * @brief Update part of a buffer; the data is copied into the list.
+	*/
+	void BufferSubData(const GLenum target, const GLuint buffer, const GLintptr offset, const void* data, const GLsizeiptr size);
+	void BindBufferBase(const GLenum target, const GLuint index, const GLuint buffer);
+
+	/**
+	 * @brief Issue the recorded commands. GL thread only.
+	*/
+	void Execute() const;
+
+	uint64_t GetSortKey() const { return sortKey; }
+	uint32_t GetNumCommands() const { return numCommands; }
+
+private:
+	friend class CommandQueue;
+
+	// CommandList Private Methods.
+	void* Append(const CommandType type, const size_t payloadBytes);
+
+	// CommandList Private Data.
+	std::vector<uint8_t> buffer;
+	size_t used;
+	uint32_t numCommands;
+	uint64_t sortKey;
+	std::atomic<CommandList*> queueNext;
+};
+
+/**
+ * @brief CommandQueue class.
+ *
+ * Lock-free multi-producer, single-consumer queue of finished command
+ * lists. Any thread can submit; the GL thread replays everything that was
+ * submitted, ordered by sort key so the result does not depend on which
+ * worker finished first.
+ *
+ * The queue also owns the lists recorded for it: Acquire() hands out a
+ * list for one frame, so an object drawn at several places in a frame
+ * records each of them into its own list instead of overwriting one.
+*/
+class CommandQueue
+{
+public:
+	// CommandQueue Public Methods.
+	CommandQueue();
+	~CommandQueue();
+
+	/**
+	 * @brief Get an empty list to record into until the next Replay(). Safe to call from any thread.
+	 *
+	 * @note The lists are reused after Replay(), so a list must not be kept across it.
+	*/
+	CommandList* Acquire(const uint64_t sortKey);
+
+	/**
+	 * @brief Hand a finished list to the GL thread. Safe to call from any thread.
+	 *
+	 * @note A list may be submitted once per Replay().
+	*/
+	void Submit(CommandList* list);
+
+	/**
+	 * @brief Execute every submitted list in sort key order. GL thread only.
+	 *
+	 * @note Submissions must have completed, e.g. by waiting for the
+	 * recording jobs, or a list still being pushed is left for the next call.
+	*/
+	void Replay();
+
+	/**
+	 * @brief Take every submitted list in sort key order without executing it,
+	 * and recycle the acquired lists as Replay() does. Consumer thread only.
+	*/
+	const std::vector<CommandList*>& Collect();
+
+	uint32_t GetNumReplayedLists() const { return numReplayedLists; }
+	uint32_t GetNumReplayedCommands() const { return numReplayedCommands; }
+
+private:
+	// CommandQueue Private Methods.
+	CommandList* Pop();
+
+	// CommandQueue Private Data.
+	alignas(64) std::atomic<CommandList*> head;
+	alignas(64) CommandList* tail;
+	CommandList stub;
+	std::vector<CommandList*> pending;
+	std::mutex poolMutex;
+	std::vector<std::unique_ptr<CommandList>> pool;	// Kept across frames, so recording stops allocating.
+	size_t numAcquired;
+	uint32_t numReplayedLists;
+	uint32_t numReplayedCommands;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// C++ STL headers.
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Project headers.
+#include "MappedFile.h"
+
+// Levels of detail of a cooked mesh, the full mesh included.
+static constexpr int COOKED_MESH_MAX_LODS = 4;
+
+/**
+ * @brief Header of a cooked mesh file, at offset 0.
+*/
+struct CookedMeshHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t numVertices;
+	uint32_t numIndices;		// Of every level of every submesh.
+	uint32_t numSubMeshes;
+	uint32_t numLods;
+	uint32_t vertexBytes;		// 16 with texcoords in [0, 1] as unsigned shorts, 20 with them as floats.
+	uint32_t indexBytes;		// 2 or 4.
+	float boundsMin[3];			// Positions are quantized over the cube at boundsMin with side scale.
+	float boundsMax[3];
+	float scale;
+	float lodErrors[COOKED_MESH_MAX_LODS];	// Largest position error of each level, as a fraction of scale.
+	uint64_t numTriangles;		// Of the full mesh.
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t subMeshTableOffset;
+	uint64_t stringOffset;		// NUL-terminated: the material libraries, then the material of every submesh.
+	uint32_t stringBytes;
+	uint32_t numMaterialLibraries;
+};
+
+/**
+ * @brief One vertex as stored and uploaded. The texcoord is two more floats
+ * instead when the header says 20 bytes.
+*/
+struct CookedVertex
+{
+	uint16_t position[3];		// Normalized over the quantization cube.
+	uint16_t padding;
+	uint32_t normal;			// Signed normalized 10:10:10:2, x in the low bits.
+	uint16_t texcoord[2];		// Normalized.
+};
+
+/**
+ * @brief One submesh of a cooked mesh: a range of the indices per level of detail.
+*/
+struct CookedSubMesh
+{
+	uint32_t firstIndex[COOKED_MESH_MAX_LODS];
+	uint32_t numIndices[COOKED_MESH_MAX_LODS];
+};
+
+/**
+ * @brief CookedMeshFile class.
+ *
+ * An OBJ model cooked offline by model_cook into what the viewer uploads:
+ * vertices welded and quantized to 16 or 20 bytes, triangles reordered
+ * for the post-transform vertex cache and vertices for fetch locality,
+ * and coarser levels of detail made by vertex clustering that reuse the
+ * vertices of the full mesh. Materials stay in the MTL files, which are
+ * small and read at load time. The file is read through a memory mapping
+ * and its vertices and indices are uploaded from it as they are.
+*/
+class CookedMeshFile
+{
+public:
+	// CookedMeshFile Public Methods.
+	/**
+	 * @brief Map and validate a file.
+	 *
+	 * @return false if the file is not a usable cooked mesh; the reason goes to std::cerr.
+	*/
+	bool Open(const std::filesystem::path& filePath);
+
+	const CookedMeshHeader& GetHeader() const { return *header; }
+	const CookedSubMesh* GetSubMeshes() const { return subMeshes; }
+	const uint8_t* GetFileData() const { return file.GetData(); }
+	size_t GetFileBytes() const { return file.GetSize(); }
+	size_t GetVertexDataBytes() const { return (size_t)header->numVertices * header->vertexBytes; }
+	size_t GetIndexDataBytes() const { return (size_t)header->numIndices * header->indexBytes; }
+
+	const std::vector<std::string>& GetMaterialLibraries() const { return materialLibraries; }
+	const std::string& GetMaterialName(const uint32_t subMesh) const { return materialNames[subMesh]; }
+
+	/**
+	 * @brief Cook an OBJ model into a cooked mesh file.
+	 *
+	 * @return false if the source cannot be read or has no faces, or the output cannot be written.
+	*/
+	static bool Build(const std::filesystem::path& objFilePath, const std::filesystem::path& outputFilePath);
+
+private:
+	// CookedMeshFile Private Data.
+	MappedFile file;
+	const CookedMeshHeader* header = nullptr;
+	const CookedSubMesh* subMeshes = nullptr;
+	std::vector<std::string> materialLibraries;		// File names relative to the cooked mesh.
+	std::vector<std::string> materialNames;			// Empty for faces before any usemtl.
+};
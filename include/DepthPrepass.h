@@ -0,0 +1,75 @@
+#pragma once
+
+// OpenGL headers.
+#include <GL/glew.h>
+
+/**
+ * @brief DepthPrepass class.
+ *
+ * Decides per mesh whether to lay down depth before shading. The overdraw
+ * ratio is measured with occlusion queries around the shading pass: samples
+ * shaded without a pre-pass divided by samples shaded with one (the visible
+ * samples). The pre-pass is kept on while the ratio is above the threshold,
+ * and the measurement is repeated periodically since the view changes.
+ *
+ * Fragment shader invocations are also counted when
+ * ARB_pipeline_statistics_query is available.
+*/
+class DepthPrepass
+{
+public:
+	// DepthPrepass Public Methods.
+	DepthPrepass(const float overdrawThreshold = 1.5f, const int remeasureFrames = 300);
+	~DepthPrepass();
+
+	/**
+	 * @brief Measure again from scratch, e.g. after the mesh changed.
+	*/
+	void Reset();
+
+	/**
+	 * @brief Whether this frame should render the depth pre-pass.
+	*/
+	bool BeginFrame();
+
+	/**
+	 * @brief Set the state for the depth-only pass.
+	*/
+	void BeginDepthPass();
+
+	/**
+	 * @brief Set the state for the shading pass and start counting samples.
+	*/
+	void BeginShadingPass();
+
+	/**
+	 * @brief Stop counting and restore the default depth state.
+	*/
+	void EndShadingPass();
+
+	bool IsEnabled() const { return enabled; }
+	float GetOverdrawRatio() const { return overdrawRatio; }
+
+private:
+	// DepthPrepass Private Methods.
+	void CollectResults();
+
+	// DepthPrepass Private Data.
+	enum class Phase { MeasureWithout, MeasureWith, Idle };
+
+	float overdrawThreshold;
+	int remeasureFrames;
+	int framesSinceMeasure;
+	bool enabled;
+	bool prepassThisFrame;
+	float overdrawRatio;
+
+	Phase phase;
+	bool queryInFlight;
+	bool queryThisFrame;
+	bool hasStatistics;
+	GLuint samplesQuery;
+	GLuint invocationsQuery;
+	GLuint64 samplesWithout;
+	GLuint64 invocationsWithout;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+// C++ STL headers.
+#include <deque>
+#include <memory>
+
+// OpenGL headers.
+#include <GL/glew.h>
+
+// Project headers.
+#include "FullscreenTriangle.h"
+#include "ShaderProg.h"
+
+/**
+ * @brief DynamicResolution class.
+ *
+ * Renders the scene into an offscreen multisampled target whose resolution
+ * scale follows the measured GPU frame time, then upscales it to the window.
+ * The targets are allocated at window size and the scene only uses the
+ * lower-left scaled region, so changing the scale never reallocates.
+ *
+ * The scale only moves when the smoothed frame time leaves a band around
+ * the target, and waits a few frames after each change to avoid oscillation.
+*/
+class DynamicResolution
+{
+public:
+	// DynamicResolution Public Methods.
+	DynamicResolution(const int width, const int height, const float targetFrameTimeMs = 16.6f);
+	~DynamicResolution();
+
+	void Resize(const int width, const int height);
+	void SetTargetFrameTime(const float targetFrameTimeMs) { targetMs = targetFrameTimeMs; }
+
+	/**
+	 * @brief Bind the offscreen target at the current scale and start timing.
+	*/
+	void BeginFrame();
+
+	/**
+	 * @brief Stop timing, resolve and upscale to the default framebuffer.
+	*/
+	void EndFrame(const std::shared_ptr<UpscaleShaderProg>& shader);
+
+	float GetScale() const { return scale; }
+	float GetTargetFrameTime() const { return targetMs; }
+	float GetSmoothedFrameTime() const { return smoothedMs; }
+	const std::deque<float>& GetFrameTimeHistory() const { return frameTimeHistory; }
+
+	static constexpr float MIN_SCALE = 0.5f;
+	static constexpr float MAX_SCALE = 1.0f;
+	static constexpr size_t HISTORY_SIZE = 120;
+
+private:
+	// DynamicResolution Private Methods.
+	void CreateTargets();
+	void ReleaseTargets();
+	void CollectFrameTime();
+	void UpdateScale(const float frameTimeMs);
+
+	// DynamicResolution Private Data.
+	static constexpr int NUM_QUERIES = 4;
+
+	int width;
+	int height;
+	int renderWidth;
+	int renderHeight;
+	int numSamples;
+	float scale;
+	float targetMs;
+	float smoothedMs;
+	int framesSinceChange;
+	std::deque<float> frameTimeHistory;
+
+	GLuint msFboId;
+	GLuint msColorRboId;
+	GLuint msDepthRboId;
+	GLuint resolveFboId;
+	GLuint resolveTexId;
+
+	GLuint timerQueries[NUM_QUERIES];
+	int numFrames;
+
+	FullscreenTriangle triangle;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+// FullscreenTriangle Declarations.
+// One triangle covering the viewport, clip-space positions on attribute 0.
+class FullscreenTriangle
+{
+public:
+	// FullscreenTriangle Public Methods.
+	FullscreenTriangle() {
+		const glm::vec2 vertices[3] = {
+			glm::vec2(-1.0f, -1.0f),
+			glm::vec2(3.0f, -1.0f),
+			glm::vec2(-1.0f, 3.0f),
+		};
+		glGenBuffers(1, &vboId);
+		glBindBuffer(GL_ARRAY_BUFFER, vboId);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	}
+	~FullscreenTriangle() {
+		glDeleteBuffers(1, &vboId);
+	}
+
+	void Draw() {
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, vboId);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), 0);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glDisableVertexAttribArray(0);
+	}
+
+private:
+	// FullscreenTriangle Private Data.
+	GLuint vboId;
+};
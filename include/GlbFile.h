@@ -0,0 +1,122 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// OpenGL headers.
+#include <GL/glew.h>
+
+// C++ STL headers.
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Project headers.
+#include "MappedFile.h"
+
+/**
+ * @brief Where one vertex attribute lives in a vertex buffer, in the terms of glVertexAttribPointer.
+*/
+struct VertexStream
+{
+	GLint size = 0;			// Components; 0 when the attribute is absent.
+	GLenum type = GL_FLOAT;
+	GLboolean normalized = GL_FALSE;
+	GLsizei stride = 0;
+	size_t offset = 0;		// Bytes from the start of the buffer.
+};
+
+/**
+ * @brief One triangle primitive of a mesh instance, ready to draw from the binary chunk.
+*/
+struct GlbPrimitive
+{
+	VertexStream position;
+	VertexStream normal;
+	VertexStream texcoord;
+	GLenum indexType = 0;		// 0 without indices.
+	size_t indexOffset = 0;		// Bytes from the start of the binary chunk.
+	size_t numIndices = 0;		// Vertices drawn, with or without indices.
+	size_t numVertices = 0;
+	int material = -1;
+	glm::mat4 matrix = glm::mat4(1.0f);		// Node transform down from the scene root.
+	glm::vec3 boundsMin = glm::vec3(0.0f);	// Of the positions, before the node transform.
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+/**
+ * @brief Metallic-roughness material, with its base color map.
+*/
+struct GlbMaterial
+{
+	std::string name;
+	glm::vec4 baseColor = glm::vec4(1.0f);
+	float metallic = 1.0f;
+	float roughness = 1.0f;
+	int baseColorImage = -1;
+};
+
+/**
+ * @brief An image embedded in the binary chunk, or a file next to the model.
+*/
+struct GlbImage
+{
+	std::string name;
+	size_t offset = 0;		// In the binary chunk, when bytes > 0.
+	size_t bytes = 0;
+	std::filesystem::path filePath;		// When the image is not embedded.
+};
+
+/**
+ * @brief GlbFile class.
+ *
+ * Reads a binary glTF 2.0 file through a memory mapping. Open() parses
+ * the JSON chunk and checks every accessor the primitives use against
+ * its buffer view and the binary chunk, including the index values, so
+ * the vertex and index data can be handed to GL in place without any
+ * further checks or conversion.
+ *
+ * Only triangle lists stored in the binary chunk are kept; other
+ * primitives, sparse accessors and external buffers are skipped with a
+ * warning.
+*/
+class GlbFile
+{
+public:
+	// GlbFile Public Methods.
+	/**
+	 * @brief Map, parse and validate a file.
+	 *
+	 * @return false if the file is not a usable GLB; the reason goes to std::cerr.
+	*/
+	bool Open(const std::filesystem::path& filePath);
+
+	const uint8_t* GetBinary() const { return binary; }
+	size_t GetBinaryBytes() const { return binaryBytes; }
+	const uint8_t* GetFileData() const { return file.GetData(); }
+	size_t GetFileBytes() const { return file.GetSize(); }
+
+	const std::vector<GlbPrimitive>& GetPrimitives() const { return primitives; }
+	const std::vector<GlbMaterial>& GetMaterials() const { return materials; }
+	const std::vector<GlbImage>& GetImages() const { return images; }
+
+	/**
+	 * @brief Read back a position or an index, e.g. to build missing normals.
+	*/
+	glm::vec3 ReadPosition(const GlbPrimitive& primitive, const size_t vertex) const;
+	uint32_t ReadIndex(const GlbPrimitive& primitive, const size_t index) const;
+
+private:
+	// GlbFile Private Data.
+	std::filesystem::path filePath;
+	MappedFile file;
+	const uint8_t* binary = nullptr;
+	size_t binaryBytes = 0;
+	std::vector<GlbPrimitive> primitives;
+	std::vector<GlbMaterial> materials;
+	std::vector<GlbImage> images;
+
+	friend class GlbParser;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace opengl_homework {
+
+static constexpr uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ull;
+
+/**
+ * @brief 64-bit FNV-1a hash, used as the key of the on-disk caches.
+ *
+ * @param seed Hash of the preceding data, to hash several buffers as one.
+*/
+inline uint64_t HashBytes(const void* data, const size_t size, uint64_t seed = FNV1A_OFFSET_BASIS) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		seed ^= bytes[i];
+		seed *= 1099511628211ull;
+	}
+	return seed;
+}
+
+inline uint64_t HashBytes(const std::string& data, uint64_t seed = FNV1A_OFFSET_BASIS) {
+	return HashBytes(data.data(), data.size(), seed);
+}
+
+}
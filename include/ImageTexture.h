@@ -3,6 +3,7 @@
 // C++ STL headers.
 #include <string>
 #include <filesystem>
+#include <vector>
 
 // OpenCV headers.
 #include <opencv2/opencv.hpp>
@@ -10,24 +11,71 @@
 // OpenGL headers.
 #include <GL/glew.h>
 
+// Project headers.
+#include "MipChainFile.h"
+#include "ResourcePool.h"
+#include "TextureResidency.h"
+
 // Texture Declarations.
-class ImageTexture
+class ImageTexture : public StreamableTexture
 {
 public:
 	// Texture Public Methods.
-	ImageTexture(const std::filesystem::path& texImagePath);
+	/**
+	 * @brief Decode the image into host memory.
+	 *
+	 * @note No GL call is made here, so textures can be decoded on a worker thread,
+	 * along with the mip chain. A chain cooked next to the image is mapped
+	 * instead. Call Upload() on the GL thread before binding.
+	 * Images are flipped to the OpenGL convention unless flipVertically is
+	 * false, as for glTF, whose texture coordinates start at the top.
+	*/
+	ImageTexture(const std::filesystem::path& texImagePath, const bool flipVertically = true);
+
+	/**
+	 * @brief Decode an image held in memory, e.g. one embedded in a model file.
+	 *
+	 * @param name Shown in messages and returned by GetTexFilePath().
+	*/
+	ImageTexture(const std::filesystem::path& name, const uint8_t* encoded, const size_t bytes, const bool flipVertically);
 	~ImageTexture();
 
+	/**
+	 * @brief Create the texture with its coarse mip levels and hand it to
+	 * TextureResidency, which streams in the finer levels it needs. The
+	 * texture can be bound right away.
+	*/
+	void Upload();
 	void Bind(GLenum textureUnit);
 	void Preview();
 	std::filesystem::path GetTexFilePath() const { return texFilePath; }
+	GLuint GetTextureId() const { return textureObj; }
+	const cv::Mat& GetImage() const { return texImage; }
+	size_t GetHostMemoryBytes() const;
+
+	// StreamableTexture Methods.
+	int GetWidth() const override { return imageWidth; }
+	int GetHeight() const override { return imageHeight; }
+	int GetNumLevels() const override { return (int)mipLevels.size(); }
+	size_t GetLevelBytes(const int level) const override;
+	int GetResidentLevel() const override { return residentLevel; }
+	void SetResidentLevel(const int level) override;
 
 private:
+	// Texture Private Methods.
+	void SetImage(const cv::Mat& image, const bool flipVertically);
+	void CreateTexture();
+
 	// Texture Private Data.
 	std::filesystem::path texFilePath;
 	GLuint textureObj;
 	int imageWidth;
 	int imageHeight;
 	int numChannels;
+	int residentLevel;	// Host level stored as GL level 0.
 	cv::Mat texImage;
+	std::vector<cv::Mat> mipLevels;	// Level 0 shares its data with texImage.
+	MipChainFile mipFile;			// Holds the levels when they were cooked.
 };
+
+using TextureHandle = Handle<ImageTexture>;
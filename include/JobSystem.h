@@ -0,0 +1,132 @@
+#pragma once
+
+// C++ STL headers.
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+struct Job;
+
+/**
+ * @brief Reference to a scheduled job, used to wait for it or to attach children to it.
+*/
+class JobHandle
+{
+public:
+	JobHandle() = default;
+	JobHandle(const JobHandle& other);
+	JobHandle(JobHandle&& other) noexcept;
+	JobHandle& operator=(JobHandle other) noexcept;
+	~JobHandle();
+
+	bool IsValid() const { return job != nullptr; }
+
+	/**
+	 * @brief Whether the job and all of its children have finished.
+	*/
+	bool IsDone() const;
+
+private:
+	friend class JobSystem;
+	explicit JobHandle(Job* job) : job(job) {}
+
+	Job* job = nullptr;
+};
+
+/**
+ * @brief JobSystem class.
+ *
+ * Work-stealing thread pool shared by the loaders and the per-frame CPU
+ * work. Each worker pushes and pops jobs at the bottom of its own
+ * lock-free deque while idle workers steal from the top of the others.
+ * Jobs scheduled from threads outside the pool go through a shared queue.
+ *
+ * A job counts as finished once it and every child attached to it have
+ * run, so a parent can be waited on for a whole tree of work. Waiting
+ * never blocks a thread that could help: Wait() runs other jobs until
+ * the awaited one is done.
+ *
+ * GL work must stay on the thread that created the context; it is posted
+ * to the main-thread queue, which runs only at the start of every frame,
+ * so GL state never changes under a pass that waits for a job mid-frame.
+ *
+ * @note The first call to GetInstance() must be made on the main thread.
+*/
+class JobSystem
+{
+public:
+	using JobFunction = std::function<void()>;
+
+	/**
+	 * @brief Get the process-wide job system, starting it on first use.
+	*/
+	static JobSystem& GetInstance();
+
+	~JobSystem();
+
+	/**
+	 * @brief Schedule a job.
+	 *
+	 * @param parent Optional job that is not finished until this one is.
+	 * The parent must not have finished yet, e.g. call this from the
+	 * parent's own function.
+	*/
+	JobHandle Schedule(JobFunction function, const JobHandle& parent = JobHandle());
+
+	/**
+	 * @brief Run other jobs until the given one has finished.
+	 *
+	 * @note Main-thread jobs are not run here, so the awaited job must not
+	 * depend on one.
+	*/
+	void Wait(const JobHandle& handle);
+
+	/**
+	 * @brief Run other jobs until every scheduled job has run, e.g. before
+	 * shutting down what the jobs use.
+	 *
+	 * @note Main-thread jobs are not run, as in Wait(). Jobs scheduled
+	 * meanwhile are waited for too, so stop whatever schedules them first.
+	*/
+	void WaitForAll();
+
+	/**
+	 * @brief Split [0, count) into chunks of at least grainSize and run them in parallel.
+	 *
+	 * The calling thread runs chunks as well, and the call returns once all
+	 * of them have finished.
+	 *
+	 * @param function Called as function(begin, end) for each chunk.
+	*/
+	template<typename F>
+	void ParallelFor(const size_t count, const size_t grainSize, F&& function) {
+		ParallelForImpl(count, grainSize, std::function<void(size_t, size_t)>(std::forward<F>(function)));
+	}
+
+	/**
+	 * @brief Queue a job that needs the GL context.
+	*/
+	void PostToMainThread(JobFunction function);
+
+	/**
+	 * @brief Run the queued main-thread jobs.
+	 *
+	 * @note Call it on the main thread at the frame boundary only.
+	 * @return Whether any job was run.
+	*/
+	bool RunMainThreadJobs();
+
+	bool HasMainThreadJobs() const;
+	int GetNumWorkers() const;
+
+private:
+	// JobSystem Private Methods.
+	JobSystem();
+
+	void ParallelForImpl(const size_t count, const size_t grainSize, std::function<void(size_t, size_t)> function);
+	void WorkerLoop(const int workerIndex);
+
+	// JobSystem Private Data.
+	struct Impl;
+	std::unique_ptr<Impl> pImpl;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+// C++ STL headers.
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A parsed JSON value.
+ *
+ * Just enough JSON for the model formats: objects keep their members in
+ * file order and are searched linearly, which is fine for the small
+ * documents they carry.
+*/
+class JsonValue
+{
+public:
+	enum class Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+	/**
+	 * @brief Parse a whole document.
+	 *
+	 * @return false on a syntax error, with a message in error.
+	*/
+	static bool Parse(std::string_view text, JsonValue& value, std::string& error);
+
+	Type GetType() const { return type; }
+	bool IsNumber() const { return type == Type::NUMBER; }
+	bool IsString() const { return type == Type::STRING; }
+	bool IsArray() const { return type == Type::ARRAY; }
+	bool IsObject() const { return type == Type::OBJECT; }
+
+	/**
+	 * @brief Member of an object, or nullptr if it is missing or this is not an object.
+	*/
+	const JsonValue* Find(std::string_view key) const;
+
+	/**
+	 * @brief Elements of an array; empty for other types.
+	*/
+	const std::vector<JsonValue>& GetElements() const { return elements; }
+	size_t GetSize() const { return elements.size(); }
+	const JsonValue& operator[](const size_t index) const { return elements[index]; }
+
+	double GetNumber() const { return number; }
+	bool GetBoolean() const { return boolean; }
+	const std::string& GetString() const { return string; }
+
+	/**
+	 * @brief Member as a number or string, or the fallback when it is missing or of another type.
+	*/
+	double GetNumber(std::string_view key, const double fallback) const;
+	std::string GetString(std::string_view key, const std::string& fallback = std::string()) const;
+
+private:
+	// JsonValue Private Data.
+	Type type = Type::NUL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> elements;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	friend class JsonParser;
+};
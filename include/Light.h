@@ -29,6 +29,7 @@ public:
 
 	glm::vec3 GetPosition() const { return position; }
 	glm::vec3 GetIntensity() const { return intensity; }
+	void SetPosition(const glm::vec3 p) { position = p; }
 
 	void Draw() {
 		glPointSize(16.0f);
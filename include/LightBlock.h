@@ -0,0 +1,75 @@
+#pragma once
+
+// C++ STL headers.
+#include <memory>
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// OpenGL headers.
+#include <GL/glew.h>
+
+// Project headers.
+#include "Light.h"
+#include "CommandList.h"
+#include "SphericalHarmonics.h"
+
+// LightBlockData Declarations.
+// Mirrors the std140 "LightBlock" uniform block in phong_shading_demo.fs.
+struct LightBlockData
+{
+	glm::vec4 dirLightDir;			// View space, normalized, pointing towards the light.
+	glm::vec4 dirLightRadiance;
+	glm::vec4 pointLightPos;		// View space.
+	glm::vec4 pointLightIntensity;
+	glm::vec4 spotLightPos;			// View space.
+	glm::vec4 spotLightDir;			// View space, normalized.
+	glm::vec4 spotLightIntensity;
+	glm::vec4 spotLightCone;		// x: cos of the outer angle, y: 1 / (cos inner - cos outer).
+	glm::vec4 viewToSky[3];			// Columns of a std140 mat3, view space to the ambient frame.
+	glm::vec4 ambientSH[9];			// IrradianceSH terms.
+};
+
+// LightBlock Declarations.
+class LightBlock
+{
+public:
+	// LightBlock Public Methods.
+	LightBlock();
+	~LightBlock();
+
+	/**
+	 * @brief Transform the lights into view space and precompute the cone terms.
+	 *
+	 * @param ambient Ambient light in its own frame, see IrradianceSH.
+	 * @param worldToAmbient Rotation from world space to that frame.
+	 *
+	 * @note Called once per frame, so no fragment has to do this work.
+	*/
+	void Prepare(
+		const glm::mat4x4& viewMatrix,
+		const IrradianceSH& ambient,
+		const glm::mat3x3& worldToAmbient,
+		const std::shared_ptr<DirectionalLight>& dirLight,
+		const std::shared_ptr<PointLight>& pointLight,
+		const std::shared_ptr<SpotLight>& spotLight);
+
+	/**
+	 * @brief Record the upload of the prepared data and the binding to BINDING_POINT.
+	*/
+	void Record(CommandList& commandList) const;
+
+	/**
+	 * @brief PhongShadingFeature bits of the lights that are present.
+	*/
+	unsigned int GetFeatures() const { return features; }
+	const LightBlockData& GetData() const { return data; }
+
+	static constexpr GLuint BINDING_POINT = 0;
+
+private:
+	// LightBlock Private Data.
+	GLuint uboId;
+	LightBlockData data;
+	unsigned int features;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+// C++ STL headers.
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * @brief MappedFile class.
+ *
+ * Read-only memory mapping of a whole file. Pages are read by the OS when
+ * they are first touched, so a loader can hand byte ranges straight to
+ * the UploadManager without reading the file into its own buffers.
+*/
+class MappedFile
+{
+public:
+	// MappedFile Public Methods.
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * @brief Map a file, unmapping the previous one.
+	 *
+	 * @return false if the file cannot be opened or is empty.
+	*/
+	bool Open(const std::filesystem::path& filePath);
+	void Close();
+
+	bool IsOpen() const { return data != nullptr; }
+	const uint8_t* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+	/**
+	 * @brief Tell the OS a range will be read front to back soon.
+	*/
+	void WillNeed(const size_t offset, const size_t bytes) const;
+
+private:
+	// MappedFile Private Data.
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
@@ -5,24 +5,25 @@
 
 #include "ShaderProg.h"
 #include "ImageTexture.h"
+#include "ResourcePool.h"
 
 // Material Declarations.
 class Material
 {
 public:
 	// Material Public Methods.
-	Material() : name("Default"), mapKd(nullptr) {};
+	Material() : name("Default") {};
 	~Material() {};
 
 	void SetName(const std::string mtlName) { name = mtlName; }
 	std::string GetName() const { return name; }
-	void SetMapKd(std::shared_ptr<ImageTexture> tex) { mapKd = tex; }
-	std::shared_ptr<ImageTexture> GetMapKd() const { return mapKd; }
+	void SetMapKd(const TextureHandle tex) { mapKd = tex; }
+	TextureHandle GetMapKd() const { return mapKd; }
 
 protected:
 	// Material Protected Data.
 	std::string name;
-	std::shared_ptr<ImageTexture> mapKd;
+	TextureHandle mapKd;
 };
 
 // ------------------------------------------------------------------------------------------------
@@ -58,6 +59,8 @@ private:
 	float Ns;
 };
 
+using MaterialHandle = Handle<PhongMaterial>;
+
 // ------------------------------------------------------------------------------------------------
 
 // SkyboxMaterial Declarations.
@@ -0,0 +1,17 @@
+#pragma once
+
+namespace opengl_homework {
+
+/**
+ * @brief Element counts known before parsing, used to reserve the loader containers.
+*/
+struct MeshLoadHint
+{
+	int numPositions = 0;
+	int numNormals = 0;
+	int numTexcoords = 0;
+	int numVertices = 0;
+	int numTriangles = 0;
+};
+
+}
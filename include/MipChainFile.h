@@ -0,0 +1,78 @@
+#pragma once
+
+// OpenCV headers.
+#include <opencv2/core.hpp>
+
+// C++ STL headers.
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Project headers.
+#include "MappedFile.h"
+
+/**
+ * @brief Header of a mip chain file, at offset 0.
+*/
+struct MipChainHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceBytes;		// Of the image it was cooked from, to tell when it is out of date.
+	int64_t sourceWriteTime;
+	int32_t width;
+	int32_t height;
+	uint32_t numChannels;
+	uint32_t numLevels;
+	uint32_t flipped;			// Rows bottom first, as OpenGL wants them for OBJ texture coordinates.
+	uint32_t padding;
+};
+
+/**
+ * @brief MipChainFile class.
+ *
+ * The decoded mip chain of an image, cooked offline into <image>.mips next
+ * to it, so a texture is mapped instead of decoded and downsampled at load
+ * time. Level i is max(1, width >> i) by max(1, height >> i) pixels of
+ * numChannels bytes in OpenCV channel order, tightly packed, and follows
+ * level i - 1.
+*/
+class MipChainFile
+{
+public:
+	// MipChainFile Public Methods.
+	/**
+	 * @brief Map the cooked chain of an image.
+	 *
+	 * @return false if there is none, or it was cooked from another version
+	 * of the image or with the other row order. Only a corrupt file is reported.
+	*/
+	bool Open(const std::filesystem::path& imagePath, const bool flipped);
+
+	const MipChainHeader& GetHeader() const { return *header; }
+
+	/**
+	 * @brief The levels as images over the mapping, finest first. They must not be written to.
+	*/
+	std::vector<cv::Mat> GetLevels() const;
+
+	static std::filesystem::path GetCookedPath(const std::filesystem::path& imagePath);
+
+	/**
+	 * @brief Downsample an image into its mip chain with a box filter, down to 1x1.
+	*/
+	static void BuildLevels(const cv::Mat& image, std::vector<cv::Mat>& levels);
+
+	/**
+	 * @brief Decode an image and write its mip chain next to it.
+	 *
+	 * @return false if the image cannot be decoded or the output written.
+	*/
+	static bool Build(const std::filesystem::path& imagePath, const bool flipped);
+
+private:
+	// MipChainFile Private Data.
+	MappedFile file;
+	const MipChainHeader* header = nullptr;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// C++ STL headers.
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Project headers.
+#include "MeshLoadHint.h"
+
+namespace opengl_homework {
+
+/**
+ * @brief Metadata of one model directory.
+*/
+struct ModelInfo
+{
+	std::string name;
+	int64_t dirWriteTime = 0;				// Of the model directory, which changes when a file is added or removed.
+	std::filesystem::path objFilePath;		// The point cloud, chunked or cooked mesh, GLB or PLY file instead when the model has one.
+	uint64_t objBytes = 0;
+	int64_t objWriteTime = 0;
+	uint64_t mtlBytes = 0;
+	int64_t mtlWriteTime = 0;
+	uint64_t contentHash = 0;
+	MeshLoadHint loadHint;
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	std::vector<std::string> materials;
+	std::vector<std::filesystem::path> textures;
+};
+
+/**
+ * @brief ModelCatalog class.
+ *
+ * Persistent index of the model library. The catalog file is read with a
+ * single I/O at startup; the model directories are only walked again when
+ * the library directory, a model directory or a model file changed, and
+ * only the models whose model file or MTL changed size or mtime are parsed
+ * again. A model directory is read from
+ * <name>.octree, <name>.chunks, <name>.glb, <name>.ply, <name>.cmesh or
+ * <name>.obj, the first found.
+*/
+class ModelCatalog
+{
+public:
+	// ModelCatalog Public Methods.
+	ModelCatalog(const std::filesystem::path& catalogFilePath);
+	~ModelCatalog();
+
+	/**
+	 * @brief Read the catalog file.
+	 *
+	 * @return false if the file is missing or has an unknown format.
+	*/
+	bool Load();
+
+	/**
+	 * @brief Write the catalog file if anything changed since it was loaded.
+	*/
+	bool Save();
+
+	/**
+	 * @brief Whether the model or texture directory, a model directory, or the
+	 * model file or MTL of a model changed since the catalog was built.
+	 *
+	 * @note Costs a few stats per model, against a full walk and scan in Refresh.
+	*/
+	bool IsStale(const std::filesystem::path& modelDir, const std::filesystem::path& textureDir) const;
+
+	/**
+	 * @brief Walk the directories and rescan the models that changed.
+	 *
+	 * @note Directories without a matching model file are skipped.
+	*/
+	void Refresh(const std::filesystem::path& modelDir, const std::filesystem::path& textureDir);
+
+	/**
+	 * @brief Parse the OBJ and MTL, the GLB, the PLY header, the chunk or submesh table or the octree of a model to fill in its metadata.
+	 *
+	 * @return false if the file cannot be read.
+	*/
+	static bool ScanModel(const std::filesystem::path& objFilePath, ModelInfo& info);
+
+	const std::vector<ModelInfo>& GetModels() const { return models; }
+	const std::vector<std::string>& GetSkyboxNames() const { return skyboxNames; }
+
+private:
+	// ModelCatalog Private Data.
+	std::filesystem::path catalogFilePath;
+	int64_t modelDirWriteTime;
+	int64_t textureDirWriteTime;
+	std::vector<ModelInfo> models;
+	std::vector<std::string> skyboxNames;
+	bool dirty;
+};
+
+}
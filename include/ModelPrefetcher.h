@@ -0,0 +1,77 @@
+#pragma once
+
+// C++ STL headers.
+#include <memory>
+#include <filesystem>
+#include <vector>
+
+// Project headers.
+#include "TriangleMesh.h"
+
+namespace opengl_homework {
+
+/**
+ * @brief ModelPrefetcher class.
+ *
+ * Loads the models around the current menu selection on a low priority
+ * background thread while the application is idle. The neighbours of the
+ * selection are always loaded, then the ring is widened until the byte
+ * budget is used up. A prefetched mesh only holds host memory, so picking
+ * it from the menu costs a CreateBuffers() call.
+ *
+ * The prefetcher owns the handles of the meshes it holds; evicted meshes
+ * are freed at the next frame boundary by RenderResources.
+ *
+ * @note Every public method except the constructor must be called on the GL
+ * thread.
+*/
+class ModelPrefetcher
+{
+public:
+	// ModelPrefetcher Public Methods.
+	ModelPrefetcher(const std::vector<std::filesystem::path>& objFilePaths,
+		const std::vector<MeshLoadHint>& loadHints, const size_t byteBudget);
+	~ModelPrefetcher();
+
+	/**
+	 * @brief Get a prefetched mesh.
+	 *
+	 * @param index Index in the model list.
+	 *
+	 * @return The mesh, or an invalid handle if it is not loaded. If the model
+	 * is being prefetched right now, wait for it instead of loading it twice.
+	*/
+	MeshHandle Acquire(const int index);
+
+	/**
+	 * @brief Take ownership of a mesh loaded in the foreground so it can be switched back to.
+	 *
+	 * @note An invalid handle marks the model as failed, so it is not prefetched again.
+	*/
+	void Insert(const int index, const MeshHandle mesh);
+
+	/**
+	 * @brief Move the prefetch window to a new selection and evict meshes outside it.
+	*/
+	void SetCurrent(const int index);
+
+	/**
+	 * @brief Pause prefetching while the GL thread loads a model itself.
+	 *
+	 * @note Calls must be paired with EndForegroundLoad().
+	*/
+	void BeginForegroundLoad();
+	void EndForegroundLoad();
+
+	size_t GetResidentBytes() const;
+
+private:
+	// ModelPrefetcher Private Methods.
+	void WorkerLoop();
+
+	// ModelPrefetcher Private Data.
+	struct Impl;
+	std::unique_ptr<Impl> pImpl;
+};
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+// C++ STL headers.
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief PlyReader class.
+ *
+ * Sequential reader of a binary little-endian PLY file through one
+ * fixed-size buffer, so files far larger than memory can be streamed. The
+ * vertex element is read as packed positions, with normals when the file
+ * has them and optionally colors, and the face element as triangle fans;
+ * every index is checked against the vertex count. Files without faces
+ * are point clouds. Other elements are skipped.
+ *
+ * @note Read all vertices before the faces, as they are stored.
+*/
+class PlyReader
+{
+public:
+	// PlyReader Public Methods.
+	explicit PlyReader(const size_t bufferBytes = 4 * 1024 * 1024);
+
+	/**
+	 * @brief Parse the header and position the reader at the first vertex.
+	 *
+	 * @return false if the file is not a binary little-endian PLY with
+	 * x, y and z and, if it has faces, an index list after the vertices;
+	 * the reason goes to std::cerr.
+	*/
+	bool Open(const std::filesystem::path& filePath);
+
+	size_t GetNumVertices() const { return numVertices; }
+	size_t GetNumFaces() const { return numFaces; }
+	bool HasNormals() const { return hasNormals; }
+	bool HasColors() const { return hasColors; }
+	const std::string& GetHeader() const { return header; }
+	size_t GetBufferBytes() const { return buffer.size(); }
+
+	/**
+	 * @brief Bytes of one vertex as ReadVertices() writes it: position, then normal if any.
+	*/
+	size_t GetVertexBytes() const { return (hasNormals ? 6 : 3) * sizeof(float); }
+
+	/**
+	 * @brief Read up to maxVertices of the remaining vertices.
+	 *
+	 * @param colors If not null, also gets the RGBA8 color of every vertex; white without colors.
+	 *
+	 * @return Vertices written; fewer than asked only at the end or on an error.
+	*/
+	size_t ReadVertices(float* out, const size_t maxVertices, uint8_t* colors = nullptr);
+
+	/**
+	 * @brief Read whole faces while their triangles fit in maxIndices.
+	 *
+	 * @return Indices written; 0 if the next face does not fit, at the end or on an error.
+	*/
+	size_t ReadTriangles(uint32_t* out, const size_t maxIndices);
+
+	size_t GetVerticesLeft() const { return verticesLeft; }
+	size_t GetFacesLeft() const { return facesLeft; }
+	bool HasFailed() const { return failed; }
+
+private:
+	// PlyReader Private Declarations.
+	struct Property
+	{
+		std::string name;
+		int type = 0;			// Scalar type, or the item type of a list.
+		int countType = -1;		// List length type; -1 for a scalar.
+	};
+
+	struct Element
+	{
+		std::string name;
+		size_t count = 0;
+		std::vector<Property> properties;
+		size_t recordBytes = 0;		// 0 if the element has lists.
+	};
+
+	// PlyReader Private Methods.
+	bool Fill(const size_t bytes);
+	bool Skip(size_t bytes);
+	bool SkipElements(const size_t end);
+	void Fail(const std::string& message);
+
+	// PlyReader Private Data.
+	std::filesystem::path filePath;
+	std::ifstream file;
+	std::vector<char> buffer;
+	size_t begin = 0;		// Unread bytes of the buffer are [begin, end).
+	size_t end = 0;
+	std::string header;
+	std::vector<Element> elements;
+	size_t nextElement = 0;		// First element not yet reached.
+	size_t vertexElement = 0;
+	size_t faceElement = 0;
+	size_t numVertices = 0;
+	size_t numFaces = 0;
+	size_t verticesLeft = 0;
+	size_t facesLeft = 0;
+	bool hasNormals = false;
+	bool hasColors = false;
+	bool failed = false;
+	int positionTypes[9] = {};		// x, y, z, nx, ny, nz, red, green, blue.
+	size_t positionOffsets[9] = {};
+	size_t faceIndexProperty = 0;
+};
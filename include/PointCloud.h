@@ -0,0 +1,82 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// C++ STL headers.
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+// Project headers.
+#include "Camera.h"
+#include "ShaderProg.h"
+
+namespace opengl_homework {
+
+/**
+ * @brief What a point cloud drew in its last frame.
+*/
+struct PointCloudStats
+{
+	size_t pointBudget = 0;
+	size_t pointsDrawn = 0;
+	size_t nodesDrawn = 0;
+	size_t nodesLoading = 0;
+	size_t residentBytes = 0;
+};
+
+/**
+ * @brief PointCloud class.
+ *
+ * Draws a point cloud octree made by PointCloudFile::Build(). Every frame
+ * the nodes in view are picked largest on screen first, descending only
+ * while the points of a node are more than a pixel apart and only while
+ * their points fit in the point budget. The picked nodes stream in from
+ * the file mapping through the UploadManager; the least recently picked
+ * ones are dropped to stay within a GPU memory budget.
+ *
+ * @note GL thread only, except for the constructor.
+*/
+class PointCloud
+{
+public:
+	// PointCloud Public Methods.
+	PointCloud(const std::filesystem::path& octreeFilePath, const bool normalized);
+	~PointCloud();
+
+	/**
+	 * @brief Start drawing; nodes are uploaded as Render() picks them.
+	*/
+	void CreateBuffers();
+
+	/**
+	 * @brief Release the node buffers.
+	*/
+	void ReleaseBuffers();
+
+	/**
+	 * @brief Pick the nodes to draw from this view, stream them in and draw the resident ones.
+	*/
+	void Render(PointCloudShaderProg& shaderProg, const glm::mat4& worldMatrix, Camera& camera);
+
+	void SetPointBudget(const size_t points);
+
+	bool IsLoaded() const;
+
+	/**
+	 * @brief Whether nodes picked in the last frame are still missing.
+	*/
+	bool IsStreaming() const;
+
+	void GetBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+	const PointCloudStats& GetStats() const;
+	void PrintInfo() const;
+
+private:
+	// PointCloud Private Data.
+	struct Impl;
+	std::unique_ptr<Impl> pImpl;
+};
+
+}
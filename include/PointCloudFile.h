@@ -0,0 +1,102 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// C++ STL headers.
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Project headers.
+#include "MappedFile.h"
+
+/**
+ * @brief Header of a point cloud octree file, at offset 0.
+*/
+struct PointCloudHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t numNodes;
+	float boundsMin[3];		// The cube of the root node.
+	float size;
+	float pointsMin[3];		// Tight bounds of the points.
+	float pointsMax[3];
+	uint64_t numPoints;		// Summed over the nodes; points copied to the upper levels count again.
+	uint64_t nodeTableOffset;
+};
+
+/**
+ * @brief One point as stored and uploaded: position, then RGBA8 color.
+*/
+struct PointCloudPoint
+{
+	float position[3];
+	uint8_t color[4];
+};
+
+/**
+ * @brief One node of a point cloud octree.
+*/
+struct PointCloudNode
+{
+	float boundsMin[3];		// The node is a cube.
+	float size;
+	uint64_t offset;		// Of its points in the file.
+	uint32_t numPoints;
+	uint32_t firstChild;	// Children are contiguous in the table.
+	uint16_t numChildren;
+	uint16_t level;
+	float spacing;			// Distance between the points of the node.
+};
+
+/**
+ * @brief PointCloudFile class.
+ *
+ * A point cloud sorted offline into a level-of-detail octree, for clouds
+ * too large to hold in memory. Every node keeps a subsample of the points
+ * below it, about one per cell of a 64^3 grid over its cube; drawing a
+ * node and some of its children refines it without redrawing what it
+ * already shows, so a viewer only uploads the nodes whose points are
+ * spaced more than a pixel apart on screen.
+ *
+ * The node table is in breadth-first order with the root first, and the
+ * points of a node are ready to upload as they are. The file is read
+ * through a memory mapping.
+*/
+class PointCloudFile
+{
+public:
+	// PointCloudFile Public Methods.
+	/**
+	 * @brief Map and validate a file.
+	 *
+	 * @return false if the file is not a usable point cloud octree; the reason goes to std::cerr.
+	*/
+	bool Open(const std::filesystem::path& filePath);
+
+	const PointCloudHeader& GetHeader() const { return *header; }
+	const PointCloudNode* GetNodes() const { return nodes; }
+	uint32_t GetNumNodes() const { return header->numNodes; }
+	const uint8_t* GetFileData() const { return file.GetData(); }
+	const MappedFile& GetMappedFile() const { return file; }
+
+	/**
+	 * @brief Sort the vertices of a binary PLY point cloud into an octree file.
+	 *
+	 * The cloud is split into chunks of a few million points whose subtrees
+	 * are built in parallel on the job system. The points go through
+	 * temporary files next to the output, so the host memory used does not
+	 * grow with the cloud.
+	 *
+	 * @return false if the source cannot be read or the output written.
+	*/
+	static bool Build(const std::filesystem::path& plyFilePath, const std::filesystem::path& outputFilePath);
+
+private:
+	// PointCloudFile Private Data.
+	MappedFile file;
+	const PointCloudHeader* header = nullptr;
+	const PointCloudNode* nodes = nullptr;
+};
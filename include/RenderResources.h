@@ -0,0 +1,53 @@
+#pragma once
+
+// Project headers.
+#include "ResourcePool.h"
+#include "ImageTexture.h"
+#include "Material.h"
+#include "TriangleMesh.h"
+
+/**
+ * @brief RenderResources class.
+ *
+ * Owner of the textures, materials and meshes. Everything else refers to
+ * them by handle, so the draw path looks objects up in dense pools instead
+ * of copying reference-counted pointers, and ownership is explicit: the
+ * object that created a handle destroys it.
+ *
+ * Destroyed objects stay alive until EndFrame(), so a mesh evicted while a
+ * frame is being recorded is only freed once its command lists have been
+ * replayed. A mesh destroys the handles of its materials and textures.
+ *
+ * @note The first call to GetInstance() must be made before any object that
+ * holds handles is created, so the registry is torn down after it.
+*/
+class RenderResources
+{
+public:
+	static RenderResources& GetInstance();
+
+	/**
+	 * @brief Destroy the objects released during the frame. GL thread only,
+	 * after the command lists have been replayed.
+	*/
+	void EndFrame();
+
+	/**
+	 * @brief Destroy every object now. GL thread only.
+	*/
+	void Clear();
+
+	ResourcePool<opengl_homework::TriangleMesh>& GetMeshes() { return meshes; }
+	ResourcePool<PhongMaterial>& GetMaterials() { return materials; }
+	ResourcePool<ImageTexture>& GetTextures() { return textures; }
+
+private:
+	RenderResources() = default;
+	~RenderResources();
+
+	// RenderResources Private Data.
+	// Declared so that owners are destroyed before what they own.
+	ResourcePool<ImageTexture> textures;
+	ResourcePool<PhongMaterial> materials;
+	ResourcePool<opengl_homework::TriangleMesh> meshes;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+// Project headers.
+#include "Clock.h"
+
+/**
+ * @brief RenderScheduler class.
+ *
+ * Decides when the window is redrawn. Input callbacks, menu actions and
+ * other state changes mark the frame dirty and get one redraw. While an
+ * animation is running, frames are scheduled with a GLUT timer so they do
+ * not exceed the frame rate cap. Nothing is drawn while the window is
+ * hidden or nothing changed, so an idle viewer costs no CPU or GPU time.
+ *
+ * @note There must be at most one scheduler, because the GLUT timer
+ * callback cannot carry a pointer to it.
+*/
+class RenderScheduler
+{
+public:
+	// RenderScheduler Public Methods.
+	RenderScheduler(const float maxFrameRate = 60.0f);
+	~RenderScheduler();
+
+	/**
+	 * @brief Mark the frame dirty and schedule one redraw.
+	*/
+	void RequestRedraw();
+
+	/**
+	 * @brief Start or stop continuous redraws at the capped frame rate.
+	*/
+	void SetAnimating(const bool animating);
+	bool IsAnimating() const { return animating; }
+
+	/**
+	 * @brief Suspend redraws while the window cannot be seen.
+	*/
+	void SetVisible(const bool visible);
+
+	void SetMaxFrameRate(const float maxFrameRate);
+
+	/**
+	 * @brief Call at the start of the display callback.
+	*/
+	void BeginFrame();
+
+	/**
+	 * @brief Call at the end of the display callback to schedule the next animation frame.
+	*/
+	void EndFrame();
+
+private:
+	// RenderScheduler Private Methods.
+	void Wake();
+	static void TimerCB(int value);
+
+	// RenderScheduler Private Data.
+	bool dirty;
+	bool animating;
+	bool visible;
+	bool redisplayPosted;
+	bool timerPending;
+	double minFrameInterval;
+	Clock frameClock;
+
+	static RenderScheduler* timerTarget;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+// C++ STL headers.
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Typed 32-bit reference to an object in a ResourcePool.
+ *
+ * The low bits index the slot and the high bits carry the generation the
+ * slot had when the object was created, so a handle to a destroyed object
+ * is detected as stale instead of reaching whatever reuses its slot.
+ * The zero value never refers to an object.
+*/
+template <typename T>
+class Handle
+{
+public:
+	static constexpr uint32_t INDEX_BITS = 20;
+	static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+	Handle() = default;
+	Handle(const uint32_t index, const uint32_t generation)
+		: value(((generation & GENERATION_MASK) << INDEX_BITS) | (index & INDEX_MASK)) {}
+
+	bool IsValid() const { return value != 0; }
+	uint32_t GetIndex() const { return value & INDEX_MASK; }
+	uint32_t GetGeneration() const { return value >> INDEX_BITS; }
+
+	bool operator==(const Handle& other) const { return value == other.value; }
+
+private:
+	uint32_t value = 0;
+};
+
+/**
+ * @brief ResourcePool class.
+ *
+ * Objects of one type stored in fixed-size chunks of slots and referenced
+ * through generational handles. Chunks are never moved, so Get() is a
+ * lock-free index and generation check that can run on any thread, while
+ * Create() and Destroy() take a short lock. Construction happens outside
+ * the lock, so a slow constructor (a file load) does not stall others.
+ *
+ * Destroy() invalidates the handle at once but keeps the object alive until
+ * Collect(), which the owner calls at a frame boundary, when no recorded
+ * work can still be holding a pointer to it.
+ *
+ * @note Collect() and Clear() run the destructors, so call them on the thread
+ * that owns the GL context when T holds GL objects.
+*/
+template <typename T>
+class ResourcePool
+{
+public:
+	// ResourcePool Public Methods.
+	ResourcePool() = default;
+	ResourcePool(const ResourcePool&) = delete;
+	ResourcePool& operator=(const ResourcePool&) = delete;
+
+	~ResourcePool() {
+		Clear();
+		for (auto& chunk : chunks) {
+			delete[] chunk.load(std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Construct an object in a free slot.
+	 *
+	 * @return An invalid handle if every slot is in use.
+	*/
+	template <typename... Args>
+	Handle<T> Create(Args&&... args) {
+		uint32_t index;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!freeSlots.empty()) {
+				index = freeSlots.back();
+				freeSlots.pop_back();
+			}
+			else {
+				if (numSlots > Handle<T>::INDEX_MASK) {
+					std::cerr << "[ERROR] Resource pool is full" << std::endl;
+					return Handle<T>();
+				}
+				index = numSlots++;
+				if (index % CHUNK_SIZE == 0) {
+					chunks[index / CHUNK_SIZE].store(new Slot[CHUNK_SIZE], std::memory_order_release);
+				}
+			}
+		}
+
+		// No handle reaches the slot before this returns.
+		Slot& slot = GetSlot(index);
+		slot.value.emplace(std::forward<Args>(args)...);
+		return Handle<T>(index, slot.generation.load(std::memory_order_relaxed));
+	}
+
+	/**
+	 * @brief Get the object of a handle.
+	 *
+	 * @return nullptr if the handle is invalid or its object was destroyed.
+	*/
+	T* Get(const Handle<T> handle) const {
+		if (!handle.IsValid()) {
+			return nullptr;
+		}
+		Slot* chunk = chunks[handle.GetIndex() / CHUNK_SIZE].load(std::memory_order_acquire);
+		if (chunk == nullptr) {
+			return nullptr;
+		}
+		Slot& slot = chunk[handle.GetIndex() % CHUNK_SIZE];
+		if (slot.generation.load(std::memory_order_acquire) != handle.GetGeneration()) {
+			return nullptr;
+		}
+		return &*slot.value;
+	}
+
+	/**
+	 * @brief Invalidate a handle and queue its object for the next Collect().
+	*/
+	void Destroy(const Handle<T> handle) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!handle.IsValid() || handle.GetIndex() >= numSlots) {
+			return;
+		}
+		Slot& slot = GetSlot(handle.GetIndex());
+		if (slot.generation.load(std::memory_order_relaxed) != handle.GetGeneration()) {
+			return;
+		}
+		slot.generation.store(NextGeneration(handle.GetGeneration()), std::memory_order_release);
+		retired.push_back(handle.GetIndex());
+	}
+
+	/**
+	 * @brief Destroy the objects queued by Destroy() and reuse their slots.
+	*/
+	void Collect() {
+		std::vector<uint32_t> indices;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (retired.empty()) {
+				return;
+			}
+			indices.swap(retired);
+		}
+
+		// Destructors may release handles of other pools; run them unlocked.
+		for (const uint32_t index : indices) {
+			GetSlot(index).value.reset();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		freeSlots.insert(freeSlots.end(), indices.begin(), indices.end());
+	}
+
+	/**
+	 * @brief Destroy every object now, invalidating all handles.
+	*/
+	void Clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		freeSlots.clear();
+		retired.clear();
+		for (uint32_t index = 0; index < numSlots; ++index) {
+			Slot& slot = GetSlot(index);
+			if (slot.value.has_value()) {
+				slot.value.reset();
+				slot.generation.store(NextGeneration(slot.generation.load(std::memory_order_relaxed)),
+					std::memory_order_release);
+			}
+			freeSlots.push_back(index);
+		}
+	}
+
+private:
+	// ResourcePool Private Declarations.
+	static constexpr uint32_t CHUNK_SIZE = 256;
+	static constexpr uint32_t MAX_CHUNKS = (Handle<T>::INDEX_MASK + 1) / CHUNK_SIZE;
+
+	struct Slot {
+		std::atomic<uint32_t> generation = 1;
+		std::optional<T> value;
+	};
+
+	// ResourcePool Private Methods.
+	Slot& GetSlot(const uint32_t index) const {
+		return chunks[index / CHUNK_SIZE].load(std::memory_order_relaxed)[index % CHUNK_SIZE];
+	}
+
+	// Desc: Generations wrap around but skip zero, which is reserved for the invalid handle.
+	static uint32_t NextGeneration(const uint32_t generation) {
+		const uint32_t next = (generation + 1) & Handle<T>::GENERATION_MASK;
+		return next == 0 ? 1 : next;
+	}
+
+	// ResourcePool Private Data.
+	std::array<std::atomic<Slot*>, MAX_CHUNKS> chunks = {};
+	uint32_t numSlots = 0;
+	std::vector<uint32_t> freeSlots;
+	std::vector<uint32_t> retired;
+	std::mutex mutex;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// C++ STL headers.
+#include <cstdint>
+#include <vector>
+
+// Project headers.
+#include "ResourcePool.h"
+
+namespace opengl_homework {
+
+// Only the handle is stored, so the store builds without the renderer.
+class TriangleMesh;
+using MeshHandle = Handle<TriangleMesh>;
+
+using SceneNodeId = uint32_t;
+constexpr SceneNodeId INVALID_SCENE_NODE = UINT32_MAX;
+
+// SceneNodeFlag Declarations.
+enum SceneNodeFlag : uint32_t
+{
+	SCENE_NODE_VISIBLE = 1 << 0,
+};
+
+/**
+ * @brief SceneStore class.
+ *
+ * Scene objects stored as parallel arrays (local and world transforms,
+ * bounds, meshes, parents and flags) indexed by node id, so a pass over
+ * one attribute walks contiguous memory.
+ *
+ * Nodes are created after their parent, so a forward pass sees every parent
+ * before its children. UpdateTransforms() pushes the dirty flags down the
+ * hierarchy, then recomputes world matrices and world bounds for the dirty
+ * nodes only, one depth level at a time, in parallel batches with SIMD
+ * matrix products.
+*/
+class SceneStore
+{
+public:
+	// SceneStore Public Methods.
+	SceneStore();
+	~SceneStore();
+
+	/**
+	 * @brief Add a node under an existing parent, or a root node.
+	*/
+	SceneNodeId Create(const SceneNodeId parent = INVALID_SCENE_NODE);
+
+	/**
+	 * @brief Remove every node.
+	*/
+	void Clear();
+
+	void SetLocalMatrix(const SceneNodeId node, const glm::mat4& localMatrix);
+	void SetLocalBounds(const SceneNodeId node, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	void SetMesh(const SceneNodeId node, const MeshHandle mesh);
+	void SetFlags(const SceneNodeId node, const uint32_t flags) { nodeFlags[node] = flags; }
+
+	/**
+	 * @brief Recompute the world transforms and bounds of the dirty nodes and their descendants.
+	*/
+	void UpdateTransforms();
+
+	const glm::mat4& GetLocalMatrix(const SceneNodeId node) const { return localMatrices[node]; }
+	const glm::mat4& GetWorldMatrix(const SceneNodeId node) const { return worldMatrices[node]; }
+	const glm::vec3& GetWorldBoundsMin(const SceneNodeId node) const { return worldBoundsMin[node]; }
+	const glm::vec3& GetWorldBoundsMax(const SceneNodeId node) const { return worldBoundsMax[node]; }
+	MeshHandle GetMesh(const SceneNodeId node) const { return meshes[node]; }
+	uint32_t GetFlags(const SceneNodeId node) const { return nodeFlags[node]; }
+	SceneNodeId GetParent(const SceneNodeId node) const { return parents[node]; }
+	size_t GetNumNodes() const { return parents.size(); }
+
+	/**
+	 * @brief Number of nodes recomputed by the last UpdateTransforms().
+	*/
+	size_t GetNumUpdated() const { return numUpdated; }
+
+private:
+	// SceneStore Private Methods.
+	void UpdateNodes(const uint32_t* nodes, const size_t count);
+
+	// SceneStore Private Data.
+	std::vector<SceneNodeId> parents;
+	std::vector<uint32_t> depths;
+	std::vector<glm::mat4> localMatrices;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<glm::vec3> localBoundsMin;
+	std::vector<glm::vec3> localBoundsMax;
+	std::vector<glm::vec3> worldBoundsMin;
+	std::vector<glm::vec3> worldBoundsMax;
+	std::vector<MeshHandle> meshes;
+	std::vector<uint32_t> nodeFlags;
+	std::vector<uint8_t> dirty;
+
+	// Dirty nodes bucketed by depth; kept to avoid reallocating every frame.
+	std::vector<std::vector<uint32_t>> dirtyByDepth;
+	size_t numUpdated;
+};
+
+}
@@ -3,6 +3,11 @@
 // C++ STL headers.
 #include <memory>
 #include <filesystem>
+#include <vector>
+
+// Project headers.
+#include "TextureResidency.h"
+#include "PointCloud.h"
 
 namespace opengl_homework {
 
@@ -29,22 +34,41 @@ public:
      */
     void Start(int, char**);
 
+    /**
+     * @brief Frame statistics of the rendering loop.
+     */
+    struct RenderStats
+    {
+        int frameRate = 0;
+        float resolutionScale = 1.0f;
+        float targetFrameTimeMs = 0.0f;
+        std::vector<float> gpuFrameTimesMs;  // Oldest first.
+        TextureResidencyStats textures;
+        PointCloudStats points;
+    };
+
+    RenderStats GetRenderStats() const;
+
 private:
     // ScreenManager Private Methods.
     ScreenManager();
 
     int CalculateFrameRate();
+    void Shutdown();
 
     void SetupFilesystem();
+    void SetupPrefetcher();
     void SetupRenderState();
     void SetupScene(int);
     void SetupShaderLib();
     void SetupLights();
+    void SetupSimulation();
     void SetupCamera();
     void SetupSkybox(int);
     void SetupMenu();
 
     void ReshapeCB(int, int);
+    void WindowStatusCB(int);
     void ProcessSpecialKeysCB(int, int, int);
     void ProcessKeysCB(unsigned char, int, int);
     void RenderSceneCB();
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include <GL/glew.h>
 
@@ -16,10 +19,54 @@ public:
 	~ShaderProg();
 
 	bool LoadFromFiles(const std::filesystem::path&, const std::filesystem::path&, const std::filesystem::path&);
-	void Bind() { glUseProgram(shaderProgId); };
+
+	/**
+	 * @brief Start compiling and linking without waiting for the driver.
+	 *
+	 * @note Submit every program first, then let Finish() (or the first Bind())
+	 * collect the results, so the driver can compile them in parallel.
+	 *
+	 * @param defines "#define" lines inserted after the #version line of every stage.
+	*/
+	bool Submit(const std::filesystem::path&, const std::filesystem::path&, const std::filesystem::path&,
+		const std::string& defines = "");
+
+	/**
+	 * @brief Non-blocking completion check, needs KHR_parallel_shader_compile.
+	 *
+	 * @note Without the extension it always reports ready and Finish() waits.
+	*/
+	bool IsReady() const;
+
+	/**
+	 * @brief Wait for the link result, validate and fetch the uniform locations.
+	*/
+	bool Finish();
+
+	void Bind();
 	void Unbind() { glUseProgram(0); };
 
 	GLint GetLocMVP() const { return locMVP; }
+	bool IsLoadedFromCache() const { return loadedFromCache; }
+
+	/**
+	 * @brief Program object for recorded commands; call Finish() first.
+	*/
+	GLuint GetProgramId() const { return shaderProgId; }
+
+	/**
+	 * @brief Enable the program binary cache.
+	 *
+	 * Linked programs are saved with glGetProgramBinary, keyed by the source
+	 * hash and the GL vendor/renderer/version strings, and loaded with
+	 * glProgramBinary on the next launch. An empty path disables the cache.
+	*/
+	static void SetBinaryCacheDir(const std::filesystem::path&);
+
+	/**
+	 * @brief Let the driver use as many compiler threads as it wants.
+	*/
+	static void SetMaxCompilerThreads();
 
 protected:
 	// ShaderProg Protected Methods.
@@ -31,10 +78,22 @@ protected:
 private:
 	// ShaderProg Private Methods.
 	GLuint AddShader(const std::string& sourceText, GLenum shaderType);
+	void SubmitSources();
+	static void CheckCompileStatus(GLuint shaderObj);
+	static void InjectDefines(const std::string& defines, std::string& sourceText);
 	static bool LoadShaderTextFromFile(const std::filesystem::path&, std::string& sourceText);
+	static std::filesystem::path GetBinaryFilePath(const std::string& vs, const std::string& fs, const std::string& gs);
+	bool SubmitProgramBinary(const std::filesystem::path&);
+	void SaveProgramBinary(const std::filesystem::path&);
 
 	// ShaderProg Private Data.
 	GLint locMVP;
+	bool loadedFromCache;
+	bool pending;
+	std::string sources[3];	// Vertex, fragment and geometry stage, kept until Finish().
+	GLuint stageIds[3];
+	std::filesystem::path binaryFilePath;
+	static std::filesystem::path binaryCacheDir;
 };
 
 // ------------------------------------------------------------------------------------------------
@@ -60,6 +119,21 @@ private:
 
 // ------------------------------------------------------------------------------------------------
 
+// DepthOnlyShaderProg Declarations.
+class DepthOnlyShaderProg : public ShaderProg
+{
+public:
+	// DepthOnlyShaderProg Public Methods.
+	DepthOnlyShaderProg();
+	~DepthOnlyShaderProg();
+
+protected:
+	// DepthOnlyShaderProg Protected Methods.
+	void GetUniformVariableLocation() override;
+};
+
+// ------------------------------------------------------------------------------------------------
+
 // PhongShadingDemoShaderProg Declarations.
 class PhongShadingDemoShaderProg : public ShaderProg
 {
@@ -68,6 +142,10 @@ public:
 	PhongShadingDemoShaderProg();
 	~PhongShadingDemoShaderProg();
 
+	// Material table of the HAS_MATERIAL_TABLE variants; must match phong_shading_demo.fs.
+	static constexpr GLuint MATERIAL_TABLE_BINDING_POINT = 1;
+	static constexpr int MAX_TABLE_MATERIALS = 256;
+
 	GLint GetLocM() const { return locM; }
 	GLint GetLocV() const { return locV; }
 	GLint GetLocNM() const { return locNM; }
@@ -77,16 +155,7 @@ public:
 	GLint GetLocKs() const { return locKs; }
 	GLint GetLocNs() const { return locNs; }
 	GLint GetLocMapKd() const { return locMapKd; }
-	GLint GetLocAmbientLight() const { return locAmbientLight; }
-	GLint GetLocDirLightDir() const { return locDirLightDir; }
-	GLint GetLocDirLightRadiance() const { return locDirLightRadiance; }
-	GLint GetLocPointLightPos() const { return locPointLightPos; }
-	GLint GetLocPointLightIntensity() const { return locPointLightIntensity; }
-	GLint GetLocSpotLightPos() const { return locSpotLightPos; }
-	GLint GetLocSpotLightDir() const { return locSpotLightDir; }
-	GLint GetLocSpotLightIntensity() const { return locSpotLightIntensity; }
-	GLint GetLocSpotLightCutoff() const { return locSpotLightCutoff; }
-	GLint GetLocSpotLightTotalWidth() const { return locSpotLightTotalWidth; }
+	GLint GetLocMapKdArray() const { return locMapKdArray; }
 
 protected:
 	// PhongShadingDemoShaderProg Protected Methods.
@@ -105,17 +174,108 @@ private:
 	GLint locKs;
 	GLint locNs;
 	GLint locMapKd;
-	// Light data.
-	GLint locAmbientLight;
-	GLint locDirLightDir;
-	GLint locDirLightRadiance;
-	GLint locPointLightPos;
-	GLint locPointLightIntensity;
-	GLint locSpotLightPos;
-	GLint locSpotLightDir;
-	GLint locSpotLightIntensity;
-	GLint locSpotLightCutoff;
-	GLint locSpotLightTotalWidth;
+	GLint locMapKdArray;
+	// Light data comes from the LightBlock uniform buffer.
+};
+
+// ------------------------------------------------------------------------------------------------
+
+// PhongShadingFeature Declarations.
+// Each bit turns on a block of phong_shading_demo.fs through a #define.
+enum PhongShadingFeature : unsigned int
+{
+	PHONG_HAS_TEXTURE = 1 << 0,
+	PHONG_HAS_DIR_LIGHT = 1 << 1,
+	PHONG_HAS_POINT_LIGHT = 1 << 2,
+	PHONG_HAS_SPOT_LIGHT = 1 << 3,
+	PHONG_HAS_SPECULAR = 1 << 4,
+	PHONG_HAS_MATERIAL_TABLE = 1 << 5,	// Per-vertex material from a table and a texture array.
+	PHONG_FACE_NORMALS = 1 << 6,		// Normals of the triangles, for meshes without vertex normals.
+};
+
+// PhongShaderVariants Declarations.
+class PhongShaderVariants
+{
+public:
+	// PhongShaderVariants Public Methods.
+	PhongShaderVariants(const std::filesystem::path& vsFilePath, const std::filesystem::path& fsFilePath,
+		const std::filesystem::path& gsFilePath);
+	~PhongShaderVariants();
+
+	/**
+	 * @brief Get the program specialized for a feature mask, submitting it on first request.
+	 *
+	 * @return nullptr if the variant fails to load. The program is owned by
+	 * the variants and lives as long as they do.
+	*/
+	PhongShadingDemoShaderProg* Get(const unsigned int features);
+
+	/**
+	 * @brief Submit the variants expected to be used, so they compile in parallel at startup.
+	*/
+	bool Prewarm(const std::vector<unsigned int>& featureMasks);
+
+	int GetNumVariants() const { return (int)variants.size(); }
+	int GetNumLoadedFromCache() const;
+
+	static std::string GetDefines(const unsigned int features);
+
+private:
+	// PhongShaderVariants Private Data.
+	std::filesystem::path vsFilePath;
+	std::filesystem::path fsFilePath;
+	std::filesystem::path gsFilePath;
+	std::map<unsigned int, std::unique_ptr<PhongShadingDemoShaderProg>> variants;
+};
+
+// ------------------------------------------------------------------------------------------------
+
+// UpscaleShaderProg Declarations.
+class UpscaleShaderProg : public ShaderProg
+{
+public:
+	// UpscaleShaderProg Public Methods.
+	UpscaleShaderProg();
+	~UpscaleShaderProg();
+
+	GLint GetLocSourceTex() const { return locSourceTex; }
+	GLint GetLocUvScale() const { return locUvScale; }
+	GLint GetLocTexelSize() const { return locTexelSize; }
+	GLint GetLocSharpness() const { return locSharpness; }
+
+protected:
+	// UpscaleShaderProg Protected Methods.
+	void GetUniformVariableLocation() override;
+
+private:
+	// UpscaleShaderProg Private Data.
+	GLint locSourceTex;
+	GLint locUvScale;
+	GLint locTexelSize;
+	GLint locSharpness;
+};
+
+// ------------------------------------------------------------------------------------------------
+
+// PointCloudShaderProg Declarations.
+class PointCloudShaderProg : public ShaderProg
+{
+public:
+	// PointCloudShaderProg Public Methods.
+	PointCloudShaderProg();
+	~PointCloudShaderProg();
+
+	GLint GetLocScreenScale() const { return locScreenScale; }
+	GLint GetLocPointSpacing() const { return locPointSpacing; }
+
+protected:
+	// PointCloudShaderProg Protected Methods.
+	void GetUniformVariableLocation() override;
+
+private:
+	// PointCloudShaderProg Private Data.
+	GLint locScreenScale;
+	GLint locPointSpacing;
 };
 
 // ------------------------------------------------------------------------------------------------
@@ -128,7 +288,8 @@ public:
 	SkyboxShaderProg();
 	~SkyboxShaderProg();
 
-	GLint GetLocMapKd() const { return locMapKd; }
+	GLint GetLocInvViewProj() const { return locInvViewProj; }
+	GLint GetLocCubeMap() const { return locCubeMap; }
 
 protected:
 	// PhongShadingDemoShaderProg Protected Methods.
@@ -136,5 +297,6 @@ protected:
 
 private:
 	// SkyboxShaderProg Public Data.
-	GLint locMapKd;
+	GLint locInvViewProj;
+	GLint locCubeMap;
 };
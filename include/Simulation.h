@@ -0,0 +1,78 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// C++ STL headers.
+#include <cstdint>
+#include <memory>
+
+namespace opengl_homework {
+
+/**
+ * @brief State produced by one simulation tick.
+ *
+ * Snapshots are plain values: the render thread reads its copies without
+ * synchronizing with the simulation thread.
+*/
+struct SimulationState
+{
+	double time = 0.0;				// Seconds since the simulation started.
+	uint64_t inputSequence = 0;		// Last input command applied.
+	bool rotating = true;
+	float modelRotation = 0.0f;		// Radians around the y axis.
+	float skyboxRotation = 0.0f;	// Radians around the y axis.
+	glm::vec3 pointLightPosition = glm::vec3(0.0f);
+	glm::vec3 spotLightPosition = glm::vec3(0.0f);
+};
+
+/**
+ * @brief Simulation class.
+ *
+ * Advances the scene (object transforms and light movement) on its own
+ * thread at a fixed tick, independent of the frame rate. Input callbacks
+ * queue commands that are applied at the start of the next tick. Each tick
+ * publishes a snapshot through a lock-free triple buffer; the render thread
+ * samples one tick in the past and interpolates between the last two
+ * snapshots it received.
+*/
+class Simulation
+{
+public:
+	// Simulation Public Methods.
+	Simulation(const SimulationState& initialState, const double tickRate = 60.0);
+	~Simulation();
+
+	// Input commands, safe to call from any thread.
+	void MovePointLight(const glm::vec3& offset);
+	void MoveSpotLight(const glm::vec3& offset);
+	void ToggleRotation();
+	void ResetModelRotation();
+	void ResetSkyboxRotation();
+
+	/**
+	 * @brief Interpolated state for the frame being rendered.
+	 *
+	 * @note Must only be called from the render thread.
+	*/
+	SimulationState Sample();
+
+	/**
+	 * @brief Whether the last Sample() already shows every queued input.
+	 *
+	 * While this is false, another frame is needed even if nothing animates.
+	*/
+	bool IsSettled() const;
+
+	double GetTickInterval() const;
+
+private:
+	// Simulation Private Methods.
+	void ThreadLoop();
+
+	// Simulation Private Data.
+	struct Impl;
+	std::unique_ptr<Impl> pImpl;
+};
+
+}
@@ -1,54 +1,64 @@
 #pragma once
 
-#include "ImageTexture.h"
 #include "ShaderProg.h"
-#include "Material.h"
 #include "Camera.h"
+#include "FullscreenTriangle.h"
+#include "JobSystem.h"
+#include "SphericalHarmonics.h"
 
-// VertexPT Declarations.
-struct VertexPT
-{
-	VertexPT() {
-		position = glm::vec3(0.0f, 0.0f, 0.0f);
-		texcoord = glm::vec2(0.0f, 0.0f);
-	}
-	VertexPT(glm::vec3 p, glm::vec2 uv) {
-		position = p;
-		texcoord = uv;
-	}
-	glm::vec3 position;
-	glm::vec2 texcoord;
-};
-
+#include <filesystem>
+#include <memory>
 
 // Skybox Declarations.
+// The equirectangular panorama is resampled once into a cubemap on the job
+// system and cached under cache/skybox, so switching only reads the faces
+// back. It is drawn as one fullscreen triangle on the far plane after the
+// opaque scene, so the depth test drops every pixel the scene covers.
+// Its diffuse irradiance is projected onto spherical harmonics at the same
+// time and cached with the faces, to light the scene with.
 class Skybox
 {
 public:
 	// Skybox Public Methods.
-	Skybox(const std::filesystem::path& texImagePath, const int nSlices,
-		const int nStacks, const float radius);
+	Skybox(const std::filesystem::path& texImagePath);
 	~Skybox();
+
+	/**
+	 * @brief Create the cubemap once its faces are loaded. GL thread only.
+	 *
+	 * @return Whether the skybox can be drawn.
+	*/
+	bool Prepare();
+	bool IsLoading() const { return cubemapObj == 0 && !loadJob.IsDone(); }
 	void Render(std::shared_ptr<Camera> camera, std::shared_ptr<SkyboxShaderProg> shader);
 
 	void SetRotation(const float newRotation) { rotationY = newRotation; }
 
-	std::shared_ptr<SkyboxMaterial> GetMaterial() const { return material; }
 	float GetRotation() const { return rotationY; }
 
+	/**
+	 * @brief Ambient light of the panorama, in its own frame. Valid once Prepare() succeeds.
+	*/
+	const IrradianceSH& GetIrradiance() const;
+
+	static void SetCacheDir(const std::filesystem::path& cacheDir) { faceCacheDir = cacheDir; }
+
 private:
+	// Skybox Private Declarations.
+	struct Faces;
+
 	// Skybox Private Methods.
-	static void CreateSphere3D(const int nSlices, const int nStacks, const float radius,
-		std::vector<VertexPT>& vertices, std::vector<unsigned int>& indices);
+	static void LoadFaces(const std::filesystem::path& texImagePath, Faces& faces);
+	static bool ReadCache(const std::filesystem::path& cacheFilePath, const uint64_t sourceStamp, Faces& faces);
+	static void WriteCache(const std::filesystem::path& cacheFilePath, const uint64_t sourceStamp, const Faces& faces);
 
 	// Skybox Private Data.
-	GLuint vboId;
-	GLuint iboId;
-	std::vector<VertexPT> vertices;
-	std::vector<unsigned int> indices;
-
-	std::shared_ptr<SkyboxMaterial> material;
-	std::shared_ptr<ImageTexture> panorama;
+	std::shared_ptr<Faces> faces;	// Shared with the load job, which may outlive the skybox.
+	JobHandle loadJob;
+	GLuint cubemapObj;
+	FullscreenTriangle triangle;
 
 	float rotationY;
+
+	static std::filesystem::path faceCacheDir;
 };
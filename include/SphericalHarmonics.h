@@ -0,0 +1,36 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// OpenCV headers.
+#include <opencv2/opencv.hpp>
+
+/**
+ * @brief Diffuse irradiance of an environment as 9 spherical-harmonic terms.
+ *
+ * The band convolution and the basis constants are folded in, so the
+ * light a diffuse surface facing n receives, divided by pi, is
+ *
+ *     c0 + c1 y + c2 z + c3 x + c4 xy + c5 yz + c6 (3z^2 - 1) + c7 xz + c8 (x^2 - y^2)
+ *
+ * with n in the panorama frame. A constant environment of radiance L gives
+ * c0 = L and zero for the rest.
+*/
+struct IrradianceSH
+{
+	glm::vec3 coefficients[9];
+
+	/**
+	 * @brief The terms of a constant environment.
+	*/
+	static IrradianceSH Constant(const glm::vec3& radiance);
+};
+
+/**
+ * @brief Project an 8-bit BGR equirectangular panorama onto IrradianceSH.
+ *
+ * Rows are split across the job system and each row accumulates four
+ * pixels at a time with SSE when it is available.
+*/
+IrradianceSH ProjectPanorama(const cv::Mat& panorama);
@@ -0,0 +1,63 @@
+#pragma once
+
+// C++ STL headers.
+#include <cstddef>
+#include <vector>
+
+// OpenCV headers.
+#include <opencv2/opencv.hpp>
+
+// OpenGL headers.
+#include <GL/glew.h>
+
+// Project headers.
+#include "TextureResidency.h"
+
+/**
+ * @brief TextureArray class.
+ *
+ * Images of different sizes resampled to one layer size and stored as the
+ * layers of a GL_TEXTURE_2D_ARRAY, so a shader can pick the texture per
+ * vertex and draws sharing the array need no texture switch.
+ *
+ * @note As with ImageTexture, the layers and their mip chains are filled in
+ * host memory (on any thread, one thread per layer) and Upload() must run on
+ * the GL thread; the levels are then streamed by the UploadManager.
+*/
+class TextureArray : public StreamableTexture
+{
+public:
+	// TextureArray Public Methods.
+	TextureArray(const int width, const int height, const int numLayers);
+	~TextureArray();
+
+	/**
+	 * @brief Resample an 8-bit image with 1, 3 or 4 channels into a layer.
+	*/
+	void SetLayer(const int layer, const cv::Mat& image);
+
+	void Upload();
+	GLuint GetTextureId() const { return textureObj; }
+	int GetNumLayers() const { return numLayers; }
+	size_t GetHostMemoryBytes() const;
+
+	// StreamableTexture Methods.
+	int GetWidth() const override { return layerWidth; }
+	int GetHeight() const override { return layerHeight; }
+	int GetNumLevels() const override { return (int)levels.size(); }
+	size_t GetLevelBytes(const int level) const override;
+	int GetResidentLevel() const override { return residentLevel; }
+	void SetResidentLevel(const int level) override;
+
+private:
+	// TextureArray Private Methods.
+	void CreateTexture();
+
+	// TextureArray Private Data.
+	GLuint textureObj;
+	int layerWidth;
+	int layerHeight;
+	int numLayers;
+	int residentLevel;	// Host level stored as GL level 0.
+	std::vector<cv::Mat> levels;	// Mip chain; BGR layers stacked vertically, bottom row first like ImageTexture.
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+// GLM headers.
+#include <glm/glm.hpp>
+
+// C++ STL headers.
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * @brief A texture whose mip chain is kept in host memory and whose GPU
+ * storage can be recreated from any level down.
+*/
+class StreamableTexture
+{
+public:
+	virtual ~StreamableTexture() = default;
+
+	virtual int GetWidth() const = 0;
+	virtual int GetHeight() const = 0;
+	virtual int GetNumLevels() const = 0;
+
+	/**
+	 * @brief Estimated GPU bytes of one level, all layers included.
+	*/
+	virtual size_t GetLevelBytes(const int level) const = 0;
+
+	/**
+	 * @brief Finest level held on the GPU.
+	*/
+	virtual int GetResidentLevel() const = 0;
+
+	/**
+	 * @brief Recreate the GPU storage with the levels from this one down.
+	*/
+	virtual void SetResidentLevel(const int level) = 0;
+};
+
+/**
+ * @brief Residency statistics of the last Update().
+*/
+struct TextureResidencyStats
+{
+	size_t budgetBytes = 0;
+	size_t residentBytes = 0;
+	size_t requestedBytes = 0;	// If every texture had the level the feedback asked for.
+	int numTextures = 0;
+	int numOverBudget = 0;		// Textures held coarser than requested.
+	uint64_t levelsStreamedIn = 0;
+	uint64_t levelsEvicted = 0;
+};
+
+/**
+ * @brief TextureResidency class.
+ *
+ * Keeps the textures on the GPU at the finest mip level they need, within
+ * a memory budget. Every frame a feedback pass estimates, from the screen
+ * size of what each texture is drawn on, the finest level that still has
+ * at most one texel per pixel and reports it with Request(). Update() then
+ * recreates the textures whose level changed; finer levels stream in
+ * through the UploadManager, coarsest first. Textures drop levels only
+ * after they have asked for less for a while, or right away when the
+ * budget is exceeded, least recently used first. A texture never drops
+ * below its small coarse levels, so it can always be sampled.
+ *
+ * @note GL thread only.
+*/
+class TextureResidency
+{
+public:
+	static TextureResidency& GetInstance();
+
+	void SetBudget(const size_t bytes) { budgetBytes = bytes; }
+
+	/**
+	 * @brief Start the feedback pass of a frame rendered at this size.
+	*/
+	void BeginFrame(const int viewportWidth, const int viewportHeight);
+
+	/**
+	 * @brief Track a texture.
+	 *
+	 * @return The level to create its GPU storage with.
+	*/
+	int Register(StreamableTexture* texture);
+	void Unregister(StreamableTexture* texture);
+
+	/**
+	 * @brief Size in pixels of a box projected to the screen.
+	 *
+	 * @return Zero if the box is outside the view.
+	*/
+	glm::vec2 GetScreenExtent(const glm::mat4& MVP, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+	glm::vec2 GetViewportSize() const { return glm::vec2((float)viewportWidth, (float)viewportHeight); }
+
+	/**
+	 * @brief Report that a texture is drawn mapped once over this many pixels.
+	*/
+	void Request(StreamableTexture* texture, const glm::vec2& screenExtent);
+
+	/**
+	 * @brief Pick the level of every texture from the requests of the frame
+	 * and the budget, and recreate the ones that changed.
+	*/
+	void Update();
+
+	const TextureResidencyStats& GetStats() const { return stats; }
+
+private:
+	// TextureResidency Private Declarations.
+	struct Entry
+	{
+		int coarseLevel = 0;		// Never evicted past this one.
+		int requestedLevel = 0;		// Finest level asked for this frame.
+		bool requested = false;
+		int coarserFrames = 0;		// Consecutive frames it asked for less than it holds.
+		uint64_t lastUsedFrame = 0;
+	};
+
+	// TextureResidency Private Methods.
+	TextureResidency() = default;
+
+	static size_t GetResidentBytes(const StreamableTexture& texture, const int level);
+
+	// TextureResidency Private Data.
+	std::unordered_map<StreamableTexture*, Entry> entries;
+	size_t budgetBytes = 256 * 1024 * 1024;
+	int viewportWidth = 1;
+	int viewportHeight = 1;
+	uint64_t frameIndex = 0;
+	TextureResidencyStats stats;
+};
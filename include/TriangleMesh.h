@@ -8,8 +8,12 @@
 
 // Project headers.
 #include "Light.h"
+#include "LightBlock.h"
 #include "ShaderProg.h"
 #include "Camera.h"
+#include "CommandList.h"
+#include "MeshLoadHint.h"
+#include "ResourcePool.h"
 
 namespace opengl_homework {
 
@@ -21,10 +25,16 @@ class TriangleMesh
 public:
 	// TriangleMesh Public Methods.
 	TriangleMesh(const std::filesystem::path&, const bool);
+	TriangleMesh(const std::filesystem::path&, const bool, const MeshLoadHint&);
 	~TriangleMesh();
 
 	/**
 	 * @brief Create buffers for rendering.
+	 *
+	 * @note The constructor only touches host memory, so a mesh can be
+	 * loaded on a worker thread. This allocates the GL objects and must run
+	 * on the GL thread; their data streams in through the UploadManager,
+	 * and the mesh is not drawn until IsResident().
 	*/
 	void CreateBuffers();
 
@@ -33,30 +43,99 @@ public:
 	*/
 	void ReleaseBuffers();
 
+	/**
+	 * @brief Render depth only from the position stream.
+	 *
+	 * @param shaderProg
+	 * @param worldMatrix
+	 * @param camera
+	*/
+	void RenderDepth(
+		DepthOnlyShaderProg&,
+		const glm::mat4&,
+		Camera&) const;
+
+	/**
+	 * @brief Feedback for TextureResidency: request the mip level of every
+	 * texture from the screen size of the mesh.
+	 *
+	 * @param worldMatrix
+	 * @param camera
+	*/
+	void RequestTextureLevels(const glm::mat4&, Camera&) const;
+
+	/**
+	 * @brief Stream the chunks of a chunked mesh for this view.
+	 *
+	 * The chunks in view are ranked by their size on screen; the largest
+	 * that fit in the chunk budget are uploaded from the mapped file, a few
+	 * at a time, and the chunks out of view or smaller on screen are evicted
+	 * to make room. Chunks that are not resident are drawn as their coarse
+	 * proxy. Does nothing for other meshes.
+	 *
+	 * @note GL thread only; call once per frame before Render().
+	 *
+	 * @param worldMatrix
+	 * @param camera
+	*/
+	void StreamChunks(const glm::mat4&, Camera&);
+
+	/**
+	 * @brief Pick the level of detail of a cooked mesh for this view.
+	 *
+	 * The coarsest level whose position error stays under a couple of
+	 * pixels at the size of the mesh on screen is drawn by both the depth
+	 * and the shading pass. Does nothing for other meshes.
+	 *
+	 * @note Call once per frame before RenderDepth() and Render().
+	 *
+	 * @param worldMatrix
+	 * @param camera
+	*/
+	void SelectLod(const glm::mat4&, Camera&);
+
 	/**
 	 * @brief Render the mesh.
+	 *
+	 * Each submesh is drawn with the shader variant matching its material
+	 * and the lights that are present. The draws are recorded on the job
+	 * system, one command list per group of submeshes, and submitted to the
+	 * queue; they reach the GPU when the queue is replayed.
+	 *
+	 * @note Call on the GL thread: the shader variants are resolved here.
+	 * A submesh whose variant is still compiling is skipped rather than
+	 * waited for.
 	 * 
-	 * @param shaderProg
+	 * @param commandQueue
+	 * @param sortKey Replay order of this mesh relative to other submitters.
+	 * @param shaderVariants
 	 * @param worldMatrix
-	 * @param ambientLight
-	 * @param dirLight
-	 * @param pointLight
-	 * @param spotLight
+	 * @param lightBlock Lights prepared and uploaded for this frame.
 	 * @param camera
+	 * @return false if submeshes were skipped; draw another frame to show them.
 	*/
-	void Render(
-		const std::shared_ptr<PhongShadingDemoShaderProg>&,
+	bool Render(
+		CommandQueue&,
+		const uint32_t,
+		PhongShaderVariants&,
 		const glm::mat4&,
-		const glm::vec3&, 
-		const std::shared_ptr<DirectionalLight>&,
-		const std::shared_ptr<PointLight>&, 
-		const std::shared_ptr<SpotLight>&,
-		const std::shared_ptr<Camera>&) const;
+		const LightBlock&,
+		Camera&) const;
 
 	int GetNumVertices() const;
 	int GetNumTriangles() const;
 	int GetNumIndices() const;
 	glm::vec3 GetObjCenter() const;
+	void GetBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+	bool IsLoaded() const;
+	bool IsResident() const;
+
+	/**
+	 * @brief Get the host memory held by the mesh.
+	 *
+	 * @return Bytes of vertices, indices and decoded textures.
+	*/
+	size_t GetHostMemoryBytes() const;
 
 	void PrintMeshInfo() const;
 
@@ -65,6 +144,8 @@ private:
 	// VertexPTN Declarations.
 	struct VertexPTN;
 	struct SubMesh;
+	struct PlyChunk;
+	struct PlyUpload;
 
 	/**
 	 * @brief TriangleMesh Private Declarations.
@@ -82,10 +163,83 @@ private:
 	 *
 	 * @param objFilePath Path to the obj file.
 	 * @param normalized Normalize the model to fit in a unit cube.
+	 * @param hint Element counts used to reserve the containers.
 	 *
 	 * @return true if the model is loaded successfully.
 	*/
-	bool LoadFromFile(const std::filesystem::path&, const bool);
+	bool LoadFromFile(const std::filesystem::path&, const bool, const MeshLoadHint&);
+
+	/**
+	 * @brief Load a model from a binary glTF file.
+	 *
+	 * The file stays mapped and its binary chunk is uploaded as the vertex
+	 * and index buffer as it is; each primitive becomes a submesh reading
+	 * its streams in place, with the node transform and the normalization
+	 * applied as its local matrix.
+	 *
+	 * @param glbFilePath Path to the glb file.
+	 * @param normalized Normalize the model to fit in a unit cube.
+	 *
+	 * @return true if the model is loaded successfully.
+	*/
+	bool LoadFromGlb(const std::filesystem::path&, const bool);
+
+	/**
+	 * @brief Check the header of a binary PLY file.
+	 *
+	 * Nothing else is read here: CreateBuffers() streams the vertices and
+	 * faces through a few fixed-size chunks, so the host memory used does
+	 * not depend on the file size. Until the vertices are in, the bounds
+	 * are the unit cube when normalized.
+	 *
+	 * @param plyFilePath Path to the ply file.
+	 * @param normalized Normalize the model to fit in a unit cube.
+	 *
+	 * @return true if the header describes a mesh the reader supports.
+	*/
+	bool LoadFromPly(const std::filesystem::path&, const bool);
+
+	/**
+	 * @brief Map a chunked mesh file built by ChunkedMeshFile::Build().
+	 *
+	 * Only the chunk table is read; CreateBuffers() uploads the proxies and
+	 * StreamChunks() the chunks in view.
+	 *
+	 * @param chunksFilePath Path to the chunks file.
+	 * @param normalized Normalize the model to fit in a unit cube.
+	 *
+	 * @return true if the file is a valid chunked mesh.
+	*/
+	bool LoadFromChunks(const std::filesystem::path&, const bool);
+
+	/**
+	 * @brief Map a cooked mesh file built by CookedMeshFile::Build().
+	 *
+	 * The material libraries it names are loaded as for an OBJ; the
+	 * vertices and indices are uploaded from the mapping as they are, and
+	 * every submesh dequantizes its positions through its local matrix.
+	 *
+	 * @param cookedFilePath Path to the cmesh file.
+	 * @param normalized Normalize the model to fit in a unit cube.
+	 *
+	 * @return true if the file is a valid cooked mesh.
+	*/
+	bool LoadFromCooked(const std::filesystem::path&, const bool);
+
+	/**
+	 * @brief Read the next chunk of the PLY file on the job system, if a chunk buffer is free.
+	*/
+	void ReadNextPlyChunk();
+
+	/**
+	 * @brief Queue the upload of a chunk that has been read. GL thread only.
+	*/
+	void QueuePlyChunk(const PlyChunk&);
+
+	/**
+	 * @brief Place the mesh from its bounds and let it be drawn, once every chunk is uploaded.
+	*/
+	void FinishPlyUpload();
 
 	/**
 	 * @brief Load material library.
@@ -97,11 +251,31 @@ private:
 	bool LoadMtllib(const std::filesystem::path&);
 
 	/**
-	 * @brief Render the submesh.
+	 * @brief Pack the materials into a uniform table and their diffuse maps into
+	 * a texture array so the mesh renders in one draw.
+	 *
+	 * @note Keeps the per-submesh path if a submesh has no material or the
+	 * materials exceed the table or the array.
+	*/
+	void BuildMaterialTable();
+
+	/**
+	 * @brief Record the whole mesh as one draw with the material table.
+	 *
+	 * @return false if the shader is still compiling and nothing was recorded.
+	*/
+	bool RenderMaterialTable(CommandQueue&, const uint32_t, PhongShadingDemoShaderProg*, const glm::mat4&,
+		const glm::mat4&, const glm::mat4&, const glm::mat4&, const glm::vec3&) const;
+
+	/**
+	 * @brief Record the vertex setup and the draw of a submesh.
 	 * 
+	 * @param commandList
 	 * @param subMesh
 	 */
-	void RenderSubMesh(const SubMesh&) const;
+	void RecordSubMesh(CommandList&, const SubMesh&) const;
 };
 
+using MeshHandle = Handle<TriangleMesh>;
+
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#pragma once
+
+// C++ STL headers.
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// OpenGL headers.
+#include <GL/glew.h>
+
+// Project headers.
+#include "JobSystem.h"
+
+/**
+ * @brief One mip level in host memory, with its layers stacked vertically
+ * and rows tightly packed.
+*/
+struct TextureLevel
+{
+	const uint8_t* data = nullptr;
+	GLsizei width = 0;
+	GLsizei height = 0;
+	GLsizei depth = 1;	// Layers of a GL_TEXTURE_2D_ARRAY level.
+};
+
+/**
+ * @brief UploadManager class.
+ *
+ * Streams buffer and texture data to the GPU a slice at a time, so a large
+ * model never stalls the frame it is loaded in. Queued uploads are split
+ * into chunks of at most 1 MB and staged into a ring buffer that stays
+ * persistently mapped (ARB_buffer_storage). The copies into the ring run on
+ * the job system one frame ahead, and Pump() issues the staged chunks as
+ * GL copies up to a byte and time budget per frame. A fence per frame tells
+ * when the GPU has consumed a stretch of the ring so it can be reused.
+ *
+ * Without ARB_buffer_storage the chunks are issued straight from host
+ * memory, still within the budget.
+ *
+ * UploadMipChain() uploads the small coarse levels of a texture at once
+ * and streams the rest coarsest first, lowering the base level as each one
+ * completes, so a texture can be sampled from the first frame and sharpens
+ * over the following ones.
+ *
+ * @note Every method must be called on the GL thread. The host data of a
+ * queued upload must stay alive until it completes or its owner calls
+ * Cancel().
+*/
+class UploadManager
+{
+public:
+	/**
+	 * @brief Get the process-wide upload manager. The ring is created on the first Pump().
+	*/
+	static UploadManager& GetInstance();
+
+	~UploadManager();
+
+	/**
+	 * @brief Limit the uploads issued by one Pump().
+	 *
+	 * @note At least one chunk is issued per frame, so uploads always progress.
+	*/
+	void SetFrameBudget(const size_t bytes, const double microseconds);
+
+	/**
+	 * @brief Queue a copy of host data into [offset, offset + bytes) of a buffer.
+	 *
+	 * @param owner Key for Cancel(), usually the object that owns the buffer.
+	 * @param onComplete Run on the GL thread once the last chunk is issued.
+	*/
+	void QueueBuffer(const void* owner, const GLuint buffer, const GLintptr offset, const void* data, const size_t bytes,
+		std::function<void()> onComplete = nullptr);
+
+	/**
+	 * @brief Queue one mip level of a GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+	 * whose storage is already allocated. Rows go in bottom up, layer by layer.
+	*/
+	void QueueTexture(const void* owner, const GLenum target, const GLuint texture, const GLint level,
+		const TextureLevel& data, const GLenum format, const size_t bytesPerPixel,
+		std::function<void()> onComplete = nullptr);
+
+	/**
+	 * @brief Allocate every level of a texture, upload the coarse ones now and
+	 * queue the others from coarse to fine.
+	 *
+	 * @param levels Level 0 first, down to 1x1.
+	*/
+	void UploadMipChain(const void* owner, const GLenum target, const GLuint texture, const GLint internalFormat,
+		const GLenum format, const size_t bytesPerPixel, const std::vector<TextureLevel>& levels);
+
+	/**
+	 * @brief Drop the queued uploads of an owner, waiting for copies of its data that are running.
+	*/
+	void Cancel(const void* owner);
+
+	/**
+	 * @brief Reclaim the ring space the GPU is done with, issue staged chunks
+	 * within the frame budget and stage the next ones. Call once per frame.
+	*/
+	void Pump();
+
+	bool HasPendingUploads() const { return !chunks.empty(); }
+	size_t GetPendingBytes() const;
+	size_t GetBytesIssuedLastFrame() const { return bytesIssuedLastFrame; }
+
+private:
+	// UploadManager Private Declarations.
+	struct Chunk
+	{
+		const void* owner = nullptr;
+		const uint8_t* data = nullptr;
+		size_t bytes = 0;
+		GLenum target = 0;		// GL_COPY_WRITE_BUFFER, or the texture target.
+		GLuint object = 0;
+		GLintptr offset = 0;	// Buffers.
+		GLint level = 0;		// Textures.
+		GLint yoffset = 0;
+		GLint zoffset = 0;
+		GLsizei width = 0;
+		GLsizei height = 0;
+		GLenum format = 0;
+		std::function<void()> onComplete;
+		bool cancelled = false;
+		// Staging.
+		bool reserved = false;
+		size_t ringOffset = 0;
+		size_t ringBytes = 0;	// Including the padding skipped when the ring wrapped.
+		JobHandle stagingJob;
+	};
+
+	struct FrameFence
+	{
+		GLsync sync;
+		size_t ringBytes;
+	};
+
+	// UploadManager Private Methods.
+	UploadManager() = default;
+
+	void SetOnComplete(const size_t numQueuedBefore, std::function<void()> onComplete);
+	void CreateRing();
+	void RetireFrames();
+	void Stage();
+	bool Reserve(const size_t bytes, size_t& offset, size_t& reservedBytes);
+	void Issue(const Chunk& chunk) const;
+
+	// UploadManager Private Data.
+	size_t frameByteBudget = 8 * 1024 * 1024;
+	double frameTimeBudgetUs = 2000.0;
+	size_t bytesIssuedLastFrame = 0;
+
+	std::deque<Chunk> chunks;
+	std::deque<FrameFence> frameFences;
+
+	bool ringCreated = false;
+	GLuint ringBuffer = 0;
+	uint8_t* ringData = nullptr;
+	size_t ringCapacity = 32 * 1024 * 1024;
+	size_t ringHead = 0;
+	size_t ringUsed = 0;
+};
@@ -6,10 +6,16 @@ layout (triangle_strip, max_vertices = 3) out;
 in vec3 vPosition[];
 in vec3 vNormal[];
 in vec2 vTexCoord[];
+#ifdef HAS_MATERIAL_TABLE
+flat in int vMaterial[];
+#endif
 
 out vec3 fPosition;
 out vec3 fNormal;
 out vec2 fTexCoord;
+#ifdef HAS_MATERIAL_TABLE
+flat out int fMaterial;
+#endif
 
 void main() {
     vec3 normal = normalize(cross(vPosition[1] - vPosition[0], vPosition[2] - vPosition[0]));
@@ -19,8 +25,15 @@ void main() {
 
     for (int i = 0; i < 3; i++) {
         fPosition = vPosition[i];
+#ifdef FACE_NORMALS
+        fNormal = normal;
+#else
         fNormal = vNormal[i];
+#endif
         fTexCoord = vTexCoord[i];
+#ifdef HAS_MATERIAL_TABLE
+        fMaterial = vMaterial[i];
+#endif
         gl_Position = gl_in[i].gl_Position;
         EmitVertex();
     }
@@ -7,22 +7,49 @@ uniform mat4 normalMatrix;
 uniform mat4 MVP;
 
 // Material properties.
+#ifdef HAS_MATERIAL_TABLE
+// One entry per material of the mesh, picked per vertex; filled by TriangleMesh.
+// Kd.w is the layer in mapKdArray, or -1 without a texture; Ks.w is Ns.
+const int MAX_TABLE_MATERIALS = 256;    // PhongShadingDemoShaderProg::MAX_TABLE_MATERIALS.
+struct MaterialEntry
+{
+    vec4 Ka;
+    vec4 Kd;
+    vec4 Ks;
+};
+layout (std140) uniform MaterialBlock
+{
+    MaterialEntry materialTable[MAX_TABLE_MATERIALS];
+};
+uniform sampler2DArray mapKdArray;
+flat in int fMaterial;
+
+// Set from the table at the start of main().
+vec3 Ka;
+vec3 Kd;
+vec3 Ks;
+float Ns;
+#else
 uniform vec3 Ka;
 uniform vec3 Kd;
 uniform vec3 Ks;
 uniform float Ns;
 uniform sampler2D mapKd;
-// Light data.
-uniform vec3 dirLightDir;
-uniform vec3 dirLightRadiance;
-uniform vec3 pointLightPos;
-uniform vec3 pointLightIntensity;
-uniform vec3 spotLightPos;
-uniform vec3 spotLightDir;
-uniform vec3 spotLightIntensity;
-uniform float spotLightCutoff;
-uniform float spotLightTotalWidth;
-uniform vec3 ambientLight;
+#endif
+// Light data, already in view space. Filled once per frame by LightBlock.
+layout (std140) uniform LightBlock
+{
+    vec4 dirLightDir;
+    vec4 dirLightRadiance;
+    vec4 pointLightPos;
+    vec4 pointLightIntensity;
+    vec4 spotLightPos;
+    vec4 spotLightDir;
+    vec4 spotLightIntensity;
+    vec4 spotLightCone;     // x: cos of the outer angle, y: 1 / (cos inner - cos outer).
+    mat3 viewToSky;         // View space to the frame of the ambient terms.
+    vec4 ambientSH[9];      // Irradiance over pi, spherical harmonics up to band 2.
+};
 
 // Camera position.
 uniform vec3 locCameraPos;
@@ -33,9 +60,21 @@ in vec2 fTexCoord;
 
 out vec4 FragColor;
 
+// Ambient light reaching a surface facing N, from the 9 terms precomputed
+// per skybox: a few multiply-adds instead of sampling the environment.
+vec3 AmbientIrradiance(vec3 N)
+{
+    vec3 n = viewToSky * N;
+    return ambientSH[0].rgb
+        + ambientSH[1].rgb * n.y + ambientSH[2].rgb * n.z + ambientSH[3].rgb * n.x
+        + ambientSH[4].rgb * (n.x * n.y) + ambientSH[5].rgb * (n.y * n.z)
+        + ambientSH[6].rgb * (3.0 * n.z * n.z - 1.0) + ambientSH[7].rgb * (n.x * n.z)
+        + ambientSH[8].rgb * (n.x * n.x - n.y * n.y);
+}
+
 vec3 Ambient(vec3 Ka, vec3 I)
 {
-    return Ka * I;
+    return Ka * max(I, vec3(0.0));
 }
 
 vec3 Diffuse(vec3 texColor, vec3 I, vec3 N, vec3 lightDir)
@@ -49,51 +88,66 @@ vec3 Specular(vec3 Ks, vec3 I, vec3 L, vec3 N, vec3 E, float shininess)
     return Ks * I * pow(max(0, dot(N, H)), shininess);
 }
 
-void main()
+// Diffuse plus, in the HAS_SPECULAR variants, the specular term.
+vec3 Shade(vec3 texColor, vec3 I, vec3 L, vec3 N, vec3 E)
 {
-    vec3 vDirLightDir = vec3(viewMatrix * vec4(dirLightDir, 0.0));
-    vDirLightDir = normalize(vDirLightDir);
+    vec3 color = Diffuse(texColor, I, N, L);
+#ifdef HAS_SPECULAR
+    color += Specular(Ks, I, L, N, E, Ns);
+#endif
+    return color;
+}
 
-    vec3 vPointLightPos = vec3(viewMatrix * vec4(pointLightPos, 1.0));
-    vec3 pointLightDist = vPointLightPos - fPosition;
-    float pointLightDistSqr = dot(pointLightDist, pointLightDist);
-    vec3 vPointLightIntensity = pointLightIntensity / pointLightDistSqr;
+// Every feature below is compiled in only when PhongShaderVariants defines it:
+// HAS_TEXTURE, HAS_DIR_LIGHT, HAS_POINT_LIGHT, HAS_SPOT_LIGHT, HAS_SPECULAR and HAS_MATERIAL_TABLE.
+void main()
+{
+#ifdef HAS_MATERIAL_TABLE
+    MaterialEntry material = materialTable[fMaterial];
+    Ka = material.Ka.rgb;
+    Kd = material.Kd.rgb;
+    Ks = material.Ks.rgb;
+    Ns = material.Ks.w;
+#endif
 
-    vec3 vSpotLightPos = vec3(viewMatrix * vec4(spotLightPos, 1.0));
-    vec3 vSpotLightDir = vec3(viewMatrix * vec4(spotLightDir, 0.0));
-    vSpotLightDir = normalize(vSpotLightDir);
-    vec3 spotLightDist = vSpotLightPos - fPosition;
-    float spotLightDistSqr = dot(spotLightDist, spotLightDist);
-    float deltaDeg = degrees(acos(dot(normalize(spotLightDist), -normalize(vSpotLightDir))));
-    float factor = clamp((spotLightTotalWidth - deltaDeg) / spotLightCutoff, 0, 1);
-    vec3 vSpotLightIntensity = spotLightIntensity * factor / spotLightDistSqr;
+    vec3 N = normalize(fNormal);
 
     // Ambient light.
-    vec3 ambient = Ambient(Ka, ambientLight);
+    vec3 color = Ambient(Ka, AmbientIrradiance(N));
 
     // Eye vector.
     vec3 E = normalize(locCameraPos - fPosition);
 
     // Texture color.
+#if defined(HAS_MATERIAL_TABLE)
+    vec3 texColor = material.Kd.w >= 0.0 ? texture(mapKdArray, vec3(fTexCoord, material.Kd.w)).rgb : Kd;
+#elif defined(HAS_TEXTURE)
     vec3 texColor = texture(mapKd, fTexCoord).rgb;
-    if (texColor == vec3(0.0))
-        texColor = Kd;
-
-    vec3 N = normalize(fNormal);
+#else
+    vec3 texColor = Kd;
+#endif
 
+#ifdef HAS_DIR_LIGHT
     // Directional light.
-    vec3 dirLight = Diffuse(texColor, dirLightRadiance, N, vDirLightDir);
-    dirLight += Specular(Ks, dirLightRadiance, vDirLightDir, N, E, Ns);
+    color += Shade(texColor, dirLightRadiance.rgb, dirLightDir.xyz, N, E);
+#endif
 
+#ifdef HAS_POINT_LIGHT
     // Point light.
-    vec3 P = normalize(vPointLightPos - fPosition);
-    vec3 pointLight = Diffuse(texColor, vPointLightIntensity, N, P);
-    pointLight += Specular(Ks, vPointLightIntensity, P, N, E, Ns);
+    vec3 pointLightDist = pointLightPos.xyz - fPosition;
+    float pointLightDistSqr = dot(pointLightDist, pointLightDist);
+    vec3 P = pointLightDist * inversesqrt(pointLightDistSqr);
+    color += Shade(texColor, pointLightIntensity.rgb / pointLightDistSqr, P, N, E);
+#endif
 
-    // Spot light.
-    vec3 S = normalize(vSpotLightPos - fPosition);
-    vec3 spotLight = Diffuse(texColor, vSpotLightIntensity, N, S);
-    spotLight += Specular(Ks, vSpotLightIntensity, S, N, E, Ns);
+#ifdef HAS_SPOT_LIGHT
+    // Spot light. The cone is compared in cosines, no acos per fragment.
+    vec3 spotLightDist = spotLightPos.xyz - fPosition;
+    float spotLightDistSqr = dot(spotLightDist, spotLightDist);
+    vec3 S = spotLightDist * inversesqrt(spotLightDistSqr);
+    float factor = clamp((dot(S, -spotLightDir.xyz) - spotLightCone.x) * spotLightCone.y, 0.0, 1.0);
+    color += Shade(texColor, spotLightIntensity.rgb * factor / spotLightDistSqr, S, N, E);
+#endif
 
-    FragColor = vec4(ambient + dirLight + pointLight + spotLight, 1.0);
+    FragColor = vec4(color, 1.0);
 }
@@ -3,6 +3,9 @@
 layout (location = 0) in vec3 Position;
 layout (location = 1) in vec3 Normal;
 layout (location = 2) in vec2 TexCoord;
+#ifdef HAS_MATERIAL_TABLE
+layout (location = 3) in float MaterialIndex;
+#endif
 
 // Transformation matrix.
 uniform mat4 worldMatrix;
@@ -14,6 +17,12 @@ uniform mat4 MVP;
 out vec3 vPosition;
 out vec3 vNormal;
 out vec2 vTexCoord;
+#ifdef HAS_MATERIAL_TABLE
+flat out int vMaterial;
+#endif
+
+// Must match depth_only.vs bit for bit, for the GL_EQUAL test after a depth pre-pass.
+invariant gl_Position;
 
 void main()
 {
@@ -21,6 +30,14 @@ void main()
 
     vec4 tmpPos = viewMatrix * worldMatrix * vec4(Position, 1.0);
     vPosition = vec3(tmpPos) / tmpPos.w;
+#ifdef FACE_NORMALS
+    // The geometry shader supplies the normal of each triangle.
+    vNormal = vec3(0.0);
+#else
     vNormal = normalize(vec3(normalMatrix * vec4(Normal, 0.0)));
+#endif
     vTexCoord = TexCoord;
+#ifdef HAS_MATERIAL_TABLE
+    vMaterial = int(MaterialIndex);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330 core
+
+in vec4 iColor;
+
+out vec4 FragColor;
+
+
+void main()
+{
+    // Round splats: drop the corners of the point sprite.
+    vec2 offset = gl_PointCoord * 2.0 - 1.0;
+    if (dot(offset, offset) > 1.0)
+        discard;
+
+    FragColor = vec4(iColor.rgb, 1.0);
+}
\ No newline at end of file
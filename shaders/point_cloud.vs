@@ -0,0 +1,23 @@
+#version 330 core
+
+layout (location = 0) in vec3 Position;
+layout (location = 1) in vec4 Color;
+
+uniform mat4 MVP;
+// Pixels per unit of clip w at distance 1: half the viewport height times the projection scale.
+uniform float screenScale;
+// Distance between the points of the node, in world space.
+uniform float pointSpacing;
+
+out vec4 iColor;
+
+
+void main()
+{
+    gl_Position = MVP * vec4(Position, 1.0);
+
+    // Splat just large enough to close the gaps between neighbours.
+    gl_PointSize = clamp(pointSpacing * screenScale / gl_Position.w, 1.0, 16.0);
+
+    iColor = Color;
+}
\ No newline at end of file
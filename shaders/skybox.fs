@@ -1,15 +1,17 @@
 #version 330 core
 
-in vec2 iTexCoord;
+in vec2 iPosition;
 
+// Clip space back to a panorama direction, without the camera translation.
+uniform mat4 invViewProj;
 // Material properties.
-uniform sampler2D mapKd;
+uniform samplerCube cubeMap;
 
 out vec4 FragColor;
 
 
 void main()
 {
-    // We create the uv coordinate from the top, so don't need to inverse.
-    FragColor = texture2D(mapKd, vec2(iTexCoord.x, 1.0 - iTexCoord.y));
+    vec4 farPoint = invViewProj * vec4(iPosition, 1.0, 1.0);
+    FragColor = texture(cubeMap, farPoint.xyz / farPoint.w);
 }
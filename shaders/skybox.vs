@@ -1,17 +1,15 @@
 #version 330 core
 
-layout (location = 0) in vec3 Position;
-layout (location = 1) in vec2 TexCoord;
+layout (location = 0) in vec2 Position;
 
-out vec2 iTexCoord;
-
-uniform mat4 MVP;
+out vec2 iPosition;
 
 
 void main()
 {
-    gl_Position = MVP * vec4(Position, 1.0);
-    
-    // Pass 
-    iTexCoord = TexCoord;
+    // On the far plane (z = w), so the depth test keeps only the pixels the scene left empty.
+    gl_Position = vec4(Position, 1.0, 1.0);
+
+    // Pass the clip position to interpolate.
+    iPosition = Position;
 }
\ No newline at end of file
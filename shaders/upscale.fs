@@ -0,0 +1,29 @@
+#version 330 core
+
+in vec2 iTexCoord;
+
+// The scene only covers [0, uvScale] of the source texture.
+uniform sampler2D sourceTex;
+uniform vec2 uvScale;
+uniform vec2 texelSize;
+uniform float sharpness;
+
+out vec4 FragColor;
+
+void main()
+{
+    // Keep the bilinear footprint inside the rendered region.
+    vec2 uvMax = uvScale - 0.5 * texelSize;
+    vec2 uv = min(iTexCoord * uvScale, uvMax);
+    vec3 color = texture(sourceTex, uv).rgb;
+
+    // Light unsharp mask to make up for the blur of the upscale.
+    if (sharpness > 0.0) {
+        vec3 n = texture(sourceTex, min(uv + vec2(0.0, texelSize.y), uvMax)).rgb;
+        vec3 s = texture(sourceTex, max(uv - vec2(0.0, texelSize.y), vec2(0.0))).rgb;
+        vec3 e = texture(sourceTex, min(uv + vec2(texelSize.x, 0.0), uvMax)).rgb;
+        vec3 w = texture(sourceTex, max(uv - vec2(texelSize.x, 0.0), vec2(0.0))).rgb;
+        color = clamp(color + sharpness * (4.0 * color - n - s - e - w), 0.0, 1.0);
+    }
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+layout (location = 0) in vec2 Position;
+
+out vec2 iTexCoord;
+
+void main()
+{
+    gl_Position = vec4(Position, 0.0, 1.0);
+    iTexCoord = Position * 0.5 + 0.5;
+}
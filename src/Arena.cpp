@@ -0,0 +1,101 @@
+#include "Arena.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <new>
+
+// Blocks are aligned like operator new; larger alignments are handled by padding.
+static constexpr size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+
+// ------------------------------------------------------------------------------------------------
+
+Arena::Arena(const size_t initialBlockSize) {
+	cursor = nullptr;
+	limit = nullptr;
+	nextBlockSize = std::max(initialBlockSize, (size_t)1024);
+	numAllocations = 0;
+	bytesAllocated = 0;
+}
+
+Arena::~Arena() {
+	ReleaseBlocks();
+}
+
+// Desc: Keep one block as large as everything used since the last reset.
+void Arena::Reset() {
+	if (blocks.size() > 1) {
+		const size_t capacity = GetCapacity();
+		ReleaseBlocks();
+		nextBlockSize = capacity;
+		AddBlock(capacity);
+	}
+	else if (!blocks.empty()) {
+		cursor = blocks.back().data;
+	}
+	numAllocations = 0;
+	bytesAllocated = 0;
+}
+
+size_t Arena::GetCapacity() const {
+	size_t capacity = 0;
+	for (const auto& block : blocks) {
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+	std::byte* aligned = cursor != nullptr
+		? (std::byte*)(((uintptr_t)cursor + alignment - 1) & ~(uintptr_t)(alignment - 1))
+		: nullptr;
+	if (aligned == nullptr || aligned + bytes > limit) {
+		AddBlock(bytes + alignment);
+		aligned = (std::byte*)(((uintptr_t)cursor + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	}
+	cursor = aligned + bytes;
+	++numAllocations;
+	bytesAllocated += bytes;
+	return aligned;
+}
+
+// Desc: Take a block of at least minSize bytes, growing geometrically.
+void Arena::AddBlock(const size_t minSize) {
+	const size_t size = std::max(nextBlockSize, minSize);
+	std::byte* data = (std::byte*)::operator new(size, std::align_val_t(BLOCK_ALIGNMENT));
+	blocks.push_back({ data, size });
+	cursor = data;
+	limit = data + size;
+	nextBlockSize = size * 2;
+}
+
+void Arena::ReleaseBlocks() {
+	for (const auto& block : blocks) {
+		::operator delete(block.data, std::align_val_t(BLOCK_ALIGNMENT));
+	}
+	blocks.clear();
+	cursor = nullptr;
+	limit = nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+std::atomic<uint64_t> FrameArena::frameIndex = 0;
+
+void FrameArena::BeginFrame() {
+	frameIndex.fetch_add(1, std::memory_order_release);
+}
+
+Arena& FrameArena::Get() {
+	struct ThreadArena {
+		Arena arena;
+		uint64_t frame = UINT64_MAX;
+	};
+	thread_local ThreadArena local;
+
+	const uint64_t frame = frameIndex.load(std::memory_order_acquire);
+	if (local.frame != frame) {
+		local.arena.Reset();
+		local.frame = frame;
+	}
+	return local.arena;
+}
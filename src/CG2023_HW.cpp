@@ -1,7 +1,28 @@
 ﻿// My headers.
+#include "ChunkedMeshFile.h"
+#include "PointCloudFile.h"
 #include "ScreenManager.h"
 
+// C++ STL headers.
+#include <cstring>
+
 int main(int argc, char** argv) {
+    // Offline: split a PLY mesh into a chunked mesh, by default next to it so the catalog picks it up.
+    // Usage: CG2023_HW --chunk <model.ply> [<model.chunks>]
+    if (argc >= 3 && std::strcmp(argv[1], "--chunk") == 0) {
+        const std::filesystem::path output = argc >= 4 ? std::filesystem::path(argv[3])
+            : std::filesystem::path(argv[2]).replace_extension(".chunks");
+        return ChunkedMeshFile::Build(argv[2], output) ? 0 : 1;
+    }
+
+    // Offline: sort a PLY point cloud into an LOD octree, by default next to it.
+    // Usage: CG2023_HW --octree <cloud.ply> [<cloud.octree>]
+    if (argc >= 3 && std::strcmp(argv[1], "--octree") == 0) {
+        const std::filesystem::path output = argc >= 4 ? std::filesystem::path(argv[3])
+            : std::filesystem::path(argv[2]).replace_extension(".octree");
+        return PointCloudFile::Build(argv[2], output) ? 0 : 1;
+    }
+
     // Start rendering loop.
     auto screen = opengl_homework::ScreenManager::GetInstance();
     screen->Start(argc, argv);
@@ -0,0 +1,399 @@
+#include "ChunkedMeshFile.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// Project headers.
+#include "Clock.h"
+#include "PlyReader.h"
+
+static constexpr char CHUNKED_MESH_MAGIC[4] = { 'M', 'C', 'H', 'K' };
+static constexpr uint32_t CHUNKED_MESH_VERSION = 1;
+
+// Triangles of a chunk: one buffer of about a megabyte and one draw.
+static constexpr size_t CHUNK_TRIANGLES = 32 * 1024;
+
+// The mesh is first sorted into a grid of at most this many cells per axis, sized for a
+// surface to cover about one chunk per cell; cells are then cut into chunks in Morton order.
+static constexpr int MAX_GRID_CELLS = 32;
+static constexpr size_t CELL_BUFFER_TRIANGLES = 64;		// Buffered per cell before writing.
+static constexpr size_t RUN_TRIANGLES = 1024 * 1024;	// Sorted in memory at a time.
+
+// Streaming reads of the source.
+static constexpr size_t READ_VERTICES = 64 * 1024;
+static constexpr size_t READ_INDICES = 1024 * 1024;
+
+// Cells per axis of the vertex clustering grid that makes the proxy of a chunk.
+static constexpr int PROXY_GRID_CELLS = 8;
+
+// Desc: Spread the low 21 bits of a value to every third bit.
+static uint64_t SpreadBits(uint64_t x) {
+	x &= 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffffull;
+	x = (x | x << 16) & 0x1f0000ff0000ffull;
+	x = (x | x << 8) & 0x100f00f00f00f00full;
+	x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+
+// Desc: Quantize a point of the box to a cell index along each axis.
+static glm::ivec3 GetCell(const glm::vec3& position, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const int cells) {
+	glm::ivec3 cell;
+	for (int axis = 0; axis < 3; ++axis) {
+		const float extent = std::max(boundsMax[axis] - boundsMin[axis], 1e-20f);
+		cell[axis] = std::clamp((int)((position[axis] - boundsMin[axis]) / extent * (float)cells), 0, cells - 1);
+	}
+	return cell;
+}
+
+// Desc: Map and validate a file. Only the tables are checked: the chunk indices were written by
+// Build(), and reading them all here would page in the whole file.
+bool ChunkedMeshFile::Open(const std::filesystem::path& filePath) {
+	header = nullptr;
+	chunks = nullptr;
+	if (!file.Open(filePath)) {
+		std::cerr << "[ERROR] Cannot open file " << filePath << std::endl;
+		return false;
+	}
+	const uint8_t* data = file.GetData();
+	const size_t size = file.GetSize();
+	const ChunkedMeshHeader* fileHeader = (const ChunkedMeshHeader*)data;
+	if (size < sizeof(ChunkedMeshHeader) || std::memcmp(fileHeader->magic, CHUNKED_MESH_MAGIC, 4) != 0
+		|| fileHeader->version != CHUNKED_MESH_VERSION) {
+		std::cerr << "[ERROR] Not a chunked mesh file: " << filePath << std::endl;
+		return false;
+	}
+	if ((fileHeader->vertexBytes != 12 && fileHeader->vertexBytes != 24)
+		|| fileHeader->chunkTableOffset % 8 != 0 || fileHeader->chunkTableOffset > size
+		|| (size - fileHeader->chunkTableOffset) / sizeof(MeshChunk) < fileHeader->numChunks
+		|| fileHeader->proxyOffset % 4 != 0 || fileHeader->proxyOffset > size) {
+		std::cerr << "[ERROR] Corrupt chunked mesh header: " << filePath << std::endl;
+		return false;
+	}
+	header = fileHeader;
+	chunks = (const MeshChunk*)(data + fileHeader->chunkTableOffset);
+	if (GetProxyBytes() > size - header->proxyOffset) {
+		std::cerr << "[ERROR] Truncated chunk proxies: " << filePath << std::endl;
+		header = nullptr;
+		return false;
+	}
+	for (uint32_t i = 0; i < header->numChunks; ++i) {
+		const MeshChunk& chunk = chunks[i];
+		if (chunk.offset % 4 != 0 || chunk.offset > size || GetChunkBytes(chunk) > size - chunk.offset
+			|| chunk.proxyFirstIndex > header->numProxyIndices || chunk.proxyNumIndices > header->numProxyIndices - chunk.proxyFirstIndex) {
+			std::cerr << "[ERROR] Corrupt chunk " << i << " in " << filePath << std::endl;
+			header = nullptr;
+			return false;
+		}
+	}
+	const uint32_t* proxyIndices = (const uint32_t*)(data + header->proxyOffset + (size_t)header->numProxyVertices * header->vertexBytes);
+	for (uint32_t i = 0; i < header->numProxyIndices; ++i) {
+		if (proxyIndices[i] >= header->numProxyVertices) {
+			std::cerr << "[ERROR] Proxy index out of range in " << filePath << std::endl;
+			header = nullptr;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Desc: Split a PLY mesh into chunks in four passes over files, none held in memory: the vertices
+// are copied to a packed file that is then mapped; the faces are counted per grid cell, then
+// read again and written out grouped by cell; each cell is finally sorted in runs and cut into
+// chunks, which get their own vertices, local indices, bounds and proxy.
+bool ChunkedMeshFile::Build(const std::filesystem::path& plyFilePath, const std::filesystem::path& outputFilePath) {
+	Clock buildClock;
+	std::filesystem::path verticesPath = outputFilePath;
+	verticesPath += ".vertices.tmp";
+	std::filesystem::path trianglesPath = outputFilePath;
+	trianglesPath += ".triangles.tmp";
+	MappedFile vertexFile;
+	MappedFile triangleFile;
+	auto removeTemporaries = [&]() {
+		vertexFile.Close();
+		triangleFile.Close();
+		std::error_code ec;
+		std::filesystem::remove(verticesPath, ec);
+		std::filesystem::remove(trianglesPath, ec);
+	};
+	auto fail = [&](const std::string& message) {
+		std::cerr << "[ERROR] " << message << ": " << plyFilePath << std::endl;
+		removeTemporaries();
+		return false;
+	};
+
+	PlyReader reader;
+	if (!reader.Open(plyFilePath)) {
+		return false;
+	}
+	if (reader.GetNumVertices() == 0 || reader.GetNumFaces() == 0) {
+		return fail("No triangles to chunk");
+	}
+	const size_t vertexBytes = reader.GetVertexBytes();
+	const size_t vertexFloats = vertexBytes / sizeof(float);
+
+	// Pass 1: the vertices, packed, and their bounds.
+	glm::vec3 minPos = glm::vec3(1e30f);
+	glm::vec3 maxPos = glm::vec3(-1e30f);
+	{
+		std::ofstream vertexOut(verticesPath, std::ios::binary | std::ios::trunc);
+		std::vector<float> vertices(READ_VERTICES * vertexFloats);
+		while (reader.GetVerticesLeft() > 0) {
+			const size_t count = reader.ReadVertices(vertices.data(), READ_VERTICES);
+			if (count == 0) {
+				break;
+			}
+			for (size_t i = 0; i < count; ++i) {
+				const glm::vec3 position = glm::vec3(vertices[i * vertexFloats], vertices[i * vertexFloats + 1],
+					vertices[i * vertexFloats + 2]);
+				minPos = glm::min(minPos, position);
+				maxPos = glm::max(maxPos, position);
+			}
+			vertexOut.write((const char*)vertices.data(), count * vertexBytes);
+		}
+		if (reader.HasFailed() || !vertexOut) {
+			return fail("Failed to copy the vertices");
+		}
+	}
+	if (!vertexFile.Open(verticesPath)) {
+		return fail("Failed to map the vertices");
+	}
+	const float* vertices = (const float*)vertexFile.GetData();
+	auto getPosition = [&](const uint32_t vertex) {
+		const float* v = vertices + (size_t)vertex * vertexFloats;
+		return glm::vec3(v[0], v[1], v[2]);
+	};
+	auto getCentroid = [&](const uint32_t* triangle) {
+		return (getPosition(triangle[0]) + getPosition(triangle[1]) + getPosition(triangle[2])) / 3.0f;
+	};
+
+	// Read every triangle of the faces left in a reader.
+	std::vector<uint32_t> indices(READ_INDICES);
+	auto readTriangles = [&](PlyReader& source, auto&& onTriangle) {
+		while (source.GetFacesLeft() > 0) {
+			const size_t count = source.ReadTriangles(indices.data(), READ_INDICES);
+			if (count == 0) {
+				return false;
+			}
+			for (size_t i = 0; i < count; i += 3) {
+				onTriangle(indices.data() + i);
+			}
+		}
+		return !source.HasFailed();
+	};
+
+	// Pass 2: triangles per cell, with a surface covering about one chunk per cell.
+	const int grid = std::clamp((int)std::ceil(std::sqrt((double)reader.GetNumFaces() / CHUNK_TRIANGLES)), 1, MAX_GRID_CELLS);
+	const size_t numCells = (size_t)grid * grid * grid;
+	auto getCellIndex = [&](const uint32_t* triangle) {
+		const glm::ivec3 cell = GetCell(getCentroid(triangle), minPos, maxPos, grid);
+		return ((size_t)cell.z * grid + cell.y) * grid + cell.x;
+	};
+	std::vector<uint64_t> cellStarts(numCells + 1, 0);
+	if (!readTriangles(reader, [&](const uint32_t* triangle) { ++cellStarts[getCellIndex(triangle) + 1]; })) {
+		return fail("Failed to read the faces");
+	}
+	for (size_t cell = 0; cell < numCells; ++cell) {
+		cellStarts[cell + 1] += cellStarts[cell];
+	}
+	const uint64_t numTriangles = cellStarts[numCells];
+	if (numTriangles == 0) {
+		return fail("No triangles to chunk");
+	}
+
+	// Pass 3: the triangles grouped by cell, through a small buffer per cell.
+	{
+		PlyReader faceReader;
+		if (!faceReader.Open(plyFilePath)) {
+			return fail("Failed to reopen the file");
+		}
+		std::vector<float> skipped(READ_VERTICES * vertexFloats);
+		while (faceReader.GetVerticesLeft() > 0 && faceReader.ReadVertices(skipped.data(), READ_VERTICES) > 0) {
+		}
+		std::ofstream triangleOut(trianglesPath, std::ios::binary | std::ios::trunc);
+		std::vector<uint64_t> cursors(cellStarts.begin(), cellStarts.end() - 1);
+		std::vector<uint32_t> cellBuffers(numCells * CELL_BUFFER_TRIANGLES * 3);
+		std::vector<uint32_t> cellFill(numCells, 0);
+		auto flush = [&](const size_t cell) {
+			triangleOut.seekp((std::streamoff)(cursors[cell] * 3 * sizeof(uint32_t)));
+			triangleOut.write((const char*)(cellBuffers.data() + cell * CELL_BUFFER_TRIANGLES * 3), cellFill[cell] * 3 * sizeof(uint32_t));
+			cursors[cell] += cellFill[cell];
+			cellFill[cell] = 0;
+		};
+		const bool read = readTriangles(faceReader, [&](const uint32_t* triangle) {
+			const size_t cell = getCellIndex(triangle);
+			std::copy(triangle, triangle + 3, cellBuffers.data() + (cell * CELL_BUFFER_TRIANGLES + cellFill[cell]) * 3);
+			if (++cellFill[cell] == CELL_BUFFER_TRIANGLES) {
+				flush(cell);
+			}
+		});
+		for (size_t cell = 0; cell < numCells; ++cell) {
+			flush(cell);
+		}
+		if (!read || !triangleOut) {
+			return fail("Failed to sort the faces");
+		}
+	}
+	if (!triangleFile.Open(trianglesPath)) {
+		return fail("Failed to map the faces");
+	}
+	const uint32_t* triangles = (const uint32_t*)triangleFile.GetData();
+
+	// Pass 4: the chunks, written as they are cut, then the proxies, the table and the header.
+	std::ofstream output(outputFilePath, std::ios::binary | std::ios::trunc);
+	ChunkedMeshHeader header = {};
+	std::memcpy(header.magic, CHUNKED_MESH_MAGIC, 4);
+	header.version = CHUNKED_MESH_VERSION;
+	header.vertexBytes = (uint32_t)vertexBytes;
+	output.write((const char*)&header, sizeof(header));
+
+	std::vector<MeshChunk> chunkTable;
+	std::vector<float> proxyVertices;
+	std::vector<uint32_t> proxyIndices;
+	std::vector<std::pair<uint64_t, uint64_t>> runOrder;
+	std::vector<uint32_t> chunkIndices;
+	std::vector<uint32_t> chunkVertices;
+	std::vector<float> chunkData;
+	auto writeChunk = [&](const std::pair<uint64_t, uint64_t>* order, const size_t count) {
+		// Chunk vertices in the order of their source index, and the local indices.
+		chunkIndices.resize(count * 3);
+		for (size_t i = 0; i < count; ++i) {
+			std::copy(triangles + order[i].second * 3, triangles + order[i].second * 3 + 3, chunkIndices.data() + i * 3);
+		}
+		chunkVertices.assign(chunkIndices.begin(), chunkIndices.end());
+		std::sort(chunkVertices.begin(), chunkVertices.end());
+		chunkVertices.erase(std::unique(chunkVertices.begin(), chunkVertices.end()), chunkVertices.end());
+		for (uint32_t& index : chunkIndices) {
+			index = (uint32_t)(std::lower_bound(chunkVertices.begin(), chunkVertices.end(), index) - chunkVertices.begin());
+		}
+		chunkData.resize(chunkVertices.size() * vertexFloats);
+		glm::vec3 chunkMin = glm::vec3(1e30f);
+		glm::vec3 chunkMax = glm::vec3(-1e30f);
+		for (size_t i = 0; i < chunkVertices.size(); ++i) {
+			std::copy(vertices + (size_t)chunkVertices[i] * vertexFloats, vertices + ((size_t)chunkVertices[i] + 1) * vertexFloats,
+				chunkData.data() + i * vertexFloats);
+			chunkMin = glm::min(chunkMin, getPosition(chunkVertices[i]));
+			chunkMax = glm::max(chunkMax, getPosition(chunkVertices[i]));
+		}
+
+		MeshChunk chunk = {};
+		for (int axis = 0; axis < 3; ++axis) {
+			chunk.boundsMin[axis] = chunkMin[axis];
+			chunk.boundsMax[axis] = chunkMax[axis];
+		}
+		chunk.offset = (uint64_t)output.tellp();
+		chunk.numVertices = (uint32_t)chunkVertices.size();
+		chunk.numIndices = (uint32_t)chunkIndices.size();
+		output.write((const char*)chunkData.data(), chunkData.size() * sizeof(float));
+		output.write((const char*)chunkIndices.data(), chunkIndices.size() * sizeof(uint32_t));
+
+		// Proxy: the vertices of a cluster merge at their mean, and the triangles that still span
+		// three clusters are kept, once each.
+		const uint32_t firstProxyVertex = (uint32_t)(proxyVertices.size() / vertexFloats);
+		std::unordered_map<uint32_t, uint32_t> clusters;
+		std::vector<uint32_t> clusterSizes;
+		std::vector<uint32_t> vertexClusters(chunkVertices.size());
+		for (size_t i = 0; i < chunkVertices.size(); ++i) {
+			const float* v = chunkData.data() + i * vertexFloats;
+			const glm::ivec3 cell = GetCell(glm::vec3(v[0], v[1], v[2]), chunkMin, chunkMax, PROXY_GRID_CELLS);
+			const uint32_t key = ((uint32_t)cell.z * PROXY_GRID_CELLS + cell.y) * PROXY_GRID_CELLS + cell.x;
+			auto [it, inserted] = clusters.emplace(key, (uint32_t)clusterSizes.size());
+			if (inserted) {
+				clusterSizes.push_back(0);
+				proxyVertices.resize(proxyVertices.size() + vertexFloats, 0.0f);
+			}
+			vertexClusters[i] = it->second;
+			++clusterSizes[it->second];
+			float* proxy = proxyVertices.data() + ((size_t)firstProxyVertex + it->second) * vertexFloats;
+			for (size_t k = 0; k < vertexFloats; ++k) {
+				proxy[k] += v[k];
+			}
+		}
+		for (size_t cluster = 0; cluster < clusterSizes.size(); ++cluster) {
+			float* proxy = proxyVertices.data() + ((size_t)firstProxyVertex + cluster) * vertexFloats;
+			for (size_t k = 0; k < 3; ++k) {
+				proxy[k] /= (float)clusterSizes[cluster];
+			}
+			if (vertexFloats == 6) {
+				const glm::vec3 normal = glm::vec3(proxy[3], proxy[4], proxy[5]);
+				const float length = glm::length(normal);
+				for (size_t k = 0; k < 3; ++k) {
+					proxy[3 + k] = length > 0.0f ? normal[(int)k] / length : 0.0f;
+				}
+			}
+		}
+		chunk.proxyFirstIndex = (uint32_t)proxyIndices.size();
+		std::set<std::array<uint32_t, 3>> proxyTriangles;
+		for (size_t i = 0; i < chunkIndices.size(); i += 3) {
+			const std::array<uint32_t, 3> triangle = {
+				vertexClusters[chunkIndices[i]], vertexClusters[chunkIndices[i + 1]], vertexClusters[chunkIndices[i + 2]] };
+			std::array<uint32_t, 3> key = triangle;
+			std::sort(key.begin(), key.end());
+			if (key[0] == key[1] || key[1] == key[2] || !proxyTriangles.insert(key).second) {
+				continue;
+			}
+			for (const uint32_t cluster : triangle) {
+				proxyIndices.push_back(firstProxyVertex + cluster);
+			}
+		}
+		chunk.proxyNumIndices = (uint32_t)proxyIndices.size() - chunk.proxyFirstIndex;
+		chunkTable.push_back(chunk);
+		header.numVertices += chunk.numVertices;
+		header.numTriangles += count;
+	};
+
+	for (size_t cell = 0; cell < numCells; ++cell) {
+		for (uint64_t runStart = cellStarts[cell]; runStart < cellStarts[cell + 1]; runStart += RUN_TRIANGLES) {
+			// Morton order of the centroids over the whole mesh keeps the chunks of a cell compact.
+			const uint64_t runEnd = std::min(runStart + RUN_TRIANGLES, cellStarts[cell + 1]);
+			runOrder.clear();
+			for (uint64_t triangle = runStart; triangle < runEnd; ++triangle) {
+				const glm::ivec3 position = GetCell(getCentroid(triangles + triangle * 3), minPos, maxPos, 1 << 21);
+				const uint64_t code = SpreadBits(position.x) | SpreadBits(position.y) << 1 | SpreadBits(position.z) << 2;
+				runOrder.emplace_back(code, triangle);
+			}
+			std::sort(runOrder.begin(), runOrder.end());
+			for (size_t first = 0; first < runOrder.size(); first += CHUNK_TRIANGLES) {
+				writeChunk(runOrder.data() + first, std::min(CHUNK_TRIANGLES, runOrder.size() - first));
+			}
+		}
+	}
+
+	header.proxyOffset = (uint64_t)output.tellp();
+	header.numProxyVertices = (uint32_t)(proxyVertices.size() / vertexFloats);
+	header.numProxyIndices = (uint32_t)proxyIndices.size();
+	output.write((const char*)proxyVertices.data(), proxyVertices.size() * sizeof(float));
+	output.write((const char*)proxyIndices.data(), proxyIndices.size() * sizeof(uint32_t));
+	const uint64_t padding = (8 - (uint64_t)output.tellp() % 8) % 8;
+	output.write("\0\0\0\0\0\0\0", (std::streamsize)padding);
+	header.chunkTableOffset = (uint64_t)output.tellp();
+	header.numChunks = (uint32_t)chunkTable.size();
+	output.write((const char*)chunkTable.data(), chunkTable.size() * sizeof(MeshChunk));
+	for (int axis = 0; axis < 3; ++axis) {
+		header.boundsMin[axis] = minPos[axis];
+		header.boundsMax[axis] = maxPos[axis];
+	}
+	output.seekp(0);
+	output.write((const char*)&header, sizeof(header));
+	output.close();
+	if (!output) {
+		std::error_code ec;
+		std::filesystem::remove(outputFilePath, ec);
+		return fail("Failed to write " + outputFilePath.string());
+	}
+	removeTemporaries();
+
+	std::cout << "[*] Chunked " << plyFilePath.filename() << " into " << header.numChunks << " chunks in "
+		<< buildClock.GetElapsedTime() << " s (" << header.numTriangles << " triangles, "
+		<< header.numProxyIndices / 3 << " in the proxies)" << std::endl;
+	return true;
+}
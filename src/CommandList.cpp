@@ -0,0 +1,316 @@
+#include "CommandList.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <cstring>
+
+// GLM headers.
+#include <glm/gtc/type_ptr.hpp>
+
+// Every command starts 8-byte aligned with this header.
+struct CommandHeader
+{
+	CommandType type;
+	uint32_t bytes;		// Header, payload and padding.
+};
+
+struct BindProgramCommand { GLuint program; };
+struct UniformMat4Command { GLint location; glm::mat4 value; };
+struct UniformVec3Command { GLint location; glm::vec3 value; };
+struct Uniform1iCommand { GLint location; GLint value; };
+struct Uniform1fCommand { GLint location; GLfloat value; };
+struct BindTextureCommand { GLenum textureUnit; GLenum target; GLuint texture; };
+struct VertexAttribCommand { GLuint index; GLuint buffer; GLint size; GLsizei stride; uint64_t offset; GLenum type; GLboolean normalized; };
+struct DisableVertexAttribsCommand { uint32_t attribMask; };
+struct DrawElementsCommand { GLenum mode; GLuint indexBuffer; GLsizei count; uint64_t firstIndex; GLenum indexType; };
+struct DrawArraysCommand { GLenum mode; GLint first; GLsizei count; };
+struct BufferSubDataCommand { GLenum target; GLuint buffer; GLintptr offset; GLsizeiptr size; };	// Followed by the data.
+struct BindBufferBaseCommand { GLenum target; GLuint index; GLuint buffer; };
+
+static constexpr size_t COMMAND_ALIGNMENT = 8;
+
+static size_t AlignCommandBytes(const size_t bytes) {
+	return (bytes + COMMAND_ALIGNMENT - 1) & ~(COMMAND_ALIGNMENT - 1);
+}
+
+CommandList::CommandList(const size_t initialCapacity) {
+	buffer.resize(initialCapacity);
+	used = 0;
+	numCommands = 0;
+	sortKey = 0;
+	queueNext.store(nullptr, std::memory_order_relaxed);
+}
+
+CommandList::~CommandList() {}
+
+void CommandList::Reset(const uint64_t sortKey) {
+	used = 0;
+	numCommands = 0;
+	this->sortKey = sortKey;
+}
+
+// Desc: Reserve space for one command; the buffer only grows until it fits a whole frame.
+void* CommandList::Append(const CommandType type, const size_t payloadBytes) {
+	const size_t bytes = AlignCommandBytes(sizeof(CommandHeader) + payloadBytes);
+	if (used + bytes > buffer.size()) {
+		buffer.resize(std::max(buffer.size() * 2, used + bytes));
+	}
+	CommandHeader header = { type, (uint32_t)bytes };
+	std::memcpy(buffer.data() + used, &header, sizeof(CommandHeader));
+	void* payload = buffer.data() + used + sizeof(CommandHeader);
+	used += bytes;
+	++numCommands;
+	return payload;
+}
+
+void CommandList::BindProgram(const GLuint program) {
+	BindProgramCommand command = { program };
+	std::memcpy(Append(CommandType::BIND_PROGRAM, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::SetUniform(const GLint location, const glm::mat4& value) {
+	UniformMat4Command command = { location, value };
+	std::memcpy(Append(CommandType::UNIFORM_MAT4, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::SetUniform(const GLint location, const glm::vec3& value) {
+	UniformVec3Command command = { location, value };
+	std::memcpy(Append(CommandType::UNIFORM_VEC3, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::SetUniform(const GLint location, const GLint value) {
+	Uniform1iCommand command = { location, value };
+	std::memcpy(Append(CommandType::UNIFORM_1I, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::SetUniform(const GLint location, const GLfloat value) {
+	Uniform1fCommand command = { location, value };
+	std::memcpy(Append(CommandType::UNIFORM_1F, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::BindTexture(const GLenum textureUnit, const GLenum target, const GLuint texture) {
+	BindTextureCommand command = { textureUnit, target, texture };
+	std::memcpy(Append(CommandType::BIND_TEXTURE, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::SetVertexAttrib(const GLuint index, const GLuint buffer, const GLint size, const GLsizei stride, const size_t offset,
+	const GLenum type, const GLboolean normalized) {
+	VertexAttribCommand command = { index, buffer, size, stride, (uint64_t)offset, type, normalized };
+	std::memcpy(Append(CommandType::VERTEX_ATTRIB, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::DisableVertexAttribs(const uint32_t attribMask) {
+	DisableVertexAttribsCommand command = { attribMask };
+	std::memcpy(Append(CommandType::DISABLE_VERTEX_ATTRIBS, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::DrawElements(const GLenum mode, const GLuint indexBuffer, const GLsizei count, const size_t firstIndex,
+	const GLenum indexType) {
+	DrawElementsCommand command = { mode, indexBuffer, count, (uint64_t)firstIndex, indexType };
+	std::memcpy(Append(CommandType::DRAW_ELEMENTS, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::DrawArrays(const GLenum mode, const GLint first, const GLsizei count) {
+	DrawArraysCommand command = { mode, first, count };
+	std::memcpy(Append(CommandType::DRAW_ARRAYS, sizeof(command)), &command, sizeof(command));
+}
+
+void CommandList::BufferSubData(const GLenum target, const GLuint buffer, const GLintptr offset, const void* data, const GLsizeiptr size) {
+	BufferSubDataCommand command = { target, buffer, offset, size };
+	uint8_t* payload = (uint8_t*)Append(CommandType::BUFFER_SUB_DATA, sizeof(command) + (size_t)size);
+	std::memcpy(payload, &command, sizeof(command));
+	std::memcpy(payload + sizeof(command), data, (size_t)size);
+}
+
+void CommandList::BindBufferBase(const GLenum target, const GLuint index, const GLuint buffer) {
+	BindBufferBaseCommand command = { target, index, buffer };
+	std::memcpy(Append(CommandType::BIND_BUFFER_BASE, sizeof(command)), &command, sizeof(command));
+}
+
+// Desc: Decode the commands in recording order and issue the GL calls.
+void CommandList::Execute() const {
+	size_t offset = 0;
+	while (offset < used) {
+		CommandHeader header;
+		std::memcpy(&header, buffer.data() + offset, sizeof(CommandHeader));
+		const uint8_t* payload = buffer.data() + offset + sizeof(CommandHeader);
+		offset += header.bytes;
+
+		switch (header.type) {
+		case CommandType::BIND_PROGRAM: {
+			BindProgramCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			glUseProgram(command.program);
+			break;
+		}
+		case CommandType::UNIFORM_MAT4: {
+			UniformMat4Command command;
+			std::memcpy(&command, payload, sizeof(command));
+			glUniformMatrix4fv(command.location, 1, GL_FALSE, glm::value_ptr(command.value));
+			break;
+		}
+		case CommandType::UNIFORM_VEC3: {
+			UniformVec3Command command;
+			std::memcpy(&command, payload, sizeof(command));
+			glUniform3fv(command.location, 1, glm::value_ptr(command.value));
+			break;
+		}
+		case CommandType::UNIFORM_1I: {
+			Uniform1iCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			glUniform1i(command.location, command.value);
+			break;
+		}
+		case CommandType::UNIFORM_1F: {
+			Uniform1fCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			glUniform1f(command.location, command.value);
+			break;
+		}
+		case CommandType::BIND_TEXTURE: {
+			BindTextureCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			glActiveTexture(command.textureUnit);
+			glBindTexture(command.target, command.texture);
+			break;
+		}
+		case CommandType::VERTEX_ATTRIB: {
+			VertexAttribCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			glBindBuffer(GL_ARRAY_BUFFER, command.buffer);
+			glEnableVertexAttribArray(command.index);
+			glVertexAttribPointer(command.index, command.size, command.type, command.normalized, command.stride,
+				(void*)(uintptr_t)command.offset);
+			break;
+		}
+		case CommandType::DISABLE_VERTEX_ATTRIBS: {
+			DisableVertexAttribsCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			for (GLuint index = 0; command.attribMask != 0; ++index, command.attribMask >>= 1) {
+				if (command.attribMask & 1) {
+					glDisableVertexAttribArray(index);
+				}
+			}
+			break;
+		}
+		case CommandType::DRAW_ELEMENTS: {
+			DrawElementsCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, command.indexBuffer);
+			const uint64_t indexBytes = command.indexType == GL_UNSIGNED_BYTE ? 1 : command.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+			glDrawElements(command.mode, command.count, command.indexType, (void*)(uintptr_t)(command.firstIndex * indexBytes));
+			break;
+		}
+		case CommandType::DRAW_ARRAYS: {
+			DrawArraysCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			glDrawArrays(command.mode, command.first, command.count);
+			break;
+		}
+		case CommandType::BUFFER_SUB_DATA: {
+			BufferSubDataCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			glBindBuffer(command.target, command.buffer);
+			glBufferSubData(command.target, command.offset, command.size, payload + sizeof(command));
+			glBindBuffer(command.target, 0);
+			break;
+		}
+		case CommandType::BIND_BUFFER_BASE: {
+			BindBufferBaseCommand command;
+			std::memcpy(&command, payload, sizeof(command));
+			glBindBufferBase(command.target, command.index, command.buffer);
+			break;
+		}
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------------------
+
+// The queue is an intrusive Vyukov MPSC list: producers swing head with one
+// atomic exchange, the consumer walks from tail. The stub node keeps the list
+// non-empty so Submit() never has to look at the consumer side.
+CommandQueue::CommandQueue() : stub(0) {
+	head.store(&stub, std::memory_order_relaxed);
+	tail = &stub;
+	numAcquired = 0;
+	numReplayedLists = 0;
+	numReplayedCommands = 0;
+}
+
+CommandQueue::~CommandQueue() {}
+
+CommandList* CommandQueue::Acquire(const uint64_t sortKey) {
+	CommandList* list;
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if (numAcquired == pool.size()) {
+			pool.push_back(std::make_unique<CommandList>());
+		}
+		list = pool[numAcquired++].get();
+	}
+	list->Reset(sortKey);
+	return list;
+}
+
+void CommandQueue::Submit(CommandList* list) {
+	list->queueNext.store(nullptr, std::memory_order_relaxed);
+	CommandList* previous = head.exchange(list, std::memory_order_acq_rel);
+	previous->queueNext.store(list, std::memory_order_release);
+}
+
+// Desc: Take the oldest submitted list, or nullptr if none is complete.
+CommandList* CommandQueue::Pop() {
+	CommandList* first = tail;
+	CommandList* next = first->queueNext.load(std::memory_order_acquire);
+	if (first == &stub) {
+		if (next == nullptr) {
+			return nullptr;
+		}
+		tail = next;
+		first = next;
+		next = next->queueNext.load(std::memory_order_acquire);
+	}
+	if (next != nullptr) {
+		tail = next;
+		return first;
+	}
+	if (first != head.load(std::memory_order_acquire)) {
+		// A producer is between its exchange and its link.
+		return nullptr;
+	}
+	// first is the last list: put the stub behind it so it can be taken.
+	Submit(&stub);
+	next = first->queueNext.load(std::memory_order_acquire);
+	if (next != nullptr) {
+		tail = next;
+		return first;
+	}
+	return nullptr;
+}
+
+// Desc: Every acquired list has been submitted or dropped by now, so the pool is handed out again from
+// the start; the lists taken here stay untouched until the next Acquire().
+const std::vector<CommandList*>& CommandQueue::Collect() {
+	pending.clear();
+	for (CommandList* list = Pop(); list != nullptr; list = Pop()) {
+		pending.push_back(list);
+	}
+	std::stable_sort(pending.begin(), pending.end(),
+		[](const CommandList* a, const CommandList* b) { return a->GetSortKey() < b->GetSortKey(); });
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		numAcquired = 0;
+	}
+	return pending;
+}
+
+void CommandQueue::Replay() {
+	Collect();
+	numReplayedLists = (uint32_t)pending.size();
+	numReplayedCommands = 0;
+	for (const CommandList* list : pending) {
+		list->Execute();
+		numReplayedCommands += list->GetNumCommands();
+	}
+}
@@ -0,0 +1,615 @@
+#include "CookedMeshFile.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+
+// Project headers.
+#include "Clock.h"
+#include "Hash.h"
+
+static constexpr char COOKED_MESH_MAGIC[4] = { 'M', 'C', 'K', 'D' };
+static constexpr uint32_t COOKED_MESH_VERSION = 1;
+
+// Cells per side of the quantization cube in the clustering grid of each coarser level.
+static constexpr int LOD_GRID_CELLS[COOKED_MESH_MAX_LODS] = { 0, 128, 32, 8 };
+// A level is only kept if it drops at least a quarter of the triangles of the one before.
+static constexpr double LOD_MIN_REDUCTION = 0.75;
+
+// Entries of the post-transform vertex cache Tipsify plans for.
+static constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+// Desc: Split the next whitespace-separated token off the front of a line.
+static std::string_view NextToken(std::string_view& line) {
+	const size_t begin = line.find_first_not_of(" \t\r");
+	if (begin == std::string_view::npos) {
+		line = std::string_view();
+		return line;
+	}
+	const size_t end = std::min(line.find_first_of(" \t\r", begin), line.size());
+	const std::string_view token = line.substr(begin, end - begin);
+	line.remove_prefix(end);
+	return token;
+}
+
+// Desc: Parse the next token of a line as a float, or 0 if there is none.
+static float ParseFloat(std::string_view& line) {
+	const std::string_view token = NextToken(line);
+	float value = 0.0f;
+	std::from_chars(token.data(), token.data() + token.size(), value);
+	return value;
+}
+
+// Desc: Resolve the next index of a face vertex ("p/t/n") against the number of elements read so
+// far, and consume its slash: positive indices count from 1, negative ones back from the last.
+// An empty index is -1; false for anything that is not an index in range.
+static bool ParseIndex(std::string_view& token, const size_t count, int& index) {
+	const size_t end = std::min(token.find('/'), token.size());
+	const std::string_view field = token.substr(0, end);
+	token.remove_prefix(std::min(end + 1, token.size()));
+	index = -1;
+	if (field.empty()) {
+		return true;
+	}
+	int value = 0;
+	const auto [last, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+	if (error != std::errc() || last != field.data() + field.size() || value == 0) {
+		return false;
+	}
+	const int64_t resolved = value > 0 ? (int64_t)value - 1 : (int64_t)count + value;
+	if (resolved < 0 || resolved >= (int64_t)count) {
+		return false;
+	}
+	index = (int)resolved;
+	return true;
+}
+
+// Desc: Quantize a unit vector to signed normalized 10:10:10:2, as GL_INT_2_10_10_10_REV reads it.
+static uint32_t PackNormal(const glm::vec3& normal) {
+	auto pack = [](const float value) {
+		return (uint32_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 511.0f) & 0x3ff;
+	};
+	return pack(normal.x) | pack(normal.y) << 10 | pack(normal.z) << 20;
+}
+
+// Desc: Quantize a value in [0, 1] to an unsigned normalized short.
+static uint16_t PackUnorm16(const float value) {
+	return (uint16_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+// Desc: Sorted distinct vertices of an index list, and the list renumbered into them.
+static std::vector<uint32_t> GetLocalVertices(const std::vector<uint32_t>& indices, std::vector<uint32_t>& localIndices) {
+	std::vector<uint32_t> vertices(indices.begin(), indices.end());
+	std::sort(vertices.begin(), vertices.end());
+	vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+	localIndices.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i) {
+		localIndices[i] = (uint32_t)(std::lower_bound(vertices.begin(), vertices.end(), indices[i]) - vertices.begin());
+	}
+	return vertices;
+}
+
+// Desc: Reorder triangles for the post-transform vertex cache with Tipsify (Sander et al. 2007):
+// emit every triangle left around a vertex, then fan around the vertex of those triangles that has
+// been in the cache longest while its own fan still fits, or else back along the recently emitted
+// vertices, or the next vertex with triangles left.
+static void OptimizeVertexCache(std::vector<uint32_t>& indices) {
+	if (indices.empty()) {
+		return;
+	}
+	std::vector<uint32_t> local;
+	const std::vector<uint32_t> vertices = GetLocalVertices(indices, local);
+	const size_t numVertices = vertices.size();
+
+	// Triangles around every vertex.
+	std::vector<uint32_t> adjacencyStart(numVertices + 1, 0);
+	for (const uint32_t vertex : local) {
+		++adjacencyStart[vertex + 1];
+	}
+	for (size_t vertex = 0; vertex < numVertices; ++vertex) {
+		adjacencyStart[vertex + 1] += adjacencyStart[vertex];
+	}
+	std::vector<uint32_t> adjacency(local.size());
+	std::vector<uint32_t> liveTriangles(numVertices);
+	{
+		std::vector<uint32_t> cursors(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t i = 0; i < local.size(); ++i) {
+			adjacency[cursors[local[i]]++] = (uint32_t)(i / 3);
+		}
+	}
+	for (size_t vertex = 0; vertex < numVertices; ++vertex) {
+		liveTriangles[vertex] = adjacencyStart[vertex + 1] - adjacencyStart[vertex];
+	}
+
+	std::vector<uint32_t> cacheTime(numVertices, 0);
+	std::vector<char> emitted(local.size() / 3, 0);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(local.size());
+	uint32_t time = VERTEX_CACHE_SIZE + 1;
+	size_t cursor = 0;
+	int64_t fanning = 0;
+	while (fanning >= 0) {
+		candidates.clear();
+		for (uint32_t k = adjacencyStart[fanning]; k < adjacencyStart[fanning + 1]; ++k) {
+			const uint32_t triangle = adjacency[k];
+			if (emitted[triangle]) {
+				continue;
+			}
+			emitted[triangle] = 1;
+			for (int corner = 0; corner < 3; ++corner) {
+				const uint32_t vertex = local[(size_t)triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveTriangles[vertex];
+				if (time - cacheTime[vertex] > VERTEX_CACHE_SIZE) {
+					cacheTime[vertex] = time++;
+				}
+			}
+		}
+
+		int64_t next = -1;
+		int64_t bestPriority = -1;
+		for (const uint32_t vertex : candidates) {
+			if (liveTriangles[vertex] == 0) {
+				continue;
+			}
+			const uint32_t age = time - cacheTime[vertex];
+			const int64_t priority = age + 2 * liveTriangles[vertex] <= VERTEX_CACHE_SIZE ? age : 0;
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+		while (next < 0 && !deadEnd.empty()) {
+			const uint32_t vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[vertex] > 0) {
+				next = vertex;
+			}
+		}
+		while (next < 0 && cursor < numVertices) {
+			if (liveTriangles[cursor] > 0) {
+				next = (int64_t)cursor;
+			}
+			++cursor;
+		}
+		fanning = next;
+	}
+	for (size_t i = 0; i < output.size(); ++i) {
+		indices[i] = vertices[output[i]];
+	}
+}
+
+// Desc: Simplify triangles by vertex clustering: every vertex moves to the vertex of its grid cell
+// closest to the mean of the cell, and the triangles that collapse or repeat are dropped. The
+// result indexes the same vertices, so a coarser level costs only its indices.
+static std::vector<uint32_t> ClusterTriangles(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+	const glm::vec3& origin, const float cellSize) {
+	std::vector<uint32_t> local;
+	const std::vector<uint32_t> vertices = GetLocalVertices(indices, local);
+	std::unordered_map<uint64_t, uint32_t> clusters;
+	std::vector<glm::vec3> sums;
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> vertexClusters(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		const glm::vec3 cell = (positions[vertices[i]] - origin) / cellSize;
+		const uint64_t key = (uint64_t)std::max(0, (int)cell.z) << 42 | (uint64_t)std::max(0, (int)cell.y) << 21
+			| (uint64_t)std::max(0, (int)cell.x);
+		auto [it, inserted] = clusters.emplace(key, (uint32_t)counts.size());
+		if (inserted) {
+			sums.push_back(glm::vec3(0.0f));
+			counts.push_back(0);
+		}
+		vertexClusters[i] = it->second;
+		sums[it->second] += positions[vertices[i]];
+		++counts[it->second];
+	}
+	std::vector<uint32_t> representatives(counts.size(), UINT32_MAX);
+	std::vector<float> distances(counts.size(), 1e30f);
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		const uint32_t cluster = vertexClusters[i];
+		const glm::vec3 offset = positions[vertices[i]] - sums[cluster] / (float)counts[cluster];
+		const float distance = glm::dot(offset, offset);
+		if (distance < distances[cluster]) {
+			distances[cluster] = distance;
+			representatives[cluster] = vertices[i];
+		}
+	}
+
+	std::vector<uint32_t> simplified;
+	std::set<std::array<uint32_t, 3>> kept;
+	for (size_t i = 0; i + 2 < local.size(); i += 3) {
+		const std::array<uint32_t, 3> triangle = { representatives[vertexClusters[local[i]]],
+			representatives[vertexClusters[local[i + 1]]], representatives[vertexClusters[local[i + 2]]] };
+		std::array<uint32_t, 3> key = triangle;
+		std::sort(key.begin(), key.end());
+		if (key[0] == key[1] || key[1] == key[2] || !kept.insert(key).second) {
+			continue;
+		}
+		simplified.insert(simplified.end(), triangle.begin(), triangle.end());
+	}
+	return simplified;
+}
+
+// Desc: Map and validate a file. The indices are checked against the vertex count once here, so
+// a damaged file cannot make the GPU read past the vertex buffer.
+bool CookedMeshFile::Open(const std::filesystem::path& filePath) {
+	header = nullptr;
+	subMeshes = nullptr;
+	materialLibraries.clear();
+	materialNames.clear();
+	if (!file.Open(filePath)) {
+		std::cerr << "[ERROR] Cannot open file " << filePath << std::endl;
+		return false;
+	}
+	const uint8_t* data = file.GetData();
+	const size_t size = file.GetSize();
+	const CookedMeshHeader* fileHeader = (const CookedMeshHeader*)data;
+	if (size < sizeof(CookedMeshHeader) || std::memcmp(fileHeader->magic, COOKED_MESH_MAGIC, 4) != 0
+		|| fileHeader->version != COOKED_MESH_VERSION) {
+		std::cerr << "[ERROR] Not a cooked mesh file: " << filePath << std::endl;
+		return false;
+	}
+	if ((fileHeader->vertexBytes != 16 && fileHeader->vertexBytes != 20)
+		|| (fileHeader->indexBytes != 2 && fileHeader->indexBytes != 4)
+		|| fileHeader->numLods == 0 || fileHeader->numLods > COOKED_MESH_MAX_LODS || !(fileHeader->scale > 0.0f)
+		|| fileHeader->vertexOffset % 4 != 0 || fileHeader->vertexOffset > size
+		|| (size - fileHeader->vertexOffset) / fileHeader->vertexBytes < fileHeader->numVertices
+		|| fileHeader->indexOffset % 4 != 0 || fileHeader->indexOffset > size
+		|| (size - fileHeader->indexOffset) / fileHeader->indexBytes < fileHeader->numIndices
+		|| fileHeader->subMeshTableOffset % 4 != 0 || fileHeader->subMeshTableOffset > size
+		|| (size - fileHeader->subMeshTableOffset) / sizeof(CookedSubMesh) < fileHeader->numSubMeshes
+		|| fileHeader->stringOffset > size || size - fileHeader->stringOffset < fileHeader->stringBytes) {
+		std::cerr << "[ERROR] Corrupt cooked mesh header: " << filePath << std::endl;
+		return false;
+	}
+	const CookedSubMesh* table = (const CookedSubMesh*)(data + fileHeader->subMeshTableOffset);
+	for (uint32_t i = 0; i < fileHeader->numSubMeshes; ++i) {
+		for (int lod = 0; lod < COOKED_MESH_MAX_LODS; ++lod) {
+			if (table[i].firstIndex[lod] > fileHeader->numIndices
+				|| table[i].numIndices[lod] > fileHeader->numIndices - table[i].firstIndex[lod]) {
+				std::cerr << "[ERROR] Corrupt submesh " << i << " in " << filePath << std::endl;
+				return false;
+			}
+		}
+	}
+	for (uint32_t i = 0; i < fileHeader->numIndices; ++i) {
+		const uint32_t index = fileHeader->indexBytes == 2 ? ((const uint16_t*)(data + fileHeader->indexOffset))[i]
+			: ((const uint32_t*)(data + fileHeader->indexOffset))[i];
+		if (index >= fileHeader->numVertices) {
+			std::cerr << "[ERROR] Index out of range in " << filePath << std::endl;
+			return false;
+		}
+	}
+
+	// The strings, one after another; a missing terminator ends the block early and fails below.
+	std::vector<std::string> strings;
+	const char* text = (const char*)(data + fileHeader->stringOffset);
+	for (size_t offset = 0; offset < fileHeader->stringBytes;) {
+		const void* end = std::memchr(text + offset, '\0', fileHeader->stringBytes - offset);
+		if (end == nullptr) {
+			break;
+		}
+		strings.emplace_back(text + offset, (const char*)end);
+		offset = (size_t)((const char*)end - text) + 1;
+	}
+	if (strings.size() != (size_t)fileHeader->numMaterialLibraries + fileHeader->numSubMeshes) {
+		std::cerr << "[ERROR] Corrupt material names in " << filePath << std::endl;
+		return false;
+	}
+	materialLibraries.assign(strings.begin(), strings.begin() + fileHeader->numMaterialLibraries);
+	materialNames.assign(strings.begin() + fileHeader->numMaterialLibraries, strings.end());
+	header = fileHeader;
+	subMeshes = table;
+	return true;
+}
+
+// Desc: Cook an OBJ in memory: parse and validate the faces, quantize and weld their vertices,
+// make the coarser levels of every material, order the triangles of each level for the vertex
+// cache and the vertices by first use, then write it all out.
+bool CookedMeshFile::Build(const std::filesystem::path& objFilePath, const std::filesystem::path& outputFilePath) {
+	Clock buildClock;
+	std::ifstream fin(objFilePath, std::ios::binary | std::ios::ate);
+	if (!fin) {
+		std::cerr << "[ERROR] Cannot open file " << objFilePath << std::endl;
+		return false;
+	}
+	std::string text((size_t)fin.tellg(), '\0');
+	fin.seekg(0);
+	fin.read(text.data(), (std::streamsize)text.size());
+	fin.close();
+
+	// Faces are grouped by material, in order of first use; a corner is its three attribute indices.
+	struct Group
+	{
+		std::string material;
+		std::vector<std::array<int, 3>> corners;
+	};
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texcoords;
+	std::vector<std::string> materialLibraries;
+	std::vector<Group> groups(1);
+	std::map<std::string, size_t> groupOfMaterial = { { "", 0 } };
+	size_t group = 0;
+	size_t rejectedFaces = 0;
+	std::vector<std::array<int, 3>> face;
+	std::string_view remaining(text);
+	while (!remaining.empty()) {
+		const size_t lineEnd = std::min(remaining.find('\n'), remaining.size());
+		std::string_view line = remaining.substr(0, lineEnd);
+		remaining.remove_prefix(std::min(lineEnd + 1, remaining.size()));
+
+		const std::string_view type = NextToken(line);
+		if (type == "v") {
+			const float x = ParseFloat(line);
+			const float y = ParseFloat(line);
+			const float z = ParseFloat(line);
+			positions.emplace_back(x, y, z);
+		}
+		else if (type == "vn") {
+			const float x = ParseFloat(line);
+			const float y = ParseFloat(line);
+			const float z = ParseFloat(line);
+			normals.emplace_back(x, y, z);
+		}
+		else if (type == "vt") {
+			const float u = ParseFloat(line);
+			const float v = ParseFloat(line);
+			texcoords.emplace_back(u, v);
+		}
+		else if (type == "f") {
+			face.clear();
+			bool valid = true;
+			for (std::string_view token = NextToken(line); !token.empty() && valid; token = NextToken(line)) {
+				std::array<int, 3> corner;
+				valid = ParseIndex(token, positions.size(), corner[0]) && ParseIndex(token, texcoords.size(), corner[1])
+					&& ParseIndex(token, normals.size(), corner[2]) && corner[0] >= 0;
+				face.push_back(corner);
+			}
+			if (!valid || face.size() < 3) {
+				++rejectedFaces;
+				continue;
+			}
+			for (size_t i = 2; i < face.size(); ++i) {
+				groups[group].corners.push_back(face[0]);
+				groups[group].corners.push_back(face[i - 1]);
+				groups[group].corners.push_back(face[i]);
+			}
+		}
+		else if (type == "usemtl") {
+			const std::string material(NextToken(line));
+			auto [it, inserted] = groupOfMaterial.emplace(material, groups.size());
+			if (inserted) {
+				groups.push_back({ material, {} });
+			}
+			group = it->second;
+		}
+		else if (type == "mtllib") {
+			materialLibraries.emplace_back(NextToken(line));
+		}
+	}
+	text.clear();
+	text.shrink_to_fit();
+	if (rejectedFaces > 0) {
+		std::cerr << "[WARNING] Skipped " << rejectedFaces << " faces with missing or out of range indices in "
+			<< objFilePath << std::endl;
+	}
+
+	// Quantization cube over the positions in use, and texcoords as shorts if they all fit in [0, 1].
+	glm::vec3 minPos = glm::vec3(1e30f);
+	glm::vec3 maxPos = glm::vec3(-1e30f);
+	bool unitTexcoords = true;
+	size_t numCorners = 0;
+	for (const Group& source : groups) {
+		for (const auto& corner : source.corners) {
+			minPos = glm::min(minPos, positions[corner[0]]);
+			maxPos = glm::max(maxPos, positions[corner[0]]);
+			if (corner[1] >= 0) {
+				const glm::vec2 texcoord = texcoords[corner[1]];
+				unitTexcoords = unitTexcoords && texcoord.x >= -1e-4f && texcoord.x <= 1.0f + 1e-4f
+					&& texcoord.y >= -1e-4f && texcoord.y <= 1.0f + 1e-4f;
+			}
+		}
+		numCorners += source.corners.size();
+	}
+	if (numCorners == 0) {
+		std::cerr << "[ERROR] No faces to cook: " << objFilePath << std::endl;
+		return false;
+	}
+	const float scale = std::max(maxPos.x - minPos.x, std::max(maxPos.y - minPos.y, maxPos.z - minPos.z));
+	const float quantizationScale = scale > 0.0f ? scale : 1.0f;
+	const uint32_t vertexBytes = unitTexcoords ? 16 : 20;
+
+	// Weld: corners that quantize to the same bytes share a vertex. Missing normals and texcoords
+	// take the defaults the OBJ loader gives them.
+	using PackedVertex = std::array<uint32_t, 5>;
+	struct PackedVertexHash
+	{
+		size_t operator()(const PackedVertex& vertex) const { return (size_t)opengl_homework::HashBytes(vertex.data(), sizeof(vertex)); }
+	};
+	std::unordered_map<PackedVertex, uint32_t, PackedVertexHash> weldedIndices;
+	std::vector<PackedVertex> vertices;
+	std::vector<glm::vec3> vertexPositions;		// Dequantized, for clustering.
+	std::vector<std::vector<uint32_t>> groupIndices(groups.size());
+	for (size_t g = 0; g < groups.size(); ++g) {
+		for (const auto& corner : groups[g].corners) {
+			const glm::vec3 position = glm::clamp((positions[corner[0]] - minPos) / quantizationScale, 0.0f, 1.0f);
+			const glm::vec3 normal = corner[2] >= 0 && glm::length(normals[corner[2]]) > 0.0f
+				? glm::normalize(normals[corner[2]]) : glm::vec3(0.0f, 1.0f, 0.0f);
+			const glm::vec2 texcoord = corner[1] >= 0 ? texcoords[corner[1]] : glm::vec2(0.0f);
+			PackedVertex vertex = {};
+			vertex[0] = (uint32_t)PackUnorm16(position.x) | (uint32_t)PackUnorm16(position.y) << 16;
+			vertex[1] = (uint32_t)PackUnorm16(position.z);
+			vertex[2] = PackNormal(normal);
+			if (unitTexcoords) {
+				vertex[3] = (uint32_t)PackUnorm16(texcoord.x) | (uint32_t)PackUnorm16(texcoord.y) << 16;
+			}
+			else {
+				std::memcpy(&vertex[3], &texcoord.x, sizeof(float));
+				std::memcpy(&vertex[4], &texcoord.y, sizeof(float));
+			}
+			auto [it, inserted] = weldedIndices.emplace(vertex, (uint32_t)vertices.size());
+			if (inserted) {
+				vertices.push_back(vertex);
+				vertexPositions.push_back(minPos + glm::vec3(vertex[0] & 0xffff, vertex[0] >> 16, vertex[1]) / 65535.0f * quantizationScale);
+			}
+			groupIndices[g].push_back(it->second);
+		}
+		groups[g].corners.clear();
+		groups[g].corners.shrink_to_fit();
+	}
+	weldedIndices.clear();
+	positions.clear();
+	normals.clear();
+	texcoords.clear();
+
+	// Levels of every group: the welded triangles, then clustered on coarser grids while that pays.
+	// A group that stops early draws its last level for the coarser ones.
+	std::vector<std::string> materialNames;
+	std::vector<std::vector<std::vector<uint32_t>>> levels;		// Per submesh, per level.
+	uint32_t numLods = 1;
+	for (size_t g = 0; g < groups.size(); ++g) {
+		if (groupIndices[g].empty()) {
+			continue;
+		}
+		std::vector<std::vector<uint32_t>> subMeshLevels;
+		subMeshLevels.push_back(std::move(groupIndices[g]));
+		for (int lod = 1; lod < COOKED_MESH_MAX_LODS; ++lod) {
+			std::vector<uint32_t> simplified = ClusterTriangles(subMeshLevels.back(), vertexPositions, minPos,
+				quantizationScale / (float)LOD_GRID_CELLS[lod]);
+			if ((double)simplified.size() > (double)subMeshLevels.back().size() * LOD_MIN_REDUCTION) {
+				break;
+			}
+			subMeshLevels.push_back(std::move(simplified));
+			if (subMeshLevels.back().empty()) {
+				break;
+			}
+		}
+		numLods = std::max(numLods, (uint32_t)subMeshLevels.size());
+		materialNames.push_back(groups[g].material);
+		levels.push_back(std::move(subMeshLevels));
+	}
+	for (auto& subMeshLevels : levels) {
+		for (auto& indices : subMeshLevels) {
+			OptimizeVertexCache(indices);
+		}
+	}
+
+	// Vertices in the order the full mesh first uses them; the coarser levels only use those.
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	uint32_t numUsed = 0;
+	for (int lod = 0; lod < COOKED_MESH_MAX_LODS; ++lod) {
+		for (auto& subMeshLevels : levels) {
+			if (lod >= (int)subMeshLevels.size()) {
+				continue;
+			}
+			for (uint32_t& index : subMeshLevels[lod]) {
+				if (remap[index] == UINT32_MAX) {
+					remap[index] = numUsed++;
+				}
+				index = remap[index];
+			}
+		}
+	}
+	std::vector<PackedVertex> orderedVertices(numUsed);
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		if (remap[i] != UINT32_MAX) {
+			orderedVertices[remap[i]] = vertices[i];
+		}
+	}
+
+	// Write the header last, once the offsets are known.
+	CookedMeshHeader header = {};
+	std::memcpy(header.magic, COOKED_MESH_MAGIC, 4);
+	header.version = COOKED_MESH_VERSION;
+	header.numVertices = numUsed;
+	header.numSubMeshes = (uint32_t)levels.size();
+	header.numLods = numLods;
+	header.vertexBytes = vertexBytes;
+	header.indexBytes = numUsed <= 65536 ? 2 : 4;
+	for (int axis = 0; axis < 3; ++axis) {
+		header.boundsMin[axis] = minPos[axis];
+		header.boundsMax[axis] = maxPos[axis];
+	}
+	header.scale = quantizationScale;
+	for (int lod = 1; lod < COOKED_MESH_MAX_LODS; ++lod) {
+		header.lodErrors[lod] = std::sqrt(3.0f) / (float)LOD_GRID_CELLS[lod];
+	}
+	header.numMaterialLibraries = (uint32_t)materialLibraries.size();
+
+	std::ofstream output(outputFilePath, std::ios::binary | std::ios::trunc);
+	output.write((const char*)&header, sizeof(header));
+	header.vertexOffset = (uint64_t)output.tellp();
+	for (const PackedVertex& vertex : orderedVertices) {
+		output.write((const char*)vertex.data(), vertexBytes);
+	}
+
+	header.indexOffset = (uint64_t)output.tellp();
+	std::vector<CookedSubMesh> subMeshTable(levels.size());
+	std::vector<uint16_t> shortIndices;
+	for (size_t i = 0; i < levels.size(); ++i) {
+		for (int lod = 0; lod < COOKED_MESH_MAX_LODS; ++lod) {
+			if (lod >= (int)levels[i].size()) {
+				subMeshTable[i].firstIndex[lod] = subMeshTable[i].firstIndex[lod - 1];
+				subMeshTable[i].numIndices[lod] = subMeshTable[i].numIndices[lod - 1];
+				continue;
+			}
+			const std::vector<uint32_t>& indices = levels[i][lod];
+			subMeshTable[i].firstIndex[lod] = header.numIndices;
+			subMeshTable[i].numIndices[lod] = (uint32_t)indices.size();
+			header.numIndices += (uint32_t)indices.size();
+			if (header.indexBytes == 2) {
+				shortIndices.assign(indices.begin(), indices.end());
+				output.write((const char*)shortIndices.data(), shortIndices.size() * sizeof(uint16_t));
+			}
+			else {
+				output.write((const char*)indices.data(), indices.size() * sizeof(uint32_t));
+			}
+		}
+		header.numTriangles += levels[i][0].size() / 3;
+	}
+	const uint64_t padding = (8 - (uint64_t)output.tellp() % 8) % 8;
+	output.write("\0\0\0\0\0\0\0", (std::streamsize)padding);
+	header.subMeshTableOffset = (uint64_t)output.tellp();
+	output.write((const char*)subMeshTable.data(), subMeshTable.size() * sizeof(CookedSubMesh));
+
+	header.stringOffset = (uint64_t)output.tellp();
+	for (const auto* strings : { &materialLibraries, &materialNames }) {
+		for (const std::string& value : *strings) {
+			output.write(value.c_str(), (std::streamsize)value.size() + 1);
+			header.stringBytes += (uint32_t)value.size() + 1;
+		}
+	}
+	output.seekp(0);
+	output.write((const char*)&header, sizeof(header));
+	output.close();
+	if (!output) {
+		std::cerr << "[ERROR] Failed to write " << outputFilePath << std::endl;
+		std::error_code ec;
+		std::filesystem::remove(outputFilePath, ec);
+		return false;
+	}
+
+	size_t coarsestIndices = 0;
+	for (const CookedSubMesh& subMesh : subMeshTable) {
+		coarsestIndices += subMesh.numIndices[numLods - 1];
+	}
+	std::cout << "[*] Cooked " << objFilePath.filename() << " in " << buildClock.GetElapsedTime() << " s ("
+		<< numCorners << " corners welded into " << numUsed << " vertices of " << vertexBytes << " bytes, "
+		<< header.numTriangles << " triangles, " << numLods << " levels down to " << coarsestIndices / 3
+		<< " triangles)" << std::endl;
+	return true;
+}
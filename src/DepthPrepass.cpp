@@ -0,0 +1,136 @@
+#include "DepthPrepass.h"
+
+#include <iostream>
+
+DepthPrepass::DepthPrepass(const float overdrawThreshold, const int remeasureFrames)
+	: overdrawThreshold(overdrawThreshold), remeasureFrames(remeasureFrames) {
+	hasStatistics = GLEW_ARB_pipeline_statistics_query;
+	glGenQueries(1, &samplesQuery);
+	invocationsQuery = 0;
+	if (hasStatistics) {
+		glGenQueries(1, &invocationsQuery);
+	}
+	Reset();
+}
+
+DepthPrepass::~DepthPrepass() {
+	glDeleteQueries(1, &samplesQuery);
+	if (invocationsQuery != 0) {
+		glDeleteQueries(1, &invocationsQuery);
+	}
+}
+
+void DepthPrepass::Reset() {
+	enabled = false;
+	prepassThisFrame = false;
+	overdrawRatio = 1.0f;
+	framesSinceMeasure = 0;
+	phase = Phase::MeasureWithout;
+	queryInFlight = false;
+	queryThisFrame = false;
+	samplesWithout = 0;
+	invocationsWithout = 0;
+}
+
+bool DepthPrepass::BeginFrame() {
+	CollectResults();
+
+	if (phase == Phase::Idle && ++framesSinceMeasure >= remeasureFrames) {
+		phase = Phase::MeasureWithout;
+	}
+
+	// Only one measurement in flight, results are read back without stalling.
+	queryThisFrame = !queryInFlight && phase != Phase::Idle;
+	switch (phase) {
+	case Phase::MeasureWithout:
+		prepassThisFrame = queryThisFrame ? false : enabled;
+		break;
+	case Phase::MeasureWith:
+		prepassThisFrame = queryThisFrame ? true : enabled;
+		break;
+	default:
+		prepassThisFrame = enabled;
+		break;
+	}
+	return prepassThisFrame;
+}
+
+void DepthPrepass::BeginDepthPass() {
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	// The shading pass culls back faces in the geometry shader; cull the same triangles here.
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+}
+
+void DepthPrepass::BeginShadingPass() {
+	if (prepassThisFrame) {
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDisable(GL_CULL_FACE);
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+	if (queryThisFrame) {
+		glBeginQuery(GL_SAMPLES_PASSED, samplesQuery);
+		if (hasStatistics) {
+			glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, invocationsQuery);
+		}
+	}
+}
+
+void DepthPrepass::EndShadingPass() {
+	if (queryThisFrame) {
+		glEndQuery(GL_SAMPLES_PASSED);
+		if (hasStatistics) {
+			glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+		}
+		queryInFlight = true;
+		queryThisFrame = false;
+	}
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+}
+
+// Desc: Read back the last measurement if the GPU is done with it.
+void DepthPrepass::CollectResults() {
+	if (!queryInFlight) {
+		return;
+	}
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(samplesQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return;
+	}
+	queryInFlight = false;
+
+	GLuint64 samples = 0;
+	GLuint64 invocations = 0;
+	glGetQueryObjectui64v(samplesQuery, GL_QUERY_RESULT, &samples);
+	if (hasStatistics) {
+		glGetQueryObjectui64v(invocationsQuery, GL_QUERY_RESULT, &invocations);
+	}
+
+	if (phase == Phase::MeasureWithout) {
+		samplesWithout = samples;
+		invocationsWithout = invocations;
+		phase = Phase::MeasureWith;
+		return;
+	}
+
+	// Samples passing GL_EQUAL after a pre-pass are exactly the visible ones.
+	overdrawRatio = samples > 0 ? (float)samplesWithout / (float)samples : 1.0f;
+	bool wasEnabled = enabled;
+	enabled = overdrawRatio > overdrawThreshold;
+	phase = Phase::Idle;
+	framesSinceMeasure = 0;
+
+	if (enabled != wasEnabled) {
+		std::cout << "[*] Depth pre-pass " << (enabled ? "enabled" : "disabled")
+			<< ": overdraw " << overdrawRatio;
+		if (hasStatistics) {
+			std::cout << ", FS invocations " << invocationsWithout << " -> " << invocations;
+		}
+		std::cout << std::endl;
+	}
+}
@@ -0,0 +1,162 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+DynamicResolution::DynamicResolution(const int width, const int height, const float targetFrameTimeMs)
+	: width(width), height(height), targetMs(targetFrameTimeMs) {
+	scale = MAX_SCALE;
+	smoothedMs = 0.0f;
+	framesSinceChange = 0;
+	numFrames = 0;
+	msFboId = msColorRboId = msDepthRboId = resolveFboId = resolveTexId = 0;
+
+	GLint maxSamples = 0;
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	numSamples = std::min(4, (int)maxSamples);
+
+	glGenQueries(NUM_QUERIES, timerQueries);
+	CreateTargets();
+}
+
+DynamicResolution::~DynamicResolution() {
+	ReleaseTargets();
+	glDeleteQueries(NUM_QUERIES, timerQueries);
+}
+
+void DynamicResolution::Resize(const int width, const int height) {
+	this->width = std::max(width, 1);
+	this->height = std::max(height, 1);
+	ReleaseTargets();
+	CreateTargets();
+}
+
+void DynamicResolution::CreateTargets() {
+	// Multisampled color and depth the scene is drawn into.
+	glGenRenderbuffers(1, &msColorRboId);
+	glBindRenderbuffer(GL_RENDERBUFFER, msColorRboId);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, numSamples, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &msDepthRboId);
+	glBindRenderbuffer(GL_RENDERBUFFER, msDepthRboId);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, numSamples, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &msFboId);
+	glBindFramebuffer(GL_FRAMEBUFFER, msFboId);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, msColorRboId);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, msDepthRboId);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "[ERROR] Incomplete multisampled framebuffer" << std::endl;
+	}
+
+	// Single-sampled texture the upscale pass reads from.
+	glGenTextures(1, &resolveTexId);
+	glBindTexture(GL_TEXTURE_2D, resolveTexId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &resolveFboId);
+	glBindFramebuffer(GL_FRAMEBUFFER, resolveFboId);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, resolveTexId, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "[ERROR] Incomplete resolve framebuffer" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DynamicResolution::ReleaseTargets() {
+	glDeleteFramebuffers(1, &msFboId);
+	glDeleteFramebuffers(1, &resolveFboId);
+	glDeleteRenderbuffers(1, &msColorRboId);
+	glDeleteRenderbuffers(1, &msDepthRboId);
+	glDeleteTextures(1, &resolveTexId);
+	msFboId = msColorRboId = msDepthRboId = resolveFboId = resolveTexId = 0;
+}
+
+void DynamicResolution::BeginFrame() {
+	CollectFrameTime();
+
+	renderWidth = std::max(1, (int)std::lround(width * scale));
+	renderHeight = std::max(1, (int)std::lround(height * scale));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, msFboId);
+	glViewport(0, 0, renderWidth, renderHeight);
+	glBeginQuery(GL_TIME_ELAPSED, timerQueries[numFrames % NUM_QUERIES]);
+}
+
+void DynamicResolution::EndFrame(const std::shared_ptr<UpscaleShaderProg>& shader) {
+	glEndQuery(GL_TIME_ELAPSED);
+	++numFrames;
+
+	// Resolve the samples of the rendered region.
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, msFboId);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFboId);
+	glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	// Upscale to the window.
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+	glDisable(GL_DEPTH_TEST);
+
+	shader->Bind();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, resolveTexId);
+	glUniform1i(shader->GetLocSourceTex(), 0);
+	glUniform2f(shader->GetLocUvScale(), (float)renderWidth / (float)width, (float)renderHeight / (float)height);
+	glUniform2f(shader->GetLocTexelSize(), 1.0f / (float)width, 1.0f / (float)height);
+	glUniform1f(shader->GetLocSharpness(), scale < MAX_SCALE ? 0.2f * (MAX_SCALE - scale) / (MAX_SCALE - MIN_SCALE) + 0.05f : 0.0f);
+	triangle.Draw();
+	shader->Unbind();
+
+	glEnable(GL_DEPTH_TEST);
+}
+
+// Desc: Read the oldest timer query; the ring keeps this from waiting on the GPU.
+void DynamicResolution::CollectFrameTime() {
+	if (numFrames < NUM_QUERIES) {
+		return;
+	}
+	GLuint query = timerQueries[numFrames % NUM_QUERIES];
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		// Rare: only happens when the GPU is NUM_QUERIES frames behind. Wait rather than reuse it.
+		glGetQueryObjectiv(query, GL_QUERY_RESULT, &available);
+	}
+	GLuint64 elapsedNs = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+	UpdateScale((float)elapsedNs * 1e-6f);
+}
+
+void DynamicResolution::UpdateScale(const float frameTimeMs) {
+	frameTimeHistory.push_back(frameTimeMs);
+	if (frameTimeHistory.size() > HISTORY_SIZE) {
+		frameTimeHistory.pop_front();
+	}
+	smoothedMs = (smoothedMs == 0.0f) ? frameTimeMs : 0.9f * smoothedMs + 0.1f * frameTimeMs;
+
+	// Hysteresis: hold the scale while inside [0.8, 1.05] * target and shortly after a change.
+	if (++framesSinceChange < 15) {
+		return;
+	}
+	if (smoothedMs <= targetMs * 1.05f && smoothedMs >= targetMs * 0.8f) {
+		return;
+	}
+	if (smoothedMs < targetMs * 0.8f && scale >= MAX_SCALE) {
+		return;
+	}
+
+	// Cost is roughly proportional to the pixel count, i.e. to scale squared.
+	float newScale = scale * std::sqrt(targetMs / std::max(smoothedMs, 0.01f));
+	newScale = std::clamp(newScale, scale - 0.1f, scale + 0.05f);
+	newScale = std::clamp(newScale, MIN_SCALE, MAX_SCALE);
+	if (std::abs(newScale - scale) > 0.01f) {
+		scale = newScale;
+		framesSinceChange = 0;
+	}
+}
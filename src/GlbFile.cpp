@@ -0,0 +1,430 @@
+#include "GlbFile.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Project headers.
+#include "Json.h"
+
+static constexpr uint32_t GLB_MAGIC = 0x46546C67;		// "glTF".
+static constexpr uint32_t GLB_VERSION = 2;
+static constexpr uint32_t CHUNK_JSON = 0x4E4F534A;		// "JSON".
+static constexpr uint32_t CHUNK_BIN = 0x004E4942;		// "BIN\0".
+static constexpr int GLTF_TRIANGLES = 4;
+// Node hierarchies deeper than this are taken to be cyclic.
+static constexpr int MAX_NODE_DEPTH = 64;
+
+// Desc: Read a little-endian word at an offset that the caller has checked.
+static uint32_t ReadU32(const uint8_t* data) {
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static size_t GetComponentBytes(const GLenum type) {
+	switch (type) {
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+		return 2;
+	case GL_UNSIGNED_INT:
+	case GL_FLOAT:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static GLint GetNumComponents(const std::string& type) {
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+// Desc: Column-major matrix of a node, from "matrix" or from translation, rotation and scale.
+static glm::mat4 GetNodeMatrix(const JsonValue& node) {
+	glm::mat4 matrix = glm::mat4(1.0f);
+	const JsonValue* values = node.Find("matrix");
+	if (values != nullptr && values->GetSize() == 16) {
+		for (int i = 0; i < 16; ++i) {
+			matrix[i / 4][i % 4] = (float)(*values)[i].GetNumber();
+		}
+		return matrix;
+	}
+	auto readVector = [&](const char* key, const size_t size, const glm::vec4 fallback) {
+		glm::vec4 vector = fallback;
+		const JsonValue* value = node.Find(key);
+		if (value != nullptr && value->GetSize() == size) {
+			for (size_t i = 0; i < size; ++i) {
+				vector[(int)i] = (float)(*value)[i].GetNumber();
+			}
+		}
+		return vector;
+	};
+	const glm::vec4 t = readVector("translation", 3, glm::vec4(0.0f));
+	const glm::vec4 q = readVector("rotation", 4, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	const glm::vec4 s = readVector("scale", 3, glm::vec4(1.0f));
+	// T * R * S, with R from the unit quaternion (x, y, z, w).
+	matrix[0] = glm::vec4(1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y + q.z * q.w), 2.0f * (q.x * q.z - q.y * q.w), 0.0f) * s.x;
+	matrix[1] = glm::vec4(2.0f * (q.x * q.y - q.z * q.w), 1.0f - 2.0f * (q.x * q.x + q.z * q.z), 2.0f * (q.y * q.z + q.x * q.w), 0.0f) * s.y;
+	matrix[2] = glm::vec4(2.0f * (q.x * q.z + q.y * q.w), 2.0f * (q.y * q.z - q.x * q.w), 1.0f - 2.0f * (q.x * q.x + q.y * q.y), 0.0f) * s.z;
+	matrix[3] = glm::vec4(t.x, t.y, t.z, 1.0f);
+	return matrix;
+}
+
+// GlbParser Declarations.
+// Walks the JSON chunk of a GlbFile and fills in its primitives, materials and images.
+class GlbParser
+{
+public:
+	GlbParser(GlbFile& glb, const JsonValue& root) : glb(glb), root(root) {}
+
+	void Parse() {
+		ParseImages();
+		ParseMaterials();
+
+		const JsonValue* scenes = root.Find("scenes");
+		const size_t sceneIndex = (size_t)root.GetNumber("scene", 0.0);
+		if (scenes != nullptr && sceneIndex < scenes->GetSize()) {
+			const JsonValue* nodes = (*scenes)[sceneIndex].Find("nodes");
+			for (size_t i = 0; nodes != nullptr && i < nodes->GetSize(); ++i) {
+				AddNode((int)(*nodes)[i].GetNumber(), glm::mat4(1.0f), 0);
+			}
+		}
+		else if (const JsonValue* meshes = root.Find("meshes")) {
+			// No scene: every mesh once, untransformed.
+			for (size_t i = 0; i < meshes->GetSize(); ++i) {
+				AddMesh((*meshes)[i], glm::mat4(1.0f));
+			}
+		}
+	}
+
+private:
+	void Warn(const std::string& message) const {
+		std::cerr << "[WARNING] " << glb.filePath.filename() << ": " << message << std::endl;
+	}
+
+	const JsonValue* GetElement(const char* key, const int index) const {
+		const JsonValue* array = root.Find(key);
+		if (array == nullptr || index < 0 || (size_t)index >= array->GetSize()) {
+			return nullptr;
+		}
+		return &(*array)[(size_t)index];
+	}
+
+	void ParseImages() {
+		const JsonValue* imageArray = root.Find("images");
+		for (size_t i = 0; imageArray != nullptr && i < imageArray->GetSize(); ++i) {
+			const JsonValue& image = (*imageArray)[i];
+			GlbImage out;
+			out.name = image.GetString("name", "image" + std::to_string(i));
+			const std::string uri = image.GetString("uri");
+			const JsonValue* view = GetElement("bufferViews", (int)image.GetNumber("bufferView", -1.0));
+			size_t viewOffset = 0;
+			size_t viewBytes = 0;
+			if (view != nullptr && GetBufferView(*view, viewOffset, viewBytes)) {
+				out.offset = viewOffset;
+				out.bytes = viewBytes;
+			}
+			else if (!uri.empty() && uri.rfind("data:", 0) != 0) {
+				out.filePath = glb.filePath.parent_path() / std::filesystem::u8path(uri);
+			}
+			else {
+				Warn("image " + std::to_string(i) + " is neither embedded nor a file, skipped");
+			}
+			glb.images.push_back(std::move(out));
+		}
+	}
+
+	void ParseMaterials() {
+		const JsonValue* materialArray = root.Find("materials");
+		for (size_t i = 0; materialArray != nullptr && i < materialArray->GetSize(); ++i) {
+			const JsonValue& material = (*materialArray)[i];
+			GlbMaterial out;
+			out.name = material.GetString("name");
+			if (const JsonValue* pbr = material.Find("pbrMetallicRoughness")) {
+				const JsonValue* factor = pbr->Find("baseColorFactor");
+				if (factor != nullptr && factor->GetSize() == 4) {
+					for (int c = 0; c < 4; ++c) {
+						out.baseColor[c] = (float)(*factor)[(size_t)c].GetNumber();
+					}
+				}
+				out.metallic = (float)pbr->GetNumber("metallicFactor", 1.0);
+				out.roughness = (float)pbr->GetNumber("roughnessFactor", 1.0);
+				if (const JsonValue* textureInfo = pbr->Find("baseColorTexture")) {
+					const JsonValue* texture = GetElement("textures", (int)textureInfo->GetNumber("index", -1.0));
+					const int source = texture != nullptr ? (int)texture->GetNumber("source", -1.0) : -1;
+					if (source >= 0 && (size_t)source < glb.images.size()) {
+						out.baseColorImage = source;
+					}
+				}
+			}
+			glb.materials.push_back(std::move(out));
+		}
+	}
+
+	void AddNode(const int nodeIndex, const glm::mat4& parentMatrix, const int depth) {
+		const JsonValue* node = GetElement("nodes", nodeIndex);
+		if (node == nullptr || depth > MAX_NODE_DEPTH) {
+			Warn("invalid node " + std::to_string(nodeIndex) + ", skipped");
+			return;
+		}
+		const glm::mat4 matrix = parentMatrix * GetNodeMatrix(*node);
+		if (const JsonValue* mesh = GetElement("meshes", (int)node->GetNumber("mesh", -1.0))) {
+			AddMesh(*mesh, matrix);
+		}
+		const JsonValue* children = node->Find("children");
+		for (size_t i = 0; children != nullptr && i < children->GetSize(); ++i) {
+			AddNode((int)(*children)[i].GetNumber(), matrix, depth + 1);
+		}
+	}
+
+	void AddMesh(const JsonValue& mesh, const glm::mat4& matrix) {
+		const JsonValue* primitiveArray = mesh.Find("primitives");
+		for (size_t i = 0; primitiveArray != nullptr && i < primitiveArray->GetSize(); ++i) {
+			GlbPrimitive primitive;
+			if (ParsePrimitive((*primitiveArray)[i], primitive)) {
+				primitive.matrix = matrix;
+				glb.primitives.push_back(primitive);
+			}
+		}
+	}
+
+	// Desc: Range of a buffer view, which must lie in the binary chunk.
+	bool GetBufferView(const JsonValue& view, size_t& offset, size_t& bytes) const {
+		if ((int)view.GetNumber("buffer", -1.0) != 0) {
+			return false;
+		}
+		const JsonValue* buffer = GetElement("buffers", 0);
+		if (buffer == nullptr || buffer->Find("uri") != nullptr) {
+			return false;
+		}
+		const double viewOffset = view.GetNumber("byteOffset", 0.0);
+		const double viewBytes = view.GetNumber("byteLength", -1.0);
+		if (viewOffset < 0.0 || viewBytes < 0.0 || viewOffset + viewBytes > (double)glb.binaryBytes) {
+			return false;
+		}
+		offset = (size_t)viewOffset;
+		bytes = (size_t)viewBytes;
+		return true;
+	}
+
+	// Desc: Locate an accessor in the binary chunk and check that all of its elements lie in its view.
+	bool GetAccessor(const int accessorIndex, const bool vertexAttribute, VertexStream& stream, size_t& count,
+		const JsonValue** accessorOut = nullptr) const {
+		const JsonValue* accessor = GetElement("accessors", accessorIndex);
+		if (accessor == nullptr || accessor->Find("sparse") != nullptr) {
+			return false;
+		}
+		const JsonValue* view = GetElement("bufferViews", (int)accessor->GetNumber("bufferView", -1.0));
+		size_t viewOffset = 0;
+		size_t viewBytes = 0;
+		if (view == nullptr || !GetBufferView(*view, viewOffset, viewBytes)) {
+			return false;
+		}
+
+		stream.type = (GLenum)accessor->GetNumber("componentType", 0.0);
+		stream.size = GetNumComponents(accessor->GetString("type"));
+		stream.normalized = accessor->Find("normalized") != nullptr && accessor->Find("normalized")->GetBoolean();
+		const size_t componentBytes = GetComponentBytes(stream.type);
+		const double countValue = accessor->GetNumber("count", -1.0);
+		const double accessorOffset = accessor->GetNumber("byteOffset", 0.0);
+		if (componentBytes == 0 || stream.size == 0 || countValue < 1.0 || accessorOffset < 0.0) {
+			return false;
+		}
+		count = (size_t)countValue;
+		const size_t elementBytes = componentBytes * (size_t)stream.size;
+		const double viewStride = view->GetNumber("byteStride", 0.0);
+		if (viewStride != 0.0 && (!vertexAttribute || viewStride < (double)elementBytes || viewStride > 252.0
+			|| (size_t)viewStride % 4 != 0)) {
+			return false;
+		}
+		const size_t stride = viewStride != 0.0 ? (size_t)viewStride : elementBytes;
+
+		// Aligned to the component size, and the last element ends inside the view.
+		stream.offset = viewOffset + (size_t)accessorOffset;
+		stream.stride = (GLsizei)stride;
+		if (stream.offset % componentBytes != 0 || stride % componentBytes != 0
+			|| (double)accessorOffset + (double)stride * (double)(count - 1) + (double)elementBytes > (double)viewBytes) {
+			return false;
+		}
+		if (accessorOut != nullptr) {
+			*accessorOut = accessor;
+		}
+		return true;
+	}
+
+	bool ParsePrimitive(const JsonValue& primitive, GlbPrimitive& out) const {
+		if ((int)primitive.GetNumber("mode", (double)GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+			Warn("primitive that is not a triangle list, skipped");
+			return false;
+		}
+		const JsonValue* attributes = primitive.Find("attributes");
+		if (attributes == nullptr) {
+			return false;
+		}
+
+		// POSITION is required; NORMAL and TEXCOORD_0 are optional but must match its count.
+		const JsonValue* positionAccessor = nullptr;
+		size_t numVertices = 0;
+		if (!GetAccessor((int)attributes->GetNumber("POSITION", -1.0), true, out.position, numVertices, &positionAccessor)
+			|| out.position.type != GL_FLOAT || out.position.size != 3) {
+			Warn("primitive with an invalid POSITION accessor, skipped");
+			return false;
+		}
+		out.numVertices = numVertices;
+		size_t count = 0;
+		if (attributes->Find("NORMAL") != nullptr
+			&& (!GetAccessor((int)attributes->GetNumber("NORMAL", -1.0), true, out.normal, count)
+				|| out.normal.type != GL_FLOAT || out.normal.size != 3 || count != numVertices)) {
+			Warn("primitive with an invalid NORMAL accessor, skipped");
+			return false;
+		}
+		if (attributes->Find("TEXCOORD_0") != nullptr
+			&& (!GetAccessor((int)attributes->GetNumber("TEXCOORD_0", -1.0), true, out.texcoord, count)
+				|| out.texcoord.size != 2 || count != numVertices
+				|| (out.texcoord.type != GL_FLOAT && !out.texcoord.normalized))) {
+			Warn("primitive with an invalid TEXCOORD_0 accessor, skipped");
+			return false;
+		}
+
+		if (primitive.Find("indices") != nullptr) {
+			VertexStream indices;
+			if (!GetAccessor((int)primitive.GetNumber("indices", -1.0), false, indices, count)
+				|| indices.size != 1 || (indices.type != GL_UNSIGNED_BYTE && indices.type != GL_UNSIGNED_SHORT
+					&& indices.type != GL_UNSIGNED_INT)) {
+				Warn("primitive with an invalid index accessor, skipped");
+				return false;
+			}
+			out.indexType = indices.type;
+			out.indexOffset = indices.offset;
+			out.numIndices = count;
+		}
+		else {
+			out.numIndices = numVertices;
+		}
+		if (out.numIndices % 3 != 0) {
+			Warn("primitive with a partial triangle, skipped");
+			return false;
+		}
+		for (size_t i = 0; out.indexType != 0 && i < out.numIndices; ++i) {
+			if (glb.ReadIndex(out, i) >= numVertices) {
+				Warn("primitive with an index past its vertices, skipped");
+				return false;
+			}
+		}
+
+		// POSITION carries its bounds in the file; scan only if a writer left them out.
+		const JsonValue* minValue = positionAccessor->Find("min");
+		const JsonValue* maxValue = positionAccessor->Find("max");
+		if (minValue != nullptr && maxValue != nullptr && minValue->GetSize() == 3 && maxValue->GetSize() == 3) {
+			for (int c = 0; c < 3; ++c) {
+				out.boundsMin[c] = (float)(*minValue)[(size_t)c].GetNumber();
+				out.boundsMax[c] = (float)(*maxValue)[(size_t)c].GetNumber();
+			}
+		}
+		else {
+			out.boundsMin = glm::vec3(1e30f);
+			out.boundsMax = glm::vec3(-1e30f);
+			for (size_t i = 0; i < numVertices; ++i) {
+				out.boundsMin = glm::min(out.boundsMin, glb.ReadPosition(out, i));
+				out.boundsMax = glm::max(out.boundsMax, glb.ReadPosition(out, i));
+			}
+		}
+
+		out.material = (int)primitive.GetNumber("material", -1.0);
+		if (out.material >= (int)glb.materials.size()) {
+			out.material = -1;
+		}
+		return true;
+	}
+
+	GlbFile& glb;
+	const JsonValue& root;
+};
+
+bool GlbFile::Open(const std::filesystem::path& glbFilePath) {
+	filePath = glbFilePath;
+	primitives.clear();
+	materials.clear();
+	images.clear();
+	if (!file.Open(filePath)) {
+		std::cerr << "[ERROR] Cannot open file " << filePath << std::endl;
+		return false;
+	}
+
+	// Header, then the JSON chunk and an optional BIN chunk, each 4-byte aligned.
+	const uint8_t* data = file.GetData();
+	const size_t size = file.GetSize();
+	if (size < 20 || ReadU32(data) != GLB_MAGIC || ReadU32(data + 4) != GLB_VERSION || ReadU32(data + 8) > size) {
+		std::cerr << "[ERROR] Not a glTF 2.0 binary file: " << filePath << std::endl;
+		return false;
+	}
+	const size_t jsonBytes = ReadU32(data + 12);
+	if (ReadU32(data + 16) != CHUNK_JSON || 20 + jsonBytes > size) {
+		std::cerr << "[ERROR] Missing JSON chunk: " << filePath << std::endl;
+		return false;
+	}
+	const size_t binHeader = 20 + ((jsonBytes + 3) & ~(size_t)3);
+	if (binHeader + 8 <= size && ReadU32(data + binHeader + 4) == CHUNK_BIN) {
+		binaryBytes = ReadU32(data + binHeader);
+		binary = data + binHeader + 8;
+		if (binHeader + 8 + binaryBytes > size) {
+			std::cerr << "[ERROR] Truncated BIN chunk: " << filePath << std::endl;
+			return false;
+		}
+	}
+
+	JsonValue root;
+	std::string error;
+	if (!JsonValue::Parse(std::string_view((const char*)data + 20, jsonBytes), root, error)) {
+		std::cerr << "[ERROR] " << filePath << ": " << error << std::endl;
+		return false;
+	}
+	const JsonValue* asset = root.Find("asset");
+	if (asset == nullptr || asset->GetString("version").rfind("2.", 0) != 0) {
+		std::cerr << "[ERROR] Unsupported glTF version: " << filePath << std::endl;
+		return false;
+	}
+
+	GlbParser parser(*this, root);
+	parser.Parse();
+	if (primitives.empty()) {
+		std::cerr << "[ERROR] No drawable triangles in " << filePath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+glm::vec3 GlbFile::ReadPosition(const GlbPrimitive& primitive, const size_t vertex) const {
+	glm::vec3 position;
+	std::memcpy(&position, binary + primitive.position.offset + vertex * primitive.position.stride, sizeof(position));
+	return position;
+}
+
+uint32_t GlbFile::ReadIndex(const GlbPrimitive& primitive, const size_t index) const {
+	if (primitive.indexType == 0) {
+		return (uint32_t)index;
+	}
+	const uint8_t* data = binary + primitive.indexOffset;
+	switch (primitive.indexType) {
+	case GL_UNSIGNED_BYTE:
+		return data[index];
+	case GL_UNSIGNED_SHORT: {
+		uint16_t value;
+		std::memcpy(&value, data + index * 2, sizeof(value));
+		return value;
+	}
+	default: {
+		uint32_t value;
+		std::memcpy(&value, data + index * 4, sizeof(value));
+		return value;
+	}
+	}
+}
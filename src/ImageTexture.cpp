@@ -1,17 +1,53 @@
 #include "ImageTexture.h"
 
-ImageTexture::ImageTexture(const std::filesystem::path& filePath)
+// C++ STL headers.
+#include <algorithm>
+
+// Project headers.
+#include "UploadManager.h"
+
+ImageTexture::ImageTexture(const std::filesystem::path& filePath, const bool flipVertically)
 	: texFilePath(filePath)
 {
 	imageWidth = 0;
 	imageHeight = 0;
 	numChannels = 0;
+	residentLevel = 0;
+	textureObj = 0;
+
+	// A chain cooked by model_cook is mapped as it is; otherwise decode the image and build it.
+	if (mipFile.Open(texFilePath, flipVertically)) {
+		mipLevels = mipFile.GetLevels();
+		texImage = mipLevels[0];
+		imageWidth = texImage.cols;
+		imageHeight = texImage.rows;
+		numChannels = texImage.channels();
+		return;
+	}
+	SetImage(cv::imread(texFilePath.string()), flipVertically);
+}
+
+ImageTexture::ImageTexture(const std::filesystem::path& name, const uint8_t* encoded, const size_t bytes,
+	const bool flipVertically)
+	: texFilePath(name)
+{
+	imageWidth = 0;
+	imageHeight = 0;
+	numChannels = 0;
+	residentLevel = 0;
 	textureObj = 0;
 
-	// Try to load texture image.
-	texImage = cv::imread(texFilePath.string());
+	// imdecode only reads through the header, so the mapped bytes are not copied.
+	const cv::Mat encodedImage(1, (int)bytes, CV_8UC1, (void*)encoded);
+	SetImage(cv::imdecode(encodedImage, cv::IMREAD_COLOR), flipVertically);
+}
+
+// Desc: Keep a decoded image and build its mip chain.
+void ImageTexture::SetImage(const cv::Mat& image, const bool flipVertically)
+{
+	texImage = image;
 	if (texImage.rows == 0 || texImage.cols == 0) {
-		std::cerr << "[ERROR] Failed to load image texture: " << filePath << std::endl;
+		std::cerr << "[ERROR] Failed to load image texture: " << texFilePath << std::endl;
 		return;
 	}
 	imageWidth = texImage.cols;
@@ -20,44 +56,97 @@ ImageTexture::ImageTexture(const std::filesystem::path& filePath)
 
 	// Flip texture in vertical direction.
 	// OpenCV has smaller y coordinate on top; while OpenGL has larger.
-	cv::flip(texImage, texImage, 0);
+	if (flipVertically) {
+		cv::flip(texImage, texImage, 0);
+	}
 
-	glGenTextures(1, &textureObj);
-    glBindTexture(GL_TEXTURE_2D, textureObj);
-    switch (numChannels) {
+	// Build the mip chain here rather than with glGenerateMipmap, so it can be streamed coarsest first.
+	MipChainFile::BuildLevels(texImage, mipLevels);
+}
+
+ImageTexture::~ImageTexture()
+{
+	if (textureObj != 0) {
+		TextureResidency::GetInstance().Unregister(this);
+		UploadManager::GetInstance().Cancel(this);
+		glDeleteTextures(1, &textureObj);
+	}
+	mipLevels.clear();
+	texImage.release();
+}
+
+// Desc: Upload the decoded image to the GPU. Must be called on the GL thread.
+void ImageTexture::Upload()
+{
+	if (textureObj != 0 || texImage.empty()) {
+		return;
+	}
+	if (numChannels != 1 && numChannels != 3 && numChannels != 4) {
+		std::cerr << "[ERROR] Unsupport texture format" << std::endl;
+		return;
+	}
+	residentLevel = TextureResidency::GetInstance().Register(this);
+	CreateTexture();
+}
+
+// Desc: Drop or add the finest levels by recreating the texture from the host mip chain.
+void ImageTexture::SetResidentLevel(const int level)
+{
+	const int newLevel = std::clamp(level, 0, GetNumLevels() - 1);
+	if (textureObj == 0 || newLevel == residentLevel) {
+		return;
+	}
+	UploadManager::GetInstance().Cancel(this);
+	glDeleteTextures(1, &textureObj);
+	textureObj = 0;
+	residentLevel = newLevel;
+	CreateTexture();
+}
+
+// Desc: RGB is counted as RGBA, as drivers usually store it.
+size_t ImageTexture::GetLevelBytes(const int level) const
+{
+	const cv::Mat& image = mipLevels[level];
+	return (size_t)image.cols * image.rows * (numChannels == 1 ? 1 : 4);
+}
+
+// Desc: Create the texture with the levels from residentLevel down and queue their data.
+void ImageTexture::CreateTexture()
+{
+	GLint internalFormat;
+	GLenum format;
+	switch (numChannels) {
 	case 1:
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, imageWidth, imageHeight, 
-						0, GL_RED, GL_UNSIGNED_BYTE, texImage.ptr());
+		internalFormat = GL_RED;
+		format = GL_RED;
 		break;
 	case 3:
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, imageWidth, imageHeight, 
-						0, GL_BGR, GL_UNSIGNED_BYTE, texImage.ptr());
+		internalFormat = GL_RGB;
+		format = GL_BGR;
 		break;
 	case 4:
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, imageWidth, imageHeight, 
-						0, GL_BGRA, GL_UNSIGNED_BYTE, texImage.ptr());
+		internalFormat = GL_RGBA;
+		format = GL_BGRA;
 		break;
 	default:
-		std::cerr << "[ERROR] Unsupport texture format" << std::endl;
-		break;
+		return;
 	}
 
+	glGenTextures(1, &textureObj);
+    glBindTexture(GL_TEXTURE_2D, textureObj);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	// Generate mipmaps.
-	glGenerateMipmap(GL_TEXTURE_2D);
-
 	glBindTexture(GL_TEXTURE_2D, 0);
-}
 
-ImageTexture::~ImageTexture()
-{
-	glDeleteTextures(1, &textureObj);
-	texImage.release();
+	std::vector<TextureLevel> levels;
+	for (size_t i = residentLevel; i < mipLevels.size(); ++i) {
+		levels.push_back({ mipLevels[i].ptr(), mipLevels[i].cols, mipLevels[i].rows, 1 });
+	}
+	UploadManager::GetInstance().UploadMipChain(this, GL_TEXTURE_2D, textureObj, internalFormat, format,
+		(size_t)numChannels, levels);
 }
 
 void ImageTexture::Bind(GLenum textureUnit)
@@ -66,6 +155,15 @@ void ImageTexture::Bind(GLenum textureUnit)
     glBindTexture(GL_TEXTURE_2D, textureObj);
 }
 
+size_t ImageTexture::GetHostMemoryBytes() const
+{
+	size_t bytes = 0;
+	for (const auto& level : mipLevels) {
+		bytes += level.total() * level.elemSize();
+	}
+	return bytes;
+}
+
 void ImageTexture::Preview()
 {
 	std::string windowText = "[DEBUG] TexturePreview: " + texFilePath.string();
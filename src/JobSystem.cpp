@@ -0,0 +1,376 @@
+#include "JobSystem.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Job Declarations.
+struct Job
+{
+	JobSystem::JobFunction function;
+	Job* parent = nullptr;
+	std::atomic<int> unfinished = 1;	// The job itself plus its unfinished children.
+	std::atomic<int> refs = 1;			// Handles, children and the scheduler.
+};
+
+static void RetainJob(Job* job) {
+	job->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void ReleaseJob(Job* job) {
+	if (job->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete job;
+	}
+}
+
+// Desc: Mark one unit of a job done, and propagate to the parent once the whole job is.
+static void FinishJob(Job* job) {
+	if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+	// Release what the function captured as soon as the job is done.
+	job->function = nullptr;
+	if (job->parent != nullptr) {
+		FinishJob(job->parent);
+		ReleaseJob(job->parent);
+	}
+	ReleaseJob(job);
+}
+
+// ------------------------------------------------------------------------------------------------
+
+JobHandle::JobHandle(const JobHandle& other) : job(other.job) {
+	if (job != nullptr) {
+		RetainJob(job);
+	}
+}
+
+JobHandle::JobHandle(JobHandle&& other) noexcept : job(other.job) {
+	other.job = nullptr;
+}
+
+JobHandle& JobHandle::operator=(JobHandle other) noexcept {
+	std::swap(job, other.job);
+	return *this;
+}
+
+JobHandle::~JobHandle() {
+	if (job != nullptr) {
+		ReleaseJob(job);
+	}
+}
+
+bool JobHandle::IsDone() const {
+	return job == nullptr || job->unfinished.load(std::memory_order_acquire) == 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+// WorkStealingDeque Declarations.
+// Bounded Chase-Lev deque: the owner pushes and pops at the bottom,
+// thieves take from the top. Push fails when full and the caller runs
+// the job inline instead.
+class WorkStealingDeque
+{
+public:
+	bool Push(Job* job) {
+		const int64_t b = bottom.load(std::memory_order_relaxed);
+		const int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= (int64_t)CAPACITY) {
+			return false;
+		}
+		buffer[b & MASK].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	Job* Pop() {
+		const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+		if (t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		Job* job = buffer[b & MASK].load(std::memory_order_relaxed);
+		if (t == b) {
+			// Last job: race the thieves for it.
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				job = nullptr;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* Steal() {
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b) {
+			return nullptr;
+		}
+		Job* job = buffer[t & MASK].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return job;
+	}
+
+private:
+	static constexpr size_t CAPACITY = 4096;
+	static constexpr size_t MASK = CAPACITY - 1;
+
+	alignas(64) std::atomic<int64_t> top = 0;
+	alignas(64) std::atomic<int64_t> bottom = 0;
+	std::atomic<Job*> buffer[CAPACITY];
+};
+
+// ------------------------------------------------------------------------------------------------
+
+// Index of the pool worker running on this thread, -1 on other threads.
+static thread_local int currentWorkerIndex = -1;
+
+// JobSystem Private Declarations.
+struct JobSystem::Impl {
+	std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+	std::vector<std::thread> workers;
+	std::thread::id mainThreadId;
+
+	// Jobs scheduled from threads outside the pool.
+	std::mutex sharedMutex;
+	std::deque<Job*> sharedQueue;
+
+	mutable std::mutex mainMutex;
+	std::vector<JobFunction> mainQueue;
+
+	// Idle workers sleep until a job is scheduled.
+	std::mutex sleepMutex;
+	std::condition_variable sleepCv;
+	std::atomic<int> numQueued = 0;
+	std::atomic<int> numSleeping = 0;
+	std::atomic<int> numUnrun = 0;	// Scheduled jobs whose function has not returned yet.
+	bool stop = false;
+
+	void Enqueue(Job* job) {
+		// Sequentially consistent with the sleep check in WorkerLoop, so a wakeup is never lost.
+		numQueued.fetch_add(1);
+		if (currentWorkerIndex >= 0 && deques[currentWorkerIndex]->Push(job)) {
+			// Pushed to the own deque.
+		}
+		else if (currentWorkerIndex >= 0) {
+			// Own deque full: run it now rather than growing.
+			numQueued.fetch_sub(1, std::memory_order_relaxed);
+			Execute(job);
+			return;
+		}
+		else {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			sharedQueue.push_back(job);
+		}
+		if (numSleeping.load() > 0) {
+			// Taking the lock orders this with a worker about to sleep.
+			{ std::lock_guard<std::mutex> lock(sleepMutex); }
+			sleepCv.notify_one();
+		}
+	}
+
+	// Desc: Own deque first, then the shared queue, then steal starting at a rotating victim.
+	Job* FindJob(const int workerIndex, uint32_t& victimSeed) {
+		Job* job = nullptr;
+		if (workerIndex >= 0) {
+			job = deques[workerIndex]->Pop();
+		}
+		if (job == nullptr) {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			if (!sharedQueue.empty()) {
+				job = sharedQueue.front();
+				sharedQueue.pop_front();
+			}
+		}
+		const int numDeques = (int)deques.size();
+		for (int i = 0; job == nullptr && i < numDeques; ++i) {
+			const int victim = (int)((victimSeed + i) % numDeques);
+			if (victim != workerIndex) {
+				job = deques[victim]->Steal();
+			}
+		}
+		victimSeed = victimSeed * 1664525u + 1013904223u;
+		if (job != nullptr) {
+			numQueued.fetch_sub(1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	void Execute(Job* job) {
+		job->function();
+		FinishJob(job);
+		numUnrun.fetch_sub(1, std::memory_order_release);
+	}
+};
+
+JobSystem& JobSystem::GetInstance() {
+	static JobSystem instance;
+	return instance;
+}
+
+JobSystem::JobSystem() {
+	pImpl = std::make_unique<Impl>();
+	pImpl->mainThreadId = std::this_thread::get_id();
+
+	// The main thread helps while it waits, so leave it a core.
+	const int numWorkers = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	for (int i = 0; i < numWorkers; ++i) {
+		pImpl->deques.push_back(std::make_unique<WorkStealingDeque>());
+	}
+	for (int i = 0; i < numWorkers; ++i) {
+		pImpl->workers.emplace_back([this, i]() { WorkerLoop(i); });
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(pImpl->sleepMutex);
+		pImpl->stop = true;
+	}
+	pImpl->sleepCv.notify_all();
+	for (auto& worker : pImpl->workers) {
+		worker.join();
+	}
+}
+
+JobHandle JobSystem::Schedule(JobFunction function, const JobHandle& parent) {
+	Job* job = new Job();
+	job->function = std::move(function);
+	if (parent.job != nullptr) {
+		job->parent = parent.job;
+		parent.job->unfinished.fetch_add(1, std::memory_order_relaxed);
+		RetainJob(parent.job);
+	}
+	// One reference for the returned handle, one held until the job finishes.
+	RetainJob(job);
+	pImpl->numUnrun.fetch_add(1, std::memory_order_relaxed);
+	pImpl->Enqueue(job);
+	return JobHandle(job);
+}
+
+// Desc: Main-thread jobs are left to the frame boundary: a GL job run here would change state in the
+// middle of the pass that waits.
+void JobSystem::Wait(const JobHandle& handle) {
+	uint32_t victimSeed = (uint32_t)currentWorkerIndex + 1;
+	while (!handle.IsDone()) {
+		Job* job = pImpl->FindJob(currentWorkerIndex, victimSeed);
+		if (job != nullptr) {
+			pImpl->Execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::WaitForAll() {
+	uint32_t victimSeed = (uint32_t)currentWorkerIndex + 1;
+	while (pImpl->numUnrun.load(std::memory_order_acquire) > 0) {
+		Job* job = pImpl->FindJob(currentWorkerIndex, victimSeed);
+		if (job != nullptr) {
+			pImpl->Execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::ParallelForImpl(const size_t count, const size_t grainSize, std::function<void(size_t, size_t)> function) {
+	if (count == 0) {
+		return;
+	}
+	// Roughly four chunks per thread, for balance, but never below the grain size.
+	const size_t numThreads = pImpl->workers.size() + 1;
+	const size_t chunkSize = std::max(std::max(grainSize, (size_t)1), (count + numThreads * 4 - 1) / (numThreads * 4));
+	if (chunkSize >= count) {
+		function(0, count);
+		return;
+	}
+
+	// An empty parent that is finished by its chunks.
+	Job* group = new Job();
+	JobHandle groupHandle(group);
+	RetainJob(group);
+	for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+		const size_t end = std::min(begin + chunkSize, count);
+		Schedule([&function, begin, end]() { function(begin, end); }, groupHandle);
+	}
+	function(0, chunkSize);
+	FinishJob(group);
+	Wait(groupHandle);
+}
+
+void JobSystem::PostToMainThread(JobFunction function) {
+	std::lock_guard<std::mutex> lock(pImpl->mainMutex);
+	pImpl->mainQueue.push_back(std::move(function));
+}
+
+// Desc: Off the main thread the jobs are left queued, as they need its GL context.
+bool JobSystem::RunMainThreadJobs() {
+	if (std::this_thread::get_id() != pImpl->mainThreadId) {
+		return false;
+	}
+	std::vector<JobFunction> jobs;
+	{
+		std::lock_guard<std::mutex> lock(pImpl->mainMutex);
+		jobs.swap(pImpl->mainQueue);
+	}
+	for (auto& job : jobs) {
+		job();
+	}
+	return !jobs.empty();
+}
+
+bool JobSystem::HasMainThreadJobs() const {
+	std::lock_guard<std::mutex> lock(pImpl->mainMutex);
+	return !pImpl->mainQueue.empty();
+}
+
+int JobSystem::GetNumWorkers() const {
+	return (int)pImpl->workers.size();
+}
+
+// Desc: Run jobs while there are any; spin briefly before going to sleep.
+void JobSystem::WorkerLoop(const int workerIndex) {
+	currentWorkerIndex = workerIndex;
+	uint32_t victimSeed = (uint32_t)workerIndex + 1;
+	int idleSpins = 0;
+	while (true) {
+		Job* job = pImpl->FindJob(workerIndex, victimSeed);
+		if (job != nullptr) {
+			pImpl->Execute(job);
+			idleSpins = 0;
+			continue;
+		}
+		if (++idleSpins < 64) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(pImpl->sleepMutex);
+		pImpl->numSleeping.fetch_add(1);
+		pImpl->sleepCv.wait(lock, [&]() {
+			return pImpl->stop || pImpl->numQueued.load() > 0;
+		});
+		pImpl->numSleeping.fetch_sub(1, std::memory_order_relaxed);
+		if (pImpl->stop) {
+			break;
+		}
+		idleSpins = 0;
+	}
+}
@@ -0,0 +1,237 @@
+#include "Json.h"
+
+// C++ STL headers.
+#include <charconv>
+#include <cstdlib>
+
+// Deeper documents are rejected rather than risking the stack.
+static constexpr int MAX_NESTING = 128;
+
+// JsonParser Declarations.
+// Recursive descent over the text, one value per call.
+class JsonParser
+{
+public:
+	explicit JsonParser(std::string_view text) : text(text) {}
+
+	bool ParseDocument(JsonValue& value, std::string& error) {
+		const bool ok = ParseValue(value, 0) && (SkipWhitespace(), position == text.size());
+		if (!ok) {
+			error = "invalid JSON near offset " + std::to_string(position);
+		}
+		return ok;
+	}
+
+private:
+	void SkipWhitespace() {
+		while (position < text.size()
+			&& (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r')) {
+			++position;
+		}
+	}
+
+	bool Consume(const char c) {
+		SkipWhitespace();
+		if (position < text.size() && text[position] == c) {
+			++position;
+			return true;
+		}
+		return false;
+	}
+
+	bool ConsumeWord(std::string_view word) {
+		if (text.substr(position, word.size()) != word) {
+			return false;
+		}
+		position += word.size();
+		return true;
+	}
+
+	bool ParseValue(JsonValue& value, const int depth) {
+		if (depth > MAX_NESTING) {
+			return false;
+		}
+		SkipWhitespace();
+		if (position >= text.size()) {
+			return false;
+		}
+		switch (text[position]) {
+		case '{':
+			return ParseObject(value, depth);
+		case '[':
+			return ParseArray(value, depth);
+		case '"':
+			value.type = JsonValue::Type::STRING;
+			return ParseString(value.string);
+		case 't':
+			value.type = JsonValue::Type::BOOLEAN;
+			value.boolean = true;
+			return ConsumeWord("true");
+		case 'f':
+			value.type = JsonValue::Type::BOOLEAN;
+			value.boolean = false;
+			return ConsumeWord("false");
+		case 'n':
+			value.type = JsonValue::Type::NUL;
+			return ConsumeWord("null");
+		default:
+			return ParseNumber(value);
+		}
+	}
+
+	bool ParseObject(JsonValue& value, const int depth) {
+		value.type = JsonValue::Type::OBJECT;
+		++position;
+		if (Consume('}')) {
+			return true;
+		}
+		do {
+			SkipWhitespace();
+			std::string key;
+			if (position >= text.size() || text[position] != '"' || !ParseString(key) || !Consume(':')) {
+				return false;
+			}
+			value.members.emplace_back(std::move(key), JsonValue());
+			if (!ParseValue(value.members.back().second, depth + 1)) {
+				return false;
+			}
+		} while (Consume(','));
+		return Consume('}');
+	}
+
+	bool ParseArray(JsonValue& value, const int depth) {
+		value.type = JsonValue::Type::ARRAY;
+		++position;
+		if (Consume(']')) {
+			return true;
+		}
+		do {
+			value.elements.emplace_back();
+			if (!ParseValue(value.elements.back(), depth + 1)) {
+				return false;
+			}
+		} while (Consume(','));
+		return Consume(']');
+	}
+
+	bool ParseNumber(JsonValue& value) {
+		value.type = JsonValue::Type::NUMBER;
+		const char* begin = text.data() + position;
+		const char* end = text.data() + text.size();
+		const auto result = std::from_chars(begin, end, value.number);
+		if (result.ec != std::errc() || result.ptr == begin) {
+			return false;
+		}
+		position += (size_t)(result.ptr - begin);
+		return true;
+	}
+
+	// Desc: Parse a quoted string, decoding escapes; \u escapes are written as UTF-8.
+	bool ParseString(std::string& out) {
+		++position;
+		while (position < text.size()) {
+			const char c = text[position++];
+			if (c == '"') {
+				return true;
+			}
+			if (c != '\\') {
+				out.push_back(c);
+				continue;
+			}
+			if (position >= text.size()) {
+				return false;
+			}
+			const char escape = text[position++];
+			switch (escape) {
+			case '"': out.push_back('"'); break;
+			case '\\': out.push_back('\\'); break;
+			case '/': out.push_back('/'); break;
+			case 'b': out.push_back('\b'); break;
+			case 'f': out.push_back('\f'); break;
+			case 'n': out.push_back('\n'); break;
+			case 'r': out.push_back('\r'); break;
+			case 't': out.push_back('\t'); break;
+			case 'u': {
+				unsigned int codePoint = 0;
+				if (!ParseHex4(codePoint)) {
+					return false;
+				}
+				// A high surrogate must be followed by its low half.
+				if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+					unsigned int low = 0;
+					if (!ConsumeWord("\\u") || !ParseHex4(low) || low < 0xDC00 || low >= 0xE000) {
+						return false;
+					}
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				AppendUtf8(out, codePoint);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool ParseHex4(unsigned int& value) {
+		if (position + 4 > text.size()) {
+			return false;
+		}
+		const auto result = std::from_chars(text.data() + position, text.data() + position + 4, value, 16);
+		if (result.ec != std::errc() || result.ptr != text.data() + position + 4) {
+			return false;
+		}
+		position += 4;
+		return true;
+	}
+
+	static void AppendUtf8(std::string& out, const unsigned int codePoint) {
+		if (codePoint < 0x80) {
+			out.push_back((char)codePoint);
+		}
+		else if (codePoint < 0x800) {
+			out.push_back((char)(0xC0 | (codePoint >> 6)));
+			out.push_back((char)(0x80 | (codePoint & 0x3F)));
+		}
+		else if (codePoint < 0x10000) {
+			out.push_back((char)(0xE0 | (codePoint >> 12)));
+			out.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+			out.push_back((char)(0x80 | (codePoint & 0x3F)));
+		}
+		else {
+			out.push_back((char)(0xF0 | (codePoint >> 18)));
+			out.push_back((char)(0x80 | ((codePoint >> 12) & 0x3F)));
+			out.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+			out.push_back((char)(0x80 | (codePoint & 0x3F)));
+		}
+	}
+
+	std::string_view text;
+	size_t position = 0;
+};
+
+bool JsonValue::Parse(std::string_view text, JsonValue& value, std::string& error) {
+	value = JsonValue();
+	JsonParser parser(text);
+	return parser.ParseDocument(value, error);
+}
+
+const JsonValue* JsonValue::Find(std::string_view key) const {
+	for (const auto& [name, member] : members) {
+		if (name == key) {
+			return &member;
+		}
+	}
+	return nullptr;
+}
+
+double JsonValue::GetNumber(std::string_view key, const double fallback) const {
+	const JsonValue* member = Find(key);
+	return member != nullptr && member->IsNumber() ? member->number : fallback;
+}
+
+std::string JsonValue::GetString(std::string_view key, const std::string& fallback) const {
+	const JsonValue* member = Find(key);
+	return member != nullptr && member->IsString() ? member->string : fallback;
+}
@@ -0,0 +1,68 @@
+#include "LightBlock.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "ShaderProg.h"
+
+LightBlock::LightBlock() {
+	data = LightBlockData();
+	features = 0;
+	glGenBuffers(1, &uboId);
+	glBindBuffer(GL_UNIFORM_BUFFER, uboId);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlockData), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+LightBlock::~LightBlock() {
+	glDeleteBuffers(1, &uboId);
+}
+
+void LightBlock::Prepare(
+	const glm::mat4x4& viewMatrix,
+	const IrradianceSH& ambient,
+	const glm::mat3x3& worldToAmbient,
+	const std::shared_ptr<DirectionalLight>& dirLight,
+	const std::shared_ptr<PointLight>& pointLight,
+	const std::shared_ptr<SpotLight>& spotLight
+) {
+	features = 0;
+	// The view matrix is a rotation and a translation, so its transpose takes normals back to world space.
+	const glm::mat3x3 viewToAmbient = worldToAmbient * glm::transpose(glm::mat3x3(viewMatrix));
+	for (int column = 0; column < 3; ++column) {
+		data.viewToSky[column] = glm::vec4(viewToAmbient[column], 0.0f);
+	}
+	for (int k = 0; k < 9; ++k) {
+		data.ambientSH[k] = glm::vec4(ambient.coefficients[k], 0.0f);
+	}
+
+	if (dirLight != nullptr) {
+		features |= PHONG_HAS_DIR_LIGHT;
+		glm::vec3 dir = glm::normalize(glm::vec3(viewMatrix * glm::vec4(dirLight->GetDirection(), 0.0f)));
+		data.dirLightDir = glm::vec4(dir, 0.0f);
+		data.dirLightRadiance = glm::vec4(dirLight->GetRadiance(), 0.0f);
+	}
+	if (pointLight != nullptr) {
+		features |= PHONG_HAS_POINT_LIGHT;
+		data.pointLightPos = viewMatrix * glm::vec4(pointLight->GetPosition(), 1.0f);
+		data.pointLightIntensity = glm::vec4(pointLight->GetIntensity(), 0.0f);
+	}
+	if (spotLight != nullptr) {
+		features |= PHONG_HAS_SPOT_LIGHT;
+		glm::vec3 dir = glm::normalize(glm::vec3(viewMatrix * glm::vec4(spotLight->GetDirection(), 0.0f)));
+		data.spotLightPos = viewMatrix * glm::vec4(spotLight->GetPosition(), 1.0f);
+		data.spotLightDir = glm::vec4(dir, 0.0f);
+		data.spotLightIntensity = glm::vec4(spotLight->GetIntensity(), 0.0f);
+		// Full intensity inside (totalWidth - cutoff) degrees, none outside totalWidth.
+		float cosOuter = std::cos(glm::radians(spotLight->GetTotalWidthDeg()));
+		float cosInner = std::cos(glm::radians(spotLight->GetTotalWidthDeg() - spotLight->GetCutoffDeg()));
+		data.spotLightCone = glm::vec4(cosOuter, 1.0f / std::max(cosInner - cosOuter, 1e-4f), 0.0f, 0.0f);
+	}
+}
+
+void LightBlock::Record(CommandList& commandList) const {
+	commandList.BufferSubData(GL_UNIFORM_BUFFER, uboId, 0, &data, sizeof(LightBlockData));
+	commandList.BindBufferBase(GL_UNIFORM_BUFFER, BINDING_POINT, uboId);
+}
@@ -0,0 +1,100 @@
+#include "MappedFile.h"
+
+// C++ STL headers.
+#include <algorithm>
+
+// Platform headers.
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const std::filesystem::path& filePath) {
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		return false;
+	}
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = (const uint8_t*)view;
+	size = (size_t)fileSize.QuadPart;
+#else
+	const int fd = open(filePath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file referenced.
+	close(fd);
+	if (view == MAP_FAILED) {
+		return false;
+	}
+	data = (const uint8_t*)view;
+	size = (size_t)fileStat.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data == nullptr) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(mappingHandle);
+	CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(data), size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+void MappedFile::WillNeed(const size_t offset, const size_t bytes) const {
+	if (data == nullptr || offset >= size) {
+		return;
+	}
+#ifndef _WIN32
+	// madvise wants a page-aligned start.
+	const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	const size_t begin = offset & ~(pageSize - 1);
+	const size_t end = std::min(size, offset + bytes);
+	madvise(const_cast<uint8_t*>(data) + begin, end - begin, MADV_WILLNEED);
+#endif
+}
@@ -0,0 +1,157 @@
+#include "MipChainFile.h"
+
+// OpenCV headers.
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+// C++ STL headers.
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static constexpr char MIP_CHAIN_MAGIC[4] = { 'M', 'I', 'P', 'C' };
+static constexpr uint32_t MIP_CHAIN_VERSION = 1;
+
+// Desc: Size and last write time of the source image, or false if it cannot be read.
+static bool GetSourceStamp(const std::filesystem::path& imagePath, uint64_t& bytes, int64_t& writeTime) {
+	std::error_code ec;
+	bytes = (uint64_t)std::filesystem::file_size(imagePath, ec);
+	if (ec) {
+		return false;
+	}
+	const auto time = std::filesystem::last_write_time(imagePath, ec);
+	writeTime = ec ? 0 : (int64_t)time.time_since_epoch().count();
+	return !ec;
+}
+
+// Desc: Bytes of every level of a chain together.
+static uint64_t GetChainBytes(const MipChainHeader& header) {
+	uint64_t bytes = 0;
+	for (uint32_t level = 0; level < header.numLevels; ++level) {
+		bytes += (uint64_t)std::max(1, header.width >> level) * std::max(1, header.height >> level) * header.numChannels;
+	}
+	return bytes;
+}
+
+std::filesystem::path MipChainFile::GetCookedPath(const std::filesystem::path& imagePath) {
+	std::filesystem::path cookedPath = imagePath;
+	cookedPath += ".mips";
+	return cookedPath;
+}
+
+// Desc: Map and validate the cooked chain of an image. A missing or outdated chain is not an error:
+// the image is then decoded as before.
+bool MipChainFile::Open(const std::filesystem::path& imagePath, const bool flipped) {
+	header = nullptr;
+	uint64_t sourceBytes = 0;
+	int64_t sourceWriteTime = 0;
+	const std::filesystem::path cookedPath = GetCookedPath(imagePath);
+	std::error_code ec;
+	if (!std::filesystem::exists(cookedPath, ec) || !GetSourceStamp(imagePath, sourceBytes, sourceWriteTime)
+		|| !file.Open(cookedPath)) {
+		return false;
+	}
+	const MipChainHeader* fileHeader = (const MipChainHeader*)file.GetData();
+	if (file.GetSize() < sizeof(MipChainHeader) || std::memcmp(fileHeader->magic, MIP_CHAIN_MAGIC, 4) != 0
+		|| fileHeader->version != MIP_CHAIN_VERSION) {
+		std::cerr << "[ERROR] Not a mip chain file: " << cookedPath << std::endl;
+		file.Close();
+		return false;
+	}
+	if (fileHeader->width <= 0 || fileHeader->height <= 0 || fileHeader->numLevels == 0 || fileHeader->numLevels > 32
+		|| (fileHeader->numChannels != 1 && fileHeader->numChannels != 3 && fileHeader->numChannels != 4)
+		|| GetChainBytes(*fileHeader) > file.GetSize() - sizeof(MipChainHeader)) {
+		std::cerr << "[ERROR] Corrupt mip chain file: " << cookedPath << std::endl;
+		file.Close();
+		return false;
+	}
+	if (fileHeader->sourceBytes != sourceBytes || fileHeader->sourceWriteTime != sourceWriteTime
+		|| (fileHeader->flipped != 0) != flipped) {
+		file.Close();
+		return false;
+	}
+	header = fileHeader;
+	return true;
+}
+
+std::vector<cv::Mat> MipChainFile::GetLevels() const {
+	std::vector<cv::Mat> levels;
+	const uint8_t* data = file.GetData() + sizeof(MipChainHeader);
+	for (uint32_t level = 0; level < header->numLevels; ++level) {
+		const int width = std::max(1, header->width >> level);
+		const int height = std::max(1, header->height >> level);
+		levels.emplace_back(height, width, CV_MAKETYPE(CV_8U, (int)header->numChannels), (void*)data);
+		data += (size_t)width * height * header->numChannels;
+	}
+	return levels;
+}
+
+// Desc: Each level halves the previous one with an area filter, rounding down, as glGenerateMipmap sizes them.
+void MipChainFile::BuildLevels(const cv::Mat& image, std::vector<cv::Mat>& levels) {
+	levels.clear();
+	levels.push_back(image);
+	while (levels.back().cols > 1 || levels.back().rows > 1) {
+		const cv::Mat& previous = levels.back();
+		cv::Mat level;
+		cv::resize(previous, level, cv::Size(std::max(1, previous.cols / 2), std::max(1, previous.rows / 2)),
+			0.0, 0.0, cv::INTER_AREA);
+		levels.push_back(level);
+	}
+}
+
+// Desc: Decode, flip and downsample the image as ImageTexture would at load time, then write the
+// levels through a temporary file, so a viewer never maps a half-written chain.
+bool MipChainFile::Build(const std::filesystem::path& imagePath, const bool flipped) {
+	MipChainHeader header = {};
+	if (!GetSourceStamp(imagePath, header.sourceBytes, header.sourceWriteTime)) {
+		std::cerr << "[ERROR] Cannot open file " << imagePath << std::endl;
+		return false;
+	}
+	cv::Mat image = cv::imread(imagePath.string());
+	if (image.empty()) {
+		std::cerr << "[ERROR] Failed to decode image: " << imagePath << std::endl;
+		return false;
+	}
+	if (flipped) {
+		cv::flip(image, image, 0);
+	}
+	std::vector<cv::Mat> levels;
+	BuildLevels(image, levels);
+
+	std::memcpy(header.magic, MIP_CHAIN_MAGIC, 4);
+	header.version = MIP_CHAIN_VERSION;
+	header.width = image.cols;
+	header.height = image.rows;
+	header.numChannels = (uint32_t)image.channels();
+	header.numLevels = (uint32_t)levels.size();
+	header.flipped = flipped ? 1 : 0;
+
+	const std::filesystem::path cookedPath = GetCookedPath(imagePath);
+	std::filesystem::path tmpPath = cookedPath;
+	tmpPath += ".tmp";
+	std::error_code ec;
+	{
+		std::ofstream output(tmpPath, std::ios::binary | std::ios::trunc);
+		output.write((const char*)&header, sizeof(header));
+		for (const cv::Mat& level : levels) {
+			const size_t rowBytes = (size_t)level.cols * header.numChannels;
+			for (int row = 0; row < level.rows; ++row) {
+				output.write((const char*)level.ptr(row), (std::streamsize)rowBytes);
+			}
+		}
+		if (!output) {
+			std::cerr << "[ERROR] Failed to write " << tmpPath << std::endl;
+			output.close();
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+	}
+	std::filesystem::rename(tmpPath, cookedPath, ec);
+	if (ec) {
+		std::cerr << "[ERROR] Failed to replace " << cookedPath << std::endl;
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+	return true;
+}
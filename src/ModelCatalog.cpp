@@ -0,0 +1,597 @@
+#include "ModelCatalog.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string_view>
+
+// Project headers.
+#include "ChunkedMeshFile.h"
+#include "CookedMeshFile.h"
+#include "GlbFile.h"
+#include "Hash.h"
+#include "JobSystem.h"
+#include "PlyReader.h"
+#include "PointCloudFile.h"
+
+namespace opengl_homework {
+
+static constexpr uint32_t CATALOG_MAGIC = 0x4C54434D;	// "MCTL".
+static constexpr uint32_t CATALOG_VERSION = 2;
+
+// Desc: Last write time of a file as a plain integer, or 0 if it does not exist.
+static int64_t GetWriteTime(const std::filesystem::path& path) {
+	std::error_code ec;
+	auto time = std::filesystem::last_write_time(path, ec);
+	return ec ? 0 : (int64_t)time.time_since_epoch().count();
+}
+
+// Desc: Size of a file, or 0 if it does not exist.
+static uint64_t GetFileBytes(const std::filesystem::path& path) {
+	std::error_code ec;
+	auto size = std::filesystem::file_size(path, ec);
+	return ec ? 0 : (uint64_t)size;
+}
+
+// Desc: Read a whole file with a single read call.
+static bool ReadWholeFile(const std::filesystem::path& path, std::string& data) {
+	std::ifstream fin(path, std::ios::binary | std::ios::ate);
+	if (!fin) {
+		return false;
+	}
+	data.resize((size_t)fin.tellg());
+	fin.seekg(0);
+	fin.read(data.data(), (std::streamsize)data.size());
+	return (bool)fin;
+}
+
+// ByteWriter Declarations (catalog serialization).
+struct ByteWriter
+{
+	std::string buffer;
+
+	template<typename T>
+	void Put(const T& value) {
+		buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+	void PutString(const std::string& value) {
+		Put((uint32_t)value.size());
+		buffer.append(value);
+	}
+};
+
+// ByteReader Declarations (catalog deserialization with bounds checks).
+struct ByteReader
+{
+	const std::string& buffer;
+	size_t offset = 0;
+	bool ok = true;
+
+	template<typename T>
+	T Get() {
+		T value{};
+		if (offset + sizeof(T) > buffer.size()) {
+			ok = false;
+			return value;
+		}
+		std::memcpy(&value, buffer.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return value;
+	}
+	std::string GetString() {
+		uint32_t size = Get<uint32_t>();
+		if (!ok || offset + size > buffer.size()) {
+			ok = false;
+			return "";
+		}
+		std::string value = buffer.substr(offset, size);
+		offset += size;
+		return value;
+	}
+};
+
+ModelCatalog::ModelCatalog(const std::filesystem::path& catalogFilePath)
+	: catalogFilePath(catalogFilePath) {
+	modelDirWriteTime = 0;
+	textureDirWriteTime = 0;
+	dirty = false;
+}
+
+ModelCatalog::~ModelCatalog() {}
+
+bool ModelCatalog::Load() {
+	std::string data;
+	if (!ReadWholeFile(catalogFilePath, data)) {
+		return false;
+	}
+
+	ByteReader reader{ data };
+	if (reader.Get<uint32_t>() != CATALOG_MAGIC || reader.Get<uint32_t>() != CATALOG_VERSION) {
+		std::cerr << "[WARNING] Ignoring catalog with unknown format: " << catalogFilePath << std::endl;
+		return false;
+	}
+	modelDirWriteTime = reader.Get<int64_t>();
+	textureDirWriteTime = reader.Get<int64_t>();
+
+	std::vector<ModelInfo> loadedModels(reader.Get<uint32_t>());
+	for (auto& info : loadedModels) {
+		info.name = reader.GetString();
+		info.dirWriteTime = reader.Get<int64_t>();
+		info.objFilePath = reader.GetString();
+		info.objBytes = reader.Get<uint64_t>();
+		info.objWriteTime = reader.Get<int64_t>();
+		info.mtlBytes = reader.Get<uint64_t>();
+		info.mtlWriteTime = reader.Get<int64_t>();
+		info.contentHash = reader.Get<uint64_t>();
+		info.loadHint = reader.Get<MeshLoadHint>();
+		info.boundsMin = reader.Get<glm::vec3>();
+		info.boundsMax = reader.Get<glm::vec3>();
+		info.materials.resize(reader.Get<uint32_t>());
+		for (auto& material : info.materials) {
+			material = reader.GetString();
+		}
+		info.textures.resize(reader.Get<uint32_t>());
+		for (auto& texture : info.textures) {
+			texture = reader.GetString();
+		}
+		if (!reader.ok) {
+			break;
+		}
+	}
+	std::vector<std::string> loadedSkyboxNames(reader.Get<uint32_t>());
+	for (auto& skyboxName : loadedSkyboxNames) {
+		skyboxName = reader.GetString();
+	}
+
+	if (!reader.ok) {
+		std::cerr << "[WARNING] Ignoring truncated catalog: " << catalogFilePath << std::endl;
+		return false;
+	}
+	models = std::move(loadedModels);
+	skyboxNames = std::move(loadedSkyboxNames);
+	dirty = false;
+	return true;
+}
+
+bool ModelCatalog::Save() {
+	if (!dirty) {
+		return true;
+	}
+
+	ByteWriter writer;
+	writer.Put(CATALOG_MAGIC);
+	writer.Put(CATALOG_VERSION);
+	writer.Put(modelDirWriteTime);
+	writer.Put(textureDirWriteTime);
+	writer.Put((uint32_t)models.size());
+	for (const auto& info : models) {
+		writer.PutString(info.name);
+		writer.Put(info.dirWriteTime);
+		writer.PutString(info.objFilePath.generic_string());
+		writer.Put(info.objBytes);
+		writer.Put(info.objWriteTime);
+		writer.Put(info.mtlBytes);
+		writer.Put(info.mtlWriteTime);
+		writer.Put(info.contentHash);
+		writer.Put(info.loadHint);
+		writer.Put(info.boundsMin);
+		writer.Put(info.boundsMax);
+		writer.Put((uint32_t)info.materials.size());
+		for (const auto& material : info.materials) {
+			writer.PutString(material);
+		}
+		writer.Put((uint32_t)info.textures.size());
+		for (const auto& texture : info.textures) {
+			writer.PutString(texture.generic_string());
+		}
+	}
+	writer.Put((uint32_t)skyboxNames.size());
+	for (const auto& skyboxName : skyboxNames) {
+		writer.PutString(skyboxName);
+	}
+
+	// Write to a temporary file first so a crash never leaves a half-written catalog.
+	std::error_code ec;
+	std::filesystem::create_directories(catalogFilePath.parent_path(), ec);
+	auto tmpFilePath = catalogFilePath;
+	tmpFilePath += ".tmp";
+	{
+		std::ofstream fout(tmpFilePath, std::ios::binary | std::ios::trunc);
+		if (!fout.write(writer.buffer.data(), (std::streamsize)writer.buffer.size())) {
+			std::cerr << "[ERROR] Failed to write catalog: " << tmpFilePath << std::endl;
+			return false;
+		}
+	}
+	std::filesystem::rename(tmpFilePath, catalogFilePath, ec);
+	if (ec) {
+		std::cerr << "[ERROR] Failed to replace catalog: " << catalogFilePath << std::endl;
+		return false;
+	}
+	dirty = false;
+	return true;
+}
+
+// Desc: The top-level directories only change when a model directory is added or removed. A file
+// cooked, added or removed inside a model directory changes that directory, and one edited in place
+// changes only itself, so every model directory, model file and MTL is checked too.
+bool ModelCatalog::IsStale(const std::filesystem::path& modelDir, const std::filesystem::path& textureDir) const {
+	if (GetWriteTime(modelDir) != modelDirWriteTime || GetWriteTime(textureDir) != textureDirWriteTime) {
+		return true;
+	}
+	for (const auto& info : models) {
+		const auto infoDir = info.objFilePath.parent_path();
+		const auto mtlFilePath = infoDir / (info.name + ".mtl");
+		if (GetWriteTime(infoDir) != info.dirWriteTime
+			|| GetFileBytes(info.objFilePath) != info.objBytes || GetWriteTime(info.objFilePath) != info.objWriteTime
+			|| GetFileBytes(mtlFilePath) != info.mtlBytes || GetWriteTime(mtlFilePath) != info.mtlWriteTime) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void ModelCatalog::Refresh(const std::filesystem::path& modelDir, const std::filesystem::path& textureDir) {
+	std::map<std::string, ModelInfo> previous;
+	for (auto& info : models) {
+		previous[info.name] = std::move(info);
+	}
+
+	std::vector<ModelInfo> refreshed;
+	std::vector<ModelInfo> changed;
+	std::vector<std::filesystem::path> changedObjFilePaths;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(modelDir, ec)) {
+		if (!entry.is_directory()) {
+			continue;
+		}
+		const std::string name = entry.path().filename().string();
+		std::filesystem::path objFilePath;
+		uint64_t objBytes = 0;
+		for (const char* extension : { ".octree", ".chunks", ".glb", ".ply", ".cmesh", ".obj" }) {
+			objFilePath = entry.path() / (name + extension);
+			objBytes = GetFileBytes(objFilePath);
+			if (objBytes != 0) {
+				break;
+			}
+		}
+		if (objBytes == 0) {
+			// No matching point cloud, chunked or cooked mesh, GLB, PLY or OBJ in this directory.
+			continue;
+		}
+		const int64_t dirWriteTime = GetWriteTime(entry.path());
+		const auto mtlFilePath = entry.path() / (name + ".mtl");
+		const int64_t objWriteTime = GetWriteTime(objFilePath);
+		const int64_t mtlWriteTime = GetWriteTime(mtlFilePath);
+		const uint64_t mtlBytes = GetFileBytes(mtlFilePath);
+
+		auto it = previous.find(name);
+		if (it != previous.end() && it->second.objFilePath == objFilePath
+			&& it->second.objBytes == objBytes && it->second.objWriteTime == objWriteTime
+			&& it->second.mtlBytes == mtlBytes && it->second.mtlWriteTime == mtlWriteTime) {
+			if (it->second.dirWriteTime != dirWriteTime) {
+				it->second.dirWriteTime = dirWriteTime;
+				dirty = true;
+			}
+			refreshed.push_back(std::move(it->second));
+			continue;
+		}
+
+		ModelInfo info;
+		info.name = name;
+		info.dirWriteTime = dirWriteTime;
+		info.mtlBytes = mtlBytes;
+		info.mtlWriteTime = mtlWriteTime;
+		changed.push_back(std::move(info));
+		changedObjFilePaths.push_back(objFilePath);
+	}
+
+	// Scanning reads and hashes every changed model; spread them over the job system.
+	std::vector<char> scanned(changed.size(), 0);
+	JobSystem::GetInstance().ParallelFor(changed.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			scanned[i] = ScanModel(changedObjFilePaths[i], changed[i]);
+		}
+	});
+	for (size_t i = 0; i < changed.size(); ++i) {
+		if (scanned[i]) {
+			refreshed.push_back(std::move(changed[i]));
+			dirty = true;
+		}
+	}
+	std::sort(refreshed.begin(), refreshed.end(),
+		[](const ModelInfo& a, const ModelInfo& b) { return a.name < b.name; });
+	if (refreshed.size() != previous.size()) {
+		dirty = true;
+	}
+	models = std::move(refreshed);
+
+	std::vector<std::string> refreshedSkyboxNames;
+	for (const auto& entry : std::filesystem::directory_iterator(textureDir, ec)) {
+		if (entry.is_regular_file()) {
+			refreshedSkyboxNames.push_back(entry.path().filename().string());
+		}
+	}
+	std::sort(refreshedSkyboxNames.begin(), refreshedSkyboxNames.end());
+	if (refreshedSkyboxNames != skyboxNames) {
+		skyboxNames = std::move(refreshedSkyboxNames);
+		dirty = true;
+	}
+
+	const int64_t newModelDirWriteTime = GetWriteTime(modelDir);
+	const int64_t newTextureDirWriteTime = GetWriteTime(textureDir);
+	if (newModelDirWriteTime != modelDirWriteTime || newTextureDirWriteTime != textureDirWriteTime) {
+		modelDirWriteTime = newModelDirWriteTime;
+		textureDirWriteTime = newTextureDirWriteTime;
+		dirty = true;
+	}
+}
+
+// Desc: Add the material names and diffuse textures of the material libraries of an OBJ model.
+static void ScanMaterialLibraries(const std::vector<std::filesystem::path>& mtlFilePaths, ModelInfo& info) {
+	for (const auto& mtlFilePath : mtlFilePaths) {
+		std::ifstream fin(mtlFilePath);
+		std::string line;
+		while (std::getline(fin, line)) {
+			std::istringstream iss(line);
+			std::string type;
+			iss >> type;
+			if (type == "newmtl") {
+				std::string mtlName;
+				iss >> mtlName;
+				info.materials.push_back(mtlName);
+			}
+			else if (type == "map_Kd") {
+				std::string texFileName;
+				iss >> texFileName;
+				info.textures.push_back(mtlFilePath.parent_path() / texFileName);
+			}
+		}
+	}
+}
+
+// Desc: Fill in the metadata of a GLB model from its validated JSON chunk; the geometry is only
+// read where the file leaves out the position bounds.
+static bool ScanGlbModel(const std::filesystem::path& glbFilePath, ModelInfo& info) {
+	GlbFile glb;
+	if (!glb.Open(glbFilePath)) {
+		std::cerr << "[ERROR] Failed to scan model: " << glbFilePath << std::endl;
+		return false;
+	}
+
+	info.objFilePath = glbFilePath;
+	info.objBytes = glb.GetFileBytes();
+	info.objWriteTime = GetWriteTime(glbFilePath);
+	info.contentHash = HashBytes(glb.GetFileData(), glb.GetFileBytes());
+	info.loadHint = MeshLoadHint();
+	info.materials.clear();
+	info.textures.clear();
+
+	glm::vec3 minPos = glm::vec3(1e9f);
+	glm::vec3 maxPos = glm::vec3(-1e9f);
+	for (const GlbPrimitive& primitive : glb.GetPrimitives()) {
+		for (int corner = 0; corner < 8; ++corner) {
+			const glm::vec3 position = glm::vec3(
+				(corner & 1) ? primitive.boundsMax.x : primitive.boundsMin.x,
+				(corner & 2) ? primitive.boundsMax.y : primitive.boundsMin.y,
+				(corner & 4) ? primitive.boundsMax.z : primitive.boundsMin.z);
+			const glm::vec3 transformed = glm::vec3(primitive.matrix * glm::vec4(position, 1.0f));
+			minPos = glm::min(minPos, transformed);
+			maxPos = glm::max(maxPos, transformed);
+		}
+		info.loadHint.numPositions += (int)primitive.numVertices;
+		info.loadHint.numVertices += (int)primitive.numVertices;
+		info.loadHint.numTriangles += (int)(primitive.numIndices / 3);
+	}
+	info.boundsMin = minPos;
+	info.boundsMax = maxPos;
+
+	for (const GlbMaterial& material : glb.GetMaterials()) {
+		info.materials.push_back(material.name);
+	}
+	for (const GlbImage& image : glb.GetImages()) {
+		if (!image.filePath.empty()) {
+			info.textures.push_back(image.filePath);
+		}
+	}
+	return true;
+}
+
+// Desc: Fill in the metadata of a PLY model from its header alone, as scans can be far larger than
+// memory. The bounds are left empty; the mesh finds them while streaming.
+static bool ScanPlyModel(const std::filesystem::path& plyFilePath, ModelInfo& info) {
+	PlyReader reader(64 * 1024);
+	if (!reader.Open(plyFilePath)) {
+		std::cerr << "[ERROR] Failed to scan model: " << plyFilePath << std::endl;
+		return false;
+	}
+
+	info.objFilePath = plyFilePath;
+	info.objBytes = GetFileBytes(plyFilePath);
+	info.objWriteTime = GetWriteTime(plyFilePath);
+	info.contentHash = HashBytes(reader.GetHeader());
+	info.contentHash = HashBytes(&info.objBytes, sizeof(info.objBytes), info.contentHash);
+	info.contentHash = HashBytes(&info.objWriteTime, sizeof(info.objWriteTime), info.contentHash);
+	info.loadHint = MeshLoadHint();
+	info.loadHint.numPositions = (int)reader.GetNumVertices();
+	info.loadHint.numNormals = reader.HasNormals() ? (int)reader.GetNumVertices() : 0;
+	info.loadHint.numVertices = (int)reader.GetNumVertices();
+	info.loadHint.numTriangles = (int)reader.GetNumFaces();
+	info.boundsMin = glm::vec3(0.0f);
+	info.boundsMax = glm::vec3(0.0f);
+	info.materials.clear();
+	info.textures.clear();
+	return true;
+}
+
+// Desc: Fill in the metadata of a chunked mesh from its header and chunk table.
+static bool ScanChunkedModel(const std::filesystem::path& chunksFilePath, ModelInfo& info) {
+	ChunkedMeshFile file;
+	if (!file.Open(chunksFilePath)) {
+		std::cerr << "[ERROR] Failed to scan model: " << chunksFilePath << std::endl;
+		return false;
+	}
+
+	const ChunkedMeshHeader& header = file.GetHeader();
+	info.objFilePath = chunksFilePath;
+	info.objBytes = file.GetFileBytes();
+	info.objWriteTime = GetWriteTime(chunksFilePath);
+	info.contentHash = HashBytes(&header, sizeof(header));
+	info.contentHash = HashBytes(file.GetChunks(), header.numChunks * sizeof(MeshChunk), info.contentHash);
+	info.loadHint = MeshLoadHint();
+	info.loadHint.numVertices = (int)std::min<uint64_t>(header.numVertices, INT_MAX);
+	info.loadHint.numTriangles = (int)std::min<uint64_t>(header.numTriangles, INT_MAX);
+	info.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	info.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	info.materials.clear();
+	info.textures.clear();
+	return true;
+}
+
+// Desc: Fill in the metadata of a point cloud octree from its header and node table.
+static bool ScanPointCloudModel(const std::filesystem::path& octreeFilePath, ModelInfo& info) {
+	PointCloudFile file;
+	if (!file.Open(octreeFilePath)) {
+		std::cerr << "[ERROR] Failed to scan model: " << octreeFilePath << std::endl;
+		return false;
+	}
+
+	const PointCloudHeader& header = file.GetHeader();
+	info.objFilePath = octreeFilePath;
+	info.objBytes = GetFileBytes(octreeFilePath);
+	info.objWriteTime = GetWriteTime(octreeFilePath);
+	info.contentHash = HashBytes(&header, sizeof(header));
+	info.contentHash = HashBytes(file.GetNodes(), header.numNodes * sizeof(PointCloudNode), info.contentHash);
+	info.loadHint = MeshLoadHint();
+	info.loadHint.numVertices = (int)std::min<uint64_t>(header.numPoints, INT_MAX);
+	info.boundsMin = glm::vec3(header.pointsMin[0], header.pointsMin[1], header.pointsMin[2]);
+	info.boundsMax = glm::vec3(header.pointsMax[0], header.pointsMax[1], header.pointsMax[2]);
+	info.materials.clear();
+	info.textures.clear();
+	return true;
+}
+
+// Desc: Fill in the metadata of a cooked OBJ model from its header and submesh table, and the
+// materials from the MTL files it names.
+static bool ScanCookedModel(const std::filesystem::path& cookedFilePath, ModelInfo& info) {
+	CookedMeshFile file;
+	if (!file.Open(cookedFilePath)) {
+		std::cerr << "[ERROR] Failed to scan model: " << cookedFilePath << std::endl;
+		return false;
+	}
+
+	const CookedMeshHeader& header = file.GetHeader();
+	info.objFilePath = cookedFilePath;
+	info.objBytes = file.GetFileBytes();
+	info.objWriteTime = GetWriteTime(cookedFilePath);
+	info.contentHash = HashBytes(&header, sizeof(header));
+	info.contentHash = HashBytes(file.GetSubMeshes(), header.numSubMeshes * sizeof(CookedSubMesh), info.contentHash);
+	info.loadHint = MeshLoadHint();
+	info.loadHint.numVertices = (int)header.numVertices;
+	info.loadHint.numTriangles = (int)std::min<uint64_t>(header.numTriangles, INT_MAX);
+	info.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	info.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	info.materials.clear();
+	info.textures.clear();
+	std::vector<std::filesystem::path> mtlFilePaths;
+	for (const std::string& library : file.GetMaterialLibraries()) {
+		mtlFilePaths.push_back(cookedFilePath.parent_path() / library);
+	}
+	ScanMaterialLibraries(mtlFilePaths, info);
+	return true;
+}
+
+bool ModelCatalog::ScanModel(const std::filesystem::path& objFilePath, ModelInfo& info) {
+	if (objFilePath.extension() == ".octree") {
+		return ScanPointCloudModel(objFilePath, info);
+	}
+	if (objFilePath.extension() == ".chunks") {
+		return ScanChunkedModel(objFilePath, info);
+	}
+	if (objFilePath.extension() == ".cmesh") {
+		return ScanCookedModel(objFilePath, info);
+	}
+	if (objFilePath.extension() == ".glb") {
+		return ScanGlbModel(objFilePath, info);
+	}
+	if (objFilePath.extension() == ".ply") {
+		return ScanPlyModel(objFilePath, info);
+	}
+	std::string data;
+	if (!ReadWholeFile(objFilePath, data)) {
+		std::cerr << "[ERROR] Failed to scan model: " << objFilePath << std::endl;
+		return false;
+	}
+
+	info.objFilePath = objFilePath;
+	info.objBytes = data.size();
+	info.objWriteTime = GetWriteTime(objFilePath);
+	info.contentHash = HashBytes(data);
+	info.loadHint = MeshLoadHint();
+	info.materials.clear();
+	info.textures.clear();
+
+	glm::vec3 minPos = glm::vec3(1e9f);
+	glm::vec3 maxPos = glm::vec3(-1e9f);
+	std::vector<std::filesystem::path> mtlFilePaths;
+
+	std::string_view text(data);
+	size_t lineStart = 0;
+	while (lineStart < text.size()) {
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string_view::npos) {
+			lineEnd = text.size();
+		}
+		std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+		const char* lineData = data.data() + lineStart;
+		lineStart = lineEnd + 1;
+
+		if (line.starts_with("v ")) {
+			char* cursor = const_cast<char*>(lineData) + 2;
+			glm::vec3 p;
+			p.x = std::strtof(cursor, &cursor);
+			p.y = std::strtof(cursor, &cursor);
+			p.z = std::strtof(cursor, &cursor);
+			minPos = glm::min(minPos, p);
+			maxPos = glm::max(maxPos, p);
+			++info.loadHint.numPositions;
+		}
+		else if (line.starts_with("vn ")) {
+			++info.loadHint.numNormals;
+		}
+		else if (line.starts_with("vt ")) {
+			++info.loadHint.numTexcoords;
+		}
+		else if (line.starts_with("f ")) {
+			std::istringstream iss(std::string(line.substr(2)));
+			std::string token;
+			int numVertices = 0;
+			while (iss >> token) {
+				++numVertices;
+			}
+			info.loadHint.numVertices += numVertices;
+			info.loadHint.numTriangles += std::max(0, numVertices - 2);
+		}
+		else if (line.starts_with("mtllib ")) {
+			std::istringstream iss(std::string(line.substr(7)));
+			std::string mtlFileName;
+			iss >> mtlFileName;
+			mtlFilePaths.push_back(objFilePath.parent_path() / mtlFileName);
+		}
+	}
+	if (info.loadHint.numPositions > 0) {
+		info.boundsMin = minPos;
+		info.boundsMax = maxPos;
+	}
+
+	// Material names and diffuse textures from the material libraries.
+	ScanMaterialLibraries(mtlFilePaths, info);
+	return true;
+}
+
+} // namespace opengl_homework
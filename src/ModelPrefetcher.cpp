@@ -0,0 +1,229 @@
+#include "ModelPrefetcher.h"
+
+// C++ STL headers.
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Project headers.
+#include "RenderResources.h"
+
+// Platform headers.
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace opengl_homework {
+
+// Desc: Drop the priority of the calling thread so prefetching never competes with rendering.
+static void LowerCurrentThreadPriority() {
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+}
+
+// ModelPrefetcher Private Declarations.
+struct ModelPrefetcher::Impl {
+	std::vector<std::filesystem::path> objFilePaths;
+	std::vector<MeshLoadHint> loadHints;
+	size_t byteBudget;
+
+	std::vector<MeshHandle> meshes;
+	std::vector<size_t> meshBytes;
+	std::vector<bool> failed;
+
+	int current = -1;
+	int inFlight = -1;
+	int foregroundLoads = 0;
+	bool stop = false;
+
+	mutable std::mutex mutex;
+	std::condition_variable wakeCv;
+	std::condition_variable doneCv;
+	std::thread worker;
+
+	// Desc: Indices ordered by distance from the selection: next, previous, then widening.
+	std::vector<int> PrefetchOrder() const {
+		std::vector<int> order;
+		if (current < 0) {
+			return order;
+		}
+		const int numModels = (int)objFilePaths.size();
+		order.push_back(current);
+		for (int offset = 1; offset < numModels; ++offset) {
+			if (current + offset < numModels)
+				order.push_back(current + offset);
+			if (current - offset >= 0)
+				order.push_back(current - offset);
+		}
+		return order;
+	}
+
+	// Desc: Next index worth loading within the budget, or -1 if the window is complete.
+	int NextIndex() const {
+		const auto order = PrefetchOrder();
+		size_t usedBytes = 0;
+		for (int i = 0; i < (int)order.size(); ++i) {
+			const int index = order[i];
+			// The selection and its two neighbours are loaded regardless of the budget.
+			if (i > 2 && usedBytes >= byteBudget) {
+				break;
+			}
+			if (meshes[index].IsValid()) {
+				usedBytes += meshBytes[index];
+				continue;
+			}
+			if (!failed[index] && index != inFlight) {
+				return index;
+			}
+		}
+		return -1;
+	}
+};
+
+ModelPrefetcher::ModelPrefetcher(const std::vector<std::filesystem::path>& objFilePaths,
+	const std::vector<MeshLoadHint>& loadHints, const size_t byteBudget) {
+	pImpl = std::make_unique<Impl>();
+	pImpl->objFilePaths = objFilePaths;
+	pImpl->loadHints = loadHints;
+	pImpl->byteBudget = byteBudget;
+	pImpl->meshes.resize(objFilePaths.size());
+	pImpl->meshBytes.resize(objFilePaths.size(), 0);
+	pImpl->failed.resize(objFilePaths.size(), false);
+	// Point clouds are drawn by PointCloud, straight from their mapping; there is nothing to prefetch.
+	for (size_t index = 0; index < objFilePaths.size(); ++index) {
+		pImpl->failed[index] = objFilePaths[index].extension() == ".octree";
+	}
+	pImpl->worker = std::thread([this]() { WorkerLoop(); });
+}
+
+ModelPrefetcher::~ModelPrefetcher() {
+	{
+		std::lock_guard<std::mutex> lock(pImpl->mutex);
+		pImpl->stop = true;
+	}
+	pImpl->wakeCv.notify_all();
+	if (pImpl->worker.joinable()) {
+		pImpl->worker.join();
+	}
+	for (const auto mesh : pImpl->meshes) {
+		RenderResources::GetInstance().GetMeshes().Destroy(mesh);
+	}
+	pImpl.reset();
+}
+
+MeshHandle ModelPrefetcher::Acquire(const int index) {
+	std::unique_lock<std::mutex> lock(pImpl->mutex);
+	pImpl->doneCv.wait(lock, [&]() { return pImpl->inFlight != index; });
+	return pImpl->meshes[index];
+}
+
+// Desc: The pool returns an invalid handle when every slot is in use; that load failed like any other.
+void ModelPrefetcher::Insert(const int index, const MeshHandle mesh) {
+	const TriangleMesh* loaded = RenderResources::GetInstance().GetMeshes().Get(mesh);
+	std::lock_guard<std::mutex> lock(pImpl->mutex);
+	if (loaded == nullptr) {
+		pImpl->failed[index] = true;
+		return;
+	}
+	pImpl->meshes[index] = mesh;
+	pImpl->meshBytes[index] = loaded->GetHostMemoryBytes();
+}
+
+void ModelPrefetcher::SetCurrent(const int index) {
+	std::vector<MeshHandle> evicted;
+	{
+		std::lock_guard<std::mutex> lock(pImpl->mutex);
+		pImpl->current = index;
+
+		const auto order = pImpl->PrefetchOrder();
+		size_t usedBytes = 0;
+		for (int i = 0; i < (int)order.size(); ++i) {
+			const int candidate = order[i];
+			if (!pImpl->meshes[candidate].IsValid()) {
+				continue;
+			}
+			if (i > 2 && usedBytes + pImpl->meshBytes[candidate] > pImpl->byteBudget) {
+				evicted.push_back(pImpl->meshes[candidate]);
+				pImpl->meshes[candidate] = MeshHandle();
+				pImpl->meshBytes[candidate] = 0;
+				continue;
+			}
+			usedBytes += pImpl->meshBytes[candidate];
+		}
+	}
+	for (const auto mesh : evicted) {
+		RenderResources::GetInstance().GetMeshes().Destroy(mesh);
+	}
+	pImpl->wakeCv.notify_all();
+}
+
+void ModelPrefetcher::BeginForegroundLoad() {
+	std::lock_guard<std::mutex> lock(pImpl->mutex);
+	++pImpl->foregroundLoads;
+}
+
+void ModelPrefetcher::EndForegroundLoad() {
+	{
+		std::lock_guard<std::mutex> lock(pImpl->mutex);
+		--pImpl->foregroundLoads;
+	}
+	pImpl->wakeCv.notify_all();
+}
+
+size_t ModelPrefetcher::GetResidentBytes() const {
+	std::lock_guard<std::mutex> lock(pImpl->mutex);
+	size_t bytes = 0;
+	for (const auto size : pImpl->meshBytes) {
+		bytes += size;
+	}
+	return bytes;
+}
+
+// Desc: Load one model at a time and yield between models while a foreground load runs.
+void ModelPrefetcher::WorkerLoop() {
+	LowerCurrentThreadPriority();
+
+	std::unique_lock<std::mutex> lock(pImpl->mutex);
+	while (true) {
+		pImpl->wakeCv.wait(lock, [&]() {
+			return pImpl->stop || (pImpl->foregroundLoads == 0 && pImpl->NextIndex() >= 0);
+		});
+		if (pImpl->stop) {
+			break;
+		}
+
+		const int index = pImpl->NextIndex();
+		const auto objFilePath = pImpl->objFilePaths[index];
+		const auto loadHint = pImpl->loadHints[index];
+		pImpl->inFlight = index;
+		lock.unlock();
+
+		// Host-only work: parse the geometry and decode the textures.
+		auto& meshes = RenderResources::GetInstance().GetMeshes();
+		const MeshHandle mesh = meshes.Create(objFilePath, true, loadHint);
+		const TriangleMesh* loaded = meshes.Get(mesh);
+
+		lock.lock();
+		pImpl->inFlight = -1;
+		if (loaded != nullptr && loaded->IsLoaded()) {
+			pImpl->meshes[index] = mesh;
+			pImpl->meshBytes[index] = loaded->GetHostMemoryBytes();
+		}
+		else {
+			pImpl->failed[index] = true;
+			meshes.Destroy(mesh);
+		}
+		pImpl->doneCv.notify_all();
+	}
+}
+
+} // namespace opengl_homework
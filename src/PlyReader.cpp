@@ -0,0 +1,410 @@
+#include "PlyReader.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+// Longest header accepted before giving up on finding end_header.
+static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+
+// Scalar types of the PLY format.
+enum PlyType : int { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64 };
+
+static const struct { const char* name; PlyType type; } PLY_TYPES[] = {
+	{ "char", PLY_INT8 }, { "int8", PLY_INT8 },
+	{ "uchar", PLY_UINT8 }, { "uint8", PLY_UINT8 },
+	{ "short", PLY_INT16 }, { "int16", PLY_INT16 },
+	{ "ushort", PLY_UINT16 }, { "uint16", PLY_UINT16 },
+	{ "int", PLY_INT32 }, { "int32", PLY_INT32 },
+	{ "uint", PLY_UINT32 }, { "uint32", PLY_UINT32 },
+	{ "float", PLY_FLOAT32 }, { "float32", PLY_FLOAT32 },
+	{ "double", PLY_FLOAT64 }, { "float64", PLY_FLOAT64 },
+};
+
+static int ParseType(const std::string& name) {
+	for (const auto& entry : PLY_TYPES) {
+		if (name == entry.name) {
+			return entry.type;
+		}
+	}
+	return -1;
+}
+
+static size_t GetTypeBytes(const int type) {
+	static const size_t bytes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+	return bytes[type];
+}
+
+// Desc: Read a little-endian scalar as a double.
+static double ReadScalar(const int type, const char* data) {
+	switch (type) {
+	case PLY_INT8: return (double)*(const int8_t*)data;
+	case PLY_UINT8: return (double)*(const uint8_t*)data;
+	case PLY_INT16: { int16_t v; std::memcpy(&v, data, 2); return v; }
+	case PLY_UINT16: { uint16_t v; std::memcpy(&v, data, 2); return v; }
+	case PLY_INT32: { int32_t v; std::memcpy(&v, data, 4); return v; }
+	case PLY_UINT32: { uint32_t v; std::memcpy(&v, data, 4); return v; }
+	case PLY_FLOAT32: { float v; std::memcpy(&v, data, 4); return v; }
+	default: { double v; std::memcpy(&v, data, 8); return v; }
+	}
+}
+
+// Desc: Read a little-endian integer of a list; negative values come back as ~0.
+static uint64_t ReadUnsigned(const int type, const char* data) {
+	switch (type) {
+	case PLY_INT8: { const int8_t v = *(const int8_t*)data; return v < 0 ? ~0ull : (uint64_t)v; }
+	case PLY_UINT8: return *(const uint8_t*)data;
+	case PLY_INT16: { int16_t v; std::memcpy(&v, data, 2); return v < 0 ? ~0ull : (uint64_t)v; }
+	case PLY_UINT16: { uint16_t v; std::memcpy(&v, data, 2); return v; }
+	case PLY_INT32: { int32_t v; std::memcpy(&v, data, 4); return v < 0 ? ~0ull : (uint64_t)v; }
+	case PLY_UINT32: { uint32_t v; std::memcpy(&v, data, 4); return v; }
+	default: return ~0ull;
+	}
+}
+
+PlyReader::PlyReader(const size_t bufferBytes) {
+	buffer.resize(bufferBytes);
+}
+
+void PlyReader::Fail(const std::string& message) {
+	if (!failed) {
+		std::cerr << "[ERROR] " << filePath.filename() << ": " << message << std::endl;
+	}
+	failed = true;
+}
+
+bool PlyReader::Open(const std::filesystem::path& plyFilePath) {
+	filePath = plyFilePath;
+	file.close();
+	file.clear();
+	file.open(filePath, std::ios::binary);
+	begin = 0;
+	end = 0;
+	header.clear();
+	elements.clear();
+	nextElement = 0;
+	failed = false;
+	if (!file) {
+		Fail("cannot open file");
+		return false;
+	}
+
+	// The header is text up to "end_header\n"; the body follows at once.
+	std::string line;
+	bool firstLine = true;
+	while (header.size() < MAX_HEADER_BYTES && std::getline(file, line)) {
+		header += line + "\n";
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		std::istringstream iss(line);
+		std::string keyword;
+		iss >> keyword;
+		if (firstLine && keyword != "ply") {
+			Fail("not a PLY file");
+			return false;
+		}
+		firstLine = false;
+		if (keyword == "format") {
+			std::string format;
+			iss >> format;
+			if (format != "binary_little_endian") {
+				Fail("only binary_little_endian PLY is supported, not " + format);
+				return false;
+			}
+		}
+		else if (keyword == "element") {
+			Element element;
+			iss >> element.name >> element.count;
+			elements.push_back(element);
+		}
+		else if (keyword == "property" && !elements.empty()) {
+			Property property;
+			std::string type;
+			iss >> type;
+			if (type == "list") {
+				std::string countType;
+				iss >> countType >> type;
+				property.countType = ParseType(countType);
+				if (property.countType < 0 || property.countType >= PLY_FLOAT32) {
+					Fail("invalid list length type " + countType);
+					return false;
+				}
+			}
+			property.type = ParseType(type);
+			iss >> property.name;
+			if (property.type < 0) {
+				Fail("unknown property type " + type);
+				return false;
+			}
+			elements.back().properties.push_back(property);
+		}
+		else if (keyword == "end_header") {
+			break;
+		}
+	}
+	if (!file || header.find("end_header") == std::string::npos) {
+		Fail("missing end_header");
+		return false;
+	}
+
+	for (auto& element : elements) {
+		for (const auto& property : element.properties) {
+			if (property.countType >= 0) {
+				element.recordBytes = 0;
+				break;
+			}
+			element.recordBytes += GetTypeBytes(property.type);
+		}
+	}
+
+	// The vertices need fixed-size records with x, y and z; the faces, if any, a list of indices after them.
+	vertexElement = elements.size();
+	faceElement = elements.size();
+	for (size_t i = 0; i < elements.size(); ++i) {
+		if (elements[i].name == "vertex" && vertexElement == elements.size()) {
+			vertexElement = i;
+		}
+		else if (elements[i].name == "face" && faceElement == elements.size()) {
+			faceElement = i;
+		}
+	}
+	if (vertexElement == elements.size() || (faceElement < elements.size() && faceElement < vertexElement)) {
+		Fail("expected a vertex element, then the faces if any");
+		return false;
+	}
+	const Element& vertex = elements[vertexElement];
+	if (vertex.recordBytes == 0) {
+		Fail("list properties in the vertex element are not supported");
+		return false;
+	}
+	static const char* POSITION_NAMES[9] = { "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue" };
+	int found = 0;
+	for (int i = 0; i < 9; ++i) {
+		size_t offset = 0;
+		positionTypes[i] = -1;
+		for (const auto& property : vertex.properties) {
+			if (property.name == POSITION_NAMES[i]) {
+				positionTypes[i] = property.type;
+				positionOffsets[i] = offset;
+				found |= 1 << i;
+			}
+			offset += GetTypeBytes(property.type);
+		}
+	}
+	if ((found & 0x7) != 0x7) {
+		Fail("vertices without x, y and z");
+		return false;
+	}
+	hasNormals = (found & 0x38) == 0x38;
+	hasColors = (found & 0x1c0) == 0x1c0;
+
+	numFaces = 0;
+	if (faceElement < elements.size()) {
+		const Element& face = elements[faceElement];
+		faceIndexProperty = face.properties.size();
+		for (size_t i = 0; i < face.properties.size(); ++i) {
+			const Property& property = face.properties[i];
+			if ((property.name == "vertex_indices" || property.name == "vertex_index") && property.countType >= 0) {
+				faceIndexProperty = i;
+			}
+		}
+		if (faceIndexProperty == face.properties.size() || face.properties[faceIndexProperty].type >= PLY_FLOAT32) {
+			Fail("faces without an integer vertex_indices list");
+			return false;
+		}
+		numFaces = face.count;
+	}
+
+	numVertices = vertex.count;
+	verticesLeft = numVertices;
+	facesLeft = numFaces;
+	// Only faces index the vertices; a point cloud may have any number of them.
+	if (numFaces > 0 && numVertices > (size_t)UINT32_MAX) {
+		Fail("more vertices than 32-bit indices can address");
+		return false;
+	}
+	return SkipElements(vertexElement);
+}
+
+// Desc: Make at least bytes available from begin, moving the unread tail to the front first.
+bool PlyReader::Fill(const size_t bytes) {
+	if (end - begin >= bytes) {
+		return true;
+	}
+	if (bytes > buffer.size()) {
+		Fail("record larger than the read buffer");
+		return false;
+	}
+	std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+	end -= begin;
+	begin = 0;
+	file.read(buffer.data() + end, (std::streamsize)(buffer.size() - end));
+	end += (size_t)file.gcount();
+	if (end < bytes) {
+		Fail("unexpected end of file");
+		return false;
+	}
+	return true;
+}
+
+// Desc: Skip bytes, seeking past whatever is not buffered.
+bool PlyReader::Skip(size_t bytes) {
+	const size_t buffered = std::min(bytes, end - begin);
+	begin += buffered;
+	bytes -= buffered;
+	if (bytes > 0) {
+		file.seekg((std::streamoff)bytes, std::ios::cur);
+		if (!file) {
+			Fail("unexpected end of file");
+			return false;
+		}
+	}
+	return true;
+}
+
+// Desc: Skip the elements before elements[last], record by record where they hold lists.
+bool PlyReader::SkipElements(const size_t last) {
+	for (; nextElement < last; ++nextElement) {
+		const Element& element = elements[nextElement];
+		if (element.recordBytes != 0) {
+			if (!Skip(element.recordBytes * element.count)) {
+				return false;
+			}
+			continue;
+		}
+		for (size_t i = 0; i < element.count; ++i) {
+			for (const auto& property : element.properties) {
+				size_t bytes = GetTypeBytes(property.type);
+				if (property.countType >= 0) {
+					if (!Fill(GetTypeBytes(property.countType))) {
+						return false;
+					}
+					bytes = GetTypeBytes(property.countType)
+						+ ReadUnsigned(property.countType, buffer.data() + begin) * GetTypeBytes(property.type);
+				}
+				if (!Skip(bytes)) {
+					return false;
+				}
+			}
+		}
+	}
+	nextElement = std::max(nextElement, last + 1);
+	return true;
+}
+
+size_t PlyReader::ReadVertices(float* out, const size_t maxVertices, uint8_t* colors) {
+	const size_t recordBytes = elements[vertexElement].recordBytes;
+	const int numFloats = hasNormals ? 6 : 3;
+	size_t count = 0;
+	while (count < maxVertices && verticesLeft > 0 && !failed) {
+		if (!Fill(recordBytes)) {
+			break;
+		}
+		// Whole records that are in the buffer.
+		const size_t batch = std::min({ maxVertices - count, verticesLeft, (end - begin) / recordBytes });
+		for (size_t i = 0; i < batch; ++i) {
+			const char* record = buffer.data() + begin + i * recordBytes;
+			float* vertex = out + (count + i) * numFloats;
+			for (int k = 0; k < numFloats; ++k) {
+				if (positionTypes[k] == PLY_FLOAT32) {
+					std::memcpy(vertex + k, record + positionOffsets[k], sizeof(float));
+				}
+				else {
+					vertex[k] = (float)ReadScalar(positionTypes[k], record + positionOffsets[k]);
+				}
+			}
+			if (colors != nullptr) {
+				// Integer channels are taken as 0-255, floating-point ones as 0-1.
+				uint8_t* color = colors + (count + i) * 4;
+				for (int k = 0; k < 3; ++k) {
+					const int type = positionTypes[6 + k];
+					const double value = hasColors ? ReadScalar(type, record + positionOffsets[6 + k]) * (type >= PLY_FLOAT32 ? 255.0 : 1.0) : 255.0;
+					color[k] = (uint8_t)std::clamp(value, 0.0, 255.0);
+				}
+				color[3] = 255;
+			}
+		}
+		begin += batch * recordBytes;
+		count += batch;
+		verticesLeft -= batch;
+	}
+	return count;
+}
+
+size_t PlyReader::ReadTriangles(uint32_t* out, const size_t maxIndices) {
+	if (facesLeft == 0) {
+		return 0;
+	}
+	if (verticesLeft > 0) {
+		Fail("faces read before the vertices");
+		return 0;
+	}
+	if (nextElement <= faceElement && !SkipElements(faceElement)) {
+		return 0;
+	}
+	const std::vector<Property>& properties = elements[faceElement].properties;
+	size_t count = 0;
+	while (facesLeft > 0 && !failed) {
+		// Size the record before consuming it, so a face that does not fit stays unread.
+		size_t recordBytes = 0;
+		size_t indicesAt = 0;
+		size_t numCorners = 0;
+		for (size_t i = 0; i < properties.size(); ++i) {
+			const Property& property = properties[i];
+			if (property.countType < 0) {
+				recordBytes += GetTypeBytes(property.type);
+				continue;
+			}
+			const size_t countBytes = GetTypeBytes(property.countType);
+			if (!Fill(recordBytes + countBytes)) {
+				return count;
+			}
+			const uint64_t length = ReadUnsigned(property.countType, buffer.data() + begin + recordBytes);
+			if (length > buffer.size()) {
+				Fail("invalid list length");
+				return count;
+			}
+			if (i == faceIndexProperty) {
+				indicesAt = recordBytes + countBytes;
+				numCorners = (size_t)length;
+			}
+			recordBytes += countBytes + (size_t)length * GetTypeBytes(property.type);
+		}
+		if (!Fill(recordBytes)) {
+			return count;
+		}
+
+		// Fan triangulation; faces with fewer than 3 corners add nothing.
+		const size_t numIndices = numCorners >= 3 ? (numCorners - 2) * 3 : 0;
+		if (count + numIndices > maxIndices) {
+			break;
+		}
+		const int indexType = properties[faceIndexProperty].type;
+		const size_t indexBytes = GetTypeBytes(indexType);
+		const char* indices = buffer.data() + begin + indicesAt;
+		uint32_t first = 0;
+		uint32_t previous = 0;
+		for (size_t k = 0; k < numCorners; ++k) {
+			const uint64_t index = ReadUnsigned(indexType, indices + k * indexBytes);
+			if (index >= numVertices) {
+				Fail("face " + std::to_string(numFaces - facesLeft) + " has an index past the vertices");
+				return count;
+			}
+			if (k == 0) {
+				first = (uint32_t)index;
+			}
+			else if (k >= 2) {
+				out[count++] = first;
+				out[count++] = previous;
+				out[count++] = (uint32_t)index;
+			}
+			previous = (uint32_t)index;
+		}
+		begin += recordBytes;
+		--facesLeft;
+	}
+	return count;
+}
@@ -0,0 +1,302 @@
+#include "PointCloud.h"
+
+// OpenGL and FreeGlut headers.
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+// GLM headers.
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// C++ STL headers.
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Project headers.
+#include "Clock.h"
+#include "PointCloudFile.h"
+#include "UploadManager.h"
+#include "TextureResidency.h"
+
+namespace opengl_homework {
+
+// Points drawn per frame unless SetPointBudget() says otherwise.
+static constexpr size_t DEFAULT_POINT_BUDGET = 4 * 1024 * 1024;
+
+// GPU memory held by node buffers, and node uploads queued at a time.
+static constexpr size_t NODE_BUDGET_BYTES = 256 * 1024 * 1024;
+static constexpr int NODE_LOADS_IN_FLIGHT = 16;
+
+// A node is refined while its points are farther apart than this on screen.
+static constexpr float MAX_POINT_PIXELS = 1.0f;
+
+// ------------------------------------------------------------------------
+// Private member implementations. ----------------------------------------
+// ------------------------------------------------------------------------
+struct PointCloud::Impl {
+	struct NodeState
+	{
+		GLuint buffer = 0;
+		bool loading = false;
+		bool resident = false;
+		uint64_t lastPickedFrame = 0;
+	};
+
+	std::string name;
+	bool loaded = false;
+	bool created = false;
+	double loadTimeMs = 0.0;
+	PointCloudFile file;
+	glm::mat4 localMatrix = glm::mat4(1.0f);	// Normalizes the cloud.
+	float localScale = 1.0f;
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	std::vector<NodeState> nodes;
+	std::vector<uint32_t> picked;			// Largest on screen first.
+	size_t pointBudget = DEFAULT_POINT_BUDGET;
+	size_t residentBytes = 0;
+	int loadsInFlight = 0;
+	uint64_t frame = 0;
+	bool streaming = false;
+	PointCloudStats stats;
+
+	size_t GetNodeBytes(const uint32_t node) const {
+		return (size_t)file.GetNodes()[node].numPoints * sizeof(PointCloudPoint);
+	}
+
+	void DropNode(const uint32_t node) {
+		NodeState& state = nodes[node];
+		glDeleteBuffers(1, &state.buffer);
+		state.buffer = 0;
+		state.resident = false;
+		residentBytes -= GetNodeBytes(node);
+	}
+};
+
+// ------------------------------------------------------------------------
+// Public member functions. -----------------------------------------------
+// ------------------------------------------------------------------------
+
+// Desc: Map the octree and read its bounds. No point is read until a node is uploaded.
+PointCloud::PointCloud(const std::filesystem::path& octreeFilePath, const bool normalized) {
+	Clock loadClock;
+	pImpl = std::make_unique<Impl>();
+	pImpl->name = octreeFilePath.stem().string();
+	if (!pImpl->file.Open(octreeFilePath)) {
+		return;
+	}
+	const PointCloudHeader& header = pImpl->file.GetHeader();
+	const glm::vec3 minPos = glm::vec3(header.pointsMin[0], header.pointsMin[1], header.pointsMin[2]);
+	const glm::vec3 maxPos = glm::vec3(header.pointsMax[0], header.pointsMax[1], header.pointsMax[2]);
+	pImpl->boundsMin = minPos;
+	pImpl->boundsMax = maxPos;
+	if (normalized) {
+		float maxLen = std::max(maxPos.x - minPos.x, std::max(maxPos.y - minPos.y, maxPos.z - minPos.z));
+		maxLen = maxLen > 0.0f ? maxLen : 1.0f;
+		const glm::vec3 center = minPos + (maxPos - minPos) * 0.5f;
+		pImpl->localScale = 1.0f / maxLen;
+		pImpl->localMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(pImpl->localScale))
+			* glm::translate(glm::mat4(1.0f), -center);
+		pImpl->boundsMin = (minPos - center) * pImpl->localScale;
+		pImpl->boundsMax = (maxPos - center) * pImpl->localScale;
+	}
+	pImpl->nodes.resize(pImpl->file.GetNumNodes());
+	pImpl->loaded = true;
+	pImpl->loadTimeMs = loadClock.GetElapsedTime() * 1000.0;
+}
+
+PointCloud::~PointCloud() {
+	ReleaseBuffers();
+}
+
+void PointCloud::CreateBuffers() {
+	pImpl->created = pImpl->loaded;
+}
+
+void PointCloud::ReleaseBuffers() {
+	if (!pImpl->created) {
+		return;
+	}
+	UploadManager::GetInstance().Cancel(this);
+	for (auto& state : pImpl->nodes) {
+		if (state.buffer != 0) {
+			glDeleteBuffers(1, &state.buffer);
+		}
+		state = Impl::NodeState();
+	}
+	pImpl->picked.clear();
+	pImpl->residentBytes = 0;
+	pImpl->loadsInFlight = 0;
+	pImpl->streaming = false;
+	pImpl->stats = PointCloudStats();
+	pImpl->created = false;
+}
+
+// Desc: Pick, stream and draw the nodes for this view. The traversal goes largest on screen first,
+// so the budget goes to the coarse nodes of everything in view before the detail of any part.
+void PointCloud::Render(PointCloudShaderProg& shaderProg, const glm::mat4& worldMatrix, Camera& camera) {
+	if (!pImpl->created) {
+		return;
+	}
+	const PointCloudFile& file = pImpl->file;
+	const PointCloudNode* fileNodes = file.GetNodes();
+	const TextureResidency& residency = TextureResidency::GetInstance();
+	const glm::mat4 modelMatrix = worldMatrix * pImpl->localMatrix;
+	const glm::mat4 MVP = camera.GetProjMatrix() * camera.GetViewMatrix() * modelMatrix;
+	const uint64_t frame = ++pImpl->frame;
+
+	// Pick the nodes in view within the point budget, refining while points are over a pixel apart.
+	auto& picked = pImpl->picked;
+	picked.clear();
+	std::priority_queue<std::pair<float, uint32_t>> candidates;
+	auto addCandidate = [&](const uint32_t i) {
+		const PointCloudNode& node = fileNodes[i];
+		const glm::vec3 nodeMin = glm::vec3(node.boundsMin[0], node.boundsMin[1], node.boundsMin[2]);
+		const glm::vec2 screenExtent = residency.GetScreenExtent(MVP, nodeMin, nodeMin + glm::vec3(node.size));
+		if (screenExtent.x > 0.0f && screenExtent.y > 0.0f) {
+			candidates.emplace(std::max(screenExtent.x, screenExtent.y), i);
+		}
+	};
+	addCandidate(0);
+	size_t pickedPoints = 0;
+	while (!candidates.empty()) {
+		const auto [screenSize, i] = candidates.top();
+		candidates.pop();
+		const PointCloudNode& node = fileNodes[i];
+		if (pickedPoints + node.numPoints > pImpl->pointBudget) {
+			break;
+		}
+		pickedPoints += node.numPoints;
+		picked.push_back(i);
+		pImpl->nodes[i].lastPickedFrame = frame;
+		if (screenSize * node.spacing / node.size > MAX_POINT_PIXELS) {
+			for (uint32_t child = node.firstChild; child < node.firstChild + node.numChildren; ++child) {
+				addCandidate(child);
+			}
+		}
+	}
+
+	// Load what was picked, coarse first; room is made by dropping nodes picked longest ago.
+	std::vector<uint32_t> victims;
+	for (uint32_t i = 0; i < (uint32_t)pImpl->nodes.size(); ++i) {
+		if (pImpl->nodes[i].resident && pImpl->nodes[i].lastPickedFrame != frame) {
+			victims.push_back(i);
+		}
+	}
+	std::sort(victims.begin(), victims.end(), [&](const uint32_t a, const uint32_t b) {
+		return pImpl->nodes[a].lastPickedFrame < pImpl->nodes[b].lastPickedFrame;
+	});
+	size_t nextVictim = 0;
+	UploadManager& uploads = UploadManager::GetInstance();
+	pImpl->streaming = false;
+	for (const uint32_t i : picked) {
+		auto& state = pImpl->nodes[i];
+		if (state.resident || state.loading) {
+			pImpl->streaming |= state.loading;
+			continue;
+		}
+		pImpl->streaming = true;
+		const size_t bytes = pImpl->GetNodeBytes(i);
+		if (pImpl->loadsInFlight >= NODE_LOADS_IN_FLIGHT) {
+			continue;
+		}
+		while (pImpl->residentBytes + bytes > NODE_BUDGET_BYTES && nextVictim < victims.size()) {
+			pImpl->DropNode(victims[nextVictim++]);
+		}
+		if (pImpl->residentBytes + bytes > NODE_BUDGET_BYTES) {
+			break;
+		}
+
+		glGenBuffers(1, &state.buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, state.buffer);
+		glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		state.loading = true;
+		pImpl->residentBytes += bytes;
+		++pImpl->loadsInFlight;
+		const PointCloudNode& node = fileNodes[i];
+		file.GetMappedFile().WillNeed(node.offset, bytes);
+		uploads.QueueBuffer(this, state.buffer, 0, file.GetFileData() + node.offset, bytes, [this, i]() {
+			auto& loaded = pImpl->nodes[i];
+			loaded.loading = false;
+			loaded.resident = true;
+			--pImpl->loadsInFlight;
+		});
+	}
+
+	// Splats sized from the spacing of their node close the gaps the finer nodes have not filled yet.
+	PointCloudStats& stats = pImpl->stats;
+	stats = PointCloudStats();
+	stats.pointBudget = pImpl->pointBudget;
+	stats.nodesLoading = (size_t)pImpl->loadsInFlight;
+	stats.residentBytes = pImpl->residentBytes;
+	const float screenScale = camera.GetProjMatrix()[1][1] * residency.GetViewportSize().y * 0.5f;
+	const float worldScale = glm::length(glm::vec3(modelMatrix[0]));
+	shaderProg.Bind();
+	glUniformMatrix4fv(shaderProg.GetLocMVP(), 1, GL_FALSE, glm::value_ptr(MVP));
+	glUniform1f(shaderProg.GetLocScreenScale(), screenScale);
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	for (const uint32_t i : picked) {
+		const auto& state = pImpl->nodes[i];
+		if (!state.resident) {
+			continue;
+		}
+		const PointCloudNode& node = fileNodes[i];
+		glUniform1f(shaderProg.GetLocPointSpacing(), node.spacing * worldScale);
+		glBindBuffer(GL_ARRAY_BUFFER, state.buffer);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PointCloudPoint), 0);
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PointCloudPoint), (const GLvoid*)offsetof(PointCloudPoint, color));
+		glDrawArrays(GL_POINTS, 0, (GLsizei)node.numPoints);
+		stats.pointsDrawn += node.numPoints;
+		++stats.nodesDrawn;
+	}
+	glDisableVertexAttribArray(0);
+	glDisableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+	shaderProg.Unbind();
+}
+
+void PointCloud::SetPointBudget(const size_t points) {
+	pImpl->pointBudget = points;
+}
+
+bool PointCloud::IsLoaded() const {
+	return pImpl->loaded;
+}
+
+bool PointCloud::IsStreaming() const {
+	return pImpl->streaming;
+}
+
+void PointCloud::GetBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+	boundsMin = pImpl->boundsMin;
+	boundsMax = pImpl->boundsMax;
+}
+
+const PointCloudStats& PointCloud::GetStats() const {
+	return pImpl->stats;
+}
+
+void PointCloud::PrintInfo() const {
+	std::cout << "[*] Point Cloud Info: " << pImpl->name << std::endl;
+	if (!pImpl->loaded) {
+		return;
+	}
+	const PointCloudHeader& header = pImpl->file.GetHeader();
+	std::cout << "# Points: " << header.numPoints << " in " << header.numNodes << " octree nodes" << std::endl;
+	std::cout << "Per frame: at most " << pImpl->pointBudget << " points, streamed within "
+		<< NODE_BUDGET_BYTES / (1024 * 1024) << " MB" << std::endl;
+	std::cout << "Extent: (" << pImpl->boundsMax.x - pImpl->boundsMin.x << " , "
+		<< pImpl->boundsMax.y - pImpl->boundsMin.y << " , " << pImpl->boundsMax.z - pImpl->boundsMin.z << ")" << std::endl;
+	std::cout << "Load time: " << pImpl->loadTimeMs << " ms" << std::endl;
+}
+
+} // namespace opengl_homework
@@ -0,0 +1,481 @@
+#include "PointCloudFile.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Project headers.
+#include "Clock.h"
+#include "JobSystem.h"
+#include "PlyReader.h"
+
+static constexpr char POINT_CLOUD_MAGIC[4] = { 'P', 'C', 'O', 'T' };
+static constexpr uint32_t POINT_CLOUD_VERSION = 1;
+
+// A node keeps one point per cell of a grid of this many cells per axis over its cube.
+static constexpr int SAMPLE_GRID = 64;
+// A node with at most this many points keeps them all and has no children.
+static constexpr size_t LEAF_POINTS = 64 * 1024;
+static constexpr int MAX_LEVEL = 20;
+
+// The cloud is first counted on a grid of 2^COUNT_GRID_LEVELS cells per axis, whose cells are
+// merged into chunks of at most MAX_CHUNK_POINTS, built independently. Only a chunk of a single
+// cell of the grid can be larger.
+static constexpr int COUNT_GRID_LEVELS = 7;
+static constexpr size_t MAX_CHUNK_POINTS = 4 * 1024 * 1024;
+static constexpr size_t CHUNK_BUFFER_POINTS = 256;		// Buffered per chunk before writing.
+
+// Streaming reads of the source.
+static constexpr size_t READ_VERTICES = 64 * 1024;
+
+// Desc: Quantize a coordinate of a cube to a cell index.
+static int GetCellIndex(const float value, const float boundsMin, const float size, const int cells) {
+	return std::clamp((int)((value - boundsMin) / size * (float)cells), 0, cells - 1);
+}
+
+// Desc: Index of the cell of a grid over a cube that holds a point.
+static size_t GetCell(const PointCloudPoint& point, const glm::vec3& cubeMin, const float size, const int cells) {
+	size_t cell = 0;
+	for (int axis = 2; axis >= 0; --axis) {
+		cell = cell * cells + GetCellIndex(point.position[axis], cubeMin[axis], size, cells);
+	}
+	return cell;
+}
+
+// Desc: Move the first point of every occupied cell of a grid over a cube to the front of the
+// points, and return how many there are. A cell is taken once its stamp is the given one.
+static size_t SamplePoints(PointCloudPoint* points, const size_t count, const glm::vec3& cubeMin, const float size,
+	const int cells, std::vector<uint32_t>& stamps, const uint32_t stamp) {
+	size_t front = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const size_t cell = GetCell(points[i], cubeMin, size, cells);
+		if (stamps[cell] != stamp) {
+			stamps[cell] = stamp;
+			std::swap(points[i], points[front++]);
+		}
+	}
+	return front;
+}
+
+// Desc: Map and validate a file. The node table is small and checked as a whole.
+bool PointCloudFile::Open(const std::filesystem::path& filePath) {
+	header = nullptr;
+	nodes = nullptr;
+	if (!file.Open(filePath)) {
+		std::cerr << "[ERROR] Cannot open file " << filePath << std::endl;
+		return false;
+	}
+	const uint8_t* data = file.GetData();
+	const size_t size = file.GetSize();
+	const PointCloudHeader* fileHeader = (const PointCloudHeader*)data;
+	if (size < sizeof(PointCloudHeader) || std::memcmp(fileHeader->magic, POINT_CLOUD_MAGIC, 4) != 0
+		|| fileHeader->version != POINT_CLOUD_VERSION) {
+		std::cerr << "[ERROR] Not a point cloud octree file: " << filePath << std::endl;
+		return false;
+	}
+	if (fileHeader->numNodes == 0 || fileHeader->nodeTableOffset % 8 != 0 || fileHeader->nodeTableOffset > size
+		|| (size - fileHeader->nodeTableOffset) / sizeof(PointCloudNode) < fileHeader->numNodes) {
+		std::cerr << "[ERROR] Corrupt point cloud header: " << filePath << std::endl;
+		return false;
+	}
+	const PointCloudNode* fileNodes = (const PointCloudNode*)(data + fileHeader->nodeTableOffset);
+	for (uint32_t i = 0; i < fileHeader->numNodes; ++i) {
+		const PointCloudNode& node = fileNodes[i];
+		if (node.offset % 4 != 0 || node.offset > size || (size - node.offset) / sizeof(PointCloudPoint) < node.numPoints
+			|| (node.numChildren > 0 && (node.firstChild <= i || node.numChildren > 8
+				|| node.firstChild > fileHeader->numNodes - node.numChildren))) {
+			std::cerr << "[ERROR] Corrupt octree node " << i << " in " << filePath << std::endl;
+			return false;
+		}
+	}
+	header = fileHeader;
+	nodes = fileNodes;
+	return true;
+}
+
+// Desc: Build the octree in four passes, none holding the cloud in memory: the points are copied
+// to a packed file that is then mapped, counted on a grid in parallel, and written out grouped by
+// chunk. The chunk subtrees are then built in parallel, each from its points alone; the nodes
+// above the chunks are finally made from subsamples of the chunk roots.
+bool PointCloudFile::Build(const std::filesystem::path& plyFilePath, const std::filesystem::path& outputFilePath) {
+	Clock buildClock;
+	std::filesystem::path pointsPath = outputFilePath;
+	pointsPath += ".points.tmp";
+	std::filesystem::path sortedPath = outputFilePath;
+	sortedPath += ".sorted.tmp";
+	MappedFile pointFile;
+	MappedFile sortedFile;
+	auto removeTemporaries = [&]() {
+		pointFile.Close();
+		sortedFile.Close();
+		std::error_code ec;
+		std::filesystem::remove(pointsPath, ec);
+		std::filesystem::remove(sortedPath, ec);
+	};
+	auto fail = [&](const std::string& message) {
+		std::cerr << "[ERROR] " << message << ": " << plyFilePath << std::endl;
+		removeTemporaries();
+		return false;
+	};
+
+	PlyReader reader;
+	if (!reader.Open(plyFilePath)) {
+		return false;
+	}
+	if (reader.GetNumVertices() == 0) {
+		return fail("No points to sort");
+	}
+
+	// Pass 1: the points with their colors, and their bounds.
+	glm::vec3 minPos = glm::vec3(1e30f);
+	glm::vec3 maxPos = glm::vec3(-1e30f);
+	{
+		std::ofstream pointOut(pointsPath, std::ios::binary | std::ios::trunc);
+		const size_t vertexFloats = reader.GetVertexBytes() / sizeof(float);
+		std::vector<float> vertices(READ_VERTICES * vertexFloats);
+		std::vector<uint8_t> colors(READ_VERTICES * 4);
+		std::vector<PointCloudPoint> packed(READ_VERTICES);
+		while (reader.GetVerticesLeft() > 0) {
+			const size_t count = reader.ReadVertices(vertices.data(), READ_VERTICES, colors.data());
+			if (count == 0) {
+				break;
+			}
+			for (size_t i = 0; i < count; ++i) {
+				PointCloudPoint& point = packed[i];
+				std::copy(vertices.data() + i * vertexFloats, vertices.data() + i * vertexFloats + 3, point.position);
+				std::copy(colors.data() + i * 4, colors.data() + i * 4 + 4, point.color);
+				const glm::vec3 position = glm::vec3(point.position[0], point.position[1], point.position[2]);
+				minPos = glm::min(minPos, position);
+				maxPos = glm::max(maxPos, position);
+			}
+			pointOut.write((const char*)packed.data(), count * sizeof(PointCloudPoint));
+		}
+		if (reader.HasFailed() || !pointOut) {
+			return fail("Failed to copy the points");
+		}
+	}
+	if (!pointFile.Open(pointsPath)) {
+		return fail("Failed to map the points");
+	}
+	const PointCloudPoint* points = (const PointCloudPoint*)pointFile.GetData();
+	const size_t numPoints = pointFile.GetSize() / sizeof(PointCloudPoint);
+	const glm::vec3 cubeMin = minPos;
+	const float cubeSize = std::max(std::max(maxPos.x - minPos.x, maxPos.y - minPos.y), std::max(maxPos.z - minPos.z, 1e-20f));
+	auto getCube = [&](const int level, const int x, const int y, const int z, glm::vec3& boundsMin, float& size) {
+		size = cubeSize / (float)(1 << level);
+		boundsMin = cubeMin + glm::vec3((float)x, (float)y, (float)z) * size;
+	};
+
+	// Pass 2: points per cell of the count grid, then per cell of every coarser level.
+	JobSystem& jobs = JobSystem::GetInstance();
+	std::vector<std::vector<uint64_t>> counts(COUNT_GRID_LEVELS + 1);
+	auto getCount = [&](const int level, const int x, const int y, const int z) {
+		const size_t cells = (size_t)1 << level;
+		return counts[level][((size_t)z * cells + y) * cells + x];
+	};
+	{
+		const int countGrid = 1 << COUNT_GRID_LEVELS;
+		std::vector<std::atomic<uint64_t>> cellCounts((size_t)countGrid * countGrid * countGrid);
+		jobs.ParallelFor(numPoints, 64 * 1024, [&](const size_t begin, const size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				cellCounts[GetCell(points[i], cubeMin, cubeSize, countGrid)].fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+		counts[COUNT_GRID_LEVELS].assign(cellCounts.size(), 0);
+		for (size_t cell = 0; cell < cellCounts.size(); ++cell) {
+			counts[COUNT_GRID_LEVELS][cell] = cellCounts[cell].load(std::memory_order_relaxed);
+		}
+	}
+	for (int level = COUNT_GRID_LEVELS - 1; level >= 0; --level) {
+		const int cells = 1 << level;
+		counts[level].assign((size_t)cells * cells * cells, 0);
+		for (int z = 0; z < cells; ++z) {
+			for (int y = 0; y < cells; ++y) {
+				for (int x = 0; x < cells; ++x) {
+					uint64_t& count = counts[level][((size_t)z * cells + y) * cells + x];
+					for (int octant = 0; octant < 8; ++octant) {
+						count += getCount(level + 1, 2 * x + (octant & 1), 2 * y + (octant >> 1 & 1), 2 * z + (octant >> 2 & 1));
+					}
+				}
+			}
+		}
+	}
+
+	// The chunks are the largest cells with few enough points, top down. The cells above them
+	// become the upper nodes, listed children first.
+	struct Chunk
+	{
+		int level, x, y, z;
+		uint64_t first;
+		uint64_t count;
+	};
+	struct CellRef
+	{
+		bool isChunk;
+		uint32_t index;
+	};
+	struct UpperCell
+	{
+		int level, x, y, z;
+		std::vector<CellRef> children;
+	};
+	std::vector<Chunk> chunks;
+	std::vector<UpperCell> upperCells;
+	std::function<CellRef(int, int, int, int)> selectCells = [&](const int level, const int x, const int y, const int z) {
+		const uint64_t count = getCount(level, x, y, z);
+		if (count <= MAX_CHUNK_POINTS || level == COUNT_GRID_LEVELS) {
+			chunks.push_back({ level, x, y, z, 0, count });
+			return CellRef{ true, (uint32_t)chunks.size() - 1 };
+		}
+		UpperCell upper = { level, x, y, z, {} };
+		for (int octant = 0; octant < 8; ++octant) {
+			const int cx = 2 * x + (octant & 1);
+			const int cy = 2 * y + (octant >> 1 & 1);
+			const int cz = 2 * z + (octant >> 2 & 1);
+			if (getCount(level + 1, cx, cy, cz) > 0) {
+				upper.children.push_back(selectCells(level + 1, cx, cy, cz));
+			}
+		}
+		upperCells.push_back(std::move(upper));
+		return CellRef{ false, (uint32_t)upperCells.size() - 1 };
+	};
+	const CellRef root = selectCells(0, 0, 0, 0);
+
+	// Chunk of every cell of the count grid, and the first point of every chunk.
+	std::vector<uint32_t> cellChunks(counts[COUNT_GRID_LEVELS].size());
+	uint64_t nextPoint = 0;
+	for (uint32_t i = 0; i < (uint32_t)chunks.size(); ++i) {
+		Chunk& chunk = chunks[i];
+		chunk.first = nextPoint;
+		nextPoint += chunk.count;
+		const int shift = COUNT_GRID_LEVELS - chunk.level;
+		const size_t countGrid = (size_t)1 << COUNT_GRID_LEVELS;
+		for (int z = chunk.z << shift; z < (chunk.z + 1) << shift; ++z) {
+			for (int y = chunk.y << shift; y < (chunk.y + 1) << shift; ++y) {
+				for (int x = chunk.x << shift; x < (chunk.x + 1) << shift; ++x) {
+					cellChunks[((size_t)z * countGrid + y) * countGrid + x] = i;
+				}
+			}
+		}
+	}
+	counts.clear();
+
+	// Pass 3: the points grouped by chunk, through a small buffer per chunk.
+	{
+		std::ofstream sortedOut(sortedPath, std::ios::binary | std::ios::trunc);
+		std::vector<uint64_t> cursors(chunks.size());
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			cursors[i] = chunks[i].first;
+		}
+		std::vector<PointCloudPoint> chunkBuffers(chunks.size() * CHUNK_BUFFER_POINTS);
+		std::vector<uint32_t> chunkFill(chunks.size(), 0);
+		auto flush = [&](const size_t chunk) {
+			sortedOut.seekp((std::streamoff)(cursors[chunk] * sizeof(PointCloudPoint)));
+			sortedOut.write((const char*)(chunkBuffers.data() + chunk * CHUNK_BUFFER_POINTS), chunkFill[chunk] * sizeof(PointCloudPoint));
+			cursors[chunk] += chunkFill[chunk];
+			chunkFill[chunk] = 0;
+		};
+		for (size_t i = 0; i < numPoints; ++i) {
+			const uint32_t chunk = cellChunks[GetCell(points[i], cubeMin, cubeSize, 1 << COUNT_GRID_LEVELS)];
+			chunkBuffers[(size_t)chunk * CHUNK_BUFFER_POINTS + chunkFill[chunk]] = points[i];
+			if (++chunkFill[chunk] == CHUNK_BUFFER_POINTS) {
+				flush(chunk);
+			}
+		}
+		for (size_t chunk = 0; chunk < chunks.size(); ++chunk) {
+			flush(chunk);
+		}
+		if (!sortedOut) {
+			return fail("Failed to sort the points");
+		}
+	}
+	pointFile.Close();
+	std::error_code removeError;
+	std::filesystem::remove(pointsPath, removeError);
+	if (!sortedFile.Open(sortedPath)) {
+		return fail("Failed to map the sorted points");
+	}
+	const PointCloudPoint* sortedPoints = (const PointCloudPoint*)sortedFile.GetData();
+
+	// Pass 4: the chunk subtrees in parallel, each written as it is done, then the upper nodes.
+	struct BuildNode
+	{
+		glm::vec3 boundsMin;
+		float size;
+		uint64_t offset;
+		uint32_t numPoints;
+		uint16_t level;
+		float spacing;
+		std::vector<uint32_t> children;
+	};
+	std::ofstream output(outputFilePath, std::ios::binary | std::ios::trunc);
+	PointCloudHeader header = {};
+	std::memcpy(header.magic, POINT_CLOUD_MAGIC, 4);
+	header.version = POINT_CLOUD_VERSION;
+	output.write((const char*)&header, sizeof(header));
+
+	std::mutex outputMutex;
+	std::vector<BuildNode> buildNodes;
+	std::vector<uint32_t> chunkRoots(chunks.size());
+	// The root points of every cell, thinned to the grid of its parent, which is made of them.
+	std::vector<std::vector<PointCloudPoint>> chunkSamples(chunks.size());
+	const size_t sampleCells = (size_t)SAMPLE_GRID * SAMPLE_GRID * SAMPLE_GRID;
+	jobs.ParallelFor(chunks.size(), 1, [&](const size_t begin, const size_t end) {
+		std::vector<uint32_t> stamps(sampleCells, 0);
+		uint32_t stamp = 0;
+		std::vector<PointCloudPoint> chunkPoints;
+		std::vector<BuildNode> localNodes;
+		for (size_t c = begin; c < end; ++c) {
+			const Chunk& chunk = chunks[c];
+			chunkPoints.assign(sortedPoints + chunk.first, sortedPoints + chunk.first + chunk.count);
+			localNodes.clear();
+
+			// A node keeps its sample at the front of its points and splits the rest into octants.
+			// Offsets are in points of the chunk until it is written.
+			std::function<uint32_t(size_t, size_t, const glm::vec3&, float, int)> buildNode =
+				[&](const size_t first, const size_t count, const glm::vec3& boundsMin, const float size, const int level) {
+				const uint32_t index = (uint32_t)localNodes.size();
+				localNodes.emplace_back();
+				BuildNode node = { boundsMin, size, first, (uint32_t)count, (uint16_t)level, 0.0f, {} };
+				PointCloudPoint* nodePoints = chunkPoints.data() + first;
+				if (count <= LEAF_POINTS || level >= MAX_LEVEL) {
+					node.spacing = size / std::max((float)SAMPLE_GRID, std::sqrt((float)count));
+					localNodes[index] = std::move(node);
+					return index;
+				}
+				const size_t kept = SamplePoints(nodePoints, count, boundsMin, size, SAMPLE_GRID, stamps, ++stamp);
+				node.numPoints = (uint32_t)kept;
+				node.spacing = size / (float)SAMPLE_GRID;
+
+				// Split the rest along z, then y, then x, which leaves the octants in order.
+				const float half = size * 0.5f;
+				const glm::vec3 center = boundsMin + glm::vec3(half);
+				PointCloudPoint* octantBounds[9];
+				octantBounds[0] = nodePoints + kept;
+				octantBounds[8] = nodePoints + count;
+				for (int axis = 2, step = 4; axis >= 0; --axis, step /= 2) {
+					for (int octant = 0; octant < 8; octant += 2 * step) {
+						octantBounds[octant + step] = std::partition(octantBounds[octant], octantBounds[octant + 2 * step],
+							[&](const PointCloudPoint& point) { return point.position[axis] < center[axis]; });
+					}
+				}
+				for (int octant = 0; octant < 8; ++octant) {
+					const size_t octantCount = (size_t)(octantBounds[octant + 1] - octantBounds[octant]);
+					if (octantCount == 0) {
+						continue;
+					}
+					const glm::vec3 childMin = boundsMin + glm::vec3((float)(octant & 1), (float)(octant >> 1 & 1), (float)(octant >> 2 & 1)) * half;
+					node.children.push_back(buildNode((size_t)(octantBounds[octant] - chunkPoints.data()), octantCount, childMin, half, level + 1));
+				}
+				localNodes[index] = std::move(node);
+				return index;
+			};
+			glm::vec3 chunkMin;
+			float chunkSize;
+			getCube(chunk.level, chunk.x, chunk.y, chunk.z, chunkMin, chunkSize);
+			buildNode(0, chunkPoints.size(), chunkMin, chunkSize, chunk.level);
+
+			std::vector<PointCloudPoint> sample(chunkPoints.begin(), chunkPoints.begin() + localNodes[0].numPoints);
+			sample.resize(SamplePoints(sample.data(), sample.size(), chunkMin, chunkSize, SAMPLE_GRID / 2, stamps, ++stamp));
+			chunkSamples[c] = std::move(sample);
+
+			std::lock_guard<std::mutex> lock(outputMutex);
+			const uint64_t base = (uint64_t)output.tellp();
+			output.write((const char*)chunkPoints.data(), chunkPoints.size() * sizeof(PointCloudPoint));
+			const uint32_t nodeBase = (uint32_t)buildNodes.size();
+			for (BuildNode& node : localNodes) {
+				node.offset = base + node.offset * sizeof(PointCloudPoint);
+				for (uint32_t& child : node.children) {
+					child += nodeBase;
+				}
+				buildNodes.push_back(std::move(node));
+			}
+			chunkRoots[c] = nodeBase;
+		}
+	});
+	sortedFile.Close();
+
+	// The upper nodes keep the thinned roots of their children: one point per cell of their
+	// grid, copied, since the children draw theirs as well.
+	std::vector<uint32_t> upperRoots(upperCells.size());
+	std::vector<std::vector<PointCloudPoint>> upperSamples(upperCells.size());
+	std::vector<uint32_t> stamps(sampleCells, 0);
+	uint32_t stamp = 0;
+	for (size_t u = 0; u < upperCells.size(); ++u) {
+		const UpperCell& upper = upperCells[u];
+		BuildNode node = {};
+		getCube(upper.level, upper.x, upper.y, upper.z, node.boundsMin, node.size);
+		node.level = (uint16_t)upper.level;
+		node.spacing = node.size / (float)SAMPLE_GRID;
+		std::vector<PointCloudPoint> cellPoints;
+		for (const CellRef& child : upper.children) {
+			std::vector<PointCloudPoint>& sample = child.isChunk ? chunkSamples[child.index] : upperSamples[child.index];
+			cellPoints.insert(cellPoints.end(), sample.begin(), sample.end());
+			std::vector<PointCloudPoint>().swap(sample);
+			node.children.push_back(child.isChunk ? chunkRoots[child.index] : upperRoots[child.index]);
+		}
+		node.offset = (uint64_t)output.tellp();
+		node.numPoints = (uint32_t)cellPoints.size();
+		output.write((const char*)cellPoints.data(), cellPoints.size() * sizeof(PointCloudPoint));
+		cellPoints.resize(SamplePoints(cellPoints.data(), cellPoints.size(), node.boundsMin, node.size, SAMPLE_GRID / 2, stamps, ++stamp));
+		upperSamples[u] = std::move(cellPoints);
+		upperRoots[u] = (uint32_t)buildNodes.size();
+		buildNodes.push_back(std::move(node));
+	}
+
+	// The node table, breadth first, so the children of a node are contiguous.
+	std::vector<PointCloudNode> nodeTable;
+	nodeTable.reserve(buildNodes.size());
+	std::vector<uint32_t> queue = { root.isChunk ? chunkRoots[root.index] : upperRoots[root.index] };
+	for (size_t i = 0; i < queue.size(); ++i) {
+		const BuildNode& node = buildNodes[queue[i]];
+		PointCloudNode entry = {};
+		for (int axis = 0; axis < 3; ++axis) {
+			entry.boundsMin[axis] = node.boundsMin[axis];
+		}
+		entry.size = node.size;
+		entry.offset = node.offset;
+		entry.numPoints = node.numPoints;
+		entry.firstChild = node.children.empty() ? 0 : (uint32_t)queue.size();
+		entry.numChildren = (uint16_t)node.children.size();
+		entry.level = node.level;
+		entry.spacing = node.spacing;
+		queue.insert(queue.end(), node.children.begin(), node.children.end());
+		nodeTable.push_back(entry);
+		header.numPoints += node.numPoints;
+	}
+
+	const uint64_t padding = (8 - (uint64_t)output.tellp() % 8) % 8;
+	output.write("\0\0\0\0\0\0\0", (std::streamsize)padding);
+	header.nodeTableOffset = (uint64_t)output.tellp();
+	header.numNodes = (uint32_t)nodeTable.size();
+	output.write((const char*)nodeTable.data(), nodeTable.size() * sizeof(PointCloudNode));
+	for (int axis = 0; axis < 3; ++axis) {
+		header.boundsMin[axis] = cubeMin[axis];
+		header.pointsMin[axis] = minPos[axis];
+		header.pointsMax[axis] = maxPos[axis];
+	}
+	header.size = cubeSize;
+	output.seekp(0);
+	output.write((const char*)&header, sizeof(header));
+	output.close();
+	if (!output) {
+		std::error_code ec;
+		std::filesystem::remove(outputFilePath, ec);
+		return fail("Failed to write " + outputFilePath.string());
+	}
+	removeTemporaries();
+
+	std::cout << "[*] Sorted " << plyFilePath.filename() << " into " << header.numNodes << " octree nodes in "
+		<< buildClock.GetElapsedTime() << " s (" << numPoints << " points in " << chunks.size() << " chunks, "
+		<< header.numPoints - numPoints << " copied to the upper levels)" << std::endl;
+	return true;
+}
@@ -0,0 +1,23 @@
+#include "RenderResources.h"
+
+RenderResources& RenderResources::GetInstance() {
+	static RenderResources instance;
+	return instance;
+}
+
+RenderResources::~RenderResources() {
+	Clear();
+}
+
+// Desc: Owners first, so the handles they release are collected in the same call.
+void RenderResources::EndFrame() {
+	meshes.Collect();
+	materials.Collect();
+	textures.Collect();
+}
+
+void RenderResources::Clear() {
+	meshes.Clear();
+	materials.Clear();
+	textures.Clear();
+}
@@ -0,0 +1,93 @@
+#include "RenderScheduler.h"
+
+// FreeGlut headers.
+#include <GL/freeglut.h>
+
+// C++ STL headers.
+#include <algorithm>
+#include <cmath>
+
+RenderScheduler* RenderScheduler::timerTarget = nullptr;
+
+RenderScheduler::RenderScheduler(const float maxFrameRate) {
+	dirty = true;
+	animating = false;
+	visible = true;
+	redisplayPosted = false;
+	timerPending = false;
+	SetMaxFrameRate(maxFrameRate);
+	timerTarget = this;
+}
+
+RenderScheduler::~RenderScheduler() {
+	// A timer still queued in GLUT must not reach a destroyed scheduler.
+	if (timerTarget == this) {
+		timerTarget = nullptr;
+	}
+}
+
+void RenderScheduler::RequestRedraw() {
+	dirty = true;
+	Wake();
+}
+
+void RenderScheduler::SetAnimating(const bool animating) {
+	if (animating == this->animating) {
+		return;
+	}
+	this->animating = animating;
+	Wake();
+}
+
+void RenderScheduler::SetVisible(const bool visible) {
+	this->visible = visible;
+	if (visible) {
+		// The window may have been exposed with stale contents.
+		dirty = true;
+		Wake();
+	}
+}
+
+void RenderScheduler::SetMaxFrameRate(const float maxFrameRate) {
+	minFrameInterval = maxFrameRate > 0.0f ? 1.0 / maxFrameRate : 0.0;
+}
+
+void RenderScheduler::BeginFrame() {
+	redisplayPosted = false;
+	dirty = false;
+	frameClock.Reset();
+}
+
+void RenderScheduler::EndFrame() {
+	// Redraws requested while rendering are picked up here as well.
+	if (animating || dirty) {
+		Wake();
+	}
+}
+
+// Desc: Post a redisplay now, or arm a timer if an animation frame would exceed the cap.
+void RenderScheduler::Wake() {
+	if (!visible || redisplayPosted || timerPending) {
+		return;
+	}
+	if (!animating && !dirty) {
+		return;
+	}
+
+	double remaining = animating ? minFrameInterval - frameClock.GetElapsedTime() : 0.0;
+	if (remaining > 0.0) {
+		timerPending = true;
+		glutTimerFunc((unsigned int)std::ceil(remaining * 1000.0), TimerCB, 0);
+		return;
+	}
+	redisplayPosted = true;
+	glutPostRedisplay();
+}
+
+void RenderScheduler::TimerCB(int) {
+	if (timerTarget == nullptr) {
+		return;
+	}
+	timerTarget->timerPending = false;
+	timerTarget->Wake();
+}
@@ -0,0 +1,155 @@
+#include "SceneStore.h"
+
+// C++ STL headers.
+#include <algorithm>
+
+// SIMD headers.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SCENE_STORE_USE_SSE
+#endif
+
+// Project headers.
+#include "JobSystem.h"
+
+namespace opengl_homework {
+
+// Nodes per job when one depth level is updated in parallel.
+static constexpr size_t NODE_GRAIN_SIZE = 1024;
+
+// Desc: out = a * b for column-major matrices; out may alias a or b.
+static void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out) {
+#ifdef SCENE_STORE_USE_SSE
+	const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+	const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+	const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+	const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+	for (int column = 0; column < 4; ++column) {
+		const __m128 b0 = _mm_set1_ps(b[column][0]);
+		const __m128 b1 = _mm_set1_ps(b[column][1]);
+		const __m128 b2 = _mm_set1_ps(b[column][2]);
+		const __m128 b3 = _mm_set1_ps(b[column][3]);
+		__m128 result = _mm_mul_ps(a0, b0);
+		result = _mm_add_ps(result, _mm_mul_ps(a1, b1));
+		result = _mm_add_ps(result, _mm_mul_ps(a2, b2));
+		result = _mm_add_ps(result, _mm_mul_ps(a3, b3));
+		_mm_storeu_ps(&out[column][0], result);
+	}
+#else
+	out = a * b;
+#endif
+}
+
+// Desc: Bounding box of a transformed box, from its center and half extent.
+static void TransformBounds(const glm::mat4& m, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+	glm::vec3& outMin, glm::vec3& outMax) {
+	const glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+	const glm::vec3 halfExtent = 0.5f * (boundsMax - boundsMin);
+	const glm::vec3 worldCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+	const glm::vec3 worldHalfExtent =
+		glm::abs(glm::vec3(m[0])) * halfExtent.x +
+		glm::abs(glm::vec3(m[1])) * halfExtent.y +
+		glm::abs(glm::vec3(m[2])) * halfExtent.z;
+	outMin = worldCenter - worldHalfExtent;
+	outMax = worldCenter + worldHalfExtent;
+}
+
+SceneStore::SceneStore() {
+	numUpdated = 0;
+}
+
+SceneStore::~SceneStore() {}
+
+SceneNodeId SceneStore::Create(const SceneNodeId parent) {
+	const SceneNodeId node = (SceneNodeId)parents.size();
+	parents.push_back(parent);
+	depths.push_back(parent == INVALID_SCENE_NODE ? 0 : depths[parent] + 1);
+	localMatrices.emplace_back(1.0f);
+	worldMatrices.emplace_back(1.0f);
+	localBoundsMin.emplace_back(0.0f);
+	localBoundsMax.emplace_back(0.0f);
+	worldBoundsMin.emplace_back(0.0f);
+	worldBoundsMax.emplace_back(0.0f);
+	meshes.emplace_back();
+	nodeFlags.push_back(SCENE_NODE_VISIBLE);
+	dirty.push_back(1);
+	return node;
+}
+
+void SceneStore::Clear() {
+	parents.clear();
+	depths.clear();
+	localMatrices.clear();
+	worldMatrices.clear();
+	localBoundsMin.clear();
+	localBoundsMax.clear();
+	worldBoundsMin.clear();
+	worldBoundsMax.clear();
+	meshes.clear();
+	nodeFlags.clear();
+	dirty.clear();
+}
+
+void SceneStore::SetLocalMatrix(const SceneNodeId node, const glm::mat4& localMatrix) {
+	localMatrices[node] = localMatrix;
+	dirty[node] = 1;
+}
+
+void SceneStore::SetLocalBounds(const SceneNodeId node, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+	localBoundsMin[node] = boundsMin;
+	localBoundsMax[node] = boundsMax;
+	dirty[node] = 1;
+}
+
+void SceneStore::SetMesh(const SceneNodeId node, const MeshHandle mesh) {
+	meshes[node] = mesh;
+}
+
+void SceneStore::UpdateTransforms() {
+	// Propagate the dirty flags; parents come before their children.
+	for (auto& level : dirtyByDepth) {
+		level.clear();
+	}
+	const size_t numNodes = parents.size();
+	for (size_t node = 0; node < numNodes; ++node) {
+		const SceneNodeId parent = parents[node];
+		if (parent != INVALID_SCENE_NODE && dirty[parent]) {
+			dirty[node] = 1;
+		}
+		if (dirty[node]) {
+			if (dirtyByDepth.size() <= depths[node]) {
+				dirtyByDepth.resize(depths[node] + 1);
+			}
+			dirtyByDepth[depths[node]].push_back((uint32_t)node);
+		}
+	}
+
+	// A level only reads the world matrices of the level above, so each one runs in parallel.
+	numUpdated = 0;
+	for (const auto& level : dirtyByDepth) {
+		JobSystem::GetInstance().ParallelFor(level.size(), NODE_GRAIN_SIZE, [&](size_t begin, size_t end) {
+			UpdateNodes(level.data() + begin, end - begin);
+		});
+		for (const uint32_t node : level) {
+			dirty[node] = 0;
+		}
+		numUpdated += level.size();
+	}
+}
+
+void SceneStore::UpdateNodes(const uint32_t* nodes, const size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		const uint32_t node = nodes[i];
+		const SceneNodeId parent = parents[node];
+		if (parent == INVALID_SCENE_NODE) {
+			worldMatrices[node] = localMatrices[node];
+		}
+		else {
+			MultiplyMatrices(worldMatrices[parent], localMatrices[node], worldMatrices[node]);
+		}
+		TransformBounds(worldMatrices[node], localBoundsMin[node], localBoundsMax[node],
+			worldBoundsMin[node], worldBoundsMax[node]);
+	}
+}
+
+} // namespace opengl_homework
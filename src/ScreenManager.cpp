@@ -10,6 +10,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 // C++ STL headers.
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <thread>
 #include <vector>
@@ -19,35 +21,41 @@
 #include "TriangleMesh.h"
 #include "ShaderProg.h"
 #include "Light.h"
+#include "LightBlock.h"
 #include "Camera.h"
 #include "Skybox.h"
 #include "Clock.h"
+#include "ModelPrefetcher.h"
+#include "ModelCatalog.h"
+#include "DepthPrepass.h"
+#include "DynamicResolution.h"
+#include "RenderScheduler.h"
+#include "Simulation.h"
+#include "JobSystem.h"
+#include "SceneStore.h"
+#include "RenderResources.h"
+#include "Arena.h"
+#include "UploadManager.h"
+#include "TextureResidency.h"
+#include "PointCloud.h"
 
 namespace opengl_homework {
 
-using MeshPtr = std::shared_ptr<opengl_homework::TriangleMesh>;
+// Light steps per key press, scaled by lightMoveSpeed (same as PointLight::MoveLeft etc.).
+static const glm::vec3 LIGHT_STEP_LEFT = glm::vec3(-0.1f, 0.0f, 0.0f);
+static const glm::vec3 LIGHT_STEP_RIGHT = glm::vec3(0.1f, 0.0f, 0.0f);
+static const glm::vec3 LIGHT_STEP_UP = glm::vec3(0.0f, 0.1f, 0.0f);
+static const glm::vec3 LIGHT_STEP_DOWN = glm::vec3(0.0f, -0.1f, 0.0f);
+
+// Replay order of the command lists: per-frame uniform updates before the scene draws.
+static constexpr uint32_t FRAME_SORT_KEY = 0;
+static constexpr uint32_t SCENE_SORT_KEY = 1;
 
 std::shared_ptr<ScreenManager> ScreenManager::GetInstance() {
     static std::shared_ptr<ScreenManager> instance(new ScreenManager());
     return instance;
 }
 
-class SceneObject
-{
-public:
-    SceneObject() {
-        mesh = nullptr;
-        worldMatrix = glm::mat4x4(1.0f);
-    }
-
-    void Update(const glm::mat4& transform) {
-        worldMatrix = transform * worldMatrix;
-    }
-
-    MeshPtr mesh;
-    glm::mat4x4 worldMatrix;
-};
-
 // SceneLight (for visualization of a point light).
 // T is derived from PointLight
 template<typename T>
@@ -72,33 +80,79 @@ struct ScreenManager::Impl {
         width(600),
         height(600),
         camera(std::make_unique<Camera>((float)width / (float)height)) {
-        sceneObj = std::make_unique<SceneObject>();
+        // The model hangs under a turntable node that carries the rotation.
+        scene = std::make_unique<SceneStore>();
+        turntableNode = scene->Create();
+        modelNode = scene->Create(turntableNode);
         pointLightObj = std::make_unique<SceneLight<PointLight>>();
         spotLightObj = std::make_unique<SceneLight<SpotLight>>();
     };
 
     int width;
     int height;
-    Clock clock;
+    Clock startupClock;
+    bool firstFrame = true;
     std::vector<std::string> objNames;
+    std::vector<std::filesystem::path> objFilePaths;    // GLB or OBJ, as chosen by the catalog.
+    std::vector<MeshLoadHint> objLoadHints;
     std::vector<std::string> skyboxNames;
+    std::unique_ptr<ModelCatalog> catalog;
     std::shared_ptr<FillColorShaderProg> fillColorShader;
-    std::shared_ptr<PhongShadingDemoShaderProg> phongShader;
+    std::shared_ptr<DepthOnlyShaderProg> depthShader;
+    std::shared_ptr<PhongShaderVariants> phongShaders;
     std::shared_ptr<SkyboxShaderProg> skyboxShader;
-    std::unique_ptr<SceneObject> sceneObj;
+    std::shared_ptr<UpscaleShaderProg> upscaleShader;
+    std::shared_ptr<PointCloudShaderProg> pointCloudShader;
+    std::unique_ptr<SceneStore> scene;
+    SceneNodeId turntableNode;
+    SceneNodeId modelNode;
+    std::unique_ptr<PointCloud> pointCloud;     // Drawn at modelNode when the model is a point cloud.
     std::shared_ptr<Camera> camera;
     std::shared_ptr<DirectionalLight> dirLight;
     std::shared_ptr<SceneLight<PointLight>> pointLightObj;
     std::shared_ptr<SceneLight<SpotLight>> spotLightObj;
+    std::shared_ptr<LightBlock> lightBlock;
     std::shared_ptr<Skybox> skybox;
+    std::shared_ptr<Skybox> pendingSkybox;	// Shown in place of skybox once its cubemap is ready.
+    std::unique_ptr<ModelPrefetcher> prefetcher;
+    std::unique_ptr<DepthPrepass> depthPrepass;
+    std::unique_ptr<DynamicResolution> dynamicResolution;
+    std::unique_ptr<RenderScheduler> scheduler;
+    std::unique_ptr<Simulation> simulation;
+    std::unique_ptr<CommandQueue> commandQueue;
+    std::unique_ptr<CommandList> frameCommands;
+    int frameRate = 0;
     glm::vec3 ambientLight;
     float lightMoveSpeed = 0.2f;
+    double simulationTickRate = 60.0;
+    size_t prefetchByteBudget = 256 * 1024 * 1024;
+    float targetFrameTimeMs = 16.6f;
+    float maxFrameRate = 60.0f;
+    size_t uploadBytesPerFrame = 8 * 1024 * 1024;
+    double uploadMicrosecondsPerFrame = 2000.0;
+    size_t textureBudgetBytes = 256 * 1024 * 1024;
 };
 
 // ------------------------------------------------------------------------
 // Public member functions. -----------------------------------------------
 // ------------------------------------------------------------------------
 
+ScreenManager::RenderStats ScreenManager::GetRenderStats() const {
+    RenderStats stats;
+    stats.frameRate = pImpl->frameRate;
+    if (pImpl->dynamicResolution != nullptr) {
+        stats.resolutionScale = pImpl->dynamicResolution->GetScale();
+        stats.targetFrameTimeMs = pImpl->dynamicResolution->GetTargetFrameTime();
+        const auto& history = pImpl->dynamicResolution->GetFrameTimeHistory();
+        stats.gpuFrameTimesMs.assign(history.begin(), history.end());
+    }
+    stats.textures = TextureResidency::GetInstance().GetStats();
+    if (pImpl->pointCloud != nullptr) {
+        stats.points = pImpl->pointCloud->GetStats();
+    }
+    return stats;
+}
+
 void ScreenManager::Start(int argc, char** argv) {
     // Setting window properties.
     glutInit(&argc, argv);
@@ -119,8 +173,10 @@ void ScreenManager::Start(int argc, char** argv) {
 
     // Initialization.
     SetupFilesystem();
+    SetupPrefetcher();
     SetupRenderState();
     SetupLights();
+    SetupSimulation();
     SetupCamera();
     SetupShaderLib();
     SetupMenu();
@@ -129,10 +185,13 @@ void ScreenManager::Start(int argc, char** argv) {
 
     // Register callback functions.
     glutDisplayFunc([]() { GetInstance()->RenderSceneCB(); });
-    glutIdleFunc([]() { glutPostRedisplay(); });
     glutReshapeFunc([](int w, int h) { GetInstance()->ReshapeCB(w, h); });
     glutSpecialFunc([](int key, int x, int y) { GetInstance()->ProcessSpecialKeysCB(key, x, y); });
     glutKeyboardFunc([](unsigned char key, int x, int y) { GetInstance()->ProcessKeysCB(key, x, y); });
+    glutWindowStatusFunc([](int state) { GetInstance()->WindowStatusCB(state); });
+
+    // Frames are drawn on demand; the first one picks up the rotation from the simulation.
+    pImpl->scheduler->RequestRedraw();
 
     // Start rendering loop.
     glutMainLoop();
@@ -143,9 +202,26 @@ void ScreenManager::Start(int argc, char** argv) {
 // ------------------------------------------------------------------------
 
 ScreenManager::ScreenManager() {
+    // Start the workers before any other singleton and make this the main thread of the job
+    // system; statics die in reverse order, so the workers outlive everything their jobs touch.
+    JobSystem::GetInstance();
+
+    // Create the registries first so they outlive every handle held by the window;
+    // the upload and residency managers outlive the textures and meshes that use them.
+    UploadManager::GetInstance();
+    TextureResidency::GetInstance();
+    RenderResources::GetInstance();
     pImpl = std::make_unique<Impl>();
 }
 
+// exit() skips the destructor of the ScreenManager, which main still holds, so stop the threads
+// that call into the singletons and let the jobs in flight finish before the statics are destroyed.
+void ScreenManager::Shutdown() {
+    pImpl->prefetcher.reset();
+    pImpl->simulation.reset();
+    JobSystem::GetInstance().WaitForAll();
+}
+
 int ScreenManager::CalculateFrameRate() {
     static int frameCount = 0;
     static int lastFrameCount = 0;
@@ -166,33 +242,97 @@ int ScreenManager::CalculateFrameRate() {
 
 // Callback function for glutDisplayFunc.
 void ScreenManager::RenderSceneCB() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Scratch memory of the previous frame is recycled from here on.
+    FrameArena::BeginFrame();
 
-    double deltaTime = pImpl->clock.GetElapsedTime();
-    pImpl->clock.Reset();
-    float rotationAngle = 0.1f * deltaTime;
+    // GL work posted by jobs since the last frame.
+    JobSystem::GetInstance().RunMainThreadJobs();
 
-    // Calculate frame rate.
-    int frameRate = CalculateFrameRate();
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glRasterPos2f(-0.95f, 0.9f);
-    std::string frameRateStr = "FPS: " + std::to_string(frameRate);
-    glutBitmapString(GLUT_BITMAP_HELVETICA_18, (const unsigned char*)frameRateStr.c_str());
+    // Stream pending buffer and texture data, within the per-frame budget.
+    UploadManager::GetInstance().Pump();
+
+    // Draw the scene offscreen at the current resolution scale.
+    pImpl->dynamicResolution->BeginFrame();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    pImpl->scheduler->BeginFrame();
 
-    // Rotate the model.
+    // Pose the scene from the simulation, interpolated between its last two ticks.
+    SimulationState state = pImpl->simulation->Sample();
     auto rotationAxis = glm::vec3(0.0f, 1.0f, 0.0f);
-    glm::mat4x4 R = glm::rotate(glm::mat4x4(1.0f), rotationAngle, rotationAxis);
-    pImpl->sceneObj->Update(R);
+    glm::mat4x4 R = glm::rotate(glm::mat4x4(1.0f), state.modelRotation, rotationAxis);
+    pImpl->scene->SetLocalMatrix(pImpl->turntableNode, R);
+    pImpl->scene->UpdateTransforms();
+    if (pImpl->pointLightObj->light != nullptr) {
+        pImpl->pointLightObj->light->SetPosition(state.pointLightPosition);
+    }
+    if (pImpl->spotLightObj->light != nullptr) {
+        pImpl->spotLightObj->light->SetPosition(state.spotLightPosition);
+    }
 
-    pImpl->sceneObj->mesh->Render(
-        pImpl->phongShader,
-        pImpl->sceneObj->worldMatrix,
-        pImpl->ambientLight,
+    // Prepare the lights once for the whole frame; the skybox lights the scene once it is up.
+    const bool skyAmbient = pImpl->skybox != nullptr;
+    pImpl->lightBlock->Prepare(
+        pImpl->camera->GetViewMatrix(),
+        skyAmbient ? pImpl->skybox->GetIrradiance() : IrradianceSH::Constant(pImpl->ambientLight),
+        skyAmbient ? glm::mat3x3(glm::rotate(glm::mat4x4(1.0f), -state.skyboxRotation, glm::vec3(0.0f, 1.0f, 0.0f)))
+            : glm::mat3x3(1.0f),
         pImpl->dirLight,
         pImpl->pointLightObj->light,
-        pImpl->spotLightObj->light,
-        pImpl->camera
+        pImpl->spotLightObj->light
     );
+    pImpl->frameCommands->Reset(FRAME_SORT_KEY);
+    pImpl->lightBlock->Record(*pImpl->frameCommands);
+    pImpl->commandQueue->Submit(pImpl->frameCommands.get());
+
+    auto& meshes = RenderResources::GetInstance().GetMeshes();
+
+    // Texture feedback: the mip level each texture needs at its size on screen.
+    // Chunked meshes pick the chunks to stream, and cooked meshes their level of detail, from the same view.
+    TextureResidency::GetInstance().BeginFrame(
+        (int)(pImpl->width * pImpl->dynamicResolution->GetScale()),
+        (int)(pImpl->height * pImpl->dynamicResolution->GetScale()));
+    for (SceneNodeId node = 0; node < (SceneNodeId)pImpl->scene->GetNumNodes(); ++node) {
+        TriangleMesh* mesh = meshes.Get(pImpl->scene->GetMesh(node));
+        if (mesh != nullptr && (pImpl->scene->GetFlags(node) & SCENE_NODE_VISIBLE)) {
+            mesh->RequestTextureLevels(pImpl->scene->GetWorldMatrix(node), *pImpl->camera);
+            mesh->StreamChunks(pImpl->scene->GetWorldMatrix(node), *pImpl->camera);
+            mesh->SelectLod(pImpl->scene->GetWorldMatrix(node), *pImpl->camera);
+        }
+    }
+
+    // Lay down depth first when the mesh has enough overdraw to pay for it.
+    if (pImpl->depthPrepass->BeginFrame()) {
+        pImpl->depthPrepass->BeginDepthPass();
+        for (SceneNodeId node = 0; node < (SceneNodeId)pImpl->scene->GetNumNodes(); ++node) {
+            const TriangleMesh* mesh = meshes.Get(pImpl->scene->GetMesh(node));
+            if (mesh != nullptr && (pImpl->scene->GetFlags(node) & SCENE_NODE_VISIBLE)) {
+                mesh->RenderDepth(*pImpl->depthShader, pImpl->scene->GetWorldMatrix(node), *pImpl->camera);
+            }
+        }
+    }
+    pImpl->depthPrepass->BeginShadingPass();
+    bool shadersPending = false;
+    for (SceneNodeId node = 0; node < (SceneNodeId)pImpl->scene->GetNumNodes(); ++node) {
+        const TriangleMesh* mesh = meshes.Get(pImpl->scene->GetMesh(node));
+        if (mesh == nullptr || !(pImpl->scene->GetFlags(node) & SCENE_NODE_VISIBLE)) {
+            continue;
+        }
+        shadersPending |= !mesh->Render(
+            *pImpl->commandQueue,
+            SCENE_SORT_KEY + node,
+            *pImpl->phongShaders,
+            pImpl->scene->GetWorldMatrix(node),
+            *pImpl->lightBlock,
+            *pImpl->camera
+        );
+    }
+    // Recording has finished on the workers; issue the lists in order.
+    pImpl->commandQueue->Replay();
+    pImpl->depthPrepass->EndShadingPass();
+    if (pImpl->pointCloud != nullptr) {
+        pImpl->pointCloud->Render(*pImpl->pointCloudShader, pImpl->scene->GetWorldMatrix(pImpl->modelNode), *pImpl->camera);
+    }
 
     // Visualize the light with fill color. ------------------------------------------------------
     // Bind shader and set parameters.
@@ -228,12 +368,71 @@ void ScreenManager::RenderSceneCB() {
 
         pImpl->fillColorShader->Unbind();
     }
+    if (pImpl->pendingSkybox != nullptr && !pImpl->pendingSkybox->IsLoading()) {
+        if (pImpl->pendingSkybox->Prepare()) {
+            pImpl->skybox = std::move(pImpl->pendingSkybox);
+        }
+        pImpl->pendingSkybox.reset();
+    }
     if (pImpl->skybox != nullptr) {
-        pImpl->skybox->SetRotation(pImpl->skybox->GetRotation() + rotationAngle);
+        pImpl->skybox->SetRotation(state.skyboxRotation);
         pImpl->skybox->Render(pImpl->camera, pImpl->skyboxShader);
     }
 
+    // Upscale to the window.
+    pImpl->dynamicResolution->EndFrame(pImpl->upscaleShader);
+
+    // Calculate frame rate.
+    pImpl->frameRate = CalculateFrameRate();
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glRasterPos2f(-0.95f, 0.9f);
+    const TextureResidencyStats& textureStats = TextureResidency::GetInstance().GetStats();
+    char frameRateStr[160];
+    int overlayLength = snprintf(frameRateStr, sizeof(frameRateStr), "FPS: %d  Scale: %.2f  Textures: %zu/%zu MB",
+        pImpl->frameRate, pImpl->dynamicResolution->GetScale(),
+        textureStats.residentBytes >> 20, textureStats.budgetBytes >> 20);
+    if (pImpl->pointCloud != nullptr) {
+        const PointCloudStats& pointStats = pImpl->pointCloud->GetStats();
+        snprintf(frameRateStr + overlayLength, sizeof(frameRateStr) - overlayLength, "  Points: %.1f/%.1fM",
+            pointStats.pointsDrawn / 1e6, pointStats.pointBudget / 1e6);
+    }
+    glutBitmapString(GLUT_BITMAP_HELVETICA_18, (const unsigned char*)frameRateStr);
+
     glutSwapBuffers();
+
+    // Move the textures to the levels requested this frame, within the budget.
+    TextureResidency::GetInstance().Update();
+
+    // Everything recorded this frame has been issued; free what was released during it.
+    RenderResources::GetInstance().EndFrame();
+
+    // Keep drawing while rotating, until queued input shows up on screen,
+    // while jobs wait for the main thread, while uploads are streaming
+    // (a PLY mesh also reads between them), while a point cloud still misses
+    // nodes, while shader variants are still compiling and until a new
+    // skybox is ready.
+    const TriangleMesh* model = meshes.Get(pImpl->scene->GetMesh(pImpl->modelNode));
+    pImpl->scheduler->SetAnimating(state.rotating || !pImpl->simulation->IsSettled()
+        || JobSystem::GetInstance().HasMainThreadJobs()
+        || UploadManager::GetInstance().HasPendingUploads()
+        || (model != nullptr && model->IsLoaded() && !model->IsResident())
+        || (pImpl->pointCloud != nullptr && pImpl->pointCloud->IsStreaming())
+        || shadersPending
+        || pImpl->pendingSkybox != nullptr);
+    pImpl->scheduler->EndFrame();
+
+    if (pImpl->firstFrame) {
+        pImpl->firstFrame = false;
+        int numPrograms = 5 + pImpl->phongShaders->GetNumVariants();
+        int numCached = (int)pImpl->fillColorShader->IsLoadedFromCache()
+            + (int)pImpl->depthShader->IsLoadedFromCache()
+            + pImpl->phongShaders->GetNumLoadedFromCache()
+            + (int)pImpl->skyboxShader->IsLoadedFromCache()
+            + (int)pImpl->upscaleShader->IsLoadedFromCache()
+            + (int)pImpl->pointCloudShader->IsLoadedFromCache();
+        std::cout << "[*] First frame: " << pImpl->startupClock.GetElapsedTime() * 1000.0 << " ms after startup ("
+            << numCached << "/" << numPrograms << " programs from binary cache)" << std::endl;
+    }
 }
 
 // Callback function for glutReshapeFunc.
@@ -242,86 +441,111 @@ void ScreenManager::ReshapeCB(int w, int h) {
     pImpl->width = w;
     pImpl->height = h;
     glViewport(0, 0, pImpl->width, pImpl->height);
+    pImpl->dynamicResolution->Resize(pImpl->width, pImpl->height);
     // Adjust camera and projection.
     pImpl->camera->UpdateAspectRatio((float)pImpl->width / (float)pImpl->height);
     pImpl->camera->UpdateProjection();
+    pImpl->scheduler->RequestRedraw();
+}
+
+// Callback function for glutWindowStatusFunc.
+void ScreenManager::WindowStatusCB(int state) {
+    pImpl->scheduler->SetVisible(state != GLUT_HIDDEN && state != GLUT_FULLY_COVERED);
 }
 
 void ScreenManager::ProcessSpecialKeysCB(int key, int x, int y) {
-    // Light control.
+    // Light control. The simulation applies the move on its next tick.
+    if (pImpl->pointLightObj->light == nullptr) {
+        return;
+    }
     switch (key) {
     case GLUT_KEY_LEFT:
-        if (pImpl->pointLightObj->light != nullptr)
-            pImpl->pointLightObj->light->MoveLeft(pImpl->lightMoveSpeed);
+        pImpl->simulation->MovePointLight(pImpl->lightMoveSpeed * LIGHT_STEP_LEFT);
         break;
     case GLUT_KEY_RIGHT:
-        if (pImpl->pointLightObj->light != nullptr)
-            pImpl->pointLightObj->light->MoveRight(pImpl->lightMoveSpeed);
+        pImpl->simulation->MovePointLight(pImpl->lightMoveSpeed * LIGHT_STEP_RIGHT);
         break;
     case GLUT_KEY_UP:
-        if (pImpl->pointLightObj->light != nullptr)
-            pImpl->pointLightObj->light->MoveUp(pImpl->lightMoveSpeed);
+        pImpl->simulation->MovePointLight(pImpl->lightMoveSpeed * LIGHT_STEP_UP);
         break;
     case GLUT_KEY_DOWN:
-        if (pImpl->pointLightObj->light != nullptr)
-            pImpl->pointLightObj->light->MoveDown(pImpl->lightMoveSpeed);
+        pImpl->simulation->MovePointLight(pImpl->lightMoveSpeed * LIGHT_STEP_DOWN);
         break;
     default:
-        break;
+        return;
     }
+    pImpl->scheduler->RequestRedraw();
 }
 
 // Callback function for glutKeyboardFunc.
 void ScreenManager::ProcessKeysCB(unsigned char key, int x, int y) {
     // Handle other keyboard inputs those are not defined as special keys.
     if (key == 27) {
+        Shutdown();
         exit(0);
     }
 
+    // Pause or resume the rotation.
+    if (key == ' ') {
+        pImpl->simulation->ToggleRotation();
+    }
+
     // Spot light control.
     auto spotLight = pImpl->spotLightObj->light;
     if (spotLight != nullptr) {
         if (key == 'a')
-            spotLight->MoveLeft(pImpl->lightMoveSpeed);
+            pImpl->simulation->MoveSpotLight(pImpl->lightMoveSpeed * LIGHT_STEP_LEFT);
         if (key == 'd')
-            spotLight->MoveRight(pImpl->lightMoveSpeed);
+            pImpl->simulation->MoveSpotLight(pImpl->lightMoveSpeed * LIGHT_STEP_RIGHT);
         if (key == 'w')
-            spotLight->MoveUp(pImpl->lightMoveSpeed);
+            pImpl->simulation->MoveSpotLight(pImpl->lightMoveSpeed * LIGHT_STEP_UP);
         if (key == 's')
-            spotLight->MoveDown(pImpl->lightMoveSpeed);
+            pImpl->simulation->MoveSpotLight(pImpl->lightMoveSpeed * LIGHT_STEP_DOWN);
     }
+    pImpl->scheduler->RequestRedraw();
 }
 
 void ScreenManager::SetupFilesystem() {
-    // Load all obj files in the models directory.
-    for (const auto& entry : std::filesystem::directory_iterator("models")) {
-        if (entry.is_directory()) {
-            pImpl->objNames.push_back(entry.path().filename().string());
-        }
+    // Read the model catalog, and only walk the directories when a directory or model file changed.
+    pImpl->catalog = std::make_unique<ModelCatalog>("cache/model_catalog.bin");
+    Skybox::SetCacheDir("cache/skybox");
+    if (!pImpl->catalog->Load() || pImpl->catalog->IsStale("models", "textures")) {
+        pImpl->catalog->Refresh("models", "textures");
+        pImpl->catalog->Save();
     }
 
-    // find the minimum bytes size of the obj files and swap it to the first position
-    int min = INT_MAX;
-    int minIndex = 0;
-    for (int i = 0; i < pImpl->objNames.size(); i++) {
-        auto size = std::filesystem::file_size("models/" + pImpl->objNames[i] + "/" + pImpl->objNames[i] + ".obj");
-        if (size < min) {
-            min = size;
-            minIndex = i;
-        }
+    auto models = pImpl->catalog->GetModels();
+    if (models.empty()) {
+        std::cerr << "No model found in the models directory." << std::endl;
+        exit(EXIT_FAILURE);
     }
-    std::swap(pImpl->objNames[0], pImpl->objNames[minIndex]);
 
-    // Load all skybox textures in the textures directory.
-    for (const auto& entry : std::filesystem::directory_iterator("textures")) {
-        if (entry.is_regular_file()) {
-            pImpl->skyboxNames.push_back(entry.path().filename().string());
-        }
+    // find the minimum bytes size of the obj files and swap it to the first position
+    auto minModel = std::min_element(models.begin(), models.end(),
+        [](const ModelInfo& a, const ModelInfo& b) { return a.objBytes < b.objBytes; });
+    std::iter_swap(models.begin(), minModel);
+    for (const auto& info : models) {
+        pImpl->objNames.push_back(info.name);
+        pImpl->objFilePaths.push_back(info.objFilePath);
+        pImpl->objLoadHints.push_back(info.loadHint);
     }
+
+    pImpl->skyboxNames = pImpl->catalog->GetSkyboxNames();
+}
+
+void ScreenManager::SetupPrefetcher() {
+    pImpl->prefetcher = std::make_unique<ModelPrefetcher>(pImpl->objFilePaths, pImpl->objLoadHints, pImpl->prefetchByteBudget);
 }
 
 void ScreenManager::SetupRenderState() {
     glEnable(GL_DEPTH_TEST);
+    pImpl->depthPrepass = std::make_unique<DepthPrepass>();
+    pImpl->dynamicResolution = std::make_unique<DynamicResolution>(pImpl->width, pImpl->height, pImpl->targetFrameTimeMs);
+    pImpl->scheduler = std::make_unique<RenderScheduler>(pImpl->maxFrameRate);
+    pImpl->commandQueue = std::make_unique<CommandQueue>();
+    pImpl->frameCommands = std::make_unique<CommandList>();
+    UploadManager::GetInstance().SetFrameBudget(pImpl->uploadBytesPerFrame, pImpl->uploadMicrosecondsPerFrame);
+    TextureResidency::GetInstance().SetBudget(pImpl->textureBudgetBytes);
 
     glm::vec4 clearColor = glm::vec4(0.44f, 0.57f, 0.75f, 1.00f);
     glClearColor(
@@ -336,18 +560,60 @@ void ScreenManager::SetupRenderState() {
 // You can alter the parameters for dynamically loading a model.
 void ScreenManager::SetupScene(int objIndex) {
     glm::mat4x4 S = glm::scale(glm::mat4x4(1.0f), glm::vec3(1.5f, 1.5f, 1.5f));
-    pImpl->sceneObj->worldMatrix = S;
-    if (pImpl->sceneObj->mesh != nullptr) {
-        pImpl->sceneObj->mesh->ReleaseBuffers();
+    pImpl->scene->SetLocalMatrix(pImpl->modelNode, S);
+    auto& meshes = RenderResources::GetInstance().GetMeshes();
+    if (TriangleMesh* previous = meshes.Get(pImpl->scene->GetMesh(pImpl->modelNode))) {
+        previous->ReleaseBuffers();
+    }
+    pImpl->pointCloud.reset();
+
+    // A point cloud is drawn by its own renderer at the model node, which then holds no mesh.
+    if (pImpl->objFilePaths[objIndex].extension() == ".octree") {
+        pImpl->pointCloud = std::make_unique<PointCloud>(pImpl->objFilePaths[objIndex], true);
+        pImpl->pointCloud->CreateBuffers();
+        glm::vec3 boundsMin, boundsMax;
+        pImpl->pointCloud->GetBounds(boundsMin, boundsMax);
+        pImpl->scene->SetMesh(pImpl->modelNode, MeshHandle());
+        pImpl->scene->SetLocalBounds(pImpl->modelNode, boundsMin, boundsMax);
+        pImpl->prefetcher->SetCurrent(objIndex);
+        pImpl->depthPrepass->Reset();
+
+        pImpl->pointCloud->PrintInfo();
+
+        pImpl->simulation->ResetModelRotation();
+        pImpl->scheduler->RequestRedraw();
+        return;
     }
-    auto objBasePath = std::filesystem::path("models");
-    auto objFilePath = objBasePath / pImpl->objNames[objIndex] / (pImpl->objNames[objIndex] + ".obj");
-    pImpl->sceneObj->mesh = std::make_shared<TriangleMesh>(objFilePath, true);
-    pImpl->sceneObj->mesh->CreateBuffers();
-
-    pImpl->sceneObj->mesh->PrintMeshInfo();
 
-    pImpl->clock.Reset();
+    // A prefetched model only needs the GPU upload.
+    MeshHandle meshHandle = pImpl->prefetcher->Acquire(objIndex);
+    if (!meshHandle.IsValid()) {
+        pImpl->prefetcher->BeginForegroundLoad();
+        meshHandle = meshes.Create(pImpl->objFilePaths[objIndex], true, pImpl->objLoadHints[objIndex]);
+        pImpl->prefetcher->EndForegroundLoad();
+        pImpl->prefetcher->Insert(objIndex, meshHandle);
+    }
+    TriangleMesh* mesh = meshes.Get(meshHandle);
+    if (mesh == nullptr) {
+        // Every mesh slot is in use; show nothing rather than a mesh that was released.
+        std::cerr << "[ERROR] No free mesh slot for " << pImpl->objFilePaths[objIndex] << std::endl;
+        pImpl->scene->SetMesh(pImpl->modelNode, MeshHandle());
+        pImpl->prefetcher->SetCurrent(objIndex);
+        pImpl->scheduler->RequestRedraw();
+        return;
+    }
+    mesh->CreateBuffers();
+    glm::vec3 boundsMin, boundsMax;
+    mesh->GetBounds(boundsMin, boundsMax);
+    pImpl->scene->SetMesh(pImpl->modelNode, meshHandle);
+    pImpl->scene->SetLocalBounds(pImpl->modelNode, boundsMin, boundsMax);
+    pImpl->prefetcher->SetCurrent(objIndex);
+    pImpl->depthPrepass->Reset();
+
+    mesh->PrintMeshInfo();
+
+    pImpl->simulation->ResetModelRotation();
+    pImpl->scheduler->RequestRedraw();
 }
 
 void ScreenManager::SetupLights() {
@@ -360,7 +626,7 @@ void ScreenManager::SetupLights() {
     glm::vec3 spotLightIntensity = glm::vec3(0.5f, 0.5f, 0.1f);
     float spotLightCutoffStartInDegree = 30.0f;
     float spotLightTotalWidthInDegree = 45.0f;
-    glm::vec3 ambientLight = glm::vec3(0.2f, 0.2f, 0.2f);
+    glm::vec3 ambientLight = glm::vec3(0.2f, 0.2f, 0.2f);   // Until the first skybox is loaded.
     pImpl->dirLight = std::make_unique<DirectionalLight>(dirLightDirection, dirLightRadiance);
     pImpl->pointLightObj->light = std::make_shared<PointLight>(pointLightPosition, pointLightIntensity);
     pImpl->pointLightObj->visColor = glm::normalize((pImpl->pointLightObj->light->GetIntensity()));
@@ -372,6 +638,15 @@ void ScreenManager::SetupLights() {
         spotLightTotalWidthInDegree);
     pImpl->spotLightObj->visColor = glm::normalize((pImpl->spotLightObj->light->GetIntensity()));
     pImpl->ambientLight = ambientLight;
+    pImpl->lightBlock = std::make_shared<LightBlock>();
+}
+
+void ScreenManager::SetupSimulation() {
+    SimulationState initialState;
+    initialState.rotating = true;
+    initialState.pointLightPosition = pImpl->pointLightObj->light->GetPosition();
+    initialState.spotLightPosition = pImpl->spotLightObj->light->GetPosition();
+    pImpl->simulation = std::make_unique<Simulation>(initialState, pImpl->simulationTickRate);
 }
 
 void ScreenManager::SetupCamera() {
@@ -390,31 +665,62 @@ void ScreenManager::SetupCamera() {
     pImpl->camera->UpdateProjection();
 }
 
+// Desc: Load the skybox in the background; the current one stays up until it is ready.
 void ScreenManager::SetupSkybox(int skyboxIndex) {
-    const int numSlices = 36;
-    const int numStacks = 18;
-    const float radius = 50.0f;
     auto skyboxDir = std::filesystem::path("textures") / pImpl->skyboxNames[skyboxIndex];
-    pImpl->skybox = std::make_shared<Skybox>(skyboxDir, numSlices, numStacks, radius);
+    pImpl->pendingSkybox = std::make_shared<Skybox>(skyboxDir);
 }
 
+// Programs are only submitted here; the driver compiles them while the
+// skybox and the first model load, and each one is finished on first Bind().
 void ScreenManager::SetupShaderLib() {
+    Clock setupClock;
+    ShaderProg::SetBinaryCacheDir("cache/shaders");
+    ShaderProg::SetMaxCompilerThreads();
+
     pImpl->fillColorShader = std::make_unique<FillColorShaderProg>();
-    pImpl->phongShader = std::make_unique<PhongShadingDemoShaderProg>();
+    pImpl->depthShader = std::make_unique<DepthOnlyShaderProg>();
+    pImpl->phongShaders = std::make_shared<PhongShaderVariants>(
+        "shaders/phong_shading_demo.vs", "shaders/phong_shading_demo.fs", "shaders/face_culling.gs");
     pImpl->skyboxShader = std::make_unique<SkyboxShaderProg>();
+    pImpl->upscaleShader = std::make_unique<UpscaleShaderProg>();
+    pImpl->pointCloudShader = std::make_unique<PointCloudShaderProg>();
 
-    if (!pImpl->fillColorShader->LoadFromFiles("shaders/fixed_color.vs", "shaders/fixed_color.fs", "")) {
+    if (!pImpl->fillColorShader->Submit("shaders/fixed_color.vs", "shaders/fixed_color.fs", "")) {
         std::cerr << "Failed to load fixed_color shader." << std::endl;
         exit(EXIT_FAILURE);
     }
-    if (!pImpl->phongShader->LoadFromFiles("shaders/phong_shading_demo.vs", "shaders/phong_shading_demo.fs", "shaders/face_culling.gs")) {
+    if (!pImpl->depthShader->Submit("shaders/depth_only.vs", "shaders/depth_only.fs", "")) {
+        std::cerr << "Failed to load depth_only shader." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    // Variants for the default light setup, with and without texture and specular.
+    const unsigned int allLights = PHONG_HAS_DIR_LIGHT | PHONG_HAS_POINT_LIGHT | PHONG_HAS_SPOT_LIGHT;
+    if (!pImpl->phongShaders->Prewarm({
+        allLights,
+        allLights | PHONG_HAS_TEXTURE,
+        allLights | PHONG_HAS_SPECULAR,
+        allLights | PHONG_HAS_TEXTURE | PHONG_HAS_SPECULAR,
+        allLights | PHONG_HAS_MATERIAL_TABLE,
+        allLights | PHONG_HAS_MATERIAL_TABLE | PHONG_HAS_SPECULAR,
+        allLights | PHONG_FACE_NORMALS })) {
         std::cerr << "Failed to load gouraud shader." << std::endl;
         exit(EXIT_FAILURE);
     }
-    if (!pImpl->skyboxShader->LoadFromFiles("shaders/skybox.vs", "shaders/skybox.fs", "")) {
+    if (!pImpl->skyboxShader->Submit("shaders/skybox.vs", "shaders/skybox.fs", "")) {
         std::cerr << "Failed to load skybox shader." << std::endl;
         exit(EXIT_FAILURE);
     }
+    if (!pImpl->upscaleShader->Submit("shaders/upscale.vs", "shaders/upscale.fs", "")) {
+        std::cerr << "Failed to load upscale shader." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (!pImpl->pointCloudShader->Submit("shaders/point_cloud.vs", "shaders/point_cloud.fs", "")) {
+        std::cerr << "Failed to load point_cloud shader." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::cout << "[*] Shader submit: " << setupClock.GetElapsedTime() * 1000.0 << " ms" << std::endl;
 }
 
 void ScreenManager::SetupMenu() {
@@ -444,6 +750,8 @@ void ScreenManager::ObjectMenuCB(int value) {
 
 void ScreenManager::SkyboxMenuCB(int value) {
     SetupSkybox(value - 1);
+    pImpl->simulation->ResetSkyboxRotation();
+    pImpl->scheduler->RequestRedraw();
 }
 
 } // namespace opengl_homework
\ No newline at end of file
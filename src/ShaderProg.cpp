@@ -2,9 +2,17 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+#include "Hash.h"
+#include "LightBlock.h"
 
 #define MAX_BUFFER_SIZE 1024
 
+std::filesystem::path ShaderProg::binaryCacheDir = "";
+
 ShaderProg::ShaderProg() {
     // Create OpenGL shader program.
     shaderProgId = glCreateProgram();
@@ -14,6 +22,9 @@ ShaderProg::ShaderProg() {
     }
     // locM = locV = locP = -1;
     locMVP = -1;
+    loadedFromCache = false;
+    pending = false;
+    stageIds[0] = stageIds[1] = stageIds[2] = 0;
 }
 
 ShaderProg::~ShaderProg() {
@@ -21,46 +32,115 @@ ShaderProg::~ShaderProg() {
 }
 
 bool ShaderProg::LoadFromFiles(const std::filesystem::path& vsFilePath, const std::filesystem::path& fsFilePath, const std::filesystem::path& gsFilePath) {
-    // Load the vertex shader from a source file and attach it to the shader program.
-    std::string vs, fs, gs;
+    return Submit(vsFilePath, fsFilePath, gsFilePath) && Finish();
+}
+
+bool ShaderProg::Submit(const std::filesystem::path& vsFilePath, const std::filesystem::path& fsFilePath, const std::filesystem::path& gsFilePath, const std::string& defines) {
+    // Load all shader sources first, they are also the key of the binary cache.
+    std::string& vs = sources[0];
+    std::string& fs = sources[1];
+    std::string& gs = sources[2];
     if (!LoadShaderTextFromFile(vsFilePath, vs)) {
         std::cerr << "[ERROR] Failed to load vertex shader source: " << vsFilePath << std::endl;
         return false;
     }
-    GLuint vsId = AddShader(vs, GL_VERTEX_SHADER);
-
-    // Load the fragment shader from a source file and attach it to the shader program.
     if (!LoadShaderTextFromFile(fsFilePath, fs)) {
         std::cerr << "[ERROR] Failed to load vertex shader source: " << fsFilePath << std::endl;
         return false;
     };
-    GLuint fsId = AddShader(fs, GL_FRAGMENT_SHADER);
-
-    GLuint gsId = 0;
+    gs.clear();
     if (!gsFilePath.empty()) {
         if (!LoadShaderTextFromFile(gsFilePath, gs)) {
             std::cerr << "[ERROR] Failed to load vertex shader source: " << gsFilePath << std::endl;
             return false;
         };
-        gsId = AddShader(gs, GL_GEOMETRY_SHADER);
+    }
+    for (auto& source : sources) {
+        InjectDefines(defines, source);
+    }
+    pending = true;
+
+    // Try the program binary cache before compiling anything.
+    binaryFilePath.clear();
+    if (!binaryCacheDir.empty() && GLEW_ARB_get_program_binary) {
+        binaryFilePath = GetBinaryFilePath(vs, fs, gs);
+        if (SubmitProgramBinary(binaryFilePath)) {
+            loadedFromCache = true;
+            return true;
+        }
+    }
+
+    SubmitSources();
+    return true;
+}
+
+// Desc: Issue compile and link without querying any status, so the driver can work in the background.
+void ShaderProg::SubmitSources() {
+    if (!binaryFilePath.empty()) {
+        // Ask the driver to keep the binary around so it can be saved after linking.
+        glProgramParameteri(shaderProgId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // Compile each stage and attach it to the shader program.
+    const GLenum shaderTypes[3] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+    for (int i = 0; i < 3; ++i) {
+        stageIds[i] = sources[i].empty() ? 0 : AddShader(sources[i], shaderTypes[i]);
     }
 
-    // Link and compile shader programs.
+    // Link shader programs.
+    glLinkProgram(shaderProgId);
+}
+
+bool ShaderProg::IsReady() const {
+    if (!pending) {
+        return true;
+    }
+    // Without the extension any status query blocks and nothing can be polled, so report ready
+    // and let Finish() wait once; a status that never arrives would hold the program back forever.
+    if (!GLEW_KHR_parallel_shader_compile) {
+        return true;
+    }
+    GLint completed = GL_FALSE;
+    glGetProgramiv(shaderProgId, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+bool ShaderProg::Finish() {
+    if (!pending) {
+        return true;
+    }
+    pending = false;
+
     GLint success = 0;
     GLchar errorLog[MAX_BUFFER_SIZE] = { 0 };
-    glLinkProgram(shaderProgId);
     glGetProgramiv(shaderProgId, GL_LINK_STATUS, &success);
+    if (success == 0 && loadedFromCache) {
+        // Driver update or corrupted file, fall back to compiling from source.
+        std::cerr << "[WARNING] Stale shader binary, recompiling: " << binaryFilePath << std::endl;
+        std::error_code ec;
+        std::filesystem::remove(binaryFilePath, ec);
+        loadedFromCache = false;
+        SubmitSources();
+        glGetProgramiv(shaderProgId, GL_LINK_STATUS, &success);
+    }
     if (success == 0) {
+        for (int i = 0; i < 3; ++i) {
+            if (stageIds[i] != 0) {
+                CheckCompileStatus(stageIds[i]);
+            }
+        }
         glGetProgramInfoLog(shaderProgId, sizeof(errorLog), NULL, errorLog);
         std::cerr << "[ERROR] Failed to link shader program: " << errorLog << std::endl;
         return false;
     }
 
     // Now the program already has all stage information, we can delete the shaders now.
-    glDeleteShader(vsId);
-    glDeleteShader(fsId);
-    if (gsId != 0) {
-        glDeleteShader(gsId);
+    for (int i = 0; i < 3; ++i) {
+        if (stageIds[i] != 0) {
+            glDetachShader(shaderProgId, stageIds[i]);
+            glDeleteShader(stageIds[i]);
+            stageIds[i] = 0;
+        }
     }
 
     // Validate program.
@@ -72,12 +152,100 @@ bool ShaderProg::LoadFromFiles(const std::filesystem::path& vsFilePath, const st
         return false;
     }
 
+    if (!loadedFromCache && !binaryFilePath.empty()) {
+        SaveProgramBinary(binaryFilePath);
+    }
+    for (auto& source : sources) {
+        source.clear();
+    }
+
     // Update the location of uniform variables.
     GetUniformVariableLocation();
 
     return true;
 }
 
+void ShaderProg::Bind() {
+    // The first use of a submitted program waits for the driver.
+    if (pending && !Finish()) {
+        std::cerr << "[ERROR] Failed to finish shader program " << shaderProgId << std::endl;
+        exit(1);
+    }
+    glUseProgram(shaderProgId);
+}
+
+void ShaderProg::SetMaxCompilerThreads() {
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+}
+
+void ShaderProg::SetBinaryCacheDir(const std::filesystem::path& cacheDir) {
+    binaryCacheDir = cacheDir;
+    if (!binaryCacheDir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(binaryCacheDir, ec);
+    }
+}
+
+// Desc: Cache file named after the sources and the driver that produced the binary.
+std::filesystem::path ShaderProg::GetBinaryFilePath(const std::string& vs, const std::string& fs, const std::string& gs) {
+    uint64_t hash = opengl_homework::HashBytes(vs);
+    hash = opengl_homework::HashBytes(fs, hash);
+    hash = opengl_homework::HashBytes(gs, hash);
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        const char* value = (const char*)glGetString(name);
+        hash = opengl_homework::HashBytes(std::string(value != nullptr ? value : ""), hash);
+    }
+    std::ostringstream fileName;
+    fileName << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+    return binaryCacheDir / fileName.str();
+}
+
+// Desc: Hand a cached binary to the driver. Whether it is accepted is checked in Finish().
+bool ShaderProg::SubmitProgramBinary(const std::filesystem::path& binaryFilePath) {
+    std::ifstream fin(binaryFilePath, std::ios::binary);
+    if (!fin) {
+        return false;
+    }
+    GLenum binaryFormat = 0;
+    if (!fin.read(reinterpret_cast<char*>(&binaryFormat), sizeof(binaryFormat))) {
+        return false;
+    }
+    const std::streamoff blobStart = fin.tellg();
+    fin.seekg(0, std::ios::end);
+    const std::streamoff blobEnd = fin.tellg();
+    if (!fin || blobEnd <= blobStart) {
+        return false;
+    }
+    std::vector<char> binary((size_t)(blobEnd - blobStart));
+    fin.seekg(blobStart);
+    if (!fin.read(binary.data(), (std::streamsize)binary.size())) {
+        return false;
+    }
+
+    glProgramBinary(shaderProgId, binaryFormat, binary.data(), (GLsizei)binary.size());
+    return true;
+}
+
+void ShaderProg::SaveProgramBinary(const std::filesystem::path& binaryFilePath) {
+    GLint binaryLength = 0;
+    glGetProgramiv(shaderProgId, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if (binaryLength <= 0) {
+        return;
+    }
+    std::vector<char> binary(binaryLength);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(shaderProgId, binaryLength, NULL, &binaryFormat, binary.data());
+
+    std::ofstream fout(binaryFilePath, std::ios::binary | std::ios::trunc);
+    fout.write(reinterpret_cast<const char*>(&binaryFormat), sizeof(binaryFormat));
+    fout.write(binary.data(), binary.size());
+    if (!fout) {
+        std::cerr << "[WARNING] Failed to write shader binary: " << binaryFilePath << std::endl;
+    }
+}
+
 void ShaderProg::GetUniformVariableLocation() {
     locMVP = glGetUniformLocation(shaderProgId, "MVP");
 }
@@ -96,18 +264,36 @@ GLuint ShaderProg::AddShader(const std::string& sourceText, GLenum shaderType) {
     glShaderSource(shaderObj, 1, p, lengths);
     glCompileShader(shaderObj);
 
+    glAttachShader(shaderProgId, shaderObj);
+
+    return shaderObj;
+}
+
+// Desc: Print the compile log of a stage. Only called after a failed link since the query blocks.
+void ShaderProg::CheckCompileStatus(GLuint shaderObj) {
     GLint success;
     glGetShaderiv(shaderObj, GL_COMPILE_STATUS, &success);
     if (!success) {
+        GLint shaderType = 0;
+        glGetShaderiv(shaderObj, GL_SHADER_TYPE, &shaderType);
         GLchar infoLog[MAX_BUFFER_SIZE];
         glGetShaderInfoLog(shaderObj, MAX_BUFFER_SIZE, NULL, infoLog);
         std::cerr << "[ERROR] Failed to compile shader with type: " << shaderType << ". Info: " << infoLog << std::endl;
-        exit(1);
     }
+}
 
-    glAttachShader(shaderProgId, shaderObj);
-
-    return shaderObj;
+// Desc: Insert the defines right after the #version line, which must stay first.
+void ShaderProg::InjectDefines(const std::string& defines, std::string& sourceText) {
+    if (defines.empty() || sourceText.empty()) {
+        return;
+    }
+    size_t insertPos = 0;
+    size_t versionPos = sourceText.find("#version");
+    if (versionPos != std::string::npos) {
+        insertPos = sourceText.find('\n', versionPos);
+        insertPos = (insertPos == std::string::npos) ? sourceText.size() : insertPos + 1;
+    }
+    sourceText.insert(insertPos, defines);
 }
 
 bool ShaderProg::LoadShaderTextFromFile(const std::filesystem::path& filePath, std::string& sourceText) {
@@ -134,6 +320,18 @@ void FillColorShaderProg::GetUniformVariableLocation() {
     locFillColor = glGetUniformLocation(shaderProgId, "fillColor");
 }
 
+// ------------------------------------------------------------------------------------------------
+
+DepthOnlyShaderProg::DepthOnlyShaderProg() {
+}
+
+DepthOnlyShaderProg::~DepthOnlyShaderProg() {
+}
+
+void DepthOnlyShaderProg::GetUniformVariableLocation() {
+    ShaderProg::GetUniformVariableLocation();
+}
+
 // ------------------------------------------------------------------------------------------------
 PhongShadingDemoShaderProg::PhongShadingDemoShaderProg() {
     locM = -1;
@@ -144,16 +342,7 @@ PhongShadingDemoShaderProg::PhongShadingDemoShaderProg() {
     locKs = -1;
     locNs = -1;
     locMapKd = -1;
-    locAmbientLight = -1;
-    locDirLightDir = -1;
-    locDirLightRadiance = -1;
-    locPointLightPos = -1;
-    locPointLightIntensity = -1;
-    locSpotLightPos = -1;
-    locSpotLightDir = -1;
-    locSpotLightIntensity = -1;
-    locSpotLightCutoff = -1;
-    locSpotLightTotalWidth = -1;
+    locMapKdArray = -1;
 }
 
 PhongShadingDemoShaderProg::~PhongShadingDemoShaderProg() {
@@ -170,23 +359,123 @@ void PhongShadingDemoShaderProg::GetUniformVariableLocation() {
     locKs = glGetUniformLocation(shaderProgId, "Ks");
     locNs = glGetUniformLocation(shaderProgId, "Ns");
     locMapKd = glGetUniformLocation(shaderProgId, "mapKd");
-    locDirLightDir = glGetUniformLocation(shaderProgId, "dirLightDir");
-    locDirLightRadiance = glGetUniformLocation(shaderProgId, "dirLightRadiance");
-    locPointLightPos = glGetUniformLocation(shaderProgId, "pointLightPos");
-    locPointLightIntensity = glGetUniformLocation(shaderProgId, "pointLightIntensity");
-    locSpotLightPos = glGetUniformLocation(shaderProgId, "spotLightPos");
-    locSpotLightDir = glGetUniformLocation(shaderProgId, "spotLightDir");
-    locSpotLightIntensity = glGetUniformLocation(shaderProgId, "spotLightIntensity");
-    locSpotLightCutoff = glGetUniformLocation(shaderProgId, "spotLightCutoff");
-    locSpotLightTotalWidth = glGetUniformLocation(shaderProgId, "spotLightTotalWidth");
-    locAmbientLight = glGetUniformLocation(shaderProgId, "ambientLight");
+    locMapKdArray = glGetUniformLocation(shaderProgId, "mapKdArray");
+    GLuint lightBlockIndex = glGetUniformBlockIndex(shaderProgId, "LightBlock");
+    if (lightBlockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shaderProgId, lightBlockIndex, LightBlock::BINDING_POINT);
+    }
+    GLuint materialBlockIndex = glGetUniformBlockIndex(shaderProgId, "MaterialBlock");
+    if (materialBlockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shaderProgId, materialBlockIndex, MATERIAL_TABLE_BINDING_POINT);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+
+PhongShaderVariants::PhongShaderVariants(const std::filesystem::path& vsFilePath, const std::filesystem::path& fsFilePath,
+    const std::filesystem::path& gsFilePath)
+    : vsFilePath(vsFilePath), fsFilePath(fsFilePath), gsFilePath(gsFilePath) {
+}
+
+PhongShaderVariants::~PhongShaderVariants() {
+}
+
+PhongShadingDemoShaderProg* PhongShaderVariants::Get(const unsigned int features) {
+    auto it = variants.find(features);
+    if (it != variants.end()) {
+        return it->second.get();
+    }
+
+    auto shader = std::make_unique<PhongShadingDemoShaderProg>();
+    if (!shader->Submit(vsFilePath, fsFilePath, gsFilePath, GetDefines(features))) {
+        std::cerr << "[ERROR] Failed to load phong shader variant " << features << std::endl;
+        return nullptr;
+    }
+    auto* result = shader.get();
+    variants[features] = std::move(shader);
+    return result;
+}
+
+bool PhongShaderVariants::Prewarm(const std::vector<unsigned int>& featureMasks) {
+    for (unsigned int features : featureMasks) {
+        if (Get(features) == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int PhongShaderVariants::GetNumLoadedFromCache() const {
+    int numCached = 0;
+    for (const auto& [features, shader] : variants) {
+        numCached += shader->IsLoadedFromCache() ? 1 : 0;
+    }
+    return numCached;
+}
+
+std::string PhongShaderVariants::GetDefines(const unsigned int features) {
+    std::string defines;
+    if (features & PHONG_HAS_TEXTURE)
+        defines += "#define HAS_TEXTURE\n";
+    if (features & PHONG_HAS_DIR_LIGHT)
+        defines += "#define HAS_DIR_LIGHT\n";
+    if (features & PHONG_HAS_POINT_LIGHT)
+        defines += "#define HAS_POINT_LIGHT\n";
+    if (features & PHONG_HAS_SPOT_LIGHT)
+        defines += "#define HAS_SPOT_LIGHT\n";
+    if (features & PHONG_HAS_SPECULAR)
+        defines += "#define HAS_SPECULAR\n";
+    if (features & PHONG_HAS_MATERIAL_TABLE)
+        defines += "#define HAS_MATERIAL_TABLE\n";
+    if (features & PHONG_FACE_NORMALS)
+        defines += "#define FACE_NORMALS\n";
+    return defines;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+UpscaleShaderProg::UpscaleShaderProg() {
+    locSourceTex = -1;
+    locUvScale = -1;
+    locTexelSize = -1;
+    locSharpness = -1;
+}
+
+UpscaleShaderProg::~UpscaleShaderProg() {
+}
+
+void UpscaleShaderProg::GetUniformVariableLocation() {
+    ShaderProg::GetUniformVariableLocation();
+    locSourceTex = glGetUniformLocation(shaderProgId, "sourceTex");
+    locUvScale = glGetUniformLocation(shaderProgId, "uvScale");
+    locTexelSize = glGetUniformLocation(shaderProgId, "texelSize");
+    locSharpness = glGetUniformLocation(shaderProgId, "sharpness");
+}
+
+// ------------------------------------------------------------------------------------------------
+
+PointCloudShaderProg::PointCloudShaderProg()
+{
+    locScreenScale = -1;
+    locPointSpacing = -1;
+}
+
+PointCloudShaderProg::~PointCloudShaderProg()
+{}
+
+void PointCloudShaderProg::GetUniformVariableLocation()
+{
+    ShaderProg::GetUniformVariableLocation();
+    locScreenScale = glGetUniformLocation(shaderProgId, "screenScale");
+    locPointSpacing = glGetUniformLocation(shaderProgId, "pointSpacing");
 }
 
 // ------------------------------------------------------------------------------------------------
 
 SkyboxShaderProg::SkyboxShaderProg()
 {
-    locMapKd = -1;
+    locInvViewProj = -1;
+    locCubeMap = -1;
 }
 
 SkyboxShaderProg::~SkyboxShaderProg()
@@ -195,5 +484,6 @@ SkyboxShaderProg::~SkyboxShaderProg()
 void SkyboxShaderProg::GetUniformVariableLocation()
 {
     ShaderProg::GetUniformVariableLocation();
-    locMapKd = glGetUniformLocation(shaderProgId, "mapKd");
+    locInvViewProj = glGetUniformLocation(shaderProgId, "invViewProj");
+    locCubeMap = glGetUniformLocation(shaderProgId, "cubeMap");
 }
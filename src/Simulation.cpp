@@ -0,0 +1,271 @@
+#include "Simulation.h"
+
+// GLM headers.
+#include <glm/gtc/constants.hpp>
+
+// C++ STL headers.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace opengl_homework {
+
+using SteadyClock = std::chrono::steady_clock;
+
+// Simulation Private Declarations.
+enum class SimulationCommandType
+{
+	MOVE_POINT_LIGHT,
+	MOVE_SPOT_LIGHT,
+	TOGGLE_ROTATION,
+	RESET_MODEL_ROTATION,
+	RESET_SKYBOX_ROTATION
+};
+
+struct SimulationCommand
+{
+	SimulationCommandType type;
+	glm::vec3 offset;
+	uint64_t sequence;
+};
+
+// The two latest ticks travel together so the render thread always
+// interpolates between consecutive ticks, however many it missed.
+struct SimulationTicks
+{
+	SimulationState previous;
+	SimulationState current;
+};
+
+static float WrapAngle(const float angle) {
+	return std::fmod(angle, glm::two_pi<float>());
+}
+
+// Desc: Interpolate along the shorter arc, so wrapping at 2*pi does not spin backwards.
+static float LerpAngle(const float a, const float b, const float t) {
+	float delta = std::remainder(b - a, glm::two_pi<float>());
+	return WrapAngle(a + delta * t);
+}
+
+static bool StatesDiffer(const SimulationState& a, const SimulationState& b) {
+	return a.modelRotation != b.modelRotation || a.skyboxRotation != b.skyboxRotation
+		|| a.pointLightPosition != b.pointLightPosition || a.spotLightPosition != b.spotLightPosition;
+}
+
+struct Simulation::Impl {
+	static constexpr uint32_t NEW_TICKS = 4;
+	static constexpr uint32_t INDEX_MASK = 3;
+
+	double tickInterval;
+	float rotationSpeed = 0.1f;		// Radians per second.
+	SteadyClock::time_point startTime;
+
+	// Simulation thread only.
+	SimulationTicks ticks;
+
+	// Input queue.
+	std::mutex inputMutex;
+	std::condition_variable inputCv;
+	std::vector<SimulationCommand> pendingCommands;
+	uint64_t nextSequence = 0;
+	std::atomic<uint64_t> submittedSequence = 0;
+	bool stop = false;
+
+	// Triple buffer: the writer owns back, the reader owns front, and
+	// middle is swapped atomically together with a "new ticks" flag.
+	SimulationTicks slots[3];
+	std::atomic<uint32_t> middle = 1;
+	uint32_t back = 2;
+	uint32_t front = 0;
+
+	// Render thread only.
+	SimulationTicks latest;
+	bool settled = true;
+
+	std::thread thread;
+
+	double Seconds(const SteadyClock::time_point t) const {
+		return std::chrono::duration<double>(t - startTime).count();
+	}
+
+	void Submit(const SimulationCommandType type, const glm::vec3& offset) {
+		{
+			std::lock_guard<std::mutex> lock(inputMutex);
+			pendingCommands.push_back({ type, offset, ++nextSequence });
+			submittedSequence.store(nextSequence, std::memory_order_release);
+		}
+		inputCv.notify_one();
+	}
+
+	void Apply(const SimulationCommand& command) {
+		SimulationState& state = ticks.current;
+		switch (command.type) {
+		case SimulationCommandType::MOVE_POINT_LIGHT:
+			state.pointLightPosition += command.offset;
+			break;
+		case SimulationCommandType::MOVE_SPOT_LIGHT:
+			state.spotLightPosition += command.offset;
+			break;
+		case SimulationCommandType::TOGGLE_ROTATION:
+			state.rotating = !state.rotating;
+			break;
+		case SimulationCommandType::RESET_MODEL_ROTATION:
+			// Snap instead of interpolating back to 0.
+			state.modelRotation = 0.0f;
+			ticks.previous.modelRotation = 0.0f;
+			break;
+		case SimulationCommandType::RESET_SKYBOX_ROTATION:
+			state.skyboxRotation = 0.0f;
+			ticks.previous.skyboxRotation = 0.0f;
+			break;
+		}
+		state.inputSequence = command.sequence;
+	}
+
+	void Step(const std::vector<SimulationCommand>& commands, const SteadyClock::time_point tickTime) {
+		ticks.previous = ticks.current;
+		for (const auto& command : commands) {
+			Apply(command);
+		}
+		SimulationState& state = ticks.current;
+		if (state.rotating) {
+			const float angle = rotationSpeed * (float)tickInterval;
+			state.modelRotation = WrapAngle(state.modelRotation + angle);
+			state.skyboxRotation = WrapAngle(state.skyboxRotation + angle);
+		}
+		state.time = Seconds(tickTime);
+	}
+
+	void Publish() {
+		slots[back] = ticks;
+		back = middle.exchange(back | NEW_TICKS, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	bool Consume() {
+		if ((middle.load(std::memory_order_relaxed) & NEW_TICKS) == 0) {
+			return false;
+		}
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+		latest = slots[front];
+		return true;
+	}
+};
+
+Simulation::Simulation(const SimulationState& initialState, const double tickRate) {
+	pImpl = std::make_unique<Impl>();
+	pImpl->tickInterval = 1.0 / tickRate;
+	pImpl->startTime = SteadyClock::now();
+	pImpl->ticks.previous = pImpl->ticks.current = initialState;
+	for (auto& slot : pImpl->slots) {
+		slot = pImpl->ticks;
+	}
+	pImpl->latest = pImpl->ticks;
+	pImpl->thread = std::thread([this]() { ThreadLoop(); });
+}
+
+Simulation::~Simulation() {
+	{
+		std::lock_guard<std::mutex> lock(pImpl->inputMutex);
+		pImpl->stop = true;
+	}
+	pImpl->inputCv.notify_all();
+	if (pImpl->thread.joinable()) {
+		pImpl->thread.join();
+	}
+}
+
+void Simulation::MovePointLight(const glm::vec3& offset) {
+	pImpl->Submit(SimulationCommandType::MOVE_POINT_LIGHT, offset);
+}
+
+void Simulation::MoveSpotLight(const glm::vec3& offset) {
+	pImpl->Submit(SimulationCommandType::MOVE_SPOT_LIGHT, offset);
+}
+
+void Simulation::ToggleRotation() {
+	pImpl->Submit(SimulationCommandType::TOGGLE_ROTATION, glm::vec3(0.0f));
+}
+
+void Simulation::ResetModelRotation() {
+	pImpl->Submit(SimulationCommandType::RESET_MODEL_ROTATION, glm::vec3(0.0f));
+}
+
+void Simulation::ResetSkyboxRotation() {
+	pImpl->Submit(SimulationCommandType::RESET_SKYBOX_ROTATION, glm::vec3(0.0f));
+}
+
+SimulationState Simulation::Sample() {
+	pImpl->Consume();
+	const SimulationState& a = pImpl->latest.previous;
+	const SimulationState& b = pImpl->latest.current;
+
+	// Render one tick in the past so there is always a tick on each side.
+	const double renderTime = pImpl->Seconds(SteadyClock::now()) - pImpl->tickInterval;
+	const double span = b.time - a.time;
+	const float t = span > 0.0 ? (float)std::clamp((renderTime - a.time) / span, 0.0, 1.0) : 1.0f;
+
+	SimulationState state = b;
+	state.time = a.time + span * t;
+	state.modelRotation = LerpAngle(a.modelRotation, b.modelRotation, t);
+	state.skyboxRotation = LerpAngle(a.skyboxRotation, b.skyboxRotation, t);
+	state.pointLightPosition = glm::mix(a.pointLightPosition, b.pointLightPosition, t);
+	state.spotLightPosition = glm::mix(a.spotLightPosition, b.spotLightPosition, t);
+
+	const uint64_t submitted = pImpl->submittedSequence.load(std::memory_order_acquire);
+	pImpl->settled = b.inputSequence >= submitted && (t >= 1.0f || !StatesDiffer(a, b));
+	return state;
+}
+
+bool Simulation::IsSettled() const {
+	return pImpl->settled;
+}
+
+double Simulation::GetTickInterval() const {
+	return pImpl->tickInterval;
+}
+
+// Desc: Tick at a fixed rate while anything moves; sleep until the next input otherwise.
+void Simulation::ThreadLoop() {
+	const auto interval = std::chrono::duration_cast<SteadyClock::duration>(
+		std::chrono::duration<double>(pImpl->tickInterval));
+	auto nextTick = SteadyClock::now();
+	std::vector<SimulationCommand> commands;
+
+	std::unique_lock<std::mutex> lock(pImpl->inputMutex);
+	while (true) {
+		const bool idle = !pImpl->ticks.current.rotating && !StatesDiffer(pImpl->ticks.previous, pImpl->ticks.current);
+		if (idle) {
+			pImpl->inputCv.wait(lock, [&]() { return pImpl->stop || !pImpl->pendingCommands.empty(); });
+			nextTick = SteadyClock::now();
+		}
+		else {
+			nextTick += interval;
+			pImpl->inputCv.wait_until(lock, nextTick, [&]() { return pImpl->stop; });
+		}
+		if (pImpl->stop) {
+			break;
+		}
+
+		// Drop the backlog after a stall instead of running a burst of catch-up ticks.
+		const auto now = SteadyClock::now();
+		if (now - nextTick > 4 * interval) {
+			nextTick = now;
+		}
+
+		commands.clear();
+		commands.swap(pImpl->pendingCommands);
+		lock.unlock();
+
+		pImpl->Step(commands, nextTick);
+		pImpl->Publish();
+
+		lock.lock();
+	}
+}
+
+} // namespace opengl_homework
@@ -3,110 +3,328 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-Skybox::Skybox(const std::filesystem::path& texImagePath, const int nSlices, const int nStacks, const float radius) {
+// OpenCV headers.
+#include <opencv2/opencv.hpp>
+
+// C++ STL headers.
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// SIMD headers.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SKYBOX_USE_SSE
+#endif
+
+// Project headers.
+#include "Clock.h"
+#include "Hash.h"
+
+static constexpr uint32_t FACE_CACHE_MAGIC = 0x43594B53;	// "SKYC".
+static constexpr uint32_t FACE_CACHE_VERSION = 2;
+// Faces get a quarter of the panorama width, the texel density of its equator.
+static constexpr int MIN_FACE_SIZE = 16;
+static constexpr int MAX_FACE_SIZE = 2048;
+// Rows of one face resampled per job.
+static constexpr size_t FACE_ROWS_PER_JOB = 16;
+
+// Direction of face texel (a, b) in [-1, 1], as (a, b, 1) coefficients per axis.
+// Faces in GL order: +X, -X, +Y, -Y, +Z, -Z.
+static const glm::vec3 FACE_AXES[6][3] = {
+	{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f) },
+	{ glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f) },
+	{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+	{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f) },
+	{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) },
+	{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+};
+
+std::filesystem::path Skybox::faceCacheDir;
+
+// Skybox Private Declarations.
+struct Skybox::Faces
+{
+	int faceSize = 0;
+	std::vector<uint8_t> data;	// Six BGR faces in GL order, rows bottom up.
+	IrradianceSH irradiance;
+	bool fromCache = false;
+};
+
+#ifdef SKYBOX_USE_SSE
+// Desc: atan2 of four pairs through an odd polynomial on [0, 1], about 1e-5 rad off.
+static __m128 Atan2(const __m128 y, const __m128 x) {
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 absX = _mm_andnot_ps(signMask, x);
+	const __m128 absY = _mm_andnot_ps(signMask, y);
+	const __m128 steep = _mm_cmpgt_ps(absY, absX);
+	const __m128 a = _mm_div_ps(_mm_min_ps(absX, absY), _mm_max_ps(_mm_max_ps(absX, absY), _mm_set1_ps(1e-30f)));
+	const __m128 s = _mm_mul_ps(a, a);
+	__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.0464964749f), s), _mm_set1_ps(0.15931422f));
+	r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(-0.327622764f));
+	r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, s), a), a);
+	// Fold back to the octant, the half plane and the sign of y.
+	const __m128 halfPi = _mm_set1_ps(0.5f * glm::pi<float>());
+	r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(halfPi, r)), _mm_andnot_ps(steep, r));
+	const __m128 negativeX = _mm_cmplt_ps(x, _mm_setzero_ps());
+	const __m128 pi = _mm_set1_ps(glm::pi<float>());
+	r = _mm_or_ps(_mm_and_ps(negativeX, _mm_sub_ps(pi, r)), _mm_andnot_ps(negativeX, r));
+	return _mm_xor_ps(r, _mm_and_ps(signMask, y));
+}
+#endif
+
+// Desc: Panorama coordinates (column, row) in pixels of the directions of a face row.
+static void ProjectFaceRow(const int face, const int row, const int faceSize, const int panoramaWidth,
+	const int panoramaHeight, float* columns, float* rows) {
+	const glm::vec3* axes = FACE_AXES[face];
+	const float b = 2.0f * ((float)row + 0.5f) / (float)faceSize - 1.0f;
+	const float width = (float)panoramaWidth;
+	const float height = (float)panoramaHeight;
+	int i = 0;
+#ifdef SKYBOX_USE_SSE
+	const __m128 invTwoPi = _mm_set1_ps(0.5f / glm::pi<float>());
+	const __m128 invPi = _mm_set1_ps(1.0f / glm::pi<float>());
+	const __m128 step = _mm_set1_ps(2.0f / (float)faceSize);
+	__m128 a = _mm_add_ps(_mm_mul_ps(_mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f), step), _mm_set1_ps(-1.0f));
+	const __m128 four = _mm_mul_ps(_mm_set1_ps(4.0f), step);
+	for (; i + 4 <= faceSize; i += 4) {
+		const __m128 x = _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(axes[0].x)), _mm_set1_ps(axes[0].y * b + axes[0].z));
+		const __m128 y = _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(axes[1].x)), _mm_set1_ps(axes[1].y * b + axes[1].z));
+		const __m128 z = _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(axes[2].x)), _mm_set1_ps(axes[2].y * b + axes[2].z));
+		// u = atan2(z, x) / 2pi wrapped to [0, 1), v = 1/2 - latitude / pi from the top.
+		__m128 u = _mm_mul_ps(Atan2(z, x), invTwoPi);
+		u = _mm_add_ps(u, _mm_and_ps(_mm_cmplt_ps(u, _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+		const __m128 horizontal = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)));
+		const __m128 v = _mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(Atan2(y, horizontal), invPi));
+		_mm_storeu_ps(columns + i, _mm_sub_ps(_mm_mul_ps(u, _mm_set1_ps(width)), _mm_set1_ps(0.5f)));
+		_mm_storeu_ps(rows + i, _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps(height)), _mm_set1_ps(0.5f)));
+		a = _mm_add_ps(a, four);
+	}
+#endif
+	for (; i < faceSize; ++i) {
+		const float a = 2.0f * ((float)i + 0.5f) / (float)faceSize - 1.0f;
+		const glm::vec3 direction = glm::vec3(
+			axes[0].x * a + axes[0].y * b + axes[0].z,
+			axes[1].x * a + axes[1].y * b + axes[1].z,
+			axes[2].x * a + axes[2].y * b + axes[2].z);
+		float u = std::atan2(direction.z, direction.x) * 0.5f / glm::pi<float>();
+		u += u < 0.0f ? 1.0f : 0.0f;
+		const float latitude = std::atan2(direction.y, std::sqrt(direction.x * direction.x + direction.z * direction.z));
+		const float v = 0.5f - latitude / glm::pi<float>();
+		columns[i] = u * width - 0.5f;
+		rows[i] = v * height - 0.5f;
+	}
+}
+
+// Desc: Resample an 8-bit BGR panorama into six faces, rows of all faces split across the job system.
+static std::vector<uint8_t> ConvertToCubemap(const cv::Mat& panorama, const int faceSize) {
+	const size_t faceBytes = (size_t)faceSize * faceSize * 3;
+	std::vector<uint8_t> faces(6 * faceBytes);
+	const int width = panorama.cols;
+	const int height = panorama.rows;
+	JobSystem::GetInstance().ParallelFor(6 * (size_t)faceSize, FACE_ROWS_PER_JOB, [&](size_t begin, size_t end) {
+		std::vector<float> columns(faceSize);
+		std::vector<float> rows(faceSize);
+		for (size_t faceRow = begin; faceRow < end; ++faceRow) {
+			const int face = (int)(faceRow / faceSize);
+			const int row = (int)(faceRow % faceSize);
+			ProjectFaceRow(face, row, faceSize, width, height, columns.data(), rows.data());
+
+			// Bilinear; columns wrap around the seam, rows clamp at the poles.
+			uint8_t* out = faces.data() + face * faceBytes + (size_t)row * faceSize * 3;
+			for (int i = 0; i < faceSize; ++i) {
+				const float column0 = std::floor(columns[i]);
+				const float row0 = std::floor(rows[i]);
+				const float fx = columns[i] - column0;
+				const float fy = rows[i] - row0;
+				int x0 = (int)column0 % width;
+				x0 += x0 < 0 ? width : 0;
+				const int x1 = x0 + 1 < width ? x0 + 1 : 0;
+				const int y0 = std::clamp((int)row0, 0, height - 1);
+				const int y1 = std::clamp((int)row0 + 1, 0, height - 1);
+				const uint8_t* top = panorama.ptr<uint8_t>(y0);
+				const uint8_t* bottom = panorama.ptr<uint8_t>(y1);
+				for (int c = 0; c < 3; ++c) {
+					const float upper = top[x0 * 3 + c] + (top[x1 * 3 + c] - top[x0 * 3 + c]) * fx;
+					const float lower = bottom[x0 * 3 + c] + (bottom[x1 * 3 + c] - bottom[x0 * 3 + c]) * fx;
+					out[i * 3 + c] = (uint8_t)(upper + (lower - upper) * fy + 0.5f);
+				}
+			}
+		}
+	});
+	return faces;
+}
+
+Skybox::Skybox(const std::filesystem::path& texImagePath) {
 	rotationY = 0.0f;
+	cubemapObj = 0;
 
-	// Load panorama.
-	panorama = std::make_shared<ImageTexture>(texImagePath);
-	// panorama->Preview();
-
-	// Create material.
-	material = std::make_unique<SkyboxMaterial>();
-	material->SetMapKd(panorama);
-
-	// Create sphere geometry.
-	CreateSphere3D(nSlices, nStacks, radius, vertices, indices);
-
-	// Create vertex buffer.
-	glGenBuffers(1, &vboId);
-	glBindBuffer(GL_ARRAY_BUFFER, vboId);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(VertexPT) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
-	// Create index buffer.
-	glGenBuffers(1, &iboId);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboId);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &(indices[0]), GL_STATIC_DRAW);
+	// Read or convert the faces in the background; Prepare() picks them up.
+	faces = std::make_shared<Faces>();
+	auto loadFaces = faces;
+	loadJob = JobSystem::GetInstance().Schedule([texImagePath, loadFaces]() {
+		LoadFaces(texImagePath, *loadFaces);
+	});
 }
 
 Skybox::~Skybox() {
-	vertices.clear();
-	glDeleteBuffers(1, &vboId);
-	indices.clear();
-	glDeleteBuffers(1, &iboId);
+	if (cubemapObj != 0) {
+		glDeleteTextures(1, &cubemapObj);
+	}
 }
 
-void Skybox::Render(std::shared_ptr<Camera> camera, std::shared_ptr<SkyboxShaderProg> shader) {
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
+bool Skybox::Prepare() {
+	if (cubemapObj != 0) {
+		return true;
+	}
+	if (!loadJob.IsDone() || faces->faceSize == 0) {
+		return false;
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, vboId);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPT), 0);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(VertexPT), (const GLvoid*)12);
+	glGenTextures(1, &cubemapObj);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapObj);
+	const size_t faceBytes = (size_t)faces->faceSize * faces->faceSize * 3;
+	for (int face = 0; face < 6; ++face) {
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB8, faces->faceSize, faces->faceSize, 0,
+			GL_BGR, GL_UNSIGNED_BYTE, faces->data.data() + face * faceBytes);
+	}
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
-	shader->Bind();
+	std::cout << "[*] Skybox cubemap " << faces->faceSize << "x" << faces->faceSize
+		<< (faces->fromCache ? " (from cache)" : " (converted)") << std::endl;
+	faces->data.clear();
+	faces->data.shrink_to_fit();
+	return true;
+}
+
+const IrradianceSH& Skybox::GetIrradiance() const {
+	return faces->irradiance;
+}
 
-	// Set transform.
-	glm::mat4x4 MVP = camera->GetProjMatrix() * camera->GetViewMatrix() * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0)) * glm::rotate(glm::mat4(1.0f), rotationY, glm::vec3(0.0f, 1.0f, 0.0f));
-	glUniformMatrix4fv(shader->GetLocMVP(), 1, GL_FALSE, glm::value_ptr(MVP));
-	// Set material properties.
-	if (material->GetMapKd() != nullptr) {
-		material->GetMapKd()->Bind(GL_TEXTURE0);
-		glUniform1i(shader->GetLocMapKd(), 0);
+void Skybox::Render(std::shared_ptr<Camera> camera, std::shared_ptr<SkyboxShaderProg> shader) {
+	if (!Prepare()) {
+		return;
 	}
 
-	// Draw.
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboId);
-	glDrawElements(GL_TRIANGLES, (GLsizei)(indices.size()), GL_UNSIGNED_INT, 0);
+	shader->Bind();
 
-	shader->Unbind();
+	// Clip space back to a panorama direction: no translation, and the rotation undone.
+	const glm::mat4x4 viewRotation = glm::mat4x4(glm::mat3x3(camera->GetViewMatrix()));
+	const glm::mat4x4 invViewProj = glm::inverse(camera->GetProjMatrix() * viewRotation
+		* glm::rotate(glm::mat4(1.0f), rotationY, glm::vec3(0.0f, 1.0f, 0.0f)));
+	glUniformMatrix4fv(shader->GetLocInvViewProj(), 1, GL_FALSE, glm::value_ptr(invViewProj));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapObj);
+	glUniform1i(shader->GetLocCubeMap(), 0);
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
+	// Far-plane depth passes only where the scene left the cleared depth.
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
+	triangle.Draw();
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	shader->Unbind();
 }
 
-void Skybox::CreateSphere3D(const int nSlices, const int nStacks, const float radius,
-	std::vector<VertexPT>& vertices, std::vector<unsigned int>& indices) {
-	const int numPhi = nSlices;
-	const int numTheta = nStacks;
-	// Phi range: from 0 to 2PI.
-	// Theta range: from PI/2 to -PI/2.
-	const float phiStart = 0.0f;
-	const float thetaStart = 0.5f * glm::pi<float>();
-	const float phiOffset = 2.0f * glm::pi<float>() / (float)numPhi;
-	const float thetaOffset = -glm::pi<float>() / (float)numTheta;
-	for (int t = 0; t <= numTheta; ++t) {
-		for (int p = 0; p <= numPhi; ++p) {
-			float phi = phiStart + p * phiOffset;
-			float theta = thetaStart + t * thetaOffset;
-			// std::cout << glm::degrees<float>(phi) << " " << glm::degrees<float>(theta) << std::endl;
-			glm::vec2 uv = glm::vec2((float)p / (float)numPhi, (float)t / (float)numTheta);
-			// std::cout << uv.x << " " << uv.y << std::endl;
-			float x = radius * std::cos(theta) * std::cos(phi);
-			float y = radius * std::sin(theta);
-			float z = radius * std::cos(theta) * std::sin(phi);
-
-			VertexPT vt = VertexPT(glm::vec3(x, y, z), uv);
-			vertices.push_back(vt);
+// Desc: Faces from the cache when it matches the panorama on disk, otherwise decoded, converted and cached.
+void Skybox::LoadFaces(const std::filesystem::path& texImagePath, Faces& faces) {
+	std::error_code ec;
+	const uint64_t sourceSize = (uint64_t)std::filesystem::file_size(texImagePath, ec);
+	const auto sourceTime = std::filesystem::last_write_time(texImagePath, ec);
+	uint64_t sourceStamp = opengl_homework::HashBytes(&sourceSize, sizeof(sourceSize));
+	const auto sourceTicks = sourceTime.time_since_epoch().count();
+	sourceStamp = opengl_homework::HashBytes(&sourceTicks, sizeof(sourceTicks), sourceStamp);
+
+	std::filesystem::path cacheFilePath;
+	if (!faceCacheDir.empty()) {
+		std::ostringstream fileName;
+		fileName << std::hex << std::setw(16) << std::setfill('0')
+			<< opengl_homework::HashBytes(texImagePath.generic_string()) << ".cube";
+		cacheFilePath = faceCacheDir / fileName.str();
+		if (ReadCache(cacheFilePath, sourceStamp, faces)) {
+			faces.fromCache = true;
+			return;
 		}
 	}
 
-	// Vertex order (4 x 2 division for example): 
-	//  0   1   2   3   4.
-	//  5   6   7   8   9.
-	// 10  11  12  13  14.
-	const int pVertices = nSlices + 1;
-	const int tVertices = nStacks + 1;
-	for (int t = 0; t < nStacks; ++t) {
-		for (int p = 0; p < nSlices; ++p) {
-			// Each grid will generate 2 triangles.
-			// The upper-half one.
-			indices.push_back(t * pVertices + p);
-			indices.push_back(t * pVertices + p + 1);
-			indices.push_back((t + 1) * pVertices + p);
-			// The bottom-half one.
-			indices.push_back(t * pVertices + p + 1);
-			indices.push_back((t + 1) * pVertices + p + 1);
-			indices.push_back((t + 1) * pVertices + p);
-		}
+	cv::Mat panorama = cv::imread(texImagePath.string(), cv::IMREAD_COLOR);
+	if (panorama.rows == 0 || panorama.cols == 0) {
+		std::cerr << "[ERROR] Failed to load skybox panorama: " << texImagePath << std::endl;
+		return;
+	}
+	int faceSize = MIN_FACE_SIZE;
+	while (faceSize * 2 <= std::min(panorama.cols / 4, MAX_FACE_SIZE)) {
+		faceSize *= 2;
+	}
+	faces.data = ConvertToCubemap(panorama, faceSize);
+	faces.faceSize = faceSize;
+
+	Clock projectClock;
+	faces.irradiance = ProjectPanorama(panorama);
+	std::cout << "[*] Skybox irradiance projected in " << projectClock.GetElapsedTime() * 1000.0 << " ms ("
+		<< panorama.cols << "x" << panorama.rows << ")" << std::endl;
+
+	if (!cacheFilePath.empty()) {
+		WriteCache(cacheFilePath, sourceStamp, faces);
 	}
 }
 
+bool Skybox::ReadCache(const std::filesystem::path& cacheFilePath, const uint64_t sourceStamp, Faces& faces) {
+	std::ifstream fin(cacheFilePath, std::ios::binary);
+	if (!fin) {
+		return false;
+	}
+	uint32_t header[2] = { 0, 0 };
+	uint64_t stamp = 0;
+	int32_t faceSize = 0;
+	fin.read(reinterpret_cast<char*>(header), sizeof(header));
+	fin.read(reinterpret_cast<char*>(&stamp), sizeof(stamp));
+	fin.read(reinterpret_cast<char*>(&faceSize), sizeof(faceSize));
+	fin.read(reinterpret_cast<char*>(faces.irradiance.coefficients), sizeof(faces.irradiance.coefficients));
+	if (!fin || header[0] != FACE_CACHE_MAGIC || header[1] != FACE_CACHE_VERSION || stamp != sourceStamp
+		|| faceSize < MIN_FACE_SIZE || faceSize > MAX_FACE_SIZE) {
+		return false;
+	}
+	faces.data.resize(6 * (size_t)faceSize * faceSize * 3);
+	if (!fin.read(reinterpret_cast<char*>(faces.data.data()), (std::streamsize)faces.data.size())) {
+		faces.data.clear();
+		return false;
+	}
+	faces.faceSize = faceSize;
+	return true;
+}
+
+void Skybox::WriteCache(const std::filesystem::path& cacheFilePath, const uint64_t sourceStamp, const Faces& faces) {
+	std::error_code ec;
+	std::filesystem::create_directories(cacheFilePath.parent_path(), ec);
+
+	// Written aside and renamed, so a reader never sees a partial file.
+	const auto tmpFilePath = std::filesystem::path(cacheFilePath).concat(".tmp");
+	{
+		const uint32_t header[2] = { FACE_CACHE_MAGIC, FACE_CACHE_VERSION };
+		const int32_t faceSize = faces.faceSize;
+		std::ofstream fout(tmpFilePath, std::ios::binary | std::ios::trunc);
+		fout.write(reinterpret_cast<const char*>(header), sizeof(header));
+		fout.write(reinterpret_cast<const char*>(&sourceStamp), sizeof(sourceStamp));
+		fout.write(reinterpret_cast<const char*>(&faceSize), sizeof(faceSize));
+		fout.write(reinterpret_cast<const char*>(faces.irradiance.coefficients), sizeof(faces.irradiance.coefficients));
+		fout.write(reinterpret_cast<const char*>(faces.data.data()), (std::streamsize)faces.data.size());
+		if (!fout) {
+			std::cerr << "[WARNING] Failed to write skybox cache: " << cacheFilePath << std::endl;
+			return;
+		}
+	}
+	std::filesystem::rename(tmpFilePath, cacheFilePath, ec);
+}
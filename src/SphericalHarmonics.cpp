@@ -0,0 +1,151 @@
+#include "SphericalHarmonics.h"
+
+// C++ STL headers.
+#include <cmath>
+#include <vector>
+
+// SIMD headers.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SPHERICAL_HARMONICS_USE_SSE
+#endif
+
+// Project headers.
+#include "JobSystem.h"
+
+// Rows of the panorama projected per job.
+static constexpr size_t ROWS_PER_JOB = 8;
+
+// Squared normalization of each basis polynomial, times the band convolution over pi (1, 2/3, 1/4).
+static const float FOLD_CONSTANTS[9] = {
+	0.282095f * 0.282095f,
+	0.488603f * 0.488603f * 2.0f / 3.0f,
+	0.488603f * 0.488603f * 2.0f / 3.0f,
+	0.488603f * 0.488603f * 2.0f / 3.0f,
+	1.092548f * 1.092548f * 0.25f,
+	1.092548f * 1.092548f * 0.25f,
+	0.315392f * 0.315392f * 0.25f,
+	1.092548f * 1.092548f * 0.25f,
+	0.546274f * 0.546274f * 0.25f,
+};
+
+IrradianceSH IrradianceSH::Constant(const glm::vec3& radiance) {
+	IrradianceSH sh;
+	for (auto& coefficient : sh.coefficients) {
+		coefficient = glm::vec3(0.0f);
+	}
+	sh.coefficients[0] = radiance;
+	return sh;
+}
+
+// Desc: Sums of color times each basis polynomial over one row, 9 terms of BGR.
+static void ProjectRow(const uint8_t* row, const int width, const float cosLatitude, const float y,
+	const float* cosLongitudes, const float* sinLongitudes, double* sums) {
+	float rowSums[9][3] = {};
+	int i = 0;
+#ifdef SPHERICAL_HARMONICS_USE_SSE
+	__m128 accumulators[9][3];
+	for (auto& term : accumulators) {
+		for (auto& channel : term) {
+			channel = _mm_setzero_ps();
+		}
+	}
+	const __m128 cosLat = _mm_set1_ps(cosLatitude);
+	const __m128 vy = _mm_set1_ps(y);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 three = _mm_set1_ps(3.0f);
+	for (; i + 4 <= width; i += 4) {
+		const __m128 x = _mm_mul_ps(cosLat, _mm_loadu_ps(cosLongitudes + i));
+		const __m128 z = _mm_mul_ps(cosLat, _mm_loadu_ps(sinLongitudes + i));
+		const __m128 basis[9] = {
+			one,
+			vy,
+			z,
+			x,
+			_mm_mul_ps(x, vy),
+			_mm_mul_ps(vy, z),
+			_mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(z, z)), one),
+			_mm_mul_ps(x, z),
+			_mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(vy, vy)),
+		};
+		const uint8_t* pixels = row + i * 3;
+		__m128 channels[3];
+		for (int c = 0; c < 3; ++c) {
+			channels[c] = _mm_set_ps(pixels[9 + c], pixels[6 + c], pixels[3 + c], pixels[c]);
+		}
+		for (int k = 0; k < 9; ++k) {
+			for (int c = 0; c < 3; ++c) {
+				accumulators[k][c] = _mm_add_ps(accumulators[k][c], _mm_mul_ps(channels[c], basis[k]));
+			}
+		}
+	}
+	for (int k = 0; k < 9; ++k) {
+		for (int c = 0; c < 3; ++c) {
+			float lanes[4];
+			_mm_storeu_ps(lanes, accumulators[k][c]);
+			rowSums[k][c] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+		}
+	}
+#endif
+	for (; i < width; ++i) {
+		const float x = cosLatitude * cosLongitudes[i];
+		const float z = cosLatitude * sinLongitudes[i];
+		const float basis[9] = { 1.0f, y, z, x, x * y, y * z, 3.0f * z * z - 1.0f, x * z, x * x - y * y };
+		for (int k = 0; k < 9; ++k) {
+			for (int c = 0; c < 3; ++c) {
+				rowSums[k][c] += row[i * 3 + c] * basis[k];
+			}
+		}
+	}
+	for (int k = 0; k < 9; ++k) {
+		for (int c = 0; c < 3; ++c) {
+			sums[k * 3 + c] = rowSums[k][c];
+		}
+	}
+}
+
+// Desc: Riemann sum over the pixels, each weighted by its solid angle cos(latitude) dlatitude dlongitude.
+IrradianceSH ProjectPanorama(const cv::Mat& panorama) {
+	const int width = panorama.cols;
+	const int height = panorama.rows;
+	const float pi = glm::pi<float>();
+
+	// Pixel centers; column 0 starts at longitude 0 and row 0 at the zenith, as in the skybox.
+	std::vector<float> cosLongitudes(width);
+	std::vector<float> sinLongitudes(width);
+	for (int i = 0; i < width; ++i) {
+		const float longitude = 2.0f * pi * ((float)i + 0.5f) / (float)width;
+		cosLongitudes[i] = std::cos(longitude);
+		sinLongitudes[i] = std::sin(longitude);
+	}
+
+	// Per-row sums, added up in order afterwards so the result does not depend on the scheduling.
+	std::vector<double> rowSums((size_t)height * 27);
+	JobSystem::GetInstance().ParallelFor((size_t)height, ROWS_PER_JOB, [&](size_t begin, size_t end) {
+		for (size_t r = begin; r < end; ++r) {
+			const float latitude = 0.5f * pi - pi * ((float)r + 0.5f) / (float)height;
+			ProjectRow(panorama.ptr<uint8_t>((int)r), width, std::cos(latitude), std::sin(latitude),
+				cosLongitudes.data(), sinLongitudes.data(), rowSums.data() + r * 27);
+		}
+	});
+
+	double sums[27] = {};
+	const double pixelAngle = (2.0 * pi / width) * (pi / height) / 255.0;
+	for (int r = 0; r < height; ++r) {
+		const double latitude = 0.5 * pi - pi * (r + 0.5) / height;
+		const double weight = std::cos(latitude) * pixelAngle;
+		for (int k = 0; k < 27; ++k) {
+			sums[k] += rowSums[(size_t)r * 27 + k] * weight;
+		}
+	}
+
+	// BGR to RGB while folding in the constants.
+	IrradianceSH sh;
+	for (int k = 0; k < 9; ++k) {
+		sh.coefficients[k] = glm::vec3(
+			(float)sums[k * 3 + 2],
+			(float)sums[k * 3 + 1],
+			(float)sums[k * 3 + 0]) * FOLD_CONSTANTS[k];
+	}
+	return sh;
+}
@@ -0,0 +1,127 @@
+#include "TextureArray.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <iostream>
+
+// Project headers.
+#include "UploadManager.h"
+
+TextureArray::TextureArray(const int width, const int height, const int numLayers)
+	: layerWidth(width), layerHeight(height), numLayers(numLayers)
+{
+	textureObj = 0;
+	residentLevel = 0;
+	int levelWidth = width;
+	int levelHeight = height;
+	while (true) {
+		levels.push_back(cv::Mat(levelHeight * numLayers, levelWidth, CV_8UC3, cv::Scalar(0, 0, 0)));
+		if (levelWidth == 1 && levelHeight == 1) {
+			break;
+		}
+		levelWidth = std::max(1, levelWidth / 2);
+		levelHeight = std::max(1, levelHeight / 2);
+	}
+}
+
+TextureArray::~TextureArray()
+{
+	if (textureObj != 0) {
+		TextureResidency::GetInstance().Unregister(this);
+		UploadManager::GetInstance().Cancel(this);
+		glDeleteTextures(1, &textureObj);
+	}
+	levels.clear();
+}
+
+// Desc: Convert to BGR, resample into the rows of the layer and downsample them through the mip chain.
+void TextureArray::SetLayer(const int layer, const cv::Mat& image)
+{
+	if (image.empty()) {
+		return;
+	}
+	cv::Mat bgr;
+	switch (image.channels()) {
+	case 1:
+		cv::cvtColor(image, bgr, cv::COLOR_GRAY2BGR);
+		break;
+	case 3:
+		bgr = image;
+		break;
+	case 4:
+		cv::cvtColor(image, bgr, cv::COLOR_BGRA2BGR);
+		break;
+	default:
+		std::cerr << "[ERROR] Unsupport texture format" << std::endl;
+		return;
+	}
+	cv::Mat source = bgr;
+	for (auto& level : levels) {
+		const int levelHeight = level.rows / numLayers;
+		cv::Mat target = level.rowRange(layer * levelHeight, (layer + 1) * levelHeight);
+		if (source.cols == target.cols && source.rows == target.rows) {
+			source.copyTo(target);
+		}
+		else {
+			cv::resize(source, target, target.size(), 0.0, 0.0, cv::INTER_AREA);
+		}
+		source = target;
+	}
+}
+
+// Desc: Create the array with its coarse levels and hand it to TextureResidency. Must be called on the GL thread.
+void TextureArray::Upload()
+{
+	if (textureObj != 0 || levels.empty()) {
+		return;
+	}
+	residentLevel = TextureResidency::GetInstance().Register(this);
+	CreateTexture();
+}
+
+// Desc: Drop or add the finest levels by recreating the array from the host mip chain.
+void TextureArray::SetResidentLevel(const int level)
+{
+	const int newLevel = std::clamp(level, 0, GetNumLevels() - 1);
+	if (textureObj == 0 || newLevel == residentLevel) {
+		return;
+	}
+	UploadManager::GetInstance().Cancel(this);
+	glDeleteTextures(1, &textureObj);
+	textureObj = 0;
+	residentLevel = newLevel;
+	CreateTexture();
+}
+
+// Desc: RGB8 is counted as RGBA8, as drivers usually store it.
+size_t TextureArray::GetLevelBytes(const int level) const
+{
+	return (size_t)levels[level].cols * levels[level].rows * 4;
+}
+
+// Desc: Create the array with the levels from residentLevel down and queue their data.
+void TextureArray::CreateTexture()
+{
+	glGenTextures(1, &textureObj);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureObj);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	std::vector<TextureLevel> uploadLevels;
+	for (size_t i = residentLevel; i < levels.size(); ++i) {
+		uploadLevels.push_back({ levels[i].ptr(), levels[i].cols, levels[i].rows / numLayers, numLayers });
+	}
+	UploadManager::GetInstance().UploadMipChain(this, GL_TEXTURE_2D_ARRAY, textureObj, GL_RGB8, GL_BGR, 3, uploadLevels);
+}
+
+size_t TextureArray::GetHostMemoryBytes() const
+{
+	size_t bytes = 0;
+	for (const auto& level : levels) {
+		bytes += level.total() * level.elemSize();
+	}
+	return bytes;
+}
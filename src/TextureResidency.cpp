@@ -0,0 +1,167 @@
+#include "TextureResidency.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+// Levels up to this size are always resident (the ones UploadManager uploads at once).
+static constexpr size_t COARSE_LEVEL_BYTES = 16 * 1024;
+// Frames a texture must ask for a coarser level before it is dropped without budget pressure.
+static constexpr int COARSEN_DELAY_FRAMES = 120;
+
+TextureResidency& TextureResidency::GetInstance() {
+	static TextureResidency instance;
+	return instance;
+}
+
+void TextureResidency::BeginFrame(const int width, const int height) {
+	++frameIndex;
+	viewportWidth = std::max(1, width);
+	viewportHeight = std::max(1, height);
+}
+
+int TextureResidency::Register(StreamableTexture* texture) {
+	Entry entry;
+	entry.coarseLevel = texture->GetNumLevels() - 1;
+	for (int level = 0; level < texture->GetNumLevels(); ++level) {
+		if (texture->GetLevelBytes(level) <= COARSE_LEVEL_BYTES) {
+			entry.coarseLevel = level;
+			break;
+		}
+	}
+	entry.requestedLevel = entry.coarseLevel;
+	entry.lastUsedFrame = frameIndex;
+	entries[texture] = entry;
+	return entry.coarseLevel;
+}
+
+void TextureResidency::Unregister(StreamableTexture* texture) {
+	entries.erase(texture);
+}
+
+// Desc: Project the corners; a box that reaches behind the camera is taken to fill the view.
+glm::vec2 TextureResidency::GetScreenExtent(const glm::mat4& MVP, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+	glm::vec2 ndcMin = glm::vec2(1e30f);
+	glm::vec2 ndcMax = glm::vec2(-1e30f);
+	for (int corner = 0; corner < 8; ++corner) {
+		const glm::vec3 position = glm::vec3(
+			(corner & 1) ? boundsMax.x : boundsMin.x,
+			(corner & 2) ? boundsMax.y : boundsMin.y,
+			(corner & 4) ? boundsMax.z : boundsMin.z);
+		const glm::vec4 clip = MVP * glm::vec4(position, 1.0f);
+		if (clip.w <= 0.0f) {
+			return GetViewportSize();
+		}
+		const glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+	if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f) {
+		return glm::vec2(0.0f);
+	}
+	// Not clamped to the view: a close-up needs the texel density of the whole box.
+	return (ndcMax - ndcMin) * 0.5f * GetViewportSize();
+}
+
+// Desc: The finest level with at most one texel per pixel along both axes.
+void TextureResidency::Request(StreamableTexture* texture, const glm::vec2& screenExtent) {
+	auto it = entries.find(texture);
+	if (it == entries.end() || screenExtent.x <= 0.0f || screenExtent.y <= 0.0f) {
+		return;
+	}
+	Entry& entry = it->second;
+	const float texelsPerPixel = std::max(
+		(float)texture->GetWidth() / std::max(screenExtent.x, 1.0f),
+		(float)texture->GetHeight() / std::max(screenExtent.y, 1.0f));
+	int level = texelsPerPixel > 1.0f ? (int)std::floor(std::log2(texelsPerPixel)) : 0;
+	level = std::min(level, entry.coarseLevel);
+
+	entry.requestedLevel = entry.requested ? std::min(entry.requestedLevel, level) : level;
+	entry.requested = true;
+	entry.lastUsedFrame = frameIndex;
+}
+
+void TextureResidency::Update() {
+	// Targets from the feedback: finer right away, coarser once the request has held for a while.
+	std::vector<std::pair<StreamableTexture*, int>> targets;
+	targets.reserve(entries.size());
+	size_t requestedBytes = 0;
+	size_t targetBytes = 0;
+	for (auto& [texture, entry] : entries) {
+		const int resident = texture->GetResidentLevel();
+		int target = resident;
+		if (entry.requested && entry.requestedLevel < resident) {
+			target = entry.requestedLevel;
+			entry.coarserFrames = 0;
+		}
+		else if (entry.requested && entry.requestedLevel > resident) {
+			if (++entry.coarserFrames >= COARSEN_DELAY_FRAMES) {
+				target = entry.requestedLevel;
+				entry.coarserFrames = 0;
+			}
+		}
+		else {
+			entry.coarserFrames = 0;
+		}
+		requestedBytes += GetResidentBytes(*texture, entry.requested ? entry.requestedLevel : resident);
+		targetBytes += GetResidentBytes(*texture, target);
+		targets.push_back({ texture, target });
+		entry.requested = false;
+	}
+
+	// Over budget: drop the finest levels of the least recently used textures first.
+	int numOverBudget = 0;
+	if (targetBytes > budgetBytes) {
+		// Ties broken by address, so the same textures give way every frame instead of trading places.
+		std::sort(targets.begin(), targets.end(), [&](const auto& a, const auto& b) {
+			const uint64_t lastUsedA = entries.at(a.first).lastUsedFrame;
+			const uint64_t lastUsedB = entries.at(b.first).lastUsedFrame;
+			if (lastUsedA != lastUsedB) {
+				return lastUsedA < lastUsedB;
+			}
+			return std::less<StreamableTexture*>()(a.first, b.first);
+		});
+		for (auto& [texture, target] : targets) {
+			const int coarseLevel = entries.at(texture).coarseLevel;
+			const int requested = target;
+			while (targetBytes > budgetBytes && target < coarseLevel) {
+				targetBytes -= texture->GetLevelBytes(target);
+				++target;
+			}
+			numOverBudget += target > requested ? 1 : 0;
+			if (targetBytes <= budgetBytes) {
+				break;
+			}
+		}
+	}
+
+	for (const auto& [texture, target] : targets) {
+		const int resident = texture->GetResidentLevel();
+		if (target < resident) {
+			stats.levelsStreamedIn += resident - target;
+		}
+		else if (target > resident) {
+			stats.levelsEvicted += target - resident;
+		}
+		if (target != resident) {
+			texture->SetResidentLevel(target);
+		}
+	}
+
+	stats.budgetBytes = budgetBytes;
+	stats.residentBytes = targetBytes;
+	stats.requestedBytes = requestedBytes;
+	stats.numTextures = (int)entries.size();
+	stats.numOverBudget = numOverBudget;
+}
+
+// Desc: Bytes of the levels from this one down to 1x1.
+size_t TextureResidency::GetResidentBytes(const StreamableTexture& texture, const int level) {
+	size_t bytes = 0;
+	for (int i = std::max(level, 0); i < texture.GetNumLevels(); ++i) {
+		bytes += texture.GetLevelBytes(i);
+	}
+	return bytes;
+}
@@ -9,19 +9,133 @@
 #include <glm/gtc/type_ptr.hpp>
 
 // C++ STL headers.
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <vector>
 #include <map>
+#include <mutex>
 
 // Project headers.
 #include "Light.h"
 #include "Material.h"
+#include "JobSystem.h"
+#include "RenderResources.h"
+#include "Arena.h"
+#include "Clock.h"
+#include "TextureArray.h"
+#include "UploadManager.h"
+#include "TextureResidency.h"
+#include "GlbFile.h"
+#include "PlyReader.h"
+#include "ChunkedMeshFile.h"
+#include "CookedMeshFile.h"
 
 namespace opengl_homework {
 
+// Vertices per job when a loop over the vertices is split across the job system.
+static constexpr size_t VERTEX_GRAIN_SIZE = 16384;
+
+// Submeshes recorded into one command list.
+static constexpr size_t SUBMESH_GROUP_SIZE = 32;
+
+// Limits of the packed texture array; the layer count is the minimum GL 3.3 guarantees.
+static constexpr int MAX_TEXTURE_ARRAY_SIZE = 2048;
+static constexpr size_t MAX_TEXTURE_ARRAY_LAYERS = 256;
+
+// PLY streaming: the chunks read ahead of the upload are all the host memory a PLY mesh
+// takes. Indices go into buffers of at most PLY_SEGMENT_INDICES, drawn one call each.
+static constexpr size_t PLY_CHUNK_BYTES = 4 * 1024 * 1024;
+static constexpr size_t PLY_CHUNKS_IN_FLIGHT = 4;
+static constexpr size_t PLY_SEGMENT_INDICES = 64 * 1024 * 1024;
+static constexpr size_t PLY_HEADER_BUFFER_BYTES = 64 * 1024;
+
+// Chunked meshes: GPU memory for the chunks of a mesh, uploads started at a time, and the
+// size on screen below which a chunk is left to its proxy.
+static constexpr size_t CHUNK_BUDGET_BYTES = 256 * 1024 * 1024;
+static constexpr int CHUNK_LOADS_IN_FLIGHT = 8;
+static constexpr float CHUNK_MIN_PIXELS = 64.0f;
+
+// Cooked meshes: the position error on screen a coarser level of detail may add.
+static constexpr float LOD_ERROR_PIXELS = 2.0f;
+
+// Desc: Split the next whitespace-separated token off the front of a line.
+static std::string_view NextToken(std::string_view& line) {
+	const size_t begin = line.find_first_not_of(" \t\r");
+	if (begin == std::string_view::npos) {
+		line = std::string_view();
+		return line;
+	}
+	const size_t end = std::min(line.find_first_of(" \t\r", begin), line.size());
+	const std::string_view token = line.substr(begin, end - begin);
+	line.remove_prefix(end);
+	return token;
+}
+
+// Desc: Parse the next token of a line as a float, or 0 if there is none.
+static float ParseFloat(std::string_view& line) {
+	const std::string_view token = NextToken(line);
+	float value = 0.0f;
+	std::from_chars(token.data(), token.data() + token.size(), value);
+	return value;
+}
+
+// Desc: Parse the next index of a face vertex ("p/t/n") and consume its slash. A negative index counts
+// back from the last of the count elements read so far. Sets -1 for an empty field, and returns false
+// for garbage, 0 or an index out of range.
+static bool ParseIndex(std::string_view& token, const size_t count, int& index) {
+	const size_t end = std::min(token.find('/'), token.size());
+	const std::string_view field = token.substr(0, end);
+	token.remove_prefix(std::min(end + 1, token.size()));
+	index = -1;
+	if (field.empty()) {
+		return true;
+	}
+	int value = 0;
+	const auto [last, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+	if (error != std::errc() || last != field.data() + field.size() || value == 0) {
+		return false;
+	}
+	const int64_t resolved = value > 0 ? (int64_t)value - 1 : (int64_t)count + value;
+	if (resolved < 0 || resolved >= (int64_t)count) {
+		return false;
+	}
+	index = (int)resolved;
+	return true;
+}
+
+// Desc: Area-weighted vertex normals of a primitive: every triangle adds its unnormalized
+// face normal, whose length is twice its area, to its three vertices.
+static void GenerateNormals(const GlbFile& glb, const GlbPrimitive& primitive, glm::vec3* normals) {
+	std::fill(normals, normals + primitive.numVertices, glm::vec3(0.0f));
+	for (size_t i = 0; i + 2 < primitive.numIndices; i += 3) {
+		const uint32_t a = glb.ReadIndex(primitive, i);
+		const uint32_t b = glb.ReadIndex(primitive, i + 1);
+		const uint32_t c = glb.ReadIndex(primitive, i + 2);
+		const glm::vec3 pa = glb.ReadPosition(primitive, a);
+		const glm::vec3 faceNormal = glm::cross(glb.ReadPosition(primitive, b) - pa, glb.ReadPosition(primitive, c) - pa);
+		normals[a] += faceNormal;
+		normals[b] += faceNormal;
+		normals[c] += faceNormal;
+	}
+	for (size_t i = 0; i < primitive.numVertices; ++i) {
+		const float length = glm::length(normals[i]);
+		normals[i] = length > 0.0f ? normals[i] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+}
+
+// Desc: MVP of a mesh or submesh with model matrix M. The shading pass tests depth with GL_EQUAL
+// against the depth pass, so every pass must multiply in this same order to match bit for bit.
+static glm::mat4 GetMVP(const glm::mat4& P, const glm::mat4& V, const glm::mat4& M) {
+	return P * V * M;
+}
+
 // VertexPTN Declarations.
 struct TriangleMesh::VertexPTN {
 	VertexPTN() {
@@ -40,29 +154,221 @@ struct TriangleMesh::VertexPTN {
 };
 
 // SubMesh Declarations.
+// A range of the mesh index buffer drawn with one material. OBJ submeshes read the
+// interleaved vertices; GLB submeshes read their own streams in the binary chunk; PLY
+// submeshes are the index segments of the file, each in a buffer of its own; chunked meshes
+// draw a submesh per chunk in view, from the chunk buffer or the proxies in the mesh buffer.
 struct TriangleMesh::SubMesh
 {
 	SubMesh() {
-		material = nullptr;
-		iboId = 0;
+		firstIndex = 0;
+		numIndices = 0;
+		position = { 3, GL_FLOAT, GL_FALSE, sizeof(VertexPTN), offsetof(VertexPTN, position) };
+		normal = { 3, GL_FLOAT, GL_FALSE, sizeof(VertexPTN), offsetof(VertexPTN, normal) };
+		texcoord = { 2, GL_FLOAT, GL_FALSE, sizeof(VertexPTN), offsetof(VertexPTN, texcoord) };
+		indexType = GL_UNSIGNED_INT;
+		vertexBuffer = 0;
+		indexBuffer = 0;
+		localMatrix = glm::mat4(1.0f);
+		hasLocalMatrix = false;
+	}
+	MaterialHandle material;
+	size_t firstIndex;		// In indices of indexType.
+	size_t numIndices;
+	VertexStream position;
+	VertexStream normal;
+	VertexStream texcoord;
+	GLenum indexType;		// 0: drawn without indices.
+	GLuint vertexBuffer;	// Owned by the submesh; 0 to use the vertex buffer of the mesh.
+	GLuint indexBuffer;		// Owned by the submesh; 0 to use the index buffer of the mesh.
+	glm::mat4 localMatrix;	// Applied before the world matrix when hasLocalMatrix.
+	bool hasLocalMatrix;
+};
+
+// PlyChunk Declarations.
+// Vertices or indices read from a PLY file, waiting for their upload.
+struct TriangleMesh::PlyChunk
+{
+	uint8_t* data = nullptr;
+	bool indices = false;
+	size_t first = 0;				// First vertex, or first index in the segment.
+	size_t count = 0;
+	size_t segment = 0;
+	size_t segmentCapacity = 0;		// Indices the segment buffer is created for.
+};
+
+// PlyUpload Declarations.
+// A PLY file streaming into the mesh buffers. The reader and the read state belong to the
+// one read job running at a time; the rest is only touched on the GL thread.
+struct TriangleMesh::PlyUpload
+{
+	PlyReader reader;
+	std::vector<std::vector<uint8_t>> chunks;
+	std::vector<uint8_t*> freeChunks;
+	Clock clock;
+
+	// Read state.
+	size_t verticesRead = 0;
+	size_t numSegments = 0;
+	size_t segmentUsed = 0;
+	size_t segmentCapacity = 0;
+	glm::vec3 boundsMin = glm::vec3(1e9f);
+	glm::vec3 boundsMax = glm::vec3(-1e9f);
+
+	// GL thread.
+	bool reading = false;
+	bool failed = false;
+	bool cancelled = false;		// The mesh released its buffers; callbacks must not touch it.
+	int chunksInFlight = 0;
+
+	PlyChunk Read(uint8_t* buffer);
+	bool IsFinished() const {
+		return !reading && chunksInFlight == 0 && reader.GetVerticesLeft() == 0 && reader.GetFacesLeft() == 0;
 	}
-	std::shared_ptr<PhongMaterial> material;
-	GLuint iboId;
-	std::vector<unsigned int> vertexIndices;
+};
+
+// Desc: Read the next chunk: vertices first, with their bounds, then whole faces. A segment is
+// sized for the faces left as if they were triangles; polygons that overflow it start the next.
+TriangleMesh::PlyChunk TriangleMesh::PlyUpload::Read(uint8_t* buffer) {
+	PlyChunk chunk;
+	chunk.data = buffer;
+	if (reader.GetVerticesLeft() > 0) {
+		const size_t vertexFloats = reader.GetVertexBytes() / sizeof(float);
+		const float* vertices = (const float*)buffer;
+		chunk.first = verticesRead;
+		chunk.count = reader.ReadVertices((float*)buffer, PLY_CHUNK_BYTES / reader.GetVertexBytes());
+		for (size_t i = 0; i < chunk.count; ++i) {
+			const glm::vec3 position = glm::vec3(vertices[i * vertexFloats], vertices[i * vertexFloats + 1],
+				vertices[i * vertexFloats + 2]);
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+		}
+		verticesRead += chunk.count;
+		return chunk;
+	}
+
+	chunk.indices = true;
+	const size_t chunkIndices = PLY_CHUNK_BYTES / sizeof(uint32_t);
+	for (int attempt = 0; attempt < 2 && chunk.count == 0 && reader.GetFacesLeft() > 0; ++attempt) {
+		if (segmentUsed == segmentCapacity || attempt > 0) {
+			++numSegments;
+			segmentUsed = 0;
+			segmentCapacity = std::min(PLY_SEGMENT_INDICES, std::max(reader.GetFacesLeft() * 3, chunkIndices));
+		}
+		chunk.count = reader.ReadTriangles((uint32_t*)buffer, std::min(chunkIndices, segmentCapacity - segmentUsed));
+	}
+	chunk.segment = numSegments - 1;
+	chunk.segmentCapacity = segmentCapacity;
+	chunk.first = segmentUsed;
+	segmentUsed += chunk.count;
+	return chunk;
+}
+
+// MaterialTableEntry Declarations.
+// Mirrors MaterialEntry in phong_shading_demo.fs (std140).
+struct MaterialTableEntry
+{
+	glm::vec4 Ka;
+	glm::vec4 Kd;	// w: layer in the texture array, or -1.
+	glm::vec4 Ks;	// w: Ns.
 };
 
 // TriangleMesh Private Declarations.
 struct TriangleMesh::Impl {
+	bool loaded;
 	GLuint vboId;
+	GLuint positionVboId;	// Tightly packed positions for the depth pre-pass.
+	GLuint iboId;			// Indices of every submesh, back to back.
 	std::vector<VertexPTN> vertices;
+	std::vector<glm::vec3> positions;		// Source of positionVboId while it uploads.
+	std::vector<unsigned int> indices;
+	int pendingUploads;		// Buffers still streaming; the mesh is drawn once this is 0.
 	std::vector<SubMesh> subMeshes;
-	std::map<std::string, std::shared_ptr<PhongMaterial>> materials;
+	std::map<std::string, MaterialHandle> materials;	// Owned; destroyed with the mesh.
+	std::vector<JobHandle> textureJobs;		// Texture decodes running while the OBJ is parsed.
+
+	// GLB models: the mapped file is the vertex and index data, uploaded to vboId as it is.
+	std::unique_ptr<GlbFile> glb;
+	std::vector<glm::vec3> generatedNormals;	// For primitives without normals, after the binary chunk in vboId.
+	size_t generatedNormalsOffset;
+
+	// PLY models: the file is read again each time the buffers are created, a chunk at a time.
+	std::filesystem::path plyFilePath;
+	bool plyNormalized;
+	std::shared_ptr<PlyUpload> plyUpload;	// Shared with the read job and the upload callbacks.
+
+	// Chunked models: the proxies stay in vboId and the chunks stream into buffers of their own,
+	// mapped from the file. subMeshes is rebuilt every frame from what is in view.
+	struct ChunkState
+	{
+		SubMesh subMesh;		// Its buffer holds the chunk vertices, then the indices.
+		SubMesh proxy;
+		glm::vec3 boundsMin;	// Before the local matrix.
+		glm::vec3 boundsMax;
+		bool loading = false;
+		bool resident = false;
+		bool wanted = false;
+		float screenSize = 0.0f;	// In pixels this frame; 0 when out of view.
+		uint64_t lastVisibleFrame = 0;
+	};
+	std::unique_ptr<ChunkedMeshFile> chunkedFile;
+	std::vector<ChunkState> chunks;
+	std::vector<uint32_t> chunkOrder;		// In view, largest on screen first.
+	glm::mat4 chunkMatrix;					// Local matrix of every chunk.
+	size_t chunkBytes = 0;					// Resident or loading.
+	int chunkLoadsInFlight = 0;
+	uint64_t chunkFrame = 0;
+
+	// Cooked models: the mapped file is the vertex and index data, uploaded to vboId and iboId as
+	// it is. The submeshes draw the level of detail SelectLod() picked.
+	std::unique_ptr<CookedMeshFile> cookedFile;
+	uint32_t cookedLod = 0;
+
+	// Vertex and index buffers of a submesh: its own, the ones of the mesh, or for GLB and
+	// chunk proxies the vertex buffer for both.
+	GLuint GetVertexBuffer(const SubMesh& subMesh) const {
+		return subMesh.vertexBuffer != 0 ? subMesh.vertexBuffer : vboId;
+	}
+	GLuint GetIndexBuffer(const SubMesh& subMesh) const {
+		return subMesh.indexBuffer != 0 ? subMesh.indexBuffer : iboId != 0 ? iboId : vboId;
+	}
+
+	// Matte material for submeshes that come without one, created on first use.
+	MaterialHandle GetDefaultMaterial() {
+		MaterialHandle& defaultMaterial = materials["default"];
+		if (!defaultMaterial.IsValid()) {
+			auto& materialPool = RenderResources::GetInstance().GetMaterials();
+			defaultMaterial = materialPool.Create();
+			PhongMaterial* material = materialPool.Get(defaultMaterial);
+			material->SetName("default");
+			material->SetKa(glm::vec3(0.8f));
+			material->SetKd(glm::vec3(0.8f));
+		}
+		return defaultMaterial;
+	}
+
+	// Single-draw path: materials in a uniform table selected per vertex, diffuse maps in one array.
+	bool useMaterialTable;
+	unsigned int materialTableFeatures;
+	std::vector<MaterialTableEntry> materialTable;
+	std::vector<float> vertexMaterials;		// Table slot of every vertex.
+	std::unique_ptr<TextureArray> textureArray;
+	GLuint materialVboId;
+	GLuint materialTableUboId;
 
 	std::string name;
 	int numVertices;
 	int numTriangles;
 	glm::vec3 objCenter;
 	glm::vec3 objExtent;
+	glm::vec3 boundsMin;	// Object space, after normalization.
+	glm::vec3 boundsMax;
+
+	// Statistics of the last load.
+	double loadTimeMs = 0.0;
+	size_t loaderAllocations = 0;	// Served by the load arena.
+	size_t loaderBlocks = 0;		// Heap allocations behind them.
+	size_t loaderBytes = 0;
 };
 
 // Desc: Get the number of vertices.
@@ -85,110 +391,527 @@ glm::vec3 TriangleMesh::GetObjCenter() const {
 	return pImpl->objCenter;
 }
 
+// Desc: Get the bounding box of the loaded positions.
+void TriangleMesh::GetBounds(glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+	boundsMin = pImpl->boundsMin;
+	boundsMax = pImpl->boundsMax;
+}
+
+// Desc: Whether the geometry was loaded from file successfully.
+bool TriangleMesh::IsLoaded() const {
+	return pImpl->loaded;
+}
+
+// Desc: Whether the buffers have been created and have finished uploading.
+bool TriangleMesh::IsResident() const {
+	return pImpl->vboId != 0 && pImpl->pendingUploads == 0;
+}
+
+// Desc: Get the host memory held by the geometry and the decoded textures.
+size_t TriangleMesh::GetHostMemoryBytes() const {
+	size_t bytes = pImpl->vertices.size() * sizeof(VertexPTN);
+	bytes += pImpl->positions.size() * sizeof(glm::vec3);
+	bytes += pImpl->indices.size() * sizeof(unsigned int);
+	bytes += pImpl->vertexMaterials.size() * sizeof(float);
+	bytes += pImpl->generatedNormals.size() * sizeof(glm::vec3);
+	if (pImpl->plyUpload != nullptr) {
+		bytes += pImpl->plyUpload->chunks.size() * PLY_CHUNK_BYTES + pImpl->plyUpload->reader.GetBufferBytes();
+	}
+	if (pImpl->glb != nullptr) {
+		bytes += pImpl->glb->GetFileBytes();
+	}
+	if (pImpl->textureArray != nullptr) {
+		bytes += pImpl->textureArray->GetHostMemoryBytes();
+	}
+	RenderResources& resources = RenderResources::GetInstance();
+	for (const auto& [name, materialHandle] : pImpl->materials) {
+		const PhongMaterial* material = resources.GetMaterials().Get(materialHandle);
+		const ImageTexture* mapKd = material != nullptr ? resources.GetTextures().Get(material->GetMapKd()) : nullptr;
+		if (mapKd != nullptr) {
+			bytes += mapKd->GetHostMemoryBytes();
+		}
+	}
+	return bytes;
+}
+
 // Desc: Constructor of a triangle mesh.
-TriangleMesh::TriangleMesh(const std::filesystem::path& objFilePath, const bool normalized = true) {
+TriangleMesh::TriangleMesh(const std::filesystem::path& objFilePath, const bool normalized = true)
+	: TriangleMesh(objFilePath, normalized, MeshLoadHint()) {
+}
+
+// Desc: Constructor of a triangle mesh with element counts known in advance (e.g. from the model catalog).
+TriangleMesh::TriangleMesh(const std::filesystem::path& objFilePath, const bool normalized, const MeshLoadHint& hint) {
 	pImpl = std::make_unique<Impl>();
 	pImpl->name = objFilePath.stem().string();
+	pImpl->vboId = 0;
+	pImpl->positionVboId = 0;
+	pImpl->iboId = 0;
+	pImpl->pendingUploads = 0;
+	pImpl->useMaterialTable = false;
+	pImpl->materialTableFeatures = 0;
+	pImpl->materialVboId = 0;
+	pImpl->materialTableUboId = 0;
+	pImpl->generatedNormalsOffset = 0;
+	pImpl->plyNormalized = false;
 	pImpl->numVertices = 0;
 	pImpl->numTriangles = 0;
 	pImpl->objCenter = glm::vec3(0.0f, 0.0f, 0.0f);
-	LoadFromFile(objFilePath, normalized);
+	pImpl->objExtent = glm::vec3(0.0f, 0.0f, 0.0f);
+	pImpl->boundsMin = glm::vec3(0.0f, 0.0f, 0.0f);
+	pImpl->boundsMax = glm::vec3(0.0f, 0.0f, 0.0f);
+	pImpl->loaded = LoadFromFile(objFilePath, normalized, hint);
 }
 
 // Desc: Destructor of a triangle mesh.
 TriangleMesh::~TriangleMesh() {
+	ReleaseBuffers();
 	pImpl->vertices.clear();
 	pImpl->subMeshes.clear();
-	ReleaseBuffers();
+
+	// The materials and textures are freed with the next collection of the pools.
+	RenderResources& resources = RenderResources::GetInstance();
+	for (const auto& [name, materialHandle] : pImpl->materials) {
+		if (const PhongMaterial* material = resources.GetMaterials().Get(materialHandle)) {
+			resources.GetTextures().Destroy(material->GetMapKd());
+		}
+		resources.GetMaterials().Destroy(materialHandle);
+	}
 }
 
 // Desc: Load the geometry data of the model from file and normalize it.
-bool TriangleMesh::LoadFromFile(const std::filesystem::path& objFilePath, const bool normalized) {
-	std::ifstream fin(objFilePath);
+bool TriangleMesh::LoadFromFile(const std::filesystem::path& objFilePath, const bool normalized, const MeshLoadHint& hint) {
+	if (objFilePath.extension() == ".glb") {
+		return LoadFromGlb(objFilePath, normalized);
+	}
+	if (objFilePath.extension() == ".ply") {
+		return LoadFromPly(objFilePath, normalized);
+	}
+	if (objFilePath.extension() == ".chunks") {
+		return LoadFromChunks(objFilePath, normalized);
+	}
+	if (objFilePath.extension() == ".cmesh") {
+		return LoadFromCooked(objFilePath, normalized);
+	}
+	Clock loadClock;
+	std::ifstream fin(objFilePath, std::ios::binary | std::ios::ate);
 	if (!fin) {
 		std::cerr << "Error: cannot open file " << objFilePath << std::endl;
 		return false;
 	}
 
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::vec2> texcoords;
+	// The file text and the attribute streams live in one arena, released in one go on return.
+	const size_t fileBytes = (size_t)fin.tellg();
+	Arena arena(fileBytes + (hint.numPositions + hint.numNormals) * sizeof(glm::vec3)
+		+ hint.numTexcoords * sizeof(glm::vec2) + 4096);
+	std::pmr::vector<char> text(fileBytes, &arena);
+	fin.seekg(0);
+	fin.read(text.data(), fileBytes);
+	fin.close();
 
-	std::string line = "";
-	while (std::getline(fin, line)) {
-		std::istringstream iss(line);
-		std::string type;
-		iss >> type;
+	std::pmr::vector<glm::vec3> positions(&arena);
+	std::pmr::vector<glm::vec3> normals(&arena);
+	std::pmr::vector<glm::vec2> texcoords(&arena);
+	positions.reserve(hint.numPositions);
+	normals.reserve(hint.numNormals);
+	texcoords.reserve(hint.numTexcoords);
+	pImpl->vertices.reserve(hint.numVertices);
+	pImpl->indices.reserve((size_t)hint.numTriangles * 3);
+
+	// Lines and tokens are views into the text, so parsing allocates nothing per token.
+	std::vector<VertexPTN> face;
+	size_t rejectedFaces = 0;
+	std::string_view remaining(text.data(), text.size());
+	while (!remaining.empty()) {
+		const size_t lineEnd = std::min(remaining.find('\n'), remaining.size());
+		std::string_view line = remaining.substr(0, lineEnd);
+		remaining.remove_prefix(std::min(lineEnd + 1, remaining.size()));
+
+		const std::string_view type = NextToken(line);
 		if (type == "mtllib") {
-			std::string mtlFileName;
-			iss >> mtlFileName;
-			LoadMtllib(objFilePath.parent_path() / mtlFileName);
+			LoadMtllib(objFilePath.parent_path() / std::string(NextToken(line)));
 		}
 		else if (type == "v") {
-			float x, y, z;
-			iss >> x >> y >> z;
+			const float x = ParseFloat(line);
+			const float y = ParseFloat(line);
+			const float z = ParseFloat(line);
 			positions.emplace_back(x, y, z);
 		}
 		else if (type == "vn") {
-			float x, y, z;
-			iss >> x >> y >> z;
+			const float x = ParseFloat(line);
+			const float y = ParseFloat(line);
+			const float z = ParseFloat(line);
 			normals.emplace_back(x, y, z);
 		}
 		else if (type == "vt") {
-			float u, v;
-			iss >> u >> v;
+			const float u = ParseFloat(line);
+			const float v = ParseFloat(line);
 			texcoords.emplace_back(u, v);
 		}
 		else if (type == "f") {
-			int numVertices = 0;
-			std::string token;
-			while (iss >> token) {
-				std::istringstream viss(token);
-				std::string posIndexStr, texcoordIndexStr, normalIndexStr;
-				std::getline(viss, posIndexStr, '/');
-				std::getline(viss, texcoordIndexStr, '/');
-				std::getline(viss, normalIndexStr, '/');
-				int posIndex = std::stoi(posIndexStr) - 1;
-				int texcoordIndex = std::stoi(texcoordIndexStr) - 1;
-				int normalIndex = std::stoi(normalIndexStr) - 1;
-				pImpl->vertices.emplace_back(positions[posIndex], normals[normalIndex], texcoords[texcoordIndex]);
-				++numVertices;
+			// A face with a missing, malformed or out of range index is dropped whole.
+			face.clear();
+			bool valid = true;
+			for (std::string_view token = NextToken(line); !token.empty(); token = NextToken(line)) {
+				int posIndex, texcoordIndex, normalIndex;
+				valid = ParseIndex(token, positions.size(), posIndex) && ParseIndex(token, texcoords.size(), texcoordIndex)
+					&& ParseIndex(token, normals.size(), normalIndex) && posIndex >= 0;
+				if (!valid)
+					break;
+				// A vertex without a texcoord or normal index keeps the default.
+				VertexPTN vertex;
+				vertex.position = positions[posIndex];
+				if (texcoordIndex >= 0)
+					vertex.texcoord = texcoords[texcoordIndex];
+				if (normalIndex >= 0)
+					vertex.normal = normals[normalIndex];
+				face.push_back(vertex);
 			}
+			if (!valid || face.size() < 3) {
+				++rejectedFaces;
+				continue;
+			}
+			// Faces before any usemtl go to a submesh with the default material.
+			if (pImpl->subMeshes.empty()) {
+				pImpl->subMeshes.emplace_back();
+				pImpl->subMeshes.back().material = pImpl->GetDefaultMaterial();
+				pImpl->subMeshes.back().firstIndex = pImpl->indices.size();
+			}
+			pImpl->vertices.insert(pImpl->vertices.end(), face.begin(), face.end());
+			const int numVertices = (int)face.size();
 
 			// Triangulate the polygon.
 			for (int i = 2; i < numVertices; ++i) {
-				pImpl->subMeshes.back().vertexIndices.push_back(pImpl->numVertices);
-				pImpl->subMeshes.back().vertexIndices.push_back(pImpl->numVertices + i - 1);
-				pImpl->subMeshes.back().vertexIndices.push_back(pImpl->numVertices + i);
+				pImpl->indices.push_back(pImpl->numVertices);
+				pImpl->indices.push_back(pImpl->numVertices + i - 1);
+				pImpl->indices.push_back(pImpl->numVertices + i);
+				pImpl->subMeshes.back().numIndices += 3;
 			}
 			pImpl->numVertices += numVertices;
 			pImpl->numTriangles += numVertices - 2;
 		}
 		else if (type == "usemtl") {
-			std::string mtlName;
-			iss >> mtlName;
+			const std::string mtlName(NextToken(line));
 			pImpl->subMeshes.emplace_back();
 			pImpl->subMeshes.back().material = pImpl->materials[mtlName];
+			pImpl->subMeshes.back().firstIndex = pImpl->indices.size();
 		}
 	}
+	if (rejectedFaces > 0) {
+		std::cerr << "[WARNING] Skipped " << rejectedFaces << " faces with missing or out of range indices in "
+			<< objFilePath << std::endl;
+	}
 
-	fin.close();
+	JobSystem& jobSystem = JobSystem::GetInstance();
+	glm::vec3 minPos = glm::vec3(1e9, 1e9, 1e9);
+	glm::vec3 maxPos = glm::vec3(-1e9, -1e9, -1e9);
+	std::mutex boundsMutex;
+	jobSystem.ParallelFor(pImpl->vertices.size(), VERTEX_GRAIN_SIZE, [&](size_t begin, size_t end) {
+		glm::vec3 chunkMin = glm::vec3(1e9, 1e9, 1e9);
+		glm::vec3 chunkMax = glm::vec3(-1e9, -1e9, -1e9);
+		for (size_t i = begin; i < end; ++i) {
+			chunkMin = glm::min(chunkMin, pImpl->vertices[i].position);
+			chunkMax = glm::max(chunkMax, pImpl->vertices[i].position);
+		}
+		std::lock_guard<std::mutex> lock(boundsMutex);
+		minPos = glm::min(minPos, chunkMin);
+		maxPos = glm::max(maxPos, chunkMax);
+	});
+	pImpl->boundsMin = minPos;
+	pImpl->boundsMax = maxPos;
 
 	if (normalized) {
 		// Normalize the model.
-		glm::vec3 minPos = glm::vec3(1e9, 1e9, 1e9);
-		glm::vec3 maxPos = glm::vec3(-1e9, -1e9, -1e9);
-		for (int i = 0; i < pImpl->numVertices; ++i) {
-			minPos = glm::min(minPos, pImpl->vertices[i].position);
-			maxPos = glm::max(maxPos, pImpl->vertices[i].position);
+		pImpl->objCenter = minPos + (maxPos - minPos) * 0.5f;
+		float maxLen = std::max(maxPos.x - minPos.x, std::max(maxPos.y - minPos.y, maxPos.z - minPos.z));
+		jobSystem.ParallelFor(pImpl->vertices.size(), VERTEX_GRAIN_SIZE, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				pImpl->vertices[i].position = (pImpl->vertices[i].position - pImpl->objCenter) / maxLen;
+			}
+		});
+		pImpl->objExtent = (maxPos - minPos) / maxLen;
+		pImpl->boundsMin = -0.5f * pImpl->objExtent;
+		pImpl->boundsMax = 0.5f * pImpl->objExtent;
+	}
+
+	for (const auto& job : pImpl->textureJobs) {
+		jobSystem.Wait(job);
+	}
+	pImpl->textureJobs.clear();
+	BuildMaterialTable();
+
+	pImpl->loadTimeMs = loadClock.GetElapsedTime() * 1000.0;
+	pImpl->loaderAllocations = arena.GetNumAllocations();
+	pImpl->loaderBlocks = arena.GetNumBlocks();
+	pImpl->loaderBytes = arena.GetCapacity();
+	return true;
+}
+
+// Desc: Map a GLB file and describe each primitive as a submesh over its binary chunk. Only missing
+// normals and the materials are built on the host; the geometry is never copied.
+bool TriangleMesh::LoadFromGlb(const std::filesystem::path& glbFilePath, const bool normalized) {
+	Clock loadClock;
+	pImpl->glb = std::make_unique<GlbFile>();
+	if (!pImpl->glb->Open(glbFilePath)) {
+		pImpl->glb.reset();
+		return false;
+	}
+	const GlbFile& glb = *pImpl->glb;
+
+	// Metallic-roughness to Phong: metals reflect in their base color, dielectrics about 4% white,
+	// and the Blinn-Phong exponent matching a GGX roughness r is 2 / r^4 - 2.
+	RenderResources& resources = RenderResources::GetInstance();
+	auto& materials = resources.GetMaterials();
+	std::vector<MaterialHandle> materialHandles;
+	for (size_t i = 0; i < glb.GetMaterials().size(); ++i) {
+		const GlbMaterial& source = glb.GetMaterials()[i];
+		const MaterialHandle handle = materials.Create();
+		PhongMaterial* material = materials.Get(handle);
+		const glm::vec3 baseColor = glm::vec3(source.baseColor);
+		const float roughness = std::max(source.roughness, 0.01f);
+		material->SetName(source.name);
+		material->SetKa(baseColor);
+		material->SetKd(baseColor);
+		material->SetKs(glm::mix(glm::vec3(0.04f), baseColor, source.metallic));
+		material->SetNs(std::clamp(2.0f / (roughness * roughness * roughness * roughness) - 2.0f, 1.0f, 1024.0f));
+		const GlbImage* image = source.baseColorImage >= 0 ? &glb.GetImages()[source.baseColorImage] : nullptr;
+		if (image != nullptr && (image->bytes > 0 || !image->filePath.empty())) {
+			// Decoded in the background, from the mapping when embedded. glTF texture coordinates
+			// start at the top of the image, as OpenCV rows do, so the image is not flipped.
+			const uint8_t* encoded = glb.GetBinary() + image->offset;
+			pImpl->textureJobs.push_back(JobSystem::GetInstance().Schedule([material, image, encoded]() {
+				auto& textures = RenderResources::GetInstance().GetTextures();
+				material->SetMapKd(image->bytes > 0
+					? textures.Create(image->name, encoded, image->bytes, false)
+					: textures.Create(image->filePath, false));
+			}));
+		}
+		// glTF names are optional and need not be unique; the index keeps the keys apart.
+		pImpl->materials[std::to_string(i) + ":" + source.name] = handle;
+		materialHandles.push_back(handle);
+	}
+
+	// Primitives of mesh instances that share their accessors also share the generated normals.
+	pImpl->generatedNormalsOffset = (glb.GetBinaryBytes() + 3) & ~(size_t)3;
+	std::map<std::pair<size_t, size_t>, size_t> normalsOfStreams;
+	glm::vec3 minPos = glm::vec3(1e9, 1e9, 1e9);
+	glm::vec3 maxPos = glm::vec3(-1e9, -1e9, -1e9);
+	for (const GlbPrimitive& primitive : glb.GetPrimitives()) {
+		SubMesh subMesh;
+		subMesh.position = primitive.position;
+		subMesh.normal = primitive.normal;
+		subMesh.texcoord = primitive.texcoord;
+		subMesh.indexType = primitive.indexType;
+		subMesh.numIndices = primitive.numIndices;
+		if (primitive.indexType != 0) {
+			subMesh.firstIndex = primitive.indexOffset / (primitive.indexType == GL_UNSIGNED_BYTE ? 1
+				: primitive.indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+		}
+		subMesh.localMatrix = primitive.matrix;
+		subMesh.hasLocalMatrix = true;
+
+		if (primitive.normal.size == 0) {
+			const auto key = std::make_pair(primitive.position.offset, primitive.indexType != 0 ? primitive.indexOffset : SIZE_MAX);
+			auto it = normalsOfStreams.find(key);
+			if (it == normalsOfStreams.end()) {
+				const size_t first = pImpl->generatedNormals.size();
+				pImpl->generatedNormals.resize(first + primitive.numVertices);
+				GenerateNormals(glb, primitive, pImpl->generatedNormals.data() + first);
+				it = normalsOfStreams.emplace(key, first).first;
+			}
+			subMesh.normal = { 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+				pImpl->generatedNormalsOffset + it->second * sizeof(glm::vec3) };
+		}
+
+		subMesh.material = primitive.material >= 0 ? materialHandles[primitive.material] : pImpl->GetDefaultMaterial();
+
+		// Bounds of the accessor box corners under the node transform.
+		for (int corner = 0; corner < 8; ++corner) {
+			const glm::vec3 position = glm::vec3(
+				(corner & 1) ? primitive.boundsMax.x : primitive.boundsMin.x,
+				(corner & 2) ? primitive.boundsMax.y : primitive.boundsMin.y,
+				(corner & 4) ? primitive.boundsMax.z : primitive.boundsMin.z);
+			const glm::vec3 transformed = glm::vec3(primitive.matrix * glm::vec4(position, 1.0f));
+			minPos = glm::min(minPos, transformed);
+			maxPos = glm::max(maxPos, transformed);
 		}
+		pImpl->numVertices += (int)primitive.numVertices;
+		pImpl->numTriangles += (int)(primitive.numIndices / 3);
+		pImpl->subMeshes.push_back(subMesh);
+	}
+	pImpl->boundsMin = minPos;
+	pImpl->boundsMax = maxPos;
+
+	if (normalized) {
+		// Normalize the model through the local matrices, as the vertices are used in place.
 		pImpl->objCenter = minPos + (maxPos - minPos) * 0.5f;
 		float maxLen = std::max(maxPos.x - minPos.x, std::max(maxPos.y - minPos.y, maxPos.z - minPos.z));
-		for (int i = 0; i < pImpl->numVertices; ++i) {
-			pImpl->vertices[i].position = (pImpl->vertices[i].position - pImpl->objCenter) / maxLen;
+		const glm::mat4 normalization = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / maxLen))
+			* glm::translate(glm::mat4(1.0f), -pImpl->objCenter);
+		for (auto& subMesh : pImpl->subMeshes) {
+			subMesh.localMatrix = normalization * subMesh.localMatrix;
 		}
 		pImpl->objExtent = (maxPos - minPos) / maxLen;
+		pImpl->boundsMin = -0.5f * pImpl->objExtent;
+		pImpl->boundsMax = 0.5f * pImpl->objExtent;
+	}
+
+	// The material table needs a material per vertex, which would mean copying the vertices,
+	// so GLB meshes keep the per-submesh path.
+	for (const auto& job : pImpl->textureJobs) {
+		JobSystem::GetInstance().Wait(job);
+	}
+	pImpl->textureJobs.clear();
+
+	pImpl->loadTimeMs = loadClock.GetElapsedTime() * 1000.0;
+	return true;
+}
+
+// Desc: Read the header of a binary PLY file. The vertices and faces are only read when the buffers
+// are created, streamed from the file, so the mesh holds no geometry on the host.
+bool TriangleMesh::LoadFromPly(const std::filesystem::path& plyFilePath, const bool normalized) {
+	Clock loadClock;
+	PlyReader reader(PLY_HEADER_BUFFER_BYTES);
+	if (!reader.Open(plyFilePath)) {
+		return false;
+	}
+	if (reader.GetNumFaces() == 0) {
+		std::cerr << "[ERROR] " << plyFilePath << " is a point cloud; sort it with --octree to view it" << std::endl;
+		return false;
+	}
+	pImpl->plyFilePath = plyFilePath;
+	pImpl->plyNormalized = normalized;
+	pImpl->numVertices = (int)reader.GetNumVertices();
+	pImpl->numTriangles = (int)reader.GetNumFaces();	// Exact once streamed, for polygon faces.
+
+	// The bounds are only known once the vertices are read; until then, culling and texture
+	// residency see a box that holds the model.
+	pImpl->boundsMin = glm::vec3(normalized ? -0.5f : -1e9f);
+	pImpl->boundsMax = glm::vec3(normalized ? 0.5f : 1e9f);
+	pImpl->GetDefaultMaterial();
+
+	pImpl->loadTimeMs = loadClock.GetElapsedTime() * 1000.0;
+	return true;
+}
+
+// Desc: Map a chunked mesh and describe every chunk and its proxy as a submesh; none is drawn
+// before StreamChunks() puts it in view.
+bool TriangleMesh::LoadFromChunks(const std::filesystem::path& chunksFilePath, const bool normalized) {
+	Clock loadClock;
+	pImpl->chunkedFile = std::make_unique<ChunkedMeshFile>();
+	if (!pImpl->chunkedFile->Open(chunksFilePath)) {
+		pImpl->chunkedFile.reset();
+		return false;
+	}
+	const ChunkedMeshFile& file = *pImpl->chunkedFile;
+	const ChunkedMeshHeader& header = file.GetHeader();
+	const glm::vec3 minPos = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	const glm::vec3 maxPos = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	pImpl->objCenter = minPos + (maxPos - minPos) * 0.5f;
+	pImpl->boundsMin = minPos;
+	pImpl->boundsMax = maxPos;
+	pImpl->chunkMatrix = glm::mat4(1.0f);
+	if (normalized) {
+		float maxLen = std::max(maxPos.x - minPos.x, std::max(maxPos.y - minPos.y, maxPos.z - minPos.z));
+		maxLen = maxLen > 0.0f ? maxLen : 1.0f;
+		pImpl->chunkMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / maxLen))
+			* glm::translate(glm::mat4(1.0f), -pImpl->objCenter);
+		pImpl->objExtent = (maxPos - minPos) / maxLen;
+		pImpl->boundsMin = -0.5f * pImpl->objExtent;
+		pImpl->boundsMax = 0.5f * pImpl->objExtent;
+	}
+	pImpl->numVertices = (int)std::min<uint64_t>(header.numVertices, INT_MAX);
+	pImpl->numTriangles = (int)std::min<uint64_t>(header.numTriangles, INT_MAX);
+
+	// Chunk buffers hold the vertices, then the indices; the proxy indices follow the proxy
+	// vertices at the start of vboId.
+	SubMesh subMesh;
+	const GLsizei vertexBytes = (GLsizei)header.vertexBytes;
+	subMesh.position = { 3, GL_FLOAT, GL_FALSE, vertexBytes, 0 };
+	subMesh.normal = vertexBytes == 24 ? VertexStream{ 3, GL_FLOAT, GL_FALSE, vertexBytes, 3 * sizeof(float) } : VertexStream();
+	subMesh.texcoord = VertexStream();
+	subMesh.localMatrix = pImpl->chunkMatrix;
+	subMesh.hasLocalMatrix = true;
+	subMesh.material = pImpl->GetDefaultMaterial();
+	const size_t proxyFirstIndex = (size_t)header.numProxyVertices * header.vertexBytes / sizeof(uint32_t);
+	pImpl->chunks.resize(file.GetNumChunks());
+	for (uint32_t i = 0; i < file.GetNumChunks(); ++i) {
+		const MeshChunk& chunk = file.GetChunks()[i];
+		auto& state = pImpl->chunks[i];
+		state.subMesh = subMesh;
+		state.subMesh.firstIndex = (size_t)chunk.numVertices * header.vertexBytes / sizeof(uint32_t);
+		state.subMesh.numIndices = chunk.numIndices;
+		state.proxy = subMesh;
+		state.proxy.firstIndex = proxyFirstIndex + chunk.proxyFirstIndex;
+		state.proxy.numIndices = chunk.proxyNumIndices;
+		state.boundsMin = glm::vec3(chunk.boundsMin[0], chunk.boundsMin[1], chunk.boundsMin[2]);
+		state.boundsMax = glm::vec3(chunk.boundsMax[0], chunk.boundsMax[1], chunk.boundsMax[2]);
+	}
+
+	pImpl->loadTimeMs = loadClock.GetElapsedTime() * 1000.0;
+	return true;
+}
+
+// Desc: Map a cooked mesh and describe its submeshes at their full level of detail. Nothing is
+// parsed but the MTL: the vertices and indices are uploaded from the mapping as they are.
+bool TriangleMesh::LoadFromCooked(const std::filesystem::path& cookedFilePath, const bool normalized) {
+	Clock loadClock;
+	pImpl->cookedFile = std::make_unique<CookedMeshFile>();
+	if (!pImpl->cookedFile->Open(cookedFilePath)) {
+		pImpl->cookedFile.reset();
+		return false;
+	}
+	const CookedMeshFile& file = *pImpl->cookedFile;
+	const CookedMeshHeader& header = file.GetHeader();
+	for (const std::string& library : file.GetMaterialLibraries()) {
+		LoadMtllib(cookedFilePath.parent_path() / library);
+	}
+
+	// Positions are normalized over the quantization cube; its matrix is applied before the
+	// normalization, in the local matrix of every submesh.
+	const glm::vec3 minPos = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	const glm::vec3 maxPos = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	pImpl->objCenter = minPos + (maxPos - minPos) * 0.5f;
+	pImpl->boundsMin = minPos;
+	pImpl->boundsMax = maxPos;
+	glm::mat4 localMatrix = glm::translate(glm::mat4(1.0f), minPos) * glm::scale(glm::mat4(1.0f), glm::vec3(header.scale));
+	if (normalized) {
+		float maxLen = std::max(maxPos.x - minPos.x, std::max(maxPos.y - minPos.y, maxPos.z - minPos.z));
+		maxLen = maxLen > 0.0f ? maxLen : 1.0f;
+		localMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / maxLen))
+			* glm::translate(glm::mat4(1.0f), -pImpl->objCenter) * localMatrix;
+		pImpl->objExtent = (maxPos - minPos) / maxLen;
+		pImpl->boundsMin = -0.5f * pImpl->objExtent;
+		pImpl->boundsMax = 0.5f * pImpl->objExtent;
 	}
+	pImpl->numVertices = (int)header.numVertices;
+	pImpl->numTriangles = (int)std::min<uint64_t>(header.numTriangles, INT_MAX);
+
+	SubMesh subMesh;
+	const GLsizei vertexBytes = (GLsizei)header.vertexBytes;
+	subMesh.position = { 3, GL_UNSIGNED_SHORT, GL_TRUE, vertexBytes, offsetof(CookedVertex, position) };
+	subMesh.normal = { 4, GL_INT_2_10_10_10_REV, GL_TRUE, vertexBytes, offsetof(CookedVertex, normal) };
+	subMesh.texcoord = header.vertexBytes == sizeof(CookedVertex)
+		? VertexStream{ 2, GL_UNSIGNED_SHORT, GL_TRUE, vertexBytes, offsetof(CookedVertex, texcoord) }
+		: VertexStream{ 2, GL_FLOAT, GL_FALSE, vertexBytes, offsetof(CookedVertex, texcoord) };
+	subMesh.indexType = header.indexBytes == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	subMesh.localMatrix = localMatrix;
+	subMesh.hasLocalMatrix = true;
+	for (uint32_t i = 0; i < header.numSubMeshes; ++i) {
+		const auto it = pImpl->materials.find(file.GetMaterialName(i));
+		subMesh.material = it != pImpl->materials.end() ? it->second : pImpl->GetDefaultMaterial();
+		subMesh.firstIndex = file.GetSubMeshes()[i].firstIndex[0];
+		subMesh.numIndices = file.GetSubMeshes()[i].numIndices[0];
+		pImpl->subMeshes.push_back(subMesh);
+	}
+	pImpl->cookedLod = 0;
+
+	// As for GLB meshes, the material table would need a material per vertex, and so a copy of them.
+	for (const auto& job : pImpl->textureJobs) {
+		JobSystem::GetInstance().Wait(job);
+	}
+	pImpl->textureJobs.clear();
+
+	pImpl->loadTimeMs = loadClock.GetElapsedTime() * 1000.0;
 	return true;
 }
 
@@ -199,8 +922,10 @@ bool TriangleMesh::LoadMtllib(const std::filesystem::path& mtlPath) {
 		return false;
 	}
 
+	auto& materials = RenderResources::GetInstance().GetMaterials();
 	std::string line = "";
 	std::string curMtlName = "";
+	PhongMaterial* curMaterial = nullptr;
 	while (std::getline(fin, line)) {
 		std::istringstream iss(line);
 		std::string type;
@@ -209,35 +934,40 @@ bool TriangleMesh::LoadMtllib(const std::filesystem::path& mtlPath) {
 			std::string mtlName;
 			iss >> mtlName;
 			curMtlName = mtlName;
-			pImpl->materials[curMtlName] = std::make_unique<PhongMaterial>();
-			pImpl->materials[curMtlName]->SetName(curMtlName);
+			if (!pImpl->materials[curMtlName].IsValid()) {
+				pImpl->materials[curMtlName] = materials.Create();
+			}
+			curMaterial = materials.Get(pImpl->materials[curMtlName]);
+			curMaterial->SetName(curMtlName);
 		}
 		else if (type == "Ka") {
 			float r, g, b;
 			iss >> r >> g >> b;
-			pImpl->materials[curMtlName]->SetKa(glm::vec3(r, g, b));
+			curMaterial->SetKa(glm::vec3(r, g, b));
 		}
 		else if (type == "Kd") {
 			float r, g, b;
 			iss >> r >> g >> b;
-			pImpl->materials[curMtlName]->SetKd(glm::vec3(r, g, b));
+			curMaterial->SetKd(glm::vec3(r, g, b));
 		}
 		else if (type == "Ks") {
 			float r, g, b;
 			iss >> r >> g >> b;
-			pImpl->materials[curMtlName]->SetKs(glm::vec3(r, g, b));
+			curMaterial->SetKs(glm::vec3(r, g, b));
 		}
 		else if (type == "Ns") {
 			float n;
 			iss >> n;
-			pImpl->materials[curMtlName]->SetNs(n);
+			curMaterial->SetNs(n);
 		}
 		else if (type == "map_Kd") {
+			// Decode in the background; LoadFromFile() waits for it before returning.
 			std::string texFileName;
 			iss >> texFileName;
-			pImpl->materials[curMtlName]->SetMapKd(
-				std::make_shared<ImageTexture>(mtlPath.parent_path() / texFileName)
-			);
+			auto texFilePath = mtlPath.parent_path() / texFileName;
+			pImpl->textureJobs.push_back(JobSystem::GetInstance().Schedule([curMaterial, texFilePath]() {
+				curMaterial->SetMapKd(RenderResources::GetInstance().GetTextures().Create(texFilePath));
+			}));
 		}
 	}
 
@@ -246,100 +976,762 @@ bool TriangleMesh::LoadMtllib(const std::filesystem::path& mtlPath) {
 	return true;
 }
 
-// Desc: Create vertex buffer and index buffer.
+// Desc: Pack the materials of the submeshes into a table and their diffuse maps into a texture
+// array, so the whole mesh renders in one draw. Keeps the per-submesh path when they do not fit.
+void TriangleMesh::BuildMaterialTable() {
+	RenderResources& resources = RenderResources::GetInstance();
+
+	// Table slot of every submesh; the per-submesh path skips submeshes without a material.
+	std::vector<PhongMaterial*> tableMaterials;
+	std::vector<uint32_t> subMeshSlots;
+	for (const auto& subMesh : pImpl->subMeshes) {
+		PhongMaterial* material = resources.GetMaterials().Get(subMesh.material);
+		if (material == nullptr) {
+			return;
+		}
+		auto it = std::find(tableMaterials.begin(), tableMaterials.end(), material);
+		subMeshSlots.push_back((uint32_t)(it - tableMaterials.begin()));
+		if (it == tableMaterials.end()) {
+			tableMaterials.push_back(material);
+		}
+	}
+	if (tableMaterials.empty() || tableMaterials.size() > (size_t)PhongShadingDemoShaderProg::MAX_TABLE_MATERIALS) {
+		return;
+	}
+
+	// One layer per textured material, at the size of the largest texture.
+	std::vector<const ImageTexture*> layerTextures;
+	std::vector<float> materialLayers(tableMaterials.size(), -1.0f);
+	int layerWidth = 0;
+	int layerHeight = 0;
+	for (size_t i = 0; i < tableMaterials.size(); ++i) {
+		const ImageTexture* mapKd = resources.GetTextures().Get(tableMaterials[i]->GetMapKd());
+		if (mapKd == nullptr || mapKd->GetImage().empty()) {
+			continue;
+		}
+		materialLayers[i] = (float)layerTextures.size();
+		layerTextures.push_back(mapKd);
+		layerWidth = std::max(layerWidth, mapKd->GetImage().cols);
+		layerHeight = std::max(layerHeight, mapKd->GetImage().rows);
+	}
+	if (layerTextures.size() > MAX_TEXTURE_ARRAY_LAYERS) {
+		return;
+	}
+	if (!layerTextures.empty()) {
+		pImpl->textureArray = std::make_unique<TextureArray>(
+			std::min(layerWidth, MAX_TEXTURE_ARRAY_SIZE),
+			std::min(layerHeight, MAX_TEXTURE_ARRAY_SIZE),
+			(int)layerTextures.size());
+		JobSystem::GetInstance().ParallelFor(layerTextures.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t layer = begin; layer < end; ++layer) {
+				pImpl->textureArray->SetLayer((int)layer, layerTextures[layer]->GetImage());
+			}
+		});
+	}
+
+	// Materials without specular get Ks = 0 and Ns = 1, which adds nothing and avoids pow(0, 0).
+	pImpl->materialTableFeatures = PHONG_HAS_MATERIAL_TABLE;
+	pImpl->materialTable.resize(tableMaterials.size());
+	for (size_t i = 0; i < tableMaterials.size(); ++i) {
+		const PhongMaterial* material = tableMaterials[i];
+		MaterialTableEntry& entry = pImpl->materialTable[i];
+		entry.Ka = glm::vec4(material->GetKa(), 0.0f);
+		entry.Kd = glm::vec4(material->GetKd(), materialLayers[i]);
+		if (material->GetKs() != glm::vec3(0.0f) && material->GetNs() > 0.0f) {
+			entry.Ks = glm::vec4(material->GetKs(), material->GetNs());
+			pImpl->materialTableFeatures |= PHONG_HAS_SPECULAR;
+		}
+		else {
+			entry.Ks = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+	}
+
+	// Every face corner is its own vertex, so each vertex belongs to exactly one submesh.
+	pImpl->vertexMaterials.assign(pImpl->vertices.size(), 0.0f);
+	for (size_t i = 0; i < pImpl->subMeshes.size(); ++i) {
+		const auto& subMesh = pImpl->subMeshes[i];
+		for (size_t k = subMesh.firstIndex; k < subMesh.firstIndex + subMesh.numIndices; ++k) {
+			pImpl->vertexMaterials[pImpl->indices[k]] = (float)subMeshSlots[i];
+		}
+	}
+
+	// The array replaces the individual textures.
+	for (PhongMaterial* material : tableMaterials) {
+		resources.GetTextures().Destroy(material->GetMapKd());
+		material->SetMapKd(TextureHandle());
+	}
+	pImpl->useMaterialTable = true;
+}
+
+// Desc: Create vertex buffer and index buffer, and queue their data and the textures for upload.
+// The host arrays stay alive with the mesh, so the UploadManager copies straight from them; only the
+// packed positions, which nothing else reads, are freed once their upload is issued.
 void TriangleMesh::CreateBuffers() {
-	glGenBuffers(1, &(pImpl->vboId));
-	glBindBuffer(GL_ARRAY_BUFFER, pImpl->vboId);
-	glBufferData(GL_ARRAY_BUFFER, pImpl->vertices.size() * sizeof(VertexPTN), pImpl->vertices.data(), GL_STATIC_DRAW);
+	RenderResources& resources = RenderResources::GetInstance();
+	if (pImpl->textureArray != nullptr) {
+		pImpl->textureArray->Upload();
+	}
+	for (const auto& [name, materialHandle] : pImpl->materials) {
+		const PhongMaterial* material = resources.GetMaterials().Get(materialHandle);
+		ImageTexture* mapKd = material != nullptr ? resources.GetTextures().Get(material->GetMapKd()) : nullptr;
+		if (mapKd != nullptr) {
+			mapKd->Upload();
+		}
+	}
+
+	// Allocate the buffers and let the UploadManager fill them over the next frames.
+	UploadManager& uploads = UploadManager::GetInstance();
+	auto queueBuffer = [&](GLuint& bufferId, const void* data, const size_t bytes, std::function<void()> onIssued = nullptr) {
+		glGenBuffers(1, &bufferId);
+		glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+		glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+		++pImpl->pendingUploads;
+		uploads.QueueBuffer(this, bufferId, 0, data, bytes, [this, onIssued]() {
+			--pImpl->pendingUploads;
+			if (onIssued) {
+				onIssued();
+			}
+		});
+	};
+
+	if (pImpl->glb != nullptr) {
+		// One buffer holds the vertices and indices: the binary chunk copied straight from the
+		// mapping, then the generated normals.
+		const size_t normalBytes = pImpl->generatedNormals.size() * sizeof(glm::vec3);
+		glGenBuffers(1, &(pImpl->vboId));
+		glBindBuffer(GL_ARRAY_BUFFER, pImpl->vboId);
+		glBufferData(GL_ARRAY_BUFFER, pImpl->generatedNormalsOffset + normalBytes, nullptr, GL_STATIC_DRAW);
+		++pImpl->pendingUploads;
+		uploads.QueueBuffer(this, pImpl->vboId, 0, pImpl->glb->GetBinary(), pImpl->glb->GetBinaryBytes(),
+			[this]() { --pImpl->pendingUploads; });
+		if (normalBytes > 0) {
+			++pImpl->pendingUploads;
+			uploads.QueueBuffer(this, pImpl->vboId, (GLintptr)pImpl->generatedNormalsOffset, pImpl->generatedNormals.data(),
+				normalBytes, [this]() { --pImpl->pendingUploads; });
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
 
+	if (pImpl->chunkedFile != nullptr) {
+		// Only the proxies are uploaded up front; StreamChunks() brings in the chunks in view.
+		const ChunkedMeshFile& file = *pImpl->chunkedFile;
+		queueBuffer(pImpl->vboId, file.GetFileData() + file.GetHeader().proxyOffset, file.GetProxyBytes());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+
+	if (pImpl->cookedFile != nullptr) {
+		const CookedMeshFile& file = *pImpl->cookedFile;
+		const CookedMeshHeader& header = file.GetHeader();
+		queueBuffer(pImpl->vboId, file.GetFileData() + header.vertexOffset, file.GetVertexDataBytes());
+		queueBuffer(pImpl->iboId, file.GetFileData() + header.indexOffset, file.GetIndexDataBytes());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+
+	if (!pImpl->plyFilePath.empty()) {
+		// The vertices stream into vboId and the faces into segment buffers created as they are reached,
+		// through a few chunks that are read in the background and reused once uploaded.
+		pImpl->plyUpload = std::make_shared<PlyUpload>();
+		PlyUpload& upload = *pImpl->plyUpload;
+		if (!upload.reader.Open(pImpl->plyFilePath)) {
+			pImpl->plyUpload.reset();
+			pImpl->loaded = false;
+			return;
+		}
+		upload.chunks.resize(PLY_CHUNKS_IN_FLIGHT);
+		for (auto& chunk : upload.chunks) {
+			chunk.resize(PLY_CHUNK_BYTES);
+			upload.freeChunks.push_back(chunk.data());
+		}
+		glGenBuffers(1, &(pImpl->vboId));
+		glBindBuffer(GL_ARRAY_BUFFER, pImpl->vboId);
+		glBufferData(GL_ARRAY_BUFFER, std::max<size_t>(upload.reader.GetNumVertices() * upload.reader.GetVertexBytes(), 1),
+			nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		++pImpl->pendingUploads;
+		ReadNextPlyChunk();
+		FinishPlyUpload();
+		return;
+	}
+
+	queueBuffer(pImpl->vboId, pImpl->vertices.data(), pImpl->vertices.size() * sizeof(VertexPTN));
+
+	pImpl->positions.resize(pImpl->vertices.size());
+	JobSystem::GetInstance().ParallelFor(pImpl->positions.size(), VERTEX_GRAIN_SIZE, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			pImpl->positions[i] = pImpl->vertices[i].position;
+		}
+	});
+	queueBuffer(pImpl->positionVboId, pImpl->positions.data(), pImpl->positions.size() * sizeof(glm::vec3), [this]() {
+		std::vector<glm::vec3>().swap(pImpl->positions);
+	});
+
+	queueBuffer(pImpl->iboId, pImpl->indices.data(), pImpl->indices.size() * sizeof(unsigned int));
+
+	if (pImpl->useMaterialTable) {
+		queueBuffer(pImpl->materialVboId, pImpl->vertexMaterials.data(), pImpl->vertexMaterials.size() * sizeof(float));
+
+		// Sized for the whole block declared in the shader; unused entries stay zero.
+		std::vector<MaterialTableEntry> table(PhongShadingDemoShaderProg::MAX_TABLE_MATERIALS, MaterialTableEntry());
+		std::copy(pImpl->materialTable.begin(), pImpl->materialTable.end(), table.begin());
+		glGenBuffers(1, &(pImpl->materialTableUboId));
+		glBindBuffer(GL_UNIFORM_BUFFER, pImpl->materialTableUboId);
+		glBufferData(GL_UNIFORM_BUFFER, table.size() * sizeof(MaterialTableEntry), table.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Desc: Start reading the next PLY chunk in the background, if a chunk is free and no read is running.
+// The read chunk is handed back to the GL thread to be uploaded.
+void TriangleMesh::ReadNextPlyChunk() {
+	const std::shared_ptr<PlyUpload> upload = pImpl->plyUpload;
+	if (upload == nullptr || upload->reading || upload->failed || upload->freeChunks.empty()
+		|| (upload->reader.GetVerticesLeft() == 0 && upload->reader.GetFacesLeft() == 0)) {
+		return;
+	}
+	uint8_t* buffer = upload->freeChunks.back();
+	upload->freeChunks.pop_back();
+	upload->reading = true;
+	JobSystem::GetInstance().Schedule([this, upload, buffer]() {
+		const PlyChunk chunk = upload->Read(buffer);
+		JobSystem::GetInstance().PostToMainThread([this, upload, chunk]() {
+			if (upload->cancelled) {
+				return;
+			}
+			upload->reading = false;
+			QueuePlyChunk(chunk);
+		});
+	});
+}
+
+// Desc: Queue the upload of a read PLY chunk, creating the buffer of a segment when its first
+// indices arrive, and read ahead into the next free chunk.
+void TriangleMesh::QueuePlyChunk(const PlyChunk& chunk) {
+	const std::shared_ptr<PlyUpload> upload = pImpl->plyUpload;
+	const PlyReader& reader = upload->reader;
+	if (chunk.count == 0) {
+		upload->freeChunks.push_back(chunk.data);
+		if (reader.HasFailed() || reader.GetVerticesLeft() > 0 || reader.GetFacesLeft() > 0) {
+			if (!reader.HasFailed()) {
+				std::cerr << "[ERROR] A face of " << pImpl->plyFilePath << " has more indices than a segment holds" << std::endl;
+			}
+			upload->failed = true;
+			pImpl->loaded = false;
+			return;
+		}
+		FinishPlyUpload();
+		return;
+	}
+
+	const size_t vertexBytes = reader.GetVertexBytes();
+	GLuint bufferId = pImpl->vboId;
+	size_t offset = chunk.first * vertexBytes;
+	size_t bytes = chunk.count * vertexBytes;
+	if (chunk.indices) {
+		if (chunk.segment == pImpl->subMeshes.size()) {
+			SubMesh subMesh;
+			subMesh.position = { 3, GL_FLOAT, GL_FALSE, (GLsizei)vertexBytes, 0 };
+			subMesh.normal = reader.HasNormals() ? VertexStream{ 3, GL_FLOAT, GL_FALSE, (GLsizei)vertexBytes, 3 * sizeof(float) }
+				: VertexStream();
+			subMesh.texcoord = VertexStream();
+			subMesh.hasLocalMatrix = true;
+			subMesh.material = pImpl->GetDefaultMaterial();
+			glGenBuffers(1, &(subMesh.indexBuffer));
+			glBindBuffer(GL_ARRAY_BUFFER, subMesh.indexBuffer);
+			glBufferData(GL_ARRAY_BUFFER, chunk.segmentCapacity * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			pImpl->subMeshes.push_back(subMesh);
+		}
+		SubMesh& subMesh = pImpl->subMeshes[chunk.segment];
+		subMesh.numIndices = std::max(subMesh.numIndices, chunk.first + chunk.count);
+		bufferId = subMesh.indexBuffer;
+		offset = chunk.first * sizeof(uint32_t);
+		bytes = chunk.count * sizeof(uint32_t);
+	}
+
+	++upload->chunksInFlight;
+	UploadManager::GetInstance().QueueBuffer(this, bufferId, (GLintptr)offset, chunk.data, bytes,
+		[this, upload, data = chunk.data]() {
+			if (upload->cancelled) {
+				return;
+			}
+			--upload->chunksInFlight;
+			upload->freeChunks.push_back(data);
+			ReadNextPlyChunk();
+			FinishPlyUpload();
+		});
+	ReadNextPlyChunk();
+}
+
+// Desc: Once every PLY chunk is uploaded, normalize the model with the bounds gathered while reading,
+// and free the chunks.
+void TriangleMesh::FinishPlyUpload() {
+	const std::shared_ptr<PlyUpload> upload = pImpl->plyUpload;
+	if (upload == nullptr || upload->failed || !upload->IsFinished()) {
+		return;
+	}
+	glm::vec3 minPos = upload->boundsMin;
+	glm::vec3 maxPos = upload->boundsMax;
+	if (upload->verticesRead == 0) {
+		minPos = maxPos = glm::vec3(0.0f);
+	}
+	pImpl->objCenter = minPos + (maxPos - minPos) * 0.5f;
+	pImpl->boundsMin = minPos;
+	pImpl->boundsMax = maxPos;
+	glm::mat4 normalization = glm::mat4(1.0f);
+	if (pImpl->plyNormalized) {
+		float maxLen = std::max(maxPos.x - minPos.x, std::max(maxPos.y - minPos.y, maxPos.z - minPos.z));
+		maxLen = maxLen > 0.0f ? maxLen : 1.0f;
+		normalization = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / maxLen))
+			* glm::translate(glm::mat4(1.0f), -pImpl->objCenter);
+		pImpl->objExtent = (maxPos - minPos) / maxLen;
+		pImpl->boundsMin = -0.5f * pImpl->objExtent;
+		pImpl->boundsMax = 0.5f * pImpl->objExtent;
+	}
+	size_t numIndices = 0;
 	for (auto& subMesh : pImpl->subMeshes) {
-		glGenBuffers(1, &(subMesh.iboId));
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, subMesh.iboId);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, subMesh.vertexIndices.size() * sizeof(unsigned int), subMesh.vertexIndices.data(), GL_STATIC_DRAW);
+		subMesh.localMatrix = normalization;
+		numIndices += subMesh.numIndices;
 	}
+	pImpl->numTriangles = (int)(numIndices / 3);
+
+	const double hostMB = (upload->chunks.size() * PLY_CHUNK_BYTES + upload->reader.GetBufferBytes()) / (1024.0 * 1024.0);
+	std::cout << "[*] Streamed " << pImpl->plyFilePath.filename() << " in " << upload->clock.GetElapsedTime() * 1000.0
+		<< " ms (" << pImpl->numVertices << " vertices, " << pImpl->numTriangles << " triangles in "
+		<< pImpl->subMeshes.size() << " segments, " << hostMB << " MB of host buffers)" << std::endl;
+	pImpl->plyUpload.reset();
+	--pImpl->pendingUploads;
 }
 
 // Desc: Release vertex buffer and index buffer.
+// Note: a mesh that was never uploaded makes no GL call, so it can be destroyed on any thread.
 void TriangleMesh::ReleaseBuffers() {
+	if (pImpl->vboId == 0) {
+		return;
+	}
+	UploadManager::GetInstance().Cancel(this);
+	pImpl->pendingUploads = 0;
+	if (!pImpl->plyFilePath.empty()) {
+		// A read job may still hold the upload; it is dropped when its result reaches the GL thread.
+		if (pImpl->plyUpload != nullptr) {
+			pImpl->plyUpload->cancelled = true;
+			pImpl->plyUpload.reset();
+		}
+		for (auto& subMesh : pImpl->subMeshes) {
+			glDeleteBuffers(1, &(subMesh.indexBuffer));
+		}
+		pImpl->subMeshes.clear();
+	}
+	for (auto& state : pImpl->chunks) {
+		glDeleteBuffers(1, &(state.subMesh.vertexBuffer));
+		state.subMesh.vertexBuffer = state.subMesh.indexBuffer = 0;
+		state.loading = state.resident = false;
+	}
+	if (pImpl->chunkedFile != nullptr) {
+		pImpl->chunkBytes = 0;
+		pImpl->chunkLoadsInFlight = 0;
+		pImpl->subMeshes.clear();
+	}
+	pImpl->positions.clear();
+	pImpl->positions.shrink_to_fit();
 	glDeleteBuffers(1, &(pImpl->vboId));
-	for (auto& subMesh : pImpl->subMeshes) {
-		glDeleteBuffers(1, &(subMesh.iboId));
+	pImpl->vboId = 0;
+	glDeleteBuffers(1, &(pImpl->positionVboId));
+	pImpl->positionVboId = 0;
+	glDeleteBuffers(1, &(pImpl->iboId));
+	pImpl->iboId = 0;
+	if (pImpl->materialVboId != 0) {
+		glDeleteBuffers(1, &(pImpl->materialVboId));
+		pImpl->materialVboId = 0;
+		glDeleteBuffers(1, &(pImpl->materialTableUboId));
+		pImpl->materialTableUboId = 0;
+	}
+}
+
+// Desc: Report the mip level each texture needs, taking every texture as mapped once over the
+// projected bounds of the mesh.
+void TriangleMesh::RequestTextureLevels(const glm::mat4& worldMatrix, Camera& camera) const {
+	TextureResidency& residency = TextureResidency::GetInstance();
+	const glm::mat4 MVP = camera.GetProjMatrix() * camera.GetViewMatrix() * worldMatrix;
+	const glm::vec2 screenExtent = residency.GetScreenExtent(MVP, pImpl->boundsMin, pImpl->boundsMax);
+	if (screenExtent.x <= 0.0f || screenExtent.y <= 0.0f) {
+		return;
+	}
+	if (pImpl->textureArray != nullptr) {
+		residency.Request(pImpl->textureArray.get(), screenExtent);
+	}
+	RenderResources& resources = RenderResources::GetInstance();
+	for (const auto& [name, materialHandle] : pImpl->materials) {
+		const PhongMaterial* material = resources.GetMaterials().Get(materialHandle);
+		ImageTexture* mapKd = material != nullptr ? resources.GetTextures().Get(material->GetMapKd()) : nullptr;
+		if (mapKd != nullptr) {
+			residency.Request(mapKd, screenExtent);
+		}
+	}
+}
+
+// Desc: Pick the chunks to hold from their size on screen, evict and upload to match within the
+// budget, and list the chunks in view to draw, as their proxy until they are resident.
+void TriangleMesh::StreamChunks(const glm::mat4& worldMatrix, Camera& camera) {
+	if (pImpl->chunkedFile == nullptr || !IsResident()) {
+		return;
+	}
+	const ChunkedMeshFile& file = *pImpl->chunkedFile;
+	const TextureResidency& residency = TextureResidency::GetInstance();
+	const glm::mat4 MVP = camera.GetProjMatrix() * camera.GetViewMatrix() * worldMatrix * pImpl->chunkMatrix;
+	const uint64_t frame = ++pImpl->chunkFrame;
+
+	// The chunks in view, largest on screen first.
+	auto& order = pImpl->chunkOrder;
+	order.clear();
+	for (uint32_t i = 0; i < (uint32_t)pImpl->chunks.size(); ++i) {
+		auto& state = pImpl->chunks[i];
+		const glm::vec2 screenExtent = residency.GetScreenExtent(MVP, state.boundsMin, state.boundsMax);
+		state.screenSize = std::max(screenExtent.x, screenExtent.y);
+		state.wanted = false;
+		if (screenExtent.x > 0.0f && screenExtent.y > 0.0f) {
+			state.lastVisibleFrame = frame;
+			order.push_back(i);
+		}
+	}
+	std::sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) {
+		return pImpl->chunks[a].screenSize > pImpl->chunks[b].screenSize;
+	});
+
+	// Wanted: the largest that fit in the budget together.
+	size_t wantedBytes = 0;
+	for (const uint32_t i : order) {
+		auto& state = pImpl->chunks[i];
+		const size_t bytes = file.GetChunkBytes(file.GetChunks()[i]);
+		if (state.screenSize < CHUNK_MIN_PIXELS) {
+			break;
+		}
+		if (wantedBytes + bytes <= CHUNK_BUDGET_BYTES) {
+			state.wanted = true;
+			wantedBytes += bytes;
+		}
+	}
+
+	// Room is made by evicting what is not wanted, out of view longest first, then smallest on screen.
+	std::vector<uint32_t> victims;
+	for (uint32_t i = 0; i < (uint32_t)pImpl->chunks.size(); ++i) {
+		const auto& state = pImpl->chunks[i];
+		if (state.resident && !state.wanted) {
+			victims.push_back(i);
+		}
+	}
+	std::sort(victims.begin(), victims.end(), [&](const uint32_t a, const uint32_t b) {
+		const auto& stateA = pImpl->chunks[a];
+		const auto& stateB = pImpl->chunks[b];
+		return stateA.lastVisibleFrame != stateB.lastVisibleFrame ? stateA.lastVisibleFrame < stateB.lastVisibleFrame
+			: stateA.screenSize < stateB.screenSize;
+	});
+	size_t nextVictim = 0;
+
+	UploadManager& uploads = UploadManager::GetInstance();
+	for (const uint32_t i : order) {
+		auto& state = pImpl->chunks[i];
+		if (pImpl->chunkLoadsInFlight >= CHUNK_LOADS_IN_FLIGHT) {
+			break;
+		}
+		if (!state.wanted || state.resident || state.loading) {
+			continue;
+		}
+		const MeshChunk& chunk = file.GetChunks()[i];
+		const size_t bytes = file.GetChunkBytes(chunk);
+		while (pImpl->chunkBytes + bytes > CHUNK_BUDGET_BYTES && nextVictim < victims.size()) {
+			const uint32_t victimIndex = victims[nextVictim++];
+			auto& victim = pImpl->chunks[victimIndex];
+			glDeleteBuffers(1, &(victim.subMesh.vertexBuffer));
+			victim.subMesh.vertexBuffer = victim.subMesh.indexBuffer = 0;
+			victim.resident = false;
+			pImpl->chunkBytes -= file.GetChunkBytes(file.GetChunks()[victimIndex]);
+		}
+		if (pImpl->chunkBytes + bytes > CHUNK_BUDGET_BYTES) {
+			break;
+		}
+
+		GLuint bufferId = 0;
+		glGenBuffers(1, &bufferId);
+		glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+		glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		state.subMesh.vertexBuffer = state.subMesh.indexBuffer = bufferId;
+		state.loading = true;
+		pImpl->chunkBytes += bytes;
+		++pImpl->chunkLoadsInFlight;
+		file.GetMappedFile().WillNeed(chunk.offset, bytes);
+		uploads.QueueBuffer(this, bufferId, 0, file.GetFileData() + chunk.offset, bytes, [this, i]() {
+			auto& loaded = pImpl->chunks[i];
+			loaded.loading = false;
+			loaded.resident = true;
+			--pImpl->chunkLoadsInFlight;
+		});
+	}
+
+	pImpl->subMeshes.clear();
+	for (const uint32_t i : order) {
+		const auto& state = pImpl->chunks[i];
+		if (state.resident) {
+			pImpl->subMeshes.push_back(state.subMesh);
+		}
+		else if (state.proxy.numIndices > 0) {
+			pImpl->subMeshes.push_back(state.proxy);
+		}
+	}
+}
+
+// Desc: The error of a level is a fraction of the quantization cube, the side of which is the largest
+// extent of the bounds, so it is measured against the size of the whole mesh on screen.
+void TriangleMesh::SelectLod(const glm::mat4& worldMatrix, Camera& camera) {
+	if (pImpl->cookedFile == nullptr) {
+		return;
+	}
+	const CookedMeshFile& file = *pImpl->cookedFile;
+	const CookedMeshHeader& header = file.GetHeader();
+	const glm::mat4 MVP = camera.GetProjMatrix() * camera.GetViewMatrix() * worldMatrix;
+	const glm::vec2 screenExtent = TextureResidency::GetInstance().GetScreenExtent(MVP, pImpl->boundsMin, pImpl->boundsMax);
+	if (screenExtent.x <= 0.0f || screenExtent.y <= 0.0f) {
+		return;
+	}
+	const float screenSize = std::max(screenExtent.x, screenExtent.y);
+	uint32_t lod = 0;
+	while (lod + 1 < header.numLods && header.lodErrors[lod + 1] * screenSize <= LOD_ERROR_PIXELS) {
+		++lod;
+	}
+	if (lod == pImpl->cookedLod) {
+		return;
+	}
+	pImpl->cookedLod = lod;
+	for (uint32_t i = 0; i < header.numSubMeshes; ++i) {
+		pImpl->subMeshes[i].firstIndex = file.GetSubMeshes()[i].firstIndex[lod];
+		pImpl->subMeshes[i].numIndices = file.GetSubMeshes()[i].numIndices[lod];
 	}
 }
 
-// Desc: Render the mesh.
-void TriangleMesh::Render(
-	const std::shared_ptr<PhongShadingDemoShaderProg>& shader,
+// Desc: Render the mesh by recording its submeshes in parallel into command lists.
+bool TriangleMesh::Render(
+	CommandQueue& commandQueue,
+	const uint32_t sortKey,
+	PhongShaderVariants& shaderVariants,
 	const glm::mat4& worldMatrix,
-	const glm::vec3& ambientLight,
-	const std::shared_ptr<DirectionalLight>& dirLight,
-	const std::shared_ptr<PointLight>& pointLight,
-	const std::shared_ptr<SpotLight>& spotLight,
-	const std::shared_ptr<Camera>& camera
+	const LightBlock& lightBlock,
+	Camera& camera
 ) const {
-	glm::mat4x4 V = camera->GetViewMatrix();
+	if (!IsResident()) {
+		return true;
+	}
+	glm::mat4x4 V = camera.GetViewMatrix();
 	glm::mat4x4 normalMatrix = glm::transpose(glm::inverse(V * worldMatrix));
-	glm::mat4x4 MVP = camera->GetProjMatrix() * V * worldMatrix;
-	auto cameraPos = camera->GetPosition();
+	glm::mat4x4 MVP = GetMVP(camera.GetProjMatrix(), V, worldMatrix);
+	auto cameraPos = camera.GetPosition();
 
-	for (const auto& subMesh : pImpl->subMeshes) {
-		shader->Bind();
+	const unsigned int lightFeatures = lightBlock.GetFeatures();
+	if (pImpl->useMaterialTable) {
+		return RenderMaterialTable(commandQueue, sortKey, shaderVariants.Get(lightFeatures | pImpl->materialTableFeatures),
+			worldMatrix, V, normalMatrix, MVP, cameraPos);
+	}
 
-		glUniformMatrix4fv(shader->GetLocM(), 1, GL_FALSE, glm::value_ptr(worldMatrix));
-		glUniformMatrix4fv(shader->GetLocV(), 1, GL_FALSE, glm::value_ptr(V));
-		glUniformMatrix4fv(shader->GetLocNM(), 1, GL_FALSE, glm::value_ptr(normalMatrix));
-		glUniformMatrix4fv(shader->GetLocMVP(), 1, GL_FALSE, glm::value_ptr(MVP));
-		glUniform3fv(shader->GetLocCameraPos(), 1, glm::value_ptr(cameraPos));
-		// Material properties.
-		glUniform3fv(shader->GetLocKa(), 1, glm::value_ptr(subMesh.material->GetKa()));
-		glUniform3fv(shader->GetLocKd(), 1, glm::value_ptr(subMesh.material->GetKd()));
-		glUniform3fv(shader->GetLocKs(), 1, glm::value_ptr(subMesh.material->GetKs()));
-		glUniform1f(shader->GetLocNs(), subMesh.material->GetNs());
-		if (subMesh.material->GetMapKd() != nullptr) {
-			subMesh.material->GetMapKd()->Bind(GL_TEXTURE0);
-			glUniform1i(shader->GetLocMapKd(), 0);
+	// Submitting and finishing a program needs the GL context, so resolve the variants here,
+	// along with the material and texture of every submesh. The tables are frame scratch.
+	// A variant still compiling leaves its submeshes out of this frame instead of stalling it.
+	RenderResources& resources = RenderResources::GetInstance();
+	Arena& scratch = FrameArena::Get();
+	const size_t numSubMeshes = pImpl->subMeshes.size();
+	std::pmr::vector<PhongShadingDemoShaderProg*> shaders(numSubMeshes, nullptr, &scratch);
+	std::pmr::vector<const PhongMaterial*> materials(numSubMeshes, nullptr, &scratch);
+	std::pmr::vector<GLuint> textureIds(numSubMeshes, 0, &scratch);
+	bool complete = true;
+	for (size_t i = 0; i < numSubMeshes; ++i) {
+		const PhongMaterial* material = resources.GetMaterials().Get(pImpl->subMeshes[i].material);
+		if (material == nullptr) {
+			continue;
 		}
-		// Light data.
-		if (dirLight != nullptr) {
-			glUniform3fv(shader->GetLocDirLightDir(), 1, glm::value_ptr(dirLight->GetDirection()));
-			glUniform3fv(shader->GetLocDirLightRadiance(), 1, glm::value_ptr(dirLight->GetRadiance()));
+		const ImageTexture* mapKd = resources.GetTextures().Get(material->GetMapKd());
+		unsigned int features = lightFeatures;
+		if (mapKd != nullptr)
+			features |= PHONG_HAS_TEXTURE;
+		if (material->GetKs() != glm::vec3(0.0f) && material->GetNs() > 0.0f)
+			features |= PHONG_HAS_SPECULAR;
+		if (pImpl->subMeshes[i].normal.size == 0)
+			features |= PHONG_FACE_NORMALS;
+		auto* shader = shaderVariants.Get(features);
+		if (shader != nullptr && !shader->IsReady()) {
+			complete = false;
+			continue;
 		}
-		if (pointLight != nullptr) {
-			glUniform3fv(shader->GetLocPointLightPos(), 1, glm::value_ptr(pointLight->GetPosition()));
-			glUniform3fv(shader->GetLocPointLightIntensity(), 1, glm::value_ptr(pointLight->GetIntensity()));
+		if (shader != nullptr && shader->Finish()) {
+			shaders[i] = shader;
+			materials[i] = material;
+			textureIds[i] = mapKd != nullptr ? mapKd->GetTextureId() : 0;
 		}
-		if (spotLight != nullptr) {
-			glUniform3fv(shader->GetLocSpotLightPos(), 1, glm::value_ptr(spotLight->GetPosition()));
-			glUniform3fv(shader->GetLocSpotLightDir(), 1, glm::value_ptr(spotLight->GetDirection()));
-			glUniform3fv(shader->GetLocSpotLightIntensity(), 1, glm::value_ptr(spotLight->GetIntensity()));
-			glUniform1f(shader->GetLocSpotLightCutoff(), spotLight->GetCutoffDeg());
-			glUniform1f(shader->GetLocSpotLightTotalWidth(), spotLight->GetTotalWidthDeg());
+	}
+
+	// The lists come from the queue, one per call and group, so a mesh drawn at several nodes
+	// records each of them.
+	const size_t numGroups = (numSubMeshes + SUBMESH_GROUP_SIZE - 1) / SUBMESH_GROUP_SIZE;
+	JobSystem::GetInstance().ParallelFor(numGroups, 1, [&](size_t groupBegin, size_t groupEnd) {
+		for (size_t group = groupBegin; group < groupEnd; ++group) {
+			CommandList& commandList = *commandQueue.Acquire(((uint64_t)sortKey << 32) | group);
+
+			const size_t end = std::min(numSubMeshes, (group + 1) * SUBMESH_GROUP_SIZE);
+			for (size_t i = group * SUBMESH_GROUP_SIZE; i < end; ++i) {
+				const auto& subMesh = pImpl->subMeshes[i];
+				const auto* shader = shaders[i];
+				const auto* material = materials[i];
+				if (shader == nullptr) {
+					continue;
+				}
+				commandList.BindProgram(shader->GetProgramId());
+
+				if (subMesh.hasLocalMatrix) {
+					const glm::mat4 M = worldMatrix * subMesh.localMatrix;
+					commandList.SetUniform(shader->GetLocM(), M);
+					commandList.SetUniform(shader->GetLocNM(), glm::transpose(glm::inverse(V * M)));
+					commandList.SetUniform(shader->GetLocMVP(), GetMVP(camera.GetProjMatrix(), V, M));
+				}
+				else {
+					commandList.SetUniform(shader->GetLocM(), worldMatrix);
+					commandList.SetUniform(shader->GetLocNM(), normalMatrix);
+					commandList.SetUniform(shader->GetLocMVP(), MVP);
+				}
+				commandList.SetUniform(shader->GetLocV(), V);
+				commandList.SetUniform(shader->GetLocCameraPos(), cameraPos);
+				// Material properties.
+				commandList.SetUniform(shader->GetLocKa(), material->GetKa());
+				commandList.SetUniform(shader->GetLocKd(), material->GetKd());
+				commandList.SetUniform(shader->GetLocKs(), material->GetKs());
+				commandList.SetUniform(shader->GetLocNs(), material->GetNs());
+				if (textureIds[i] != 0) {
+					commandList.BindTexture(GL_TEXTURE0, GL_TEXTURE_2D, textureIds[i]);
+					commandList.SetUniform(shader->GetLocMapKd(), (GLint)0);
+				}
+				// Light data is read from the LightBlock uniform buffer.
+
+				RecordSubMesh(commandList, subMesh);
+			}
+			commandList.BindProgram(0);
+			commandQueue.Submit(&commandList);
 		}
-		glUniform3fv(shader->GetLocAmbientLight(), 1, glm::value_ptr(ambientLight));
+	});
+	return complete;
+}
 
-		RenderSubMesh(subMesh);
+// Desc: Record the whole mesh as one draw, with the material of each vertex read from the table.
+bool TriangleMesh::RenderMaterialTable(
+	CommandQueue& commandQueue,
+	const uint32_t sortKey,
+	PhongShadingDemoShaderProg* shader,
+	const glm::mat4& worldMatrix,
+	const glm::mat4& V,
+	const glm::mat4& normalMatrix,
+	const glm::mat4& MVP,
+	const glm::vec3& cameraPos
+) const {
+	if (shader != nullptr && !shader->IsReady()) {
+		return false;
+	}
+	if (shader == nullptr || !shader->Finish()) {
+		return true;
+	}
+	CommandList& commandList = *commandQueue.Acquire((uint64_t)sortKey << 32);
+	commandList.BindProgram(shader->GetProgramId());
 
-		shader->Unbind();
+	commandList.SetUniform(shader->GetLocM(), worldMatrix);
+	commandList.SetUniform(shader->GetLocV(), V);
+	commandList.SetUniform(shader->GetLocNM(), normalMatrix);
+	commandList.SetUniform(shader->GetLocMVP(), MVP);
+	commandList.SetUniform(shader->GetLocCameraPos(), cameraPos);
+	commandList.BindBufferBase(GL_UNIFORM_BUFFER, PhongShadingDemoShaderProg::MATERIAL_TABLE_BINDING_POINT,
+		pImpl->materialTableUboId);
+	if (pImpl->textureArray != nullptr) {
+		commandList.BindTexture(GL_TEXTURE0, GL_TEXTURE_2D_ARRAY, pImpl->textureArray->GetTextureId());
+		commandList.SetUniform(shader->GetLocMapKdArray(), (GLint)0);
 	}
+
+	commandList.SetVertexAttrib(0, pImpl->vboId, 3, sizeof(VertexPTN), offsetof(VertexPTN, position));
+	commandList.SetVertexAttrib(1, pImpl->vboId, 3, sizeof(VertexPTN), offsetof(VertexPTN, normal));
+	commandList.SetVertexAttrib(2, pImpl->vboId, 2, sizeof(VertexPTN), offsetof(VertexPTN, texcoord));
+	commandList.SetVertexAttrib(3, pImpl->materialVboId, 1, sizeof(float), 0);
+	commandList.DrawElements(GL_TRIANGLES, pImpl->iboId, (GLsizei)pImpl->indices.size());
+	commandList.DisableVertexAttribs(0xF);
+
+	commandList.BindProgram(0);
+	commandQueue.Submit(&commandList);
+	return true;
 }
 
-// Desc: Render the submesh.
-void TriangleMesh::RenderSubMesh(const TriangleMesh::SubMesh& subMesh) const {
-	glBindBuffer(GL_ARRAY_BUFFER, pImpl->vboId);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, subMesh.iboId);
+// Desc: Render depth only, with the position stream and all submeshes under one shader.
+void TriangleMesh::RenderDepth(
+	DepthOnlyShaderProg& shader,
+	const glm::mat4& worldMatrix,
+	Camera& camera
+) const {
+	if (!IsResident()) {
+		return;
+	}
+	const glm::mat4x4 P = camera.GetProjMatrix();
+	const glm::mat4x4 V = camera.GetViewMatrix();
 
+	shader.Bind();
 	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPTN), (void*)offsetof(VertexPTN, position));
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexPTN), (void*)offsetof(VertexPTN, normal));
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VertexPTN), (void*)offsetof(VertexPTN, texcoord));
+	if (pImpl->positionVboId == 0) {
+		// GLB, PLY, chunk and cooked positions are interleaved or not as the file has them, quantized for
+		// cooked meshes, and carry their local transform.
+		for (const auto& subMesh : pImpl->subMeshes) {
+			glBindBuffer(GL_ARRAY_BUFFER, pImpl->GetVertexBuffer(subMesh));
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pImpl->GetIndexBuffer(subMesh));
+			const glm::mat4 subMeshMVP = GetMVP(P, V, subMesh.hasLocalMatrix ? worldMatrix * subMesh.localMatrix : worldMatrix);
+			glUniformMatrix4fv(shader.GetLocMVP(), 1, GL_FALSE, glm::value_ptr(subMeshMVP));
+			glVertexAttribPointer(0, subMesh.position.size, subMesh.position.type, subMesh.position.normalized,
+				subMesh.position.stride, (void*)(uintptr_t)subMesh.position.offset);
+			if (subMesh.indexType != 0) {
+				const size_t indexBytes = subMesh.indexType == GL_UNSIGNED_BYTE ? 1 : subMesh.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+				glDrawElements(GL_TRIANGLES, (GLsizei)subMesh.numIndices, subMesh.indexType,
+					(void*)(uintptr_t)(subMesh.firstIndex * indexBytes));
+			}
+			else {
+				glDrawArrays(GL_TRIANGLES, 0, (GLsizei)subMesh.numIndices);
+			}
+		}
+	}
+	else {
+		const glm::mat4 MVP = GetMVP(P, V, worldMatrix);
+		glUniformMatrix4fv(shader.GetLocMVP(), 1, GL_FALSE, glm::value_ptr(MVP));
+		glBindBuffer(GL_ARRAY_BUFFER, pImpl->positionVboId);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pImpl->iboId);
+		glDrawElements(GL_TRIANGLES, (GLsizei)pImpl->indices.size(), GL_UNSIGNED_INT, 0);
+	}
+	glDisableVertexAttribArray(0);
 
-	glDrawElements(GL_TRIANGLES, subMesh.vertexIndices.size(), GL_UNSIGNED_INT, 0);
+	shader.Unbind();
+}
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
+// Desc: Record the submesh.
+// GLB meshes index out of the vertex buffer; a submesh without normals or texcoords leaves their attribute disabled.
+void TriangleMesh::RecordSubMesh(CommandList& commandList, const TriangleMesh::SubMesh& subMesh) const {
+	uint32_t attribMask = 0;
+	const VertexStream* streams[3] = { &subMesh.position, &subMesh.normal, &subMesh.texcoord };
+	for (GLuint index = 0; index < 3; ++index) {
+		const VertexStream& stream = *streams[index];
+		if (stream.size != 0) {
+			commandList.SetVertexAttrib(index, pImpl->GetVertexBuffer(subMesh), stream.size, stream.stride, stream.offset, stream.type, stream.normalized);
+			attribMask |= 1u << index;
+		}
+	}
+
+	if (subMesh.indexType != 0) {
+		commandList.DrawElements(GL_TRIANGLES, pImpl->GetIndexBuffer(subMesh), (GLsizei)subMesh.numIndices, subMesh.firstIndex, subMesh.indexType);
+	}
+	else {
+		commandList.DrawArrays(GL_TRIANGLES, 0, (GLsizei)subMesh.numIndices);
+	}
+
+	commandList.DisableVertexAttribs(attribMask);
 }
 
 // Desc: Print mesh information.
@@ -348,10 +1740,30 @@ void TriangleMesh::PrintMeshInfo() const {
 	std::cout << "# Vertices: " << pImpl->numVertices << std::endl;
 	std::cout << "# Triangles: " << pImpl->numTriangles << std::endl;
 	std::cout << "# Submeshes: " << pImpl->subMeshes.size() << std::endl;
+	if (pImpl->useMaterialTable) {
+		std::cout << "Per frame: 1 draw call, " << (pImpl->textureArray != nullptr ? 1 : 0)
+			<< " texture bind (" << pImpl->materialTable.size() << " materials in the table, "
+			<< (pImpl->textureArray != nullptr ? pImpl->textureArray->GetNumLayers() : 0) << " texture layers)" << std::endl;
+	}
+	else {
+		std::cout << "Per frame: " << pImpl->subMeshes.size() << " draw calls (material table not used)" << std::endl;
+	}
+	if (pImpl->cookedFile != nullptr) {
+		const CookedMeshHeader& header = pImpl->cookedFile->GetHeader();
+		std::cout << "Cooked: " << header.vertexBytes << " bytes per vertex, " << header.indexBytes << " per index, "
+			<< header.numLods << " levels of detail, level " << pImpl->cookedLod << " drawn" << std::endl;
+	}
+	if (pImpl->chunkedFile != nullptr) {
+		std::cout << "Chunks: " << pImpl->chunks.size() << " streamed within " << CHUNK_BUDGET_BYTES / (1024 * 1024)
+			<< " MB, " << pImpl->chunkedFile->GetHeader().numProxyIndices / 3 << " proxy triangles" << std::endl;
+	}
 	std::cout << "Center: (" << pImpl->objCenter.x << " , "
 		<< pImpl->objCenter.y << " , " << pImpl->objCenter.z << ")" << std::endl;
 	std::cout << "Extent: (" << pImpl->objExtent.x << " , "
 		<< pImpl->objExtent.y << " , " << pImpl->objExtent.z << ")" << std::endl;
+	std::cout << "Load time: " << pImpl->loadTimeMs << " ms" << std::endl;
+	std::cout << "Loader scratch: " << pImpl->loaderAllocations << " allocations from "
+		<< pImpl->loaderBlocks << " heap block(s), " << pImpl->loaderBytes / 1024 << " KB" << std::endl;
 }
 
 } // namespace opengl_homework
\ No newline at end of file
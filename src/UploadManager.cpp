@@ -0,0 +1,312 @@
+#include "UploadManager.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Project headers.
+#include "Clock.h"
+
+// Largest slice issued as one GL call.
+static constexpr size_t MAX_CHUNK_BYTES = 1024 * 1024;
+// Ring allocations start on this boundary.
+static constexpr size_t RING_ALIGNMENT = 64;
+// Mip levels up to this size are uploaded at once, so the texture can be sampled right away.
+static constexpr size_t IMMEDIATE_LEVEL_BYTES = 16 * 1024;
+
+UploadManager& UploadManager::GetInstance() {
+	static UploadManager instance;
+	return instance;
+}
+
+UploadManager::~UploadManager() {
+	for (const auto& fence : frameFences) {
+		glDeleteSync(fence.sync);
+	}
+	if (ringBuffer != 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, ringBuffer);
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &ringBuffer);
+	}
+}
+
+void UploadManager::SetFrameBudget(const size_t bytes, const double microseconds) {
+	frameByteBudget = bytes;
+	frameTimeBudgetUs = microseconds;
+}
+
+void UploadManager::QueueBuffer(const void* owner, const GLuint buffer, const GLintptr offset, const void* data,
+	const size_t bytes, std::function<void()> onComplete) {
+	const uint8_t* source = (const uint8_t*)data;
+	const size_t numQueued = chunks.size();
+	for (size_t begin = 0; begin < bytes; begin += MAX_CHUNK_BYTES) {
+		Chunk chunk;
+		chunk.owner = owner;
+		chunk.data = source + begin;
+		chunk.bytes = std::min(MAX_CHUNK_BYTES, bytes - begin);
+		chunk.target = GL_COPY_WRITE_BUFFER;
+		chunk.object = buffer;
+		chunk.offset = offset + (GLintptr)begin;
+		chunks.push_back(std::move(chunk));
+	}
+	SetOnComplete(numQueued, std::move(onComplete));
+}
+
+void UploadManager::QueueTexture(const void* owner, const GLenum target, const GLuint texture, const GLint level,
+	const TextureLevel& data, const GLenum format, const size_t bytesPerPixel, std::function<void()> onComplete) {
+	const size_t numQueued = chunks.size();
+	const size_t rowBytes = (size_t)data.width * bytesPerPixel;
+	const GLsizei rowsPerChunk = (GLsizei)std::max<size_t>(1, MAX_CHUNK_BYTES / std::max<size_t>(1, rowBytes));
+	for (GLsizei layer = 0; layer < data.depth; ++layer) {
+		for (GLsizei y = 0; y < data.height; y += rowsPerChunk) {
+			Chunk chunk;
+			chunk.owner = owner;
+			chunk.height = std::min(rowsPerChunk, data.height - y);
+			chunk.data = data.data + ((size_t)layer * data.height + y) * rowBytes;
+			chunk.bytes = (size_t)chunk.height * rowBytes;
+			chunk.target = target;
+			chunk.object = texture;
+			chunk.level = level;
+			chunk.yoffset = y;
+			chunk.zoffset = layer;
+			chunk.width = data.width;
+			chunk.format = format;
+			chunks.push_back(std::move(chunk));
+		}
+	}
+	SetOnComplete(numQueued, std::move(onComplete));
+}
+
+// Desc: Attach the callback to the last chunk of a request; run it now if the request was empty.
+void UploadManager::SetOnComplete(const size_t numQueuedBefore, std::function<void()> onComplete) {
+	if (!onComplete) {
+		return;
+	}
+	if (chunks.size() == numQueuedBefore) {
+		onComplete();
+		return;
+	}
+	chunks.back().onComplete = std::move(onComplete);
+}
+
+void UploadManager::UploadMipChain(const void* owner, const GLenum target, const GLuint texture,
+	const GLint internalFormat, const GLenum format, const size_t bytesPerPixel, const std::vector<TextureLevel>& levels) {
+	if (levels.empty()) {
+		return;
+	}
+	const GLint maxLevel = (GLint)levels.size() - 1;
+
+	// Allocate every level; fill the coarse tail of the chain right away.
+	glBindTexture(target, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	GLint baseLevel = maxLevel + 1;
+	for (GLint level = maxLevel; level >= 0; --level) {
+		const TextureLevel& data = levels[level];
+		const size_t levelBytes = (size_t)data.width * data.height * data.depth * bytesPerPixel;
+		const bool immediate = baseLevel == level + 1 && levelBytes <= IMMEDIATE_LEVEL_BYTES;
+		const void* pixels = immediate ? data.data : nullptr;
+		if (target == GL_TEXTURE_2D_ARRAY) {
+			glTexImage3D(target, level, internalFormat, data.width, data.height, data.depth,
+				0, format, GL_UNSIGNED_BYTE, pixels);
+		}
+		else {
+			glTexImage2D(target, level, internalFormat, data.width, data.height,
+				0, format, GL_UNSIGNED_BYTE, pixels);
+		}
+		if (immediate) {
+			baseLevel = level;
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, baseLevel);
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, maxLevel);
+	glBindTexture(target, 0);
+
+	// Stream the finer levels; each one becomes the base level once it is complete.
+	for (GLint level = baseLevel - 1; level >= 0; --level) {
+		QueueTexture(owner, target, texture, level, levels[level], format, bytesPerPixel, [target, texture, level]() {
+			glBindTexture(target, texture);
+			glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, level);
+			glBindTexture(target, 0);
+		});
+	}
+}
+
+void UploadManager::Cancel(const void* owner) {
+	for (auto& chunk : chunks) {
+		if (chunk.owner != owner || chunk.cancelled) {
+			continue;
+		}
+		chunk.cancelled = true;
+		chunk.onComplete = nullptr;
+		if (chunk.stagingJob.IsValid() && !chunk.stagingJob.IsDone()) {
+			JobSystem::GetInstance().Wait(chunk.stagingJob);
+		}
+	}
+}
+
+// Desc: Issue in queue order, so ring space is handed back in the order it was reserved.
+void UploadManager::Pump() {
+	if (!ringCreated) {
+		CreateRing();
+	}
+	RetireFrames();
+
+	Clock clock;
+	size_t issuedBytes = 0;
+	size_t fencedRingBytes = 0;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (ringBuffer != 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, ringBuffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ringBuffer);
+	}
+	while (!chunks.empty()) {
+		Chunk& chunk = chunks.front();
+		if (!chunk.cancelled) {
+			if (ringBuffer != 0 && (!chunk.reserved || !chunk.stagingJob.IsDone())) {
+				break;
+			}
+			if (issuedBytes > 0 && (issuedBytes + chunk.bytes > frameByteBudget
+				|| clock.GetElapsedTime() * 1e6 > frameTimeBudgetUs)) {
+				break;
+			}
+			Issue(chunk);
+			issuedBytes += chunk.bytes;
+			if (chunk.onComplete) {
+				chunk.onComplete();
+			}
+		}
+		fencedRingBytes += chunk.reserved ? chunk.ringBytes : 0;
+		chunks.pop_front();
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	if (fencedRingBytes > 0) {
+		frameFences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), fencedRingBytes });
+	}
+	bytesIssuedLastFrame = issuedBytes;
+
+	Stage();
+}
+
+size_t UploadManager::GetPendingBytes() const {
+	size_t bytes = 0;
+	for (const auto& chunk : chunks) {
+		bytes += chunk.cancelled ? 0 : chunk.bytes;
+	}
+	return bytes;
+}
+
+// Desc: Create and map the staging ring, or fall back to uploads from host memory.
+void UploadManager::CreateRing() {
+	ringCreated = true;
+	if (!GLEW_ARB_buffer_storage) {
+		std::cout << "[*] ARB_buffer_storage is not available; uploads are issued from host memory" << std::endl;
+		return;
+	}
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &ringBuffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, ringBuffer);
+	glBufferStorage(GL_COPY_READ_BUFFER, ringCapacity, nullptr, flags);
+	ringData = (uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, ringCapacity, flags);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	if (ringData == nullptr) {
+		std::cerr << "[WARNING] Failed to map the upload ring; uploads are issued from host memory" << std::endl;
+		glDeleteBuffers(1, &ringBuffer);
+		ringBuffer = 0;
+	}
+}
+
+// Desc: Hand back the ring space of the frames the GPU has finished copying from.
+void UploadManager::RetireFrames() {
+	while (!frameFences.empty()) {
+		const GLenum status = glClientWaitSync(frameFences.front().sync, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(frameFences.front().sync);
+		ringUsed -= frameFences.front().ringBytes;
+		frameFences.pop_front();
+	}
+}
+
+// Desc: Reserve ring space for the next chunks and copy them in on the workers,
+// keeping up to two frames of budget staged ahead.
+void UploadManager::Stage() {
+	if (ringBuffer == 0) {
+		return;
+	}
+	size_t stagedBytes = 0;
+	for (auto& chunk : chunks) {
+		if (stagedBytes >= 2 * frameByteBudget) {
+			break;
+		}
+		if (chunk.cancelled) {
+			continue;
+		}
+		if (!chunk.reserved) {
+			if (!Reserve(chunk.bytes, chunk.ringOffset, chunk.ringBytes)) {
+				break;
+			}
+			chunk.reserved = true;
+			uint8_t* destination = ringData + chunk.ringOffset;
+			const uint8_t* source = chunk.data;
+			const size_t bytes = chunk.bytes;
+			chunk.stagingJob = JobSystem::GetInstance().Schedule([destination, source, bytes]() {
+				std::memcpy(destination, source, bytes);
+			});
+		}
+		stagedBytes += chunk.bytes;
+	}
+}
+
+// Desc: Take contiguous space after the head, wrapping to the start when the end is too short.
+bool UploadManager::Reserve(const size_t bytes, size_t& offset, size_t& reservedBytes) {
+	const size_t alignedBytes = (bytes + RING_ALIGNMENT - 1) / RING_ALIGNMENT * RING_ALIGNMENT;
+	if (ringUsed == 0) {
+		ringHead = 0;
+	}
+	size_t padding = 0;
+	offset = ringHead;
+	if (ringHead + alignedBytes > ringCapacity) {
+		padding = ringCapacity - ringHead;
+		offset = 0;
+	}
+	if (ringUsed + padding + alignedBytes > ringCapacity) {
+		return false;
+	}
+	ringHead = offset + alignedBytes;
+	reservedBytes = padding + alignedBytes;
+	ringUsed += reservedBytes;
+	return true;
+}
+
+void UploadManager::Issue(const Chunk& chunk) const {
+	// From the ring the source is an offset into the bound buffer, otherwise a host pointer.
+	const void* source = ringBuffer != 0 ? (const void*)(uintptr_t)chunk.ringOffset : (const void*)chunk.data;
+	if (chunk.target == GL_COPY_WRITE_BUFFER) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, chunk.object);
+		if (ringBuffer != 0) {
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)chunk.ringOffset, chunk.offset, chunk.bytes);
+		}
+		else {
+			glBufferSubData(GL_COPY_WRITE_BUFFER, chunk.offset, chunk.bytes, source);
+		}
+		return;
+	}
+	glBindTexture(chunk.target, chunk.object);
+	if (chunk.target == GL_TEXTURE_2D_ARRAY) {
+		glTexSubImage3D(chunk.target, chunk.level, 0, chunk.yoffset, chunk.zoffset, chunk.width, chunk.height, 1,
+			chunk.format, GL_UNSIGNED_BYTE, source);
+	}
+	else {
+		glTexSubImage2D(chunk.target, chunk.level, 0, chunk.yoffset, chunk.width, chunk.height,
+			chunk.format, GL_UNSIGNED_BYTE, source);
+	}
+	glBindTexture(chunk.target, 0);
+}
@@ -0,0 +1,122 @@
+// Project headers.
+#include "Clock.h"
+#include "JobSystem.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Empty jobs per overhead run; enough that the clock resolution does not matter.
+static constexpr size_t OVERHEAD_JOBS = 200000;
+// Iterations of the scaling kernel, split over the threads taking part.
+static constexpr uint64_t SCALING_ITERATIONS = 200000000;
+static constexpr int NUM_RUNS = 5;
+
+// Desc: Busy work with no memory traffic, so the scaling measures the scheduler and not the bus.
+static uint64_t Spin(uint64_t seed, const uint64_t iterations) {
+	for (uint64_t i = 0; i < iterations; ++i) {
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+	}
+	return seed;
+}
+
+// Desc: Best of NUM_RUNS, in seconds; the first run also warms the workers up.
+template<typename F>
+static double Measure(F&& run) {
+	double best = 0.0;
+	for (int i = 0; i < NUM_RUNS; ++i) {
+		Clock clock;
+		run();
+		const double seconds = clock.GetElapsedTime();
+		best = i == 0 ? seconds : std::min(best, seconds);
+	}
+	return best;
+}
+
+int main() {
+	// Start the workers on this thread, as the viewer does.
+	JobSystem& jobs = JobSystem::GetInstance();
+	const int numThreads = jobs.GetNumWorkers() + 1;
+	std::cout << "[*] JobSystem: " << jobs.GetNumWorkers() << " workers + the main thread" << std::endl;
+
+	// Per-job overhead: schedule, run, finish and wait for empty jobs. From the main thread they go
+	// through the shared queue; from a worker they go to its own deque and are stolen by the others.
+	std::atomic<size_t> counter = 0;
+	const double mainSeconds = Measure([&]() {
+		std::vector<JobHandle> handles;
+		handles.reserve(OVERHEAD_JOBS);
+		for (size_t i = 0; i < OVERHEAD_JOBS; ++i) {
+			handles.push_back(jobs.Schedule([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); }));
+		}
+		for (const JobHandle& handle : handles) {
+			jobs.Wait(handle);
+		}
+	});
+	const double workerSeconds = Measure([&]() {
+		const JobHandle root = jobs.Schedule([&]() {
+			std::vector<JobHandle> handles;
+			handles.reserve(OVERHEAD_JOBS);
+			for (size_t i = 0; i < OVERHEAD_JOBS; ++i) {
+				handles.push_back(jobs.Schedule([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); }));
+			}
+			for (const JobHandle& handle : handles) {
+				jobs.Wait(handle);
+			}
+		});
+		jobs.Wait(root);
+	});
+	const double parallelForSeconds = Measure([&]() {
+		jobs.ParallelFor(OVERHEAD_JOBS, 1, [&counter](const size_t begin, const size_t end) {
+			counter.fetch_add(end - begin, std::memory_order_relaxed);
+		});
+	});
+	std::cout << "[*] Per-job overhead: " << mainSeconds * 1e9 / OVERHEAD_JOBS << " ns scheduled from the main thread, "
+		<< workerSeconds * 1e9 / OVERHEAD_JOBS << " ns from a worker; ParallelFor over " << OVERHEAD_JOBS
+		<< " empty items: " << parallelForSeconds * 1e6 << " us" << std::endl;
+
+	// Shutdown: jobs nobody waits on must all have run once WaitForAll returns.
+	const size_t numScheduled = counter.load() + OVERHEAD_JOBS;
+	for (size_t i = 0; i < OVERHEAD_JOBS; ++i) {
+		jobs.Schedule([&counter]() { counter.fetch_add(1, std::memory_order_relaxed); });
+	}
+	jobs.WaitForAll();
+	if (counter.load() != numScheduled) {
+		std::cerr << "[ERROR] WaitForAll returned with " << numScheduled - counter.load() << " jobs not run" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// Scaling: the same work split into one chunk per thread taking part. With fewer chunks than
+	// threads only that many threads can help, so each row is the speedup on that many cores.
+	std::vector<uint64_t> sinks(numThreads);
+	const double serialSeconds = Measure([&]() { sinks[0] = Spin(1, SCALING_ITERATIONS); });
+	std::cout << "[*] Scaling of " << SCALING_ITERATIONS << " iterations (" << serialSeconds * 1e3 << " ms serial):" << std::endl;
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < numThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(numThreads);
+	for (const int threads : threadCounts) {
+		const double seconds = Measure([&]() {
+			jobs.ParallelFor((size_t)threads, 1, [&](const size_t begin, const size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					sinks[i] = Spin(i + 1, SCALING_ITERATIONS / threads);
+				}
+			});
+		});
+		std::cout << "    " << threads << " threads: " << seconds * 1e3 << " ms, speedup " << serialSeconds / seconds
+			<< ", efficiency " << serialSeconds / seconds / threads * 100.0 << "%" << std::endl;
+	}
+
+	// Keep the results alive so the work is not optimized away.
+	uint64_t sink = counter.load();
+	for (const uint64_t value : sinks) {
+		sink ^= value;
+	}
+	return sink == 42 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,285 @@
+// Project headers.
+#include "ChunkedMeshFile.h"
+#include "Clock.h"
+#include "CookedMeshFile.h"
+#include "Hash.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MipChainFile.h"
+#include "ModelCatalog.h"
+#include "PlyReader.h"
+#include "PointCloudFile.h"
+
+// C++ STL headers.
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using opengl_homework::HashBytes;
+using opengl_homework::ModelCatalog;
+using opengl_homework::ModelInfo;
+
+static constexpr uint32_t MANIFEST_MAGIC = 0x4B4F434D;	// "MCOK".
+// Bump when a builder changes its output, so the whole library is cooked again.
+static constexpr uint32_t MANIFEST_VERSION = 1;
+
+/**
+ * @brief What the last cook of a model was made from.
+*/
+struct CookRecord
+{
+	std::string source;			// Generic path, as walked from the library root.
+	uint64_t bytes = 0;
+	int64_t writeTime = 0;
+	uint64_t contentHash = 0;
+	std::string output;
+};
+
+enum class CookResult { NothingToCook, UpToDate, Cooked, Failed };
+
+// Desc: Last write time of a file as a plain integer, or 0 if it does not exist.
+static int64_t GetWriteTime(const std::filesystem::path& path) {
+	std::error_code ec;
+	auto time = std::filesystem::last_write_time(path, ec);
+	return ec ? 0 : (int64_t)time.time_since_epoch().count();
+}
+
+// Desc: Read the records of the last cook, keyed by source. A missing or foreign manifest is empty.
+static std::map<std::string, CookRecord> LoadManifest(const std::filesystem::path& manifestPath) {
+	std::map<std::string, CookRecord> records;
+	std::ifstream fin(manifestPath, std::ios::binary);
+	uint32_t header[2] = {};
+	if (!fin.read((char*)header, sizeof(header)) || header[0] != MANIFEST_MAGIC || header[1] != MANIFEST_VERSION) {
+		return records;
+	}
+	auto getString = [&](std::string& value) {
+		uint32_t size = 0;
+		if (!fin.read((char*)&size, sizeof(size)) || size > 64 * 1024) {
+			return false;
+		}
+		value.resize(size);
+		return (bool)fin.read(value.data(), size);
+	};
+	CookRecord record;
+	while (getString(record.source) && fin.read((char*)&record.bytes, sizeof(record.bytes))
+		&& fin.read((char*)&record.writeTime, sizeof(record.writeTime))
+		&& fin.read((char*)&record.contentHash, sizeof(record.contentHash)) && getString(record.output)) {
+		records[record.source] = record;
+	}
+	return records;
+}
+
+// Desc: Write the records through a temporary file, so a crash never leaves a half-written manifest.
+static bool SaveManifest(const std::filesystem::path& manifestPath, const std::vector<CookRecord>& records) {
+	std::string buffer;
+	auto put = [&](const void* data, const size_t size) { buffer.append((const char*)data, size); };
+	auto putString = [&](const std::string& value) {
+		const uint32_t size = (uint32_t)value.size();
+		put(&size, sizeof(size));
+		buffer.append(value);
+	};
+	put(&MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC));
+	put(&MANIFEST_VERSION, sizeof(MANIFEST_VERSION));
+	for (const CookRecord& record : records) {
+		putString(record.source);
+		put(&record.bytes, sizeof(record.bytes));
+		put(&record.writeTime, sizeof(record.writeTime));
+		put(&record.contentHash, sizeof(record.contentHash));
+		putString(record.output);
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(manifestPath.parent_path(), ec);
+	auto tmpPath = manifestPath;
+	tmpPath += ".tmp";
+	{
+		std::ofstream fout(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!fout.write(buffer.data(), (std::streamsize)buffer.size())) {
+			std::cerr << "[ERROR] Failed to write manifest: " << tmpPath << std::endl;
+			return false;
+		}
+	}
+	std::filesystem::rename(tmpPath, manifestPath, ec);
+	if (ec) {
+		std::cerr << "[ERROR] Failed to replace manifest: " << manifestPath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Desc: The file a model directory is cooked from: its PLY, else its OBJ. GLB models load as they are.
+static std::filesystem::path GetCookSource(const std::filesystem::path& modelDir) {
+	const std::string name = modelDir.filename().string();
+	std::error_code ec;
+	const std::filesystem::path plyFilePath = modelDir / (name + ".ply");
+	return std::filesystem::exists(plyFilePath, ec) ? plyFilePath : modelDir / (name + ".obj");
+}
+
+// Desc: Cook one model directory: a PLY mesh becomes a chunked mesh, a PLY point cloud an octree and
+// an OBJ a cooked mesh, next to the source where the catalog prefers them. The source is hashed only
+// when its size or mtime changed, so touching a file does not cook it again.
+static CookResult CookModel(const std::filesystem::path& modelDir, const CookRecord* previous, const bool force,
+	CookRecord& record) {
+	const std::string name = modelDir.filename().string();
+	const std::filesystem::path source = GetCookSource(modelDir);
+	std::error_code ec;
+	record.source = source.generic_string();
+	record.bytes = (uint64_t)std::filesystem::file_size(source, ec);
+	if (ec) {
+		return CookResult::NothingToCook;
+	}
+	record.writeTime = GetWriteTime(source);
+
+	const bool isObj = source.extension() == ".obj";
+	bool hasFaces = true;
+	if (!isObj) {
+		PlyReader reader(64 * 1024);
+		if (!reader.Open(source)) {
+			return CookResult::Failed;
+		}
+		hasFaces = reader.GetNumFaces() > 0;
+	}
+	const std::filesystem::path output = modelDir / (name + (isObj ? ".cmesh" : hasFaces ? ".chunks" : ".octree"));
+	record.output = output.generic_string();
+	const bool outputExists = std::filesystem::exists(output, ec);
+	const bool sameOutput = previous != nullptr && previous->output == record.output && outputExists;
+	if (!force && sameOutput && previous->bytes == record.bytes && previous->writeTime == record.writeTime) {
+		record.contentHash = previous->contentHash;
+		return CookResult::UpToDate;
+	}
+
+	MappedFile sourceFile;
+	if (!sourceFile.Open(source)) {
+		std::cerr << "[ERROR] Cannot open file " << source << std::endl;
+		return CookResult::Failed;
+	}
+	record.contentHash = HashBytes(sourceFile.GetData(), sourceFile.GetSize());
+	sourceFile.Close();
+	if (!force && sameOutput && previous->contentHash == record.contentHash) {
+		return CookResult::UpToDate;
+	}
+
+	const bool built = isObj ? CookedMeshFile::Build(source, output)
+		: hasFaces ? ChunkedMeshFile::Build(source, output) : PointCloudFile::Build(source, output);
+	return built ? CookResult::Cooked : CookResult::Failed;
+}
+
+// Desc: Cook the mip chain of a diffuse map, flipped as the OBJ loader flips it, unless the chain
+// next to it was made from the image as it is now.
+static CookResult CookTexture(const std::filesystem::path& imagePath, const bool force) {
+	std::error_code ec;
+	if (!std::filesystem::exists(imagePath, ec)) {
+		return CookResult::NothingToCook;
+	}
+	MipChainFile cooked;
+	if (!force && cooked.Open(imagePath, true)) {
+		return CookResult::UpToDate;
+	}
+	return MipChainFile::Build(imagePath, true) ? CookResult::Cooked : CookResult::Failed;
+}
+
+int main(int argc, char** argv) {
+	// Usage: model_cook [--force] [<library root>]
+	// The root holds models/, textures/ and cache/, as the working directory of the viewer does.
+	bool force = false;
+	std::filesystem::path root = ".";
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--force") == 0) {
+			force = true;
+		}
+		else {
+			root = argv[i];
+		}
+	}
+	const std::filesystem::path modelDir = root / "models";
+	const std::filesystem::path manifestPath = root / "cache" / "model_cook.bin";
+
+	// Start the workers on this thread; the models are cooked on all of them.
+	JobSystem& jobs = JobSystem::GetInstance();
+	Clock cookClock;
+
+	std::vector<std::filesystem::path> modelDirs;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(modelDir, ec)) {
+		if (entry.is_directory()) {
+			modelDirs.push_back(entry.path());
+		}
+	}
+	if (ec) {
+		std::cerr << "[ERROR] Cannot read the model directory " << modelDir << std::endl;
+		return 1;
+	}
+	std::sort(modelDirs.begin(), modelDirs.end());
+
+	// One model per job. PointCloudFile::Build also splits its chunks over the workers; ChunkedMeshFile::Build
+	// runs whole on the worker that picked its model.
+	const std::map<std::string, CookRecord> previous = LoadManifest(manifestPath);
+	std::vector<CookRecord> records(modelDirs.size());
+	std::vector<CookResult> results(modelDirs.size(), CookResult::NothingToCook);
+	jobs.ParallelFor(modelDirs.size(), 1, [&](const size_t begin, const size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const auto it = previous.find(GetCookSource(modelDirs[i]).generic_string());
+			results[i] = CookModel(modelDirs[i], it != previous.end() ? &it->second : nullptr, force, records[i]);
+		}
+	});
+
+	size_t counts[4] = {};
+	std::vector<CookRecord> cooked;
+	for (size_t i = 0; i < modelDirs.size(); ++i) {
+		++counts[(int)results[i]];
+		if (results[i] == CookResult::UpToDate || results[i] == CookResult::Cooked) {
+			cooked.push_back(records[i]);
+		}
+	}
+	SaveManifest(manifestPath, cooked);
+
+	// The diffuse maps of the cooked OBJ models, once each however many models share them. Their
+	// chains record the image they were made from, so they need no manifest.
+	std::set<std::filesystem::path> textureSet;
+	for (const CookRecord& record : cooked) {
+		ModelInfo info;
+		if (std::filesystem::path(record.output).extension() == ".cmesh" && ModelCatalog::ScanModel(record.output, info)) {
+			for (const auto& texture : info.textures) {
+				textureSet.insert(texture.lexically_normal());
+			}
+		}
+	}
+	const std::vector<std::filesystem::path> textures(textureSet.begin(), textureSet.end());
+	std::vector<CookResult> textureResults(textures.size(), CookResult::NothingToCook);
+	jobs.ParallelFor(textures.size(), 1, [&](const size_t begin, const size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			textureResults[i] = CookTexture(textures[i], force);
+		}
+	});
+	size_t textureCounts[4] = {};
+	for (const CookResult result : textureResults) {
+		++textureCounts[(int)result];
+	}
+	const double cookSeconds = cookClock.GetElapsedTime();
+
+	// Point the catalog at the cooked outputs now, so the viewer starts without scanning.
+	ModelCatalog catalog(root / "cache" / "model_catalog.bin");
+	catalog.Load();
+	catalog.Refresh(modelDir, root / "textures");
+	catalog.Save();
+
+	// Throughput counts only the models cooked; the skipped ones cost a stat or a hash and are reported apart.
+	const size_t numCooked = counts[(int)CookResult::Cooked];
+	std::cout << "[*] Cooked " << numCooked << " of " << modelDirs.size() << " models in " << cookSeconds << " s ("
+		<< (numCooked > 0 && cookSeconds > 0.0 ? numCooked / cookSeconds : 0.0) << " models/s on "
+		<< jobs.GetNumWorkers() + 1 << " threads), " << counts[(int)CookResult::Failed] << " failed" << std::endl;
+	std::cout << "[*] Skipped " << counts[(int)CookResult::UpToDate] + counts[(int)CookResult::NothingToCook]
+		<< " models: " << counts[(int)CookResult::UpToDate] << " up to date, "
+		<< counts[(int)CookResult::NothingToCook] << " with nothing to cook" << std::endl;
+	std::cout << "[*] Mip chains of " << textures.size() << " textures: " << textureCounts[(int)CookResult::Cooked]
+		<< " cooked, " << textureCounts[(int)CookResult::UpToDate] << " up to date, "
+		<< textureCounts[(int)CookResult::NothingToCook] << " missing, " << textureCounts[(int)CookResult::Failed]
+		<< " failed" << std::endl;
+	return counts[(int)CookResult::Failed] + textureCounts[(int)CookResult::Failed] > 0 ? 1 : 0;
+}
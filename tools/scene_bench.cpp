@@ -0,0 +1,207 @@
+// GLM headers.
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Project headers.
+#include "Clock.h"
+#include "CommandList.h"
+#include "JobSystem.h"
+#include "SceneStore.h"
+
+// C++ STL headers.
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using opengl_homework::SceneNodeId;
+using opengl_homework::SceneStore;
+using opengl_homework::TriangleMesh;
+
+// 1000 roots of 99 children each: 100k objects, two levels deep.
+static constexpr int NUM_ROOTS = 1000;
+static constexpr int CHILDREN_PER_ROOT = 99;
+static constexpr int NUM_FRAMES = 100;
+// Roots moved per frame in the sparse run: 1% of the scene is dirty.
+static constexpr int SPARSE_ROOTS = 10;
+// Nodes and submesh groups of the instancing check, recorded over a few frames.
+static constexpr int INSTANCED_NODES = 64;
+static constexpr int INSTANCED_GROUPS = 3;
+static constexpr int INSTANCED_FRAMES = 3;
+
+/**
+ * @brief The node layout SceneStore replaced: one heap object per node holding
+ * its mesh, transforms and bounds, reached through its parent pointer and
+ * recomputed every frame.
+*/
+class SceneObject
+{
+public:
+	void Update() {
+		worldMatrix = parent != nullptr ? parent->worldMatrix * localMatrix : localMatrix;
+		const glm::vec3 center = 0.5f * (localBoundsMin + localBoundsMax);
+		const glm::vec3 halfExtent = 0.5f * (localBoundsMax - localBoundsMin);
+		const glm::vec3 worldCenter = glm::vec3(worldMatrix * glm::vec4(center, 1.0f));
+		const glm::vec3 worldHalfExtent =
+			glm::abs(glm::vec3(worldMatrix[0])) * halfExtent.x +
+			glm::abs(glm::vec3(worldMatrix[1])) * halfExtent.y +
+			glm::abs(glm::vec3(worldMatrix[2])) * halfExtent.z;
+		worldBoundsMin = worldCenter - worldHalfExtent;
+		worldBoundsMax = worldCenter + worldHalfExtent;
+	}
+
+	std::shared_ptr<TriangleMesh> mesh;
+	SceneObject* parent = nullptr;
+	glm::mat4 localMatrix = glm::mat4(1.0f);
+	glm::mat4 worldMatrix = glm::mat4(1.0f);
+	glm::vec3 localBoundsMin = glm::vec3(-0.5f);
+	glm::vec3 localBoundsMax = glm::vec3(0.5f);
+	glm::vec3 worldBoundsMin = glm::vec3(0.0f);
+	glm::vec3 worldBoundsMax = glm::vec3(0.0f);
+};
+
+// Desc: The local matrix of a node in a frame: roots turn, children sit on a ring around them.
+static glm::mat4 GetLocalMatrix(const int frame, const int index, const bool isRoot) {
+	if (isRoot) {
+		return glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3((float)index, 0.0f, 0.0f)),
+			0.01f * (float)frame, glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+	const float angle = 0.0634f * (float)index;
+	return glm::translate(glm::mat4(1.0f), glm::vec3(std::cos(angle), 0.0f, std::sin(angle)));
+}
+
+// Desc: Record one mesh at several nodes as TriangleMesh::Render does, one list per node and submesh
+// group taken from the queue, and check every recording reaches the queue intact, frame after frame.
+static bool CheckInstancedRecording(JobSystem& jobs) {
+	CommandQueue queue;
+	for (int frame = 0; frame < INSTANCED_FRAMES; ++frame) {
+		for (int node = 0; node < INSTANCED_NODES; ++node) {
+			jobs.ParallelFor(INSTANCED_GROUPS, 1, [&](const size_t groupBegin, const size_t groupEnd) {
+				for (size_t group = groupBegin; group < groupEnd; ++group) {
+					CommandList& commandList = *queue.Acquire(((uint64_t)node << 32) | group);
+					commandList.SetUniform((GLint)group, (GLfloat)node);
+					commandList.DrawArrays(GL_TRIANGLES, 0, 3);
+					queue.Submit(&commandList);
+				}
+			});
+		}
+		const std::vector<CommandList*>& lists = queue.Collect();
+		if (lists.size() != (size_t)INSTANCED_NODES * INSTANCED_GROUPS) {
+			std::cerr << "[ERROR] Frame " << frame << " replays " << lists.size() << " lists instead of "
+				<< INSTANCED_NODES * INSTANCED_GROUPS << std::endl;
+			return false;
+		}
+		for (size_t i = 0; i < lists.size(); ++i) {
+			const uint64_t expectedKey = ((uint64_t)(i / INSTANCED_GROUPS) << 32) | (i % INSTANCED_GROUPS);
+			if (lists[i]->GetSortKey() != expectedKey || lists[i]->GetNumCommands() != 2) {
+				std::cerr << "[ERROR] Frame " << frame << " lost the recording of node " << i / INSTANCED_GROUPS
+					<< ", group " << i % INSTANCED_GROUPS << std::endl;
+				return false;
+			}
+		}
+	}
+	std::cout << "[*] One mesh recorded at " << INSTANCED_NODES << " nodes: every list replayed once" << std::endl;
+	return true;
+}
+
+// Desc: Print one run as nodes updated per second and per frame time.
+static void Report(const char* name, const double seconds, const size_t numUpdated) {
+	std::cout << "    " << name << ": " << seconds * 1e3 / NUM_FRAMES << " ms/frame, "
+		<< (double)numUpdated / seconds / 1e6 << " M nodes/s" << std::endl;
+}
+
+int main() {
+	// Start the workers on this thread, as the viewer does.
+	JobSystem& jobs = JobSystem::GetInstance();
+	const size_t numNodes = (size_t)NUM_ROOTS * (1 + CHILDREN_PER_ROOT);
+	if (!CheckInstancedRecording(jobs)) {
+		return EXIT_FAILURE;
+	}
+
+	// Both layouts get the same hierarchy, each parent created before its children.
+	std::vector<std::unique_ptr<SceneObject>> objects;
+	SceneStore store;
+	std::vector<SceneObject*> rootObjects;
+	std::vector<SceneNodeId> rootNodes;
+	for (int root = 0; root < NUM_ROOTS; ++root) {
+		objects.push_back(std::make_unique<SceneObject>());
+		SceneObject* rootObject = objects.back().get();
+		rootObject->localMatrix = GetLocalMatrix(0, root, true);
+		rootObjects.push_back(rootObject);
+		const SceneNodeId rootNode = store.Create();
+		store.SetLocalMatrix(rootNode, rootObject->localMatrix);
+		store.SetLocalBounds(rootNode, rootObject->localBoundsMin, rootObject->localBoundsMax);
+		rootNodes.push_back(rootNode);
+		for (int child = 0; child < CHILDREN_PER_ROOT; ++child) {
+			objects.push_back(std::make_unique<SceneObject>());
+			SceneObject* childObject = objects.back().get();
+			childObject->parent = rootObject;
+			childObject->localMatrix = GetLocalMatrix(0, child, false);
+			const SceneNodeId childNode = store.Create(rootNode);
+			store.SetLocalMatrix(childNode, childObject->localMatrix);
+			store.SetLocalBounds(childNode, childObject->localBoundsMin, childObject->localBoundsMax);
+		}
+	}
+	store.UpdateTransforms();
+	std::cout << "[*] " << numNodes << " scene objects, " << NUM_FRAMES << " frames, " << jobs.GetNumWorkers() + 1
+		<< " threads" << std::endl;
+
+	// Every root moves every frame, so every object is recomputed in both layouts.
+	std::cout << "[*] Every object moving:" << std::endl;
+	Clock clock;
+	for (int frame = 1; frame <= NUM_FRAMES; ++frame) {
+		for (int root = 0; root < NUM_ROOTS; ++root) {
+			rootObjects[root]->localMatrix = GetLocalMatrix(frame, root, true);
+		}
+		for (const auto& object : objects) {
+			object->Update();
+		}
+	}
+	Report("SceneObject per node", clock.GetElapsedTime(), numNodes * NUM_FRAMES);
+
+	size_t numUpdated = 0;
+	clock.Reset();
+	for (int frame = 1; frame <= NUM_FRAMES; ++frame) {
+		for (int root = 0; root < NUM_ROOTS; ++root) {
+			store.SetLocalMatrix(rootNodes[root], GetLocalMatrix(frame, root, true));
+		}
+		store.UpdateTransforms();
+		numUpdated += store.GetNumUpdated();
+	}
+	Report("SceneStore", clock.GetElapsedTime(), numUpdated);
+
+	// A few roots move: the old layout still recomputes everything, the store only their subtrees.
+	std::cout << "[*] " << SPARSE_ROOTS * (1 + CHILDREN_PER_ROOT) << " objects moving:" << std::endl;
+	clock.Reset();
+	for (int frame = 1; frame <= NUM_FRAMES; ++frame) {
+		for (int root = 0; root < SPARSE_ROOTS; ++root) {
+			rootObjects[root]->localMatrix = GetLocalMatrix(frame, root, true);
+		}
+		for (const auto& object : objects) {
+			object->Update();
+		}
+	}
+	Report("SceneObject per node", clock.GetElapsedTime(), numNodes * NUM_FRAMES);
+
+	numUpdated = 0;
+	clock.Reset();
+	for (int frame = 1; frame <= NUM_FRAMES; ++frame) {
+		for (int root = 0; root < SPARSE_ROOTS; ++root) {
+			store.SetLocalMatrix(rootNodes[root], GetLocalMatrix(frame, root, true));
+		}
+		store.UpdateTransforms();
+		numUpdated += store.GetNumUpdated();
+	}
+	Report("SceneStore", clock.GetElapsedTime(), numUpdated);
+
+	// Both layouts must agree, or the comparison means nothing.
+	for (size_t i = 0; i < numNodes; ++i) {
+		const glm::vec4 difference = objects[i]->worldMatrix[3] - store.GetWorldMatrix((SceneNodeId)i)[3];
+		if (glm::dot(difference, difference) > 1e-6f) {
+			std::cerr << "[ERROR] The layouts disagree at node " << i << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}